@@ -1,9 +1,9 @@
 // Character counter handler
 function handleInput(el) {
   const counter = document.getElementById('char-counter');
-  const remaining = 200 - el.value.length;
+  const remaining = 8000 - el.value.length;
   counter.textContent = `${remaining} characters left`;
-  if (remaining <= 20) {
+  if (remaining <= 200) {
     counter.style.color = 'var(--warning)';
   } else {
     counter.style.color = 'var(--accent-light)';
@@ -13,11 +13,19 @@ function handleInput(el) {
 // Form submission handler
 function handleSubmit(e) {
   e.preventDefault();
-  const formData = new FormData(e.target);
+  // The message goes as the request body, which the printer writes to
+  // flash as it arrives rather than holding it in RAM. Not as text/plain:
+  // the server would take "2+2=4" for a form field.
   fetch('/submit', {
     method: 'POST',
-    body: formData
-  }).then(() => {
+    headers: { 'Content-Type': 'application/octet-stream' },
+    body: document.getElementById('message').value
+  }).then(response => {
+    // Full print queue (429) or a message too long: keep the text
+    if (!response.ok) {
+      return response.text().then(text => alert(text));
+    }
+
     const textarea = document.getElementById('message');
     const message = document.getElementById('thank-you');
 
@@ -154,6 +162,29 @@ async function updateLogs() {
   }
 }
 
+// Update print queue progress from server
+async function updatePrinterStatus() {
+  try {
+    const response = await fetch('/api/printer');
+    const data = await response.json();
+    const elem = document.getElementById('printer-status');
+    if (data.problem) {
+      const remaining = data.jobsQueued - data.jobsCompleted;
+      elem.textContent = `Stopped: ${data.problem} (${remaining} job(s) waiting)`;
+    } else if (data.state === 'idle') {
+      elem.textContent = `Idle (${data.jobsCompleted} jobs printed)`;
+    } else {
+      const remaining = data.jobsQueued - data.jobsCompleted;
+      elem.textContent = `Printing ${remaining} job(s), ${data.pendingBytes} bytes left`;
+    }
+    if (data.paperNearEnd && !data.paperOut) {
+      elem.textContent += ' - paper running low';
+    }
+  } catch (e) {
+    console.error('Failed to fetch printer status:', e);
+  }
+}
+
 // Load schedule settings on page load
 async function loadScheduleSettings() {
   try {
@@ -204,10 +235,12 @@ function updateLastPrintInfo(lastDate) {
   }
 }
 
-// Auto-refresh logs every second
+// Auto-refresh logs and printer status every second
 setInterval(updateLogs, 1000);
+setInterval(updatePrinterStatus, 1000);
 
 // Initial fetches
 setTimeout(updateLogs, 100);
+setTimeout(updatePrinterStatus, 100);
 setTimeout(updateWifiInfo, 100);
 setTimeout(loadScheduleSettings, 100);
@@ -0,0 +1,65 @@
+#ifndef BYTE_IO_H
+#define BYTE_IO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Building blocks of the files kept on flash (print spool, joke bank,
+// history, recent jokes): little-endian fields, the CRC-16 that guards
+// their records and 64-bit FNV-1a hashes of joke text.
+//
+// Plain C++ only (no Arduino headers) so the same code runs in host tests.
+
+const uint16_t CRC16_INIT = 0xFFFF;
+const uint64_t FNV64_OFFSET = 0xcbf29ce484222325ULL;
+const uint64_t FNV64_PRIME = 0x100000001b3ULL;
+
+// CRC-16/CCITT-FALSE, continued from crc (CRC16_INIT to start)
+inline uint16_t crc16(uint16_t crc, const uint8_t *data, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+// FNV-1a, continued from hash (FNV64_OFFSET to start)
+inline uint64_t fnv1a64(uint64_t hash, const char *data, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    hash ^= (uint8_t)data[i];
+    hash *= FNV64_PRIME;
+  }
+  return hash;
+}
+
+inline void putU16(uint8_t *out, uint16_t value) {
+  out[0] = value & 0xFF;
+  out[1] = value >> 8;
+}
+
+inline void putU32(uint8_t *out, uint32_t value) {
+  for (int i = 0; i < 4; i++) {
+    out[i] = (value >> (8 * i)) & 0xFF;
+  }
+}
+
+inline void putU64(uint8_t *out, uint64_t value) {
+  putU32(out, (uint32_t)value);
+  putU32(out + 4, (uint32_t)(value >> 32));
+}
+
+inline uint16_t getU16(const uint8_t *in) {
+  return in[0] | (in[1] << 8);
+}
+
+inline uint32_t getU32(const uint8_t *in) {
+  return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+inline uint64_t getU64(const uint8_t *in) {
+  return (uint64_t)getU32(in) | ((uint64_t)getU32(in + 4) << 32);
+}
+
+#endif
@@ -0,0 +1,64 @@
+#include "config_store.h"
+
+ConfigStore::ConfigStore(ConfigStorage &storage, uint32_t settleMillis, uint32_t maxDelayMillis)
+  : storage(storage), settleMillis(settleMillis), maxDelayMillis(maxDelayMillis), pending(false),
+    firstChange(0), lastChange(0), changeCount(0), writeCount(0), failureCount(0) {}
+
+bool ConfigStore::load() {
+  pending = false;
+  if (storage.parse(CONFIG_CURRENT)) {
+    // A temp file next to it is a write that was cut short
+    if (storage.exists(CONFIG_TEMP)) {
+      storage.remove(CONFIG_TEMP);
+    }
+    return true;
+  }
+
+  // The old file already gone, the new one not yet renamed
+  if (storage.parse(CONFIG_TEMP)) {
+    if (!storage.replace()) {
+      changed(0);
+    }
+    return true;
+  }
+  storage.reset();
+  return false;
+}
+
+void ConfigStore::changed(uint32_t now) {
+  if (!pending) {
+    firstChange = now;
+  }
+  pending = true;
+  lastChange = now;
+  changeCount++;
+}
+
+uint32_t ConfigStore::dueIn(uint32_t now) const {
+  if (!pending) {
+    return 0;
+  }
+  uint32_t settled = now - lastChange;
+  uint32_t waited = now - firstChange;
+  if (settled >= settleMillis || waited >= maxDelayMillis) {
+    return 0;
+  }
+  uint32_t untilSettled = settleMillis - settled;
+  uint32_t untilLatest = maxDelayMillis - waited;
+  return untilSettled < untilLatest ? untilSettled : untilLatest;
+}
+
+bool ConfigStore::flush(uint32_t now) {
+  if (!pending) {
+    return true;
+  }
+  if (!storage.write() || !storage.replace()) {
+    failureCount++;
+    firstChange = now;
+    lastChange = now;
+    return false;
+  }
+  writeCount++;
+  pending = false;
+  return true;
+}
@@ -0,0 +1,140 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The settings file (config.json), read once at boot and kept in RAM.
+//
+// Changes are made to the settings in RAM and announced with changed().
+// They go to flash once no other change came for settleMillis, and at the
+// latest maxDelayMillis after the first one, so a burst of changes is one
+// write. Settings that must not wait (WiFi credentials before a restart)
+// are written with flush() straight away.
+//
+// A write never touches the current file: the settings go to a temp file,
+// which then takes the current one's place. A reset before that keeps the
+// old settings; load() drops the partial temp file. Where the rename
+// removes the old file first, a reset in between leaves only the temp
+// file, which load() takes if it is complete.
+//
+// Plain C++ only (no Arduino headers) so the same code runs in host tests.
+
+const uint32_t CONFIG_SETTLE_MILLIS = 2000;
+const uint32_t CONFIG_MAX_DELAY_MILLIS = 10000;
+
+enum ConfigFile : uint8_t {
+  CONFIG_CURRENT,
+  CONFIG_TEMP
+};
+
+// The settings and their files. JSON on LittleFS on the device; host tests
+// use memory and inject resets at every write.
+class ConfigStorage {
+public:
+  virtual ~ConfigStorage() {}
+
+  // Read a file into the settings in RAM. False if it is missing or
+  // incomplete, the settings then undefined until reset() or another parse().
+  virtual bool parse(ConfigFile file) = 0;
+
+  // Settings as if there was no file
+  virtual void reset() = 0;
+
+  // Write the settings to the temp file from scratch, then put it in the
+  // current file's place
+  virtual bool write() = 0;
+  virtual bool replace() = 0;
+
+  virtual bool exists(ConfigFile file) = 0;
+  virtual void remove(ConfigFile file) = 0;
+};
+
+class ConfigStore {
+public:
+  explicit ConfigStore(ConfigStorage &storage, uint32_t settleMillis = CONFIG_SETTLE_MILLIS,
+                       uint32_t maxDelayMillis = CONFIG_MAX_DELAY_MILLIS);
+
+  // Once at boot. False if no file could be read: the settings are the
+  // defaults then.
+  bool load();
+
+  // The settings in RAM were changed
+  void changed(uint32_t now);
+
+  bool dirty() const { return pending; }
+
+  // Milliseconds until the changes are due to be written, 0 once they are
+  // (or if there are none)
+  uint32_t dueIn(uint32_t now) const;
+
+  // Write the changes now. False if that failed: they stay pending and
+  // are due again after settleMillis.
+  bool flush(uint32_t now);
+
+  uint32_t changes() const { return changeCount; }  // changed() calls
+  uint32_t writes() const { return writeCount; }    // Files written
+  uint32_t failures() const { return failureCount; }
+
+private:
+  ConfigStorage &storage;
+  uint32_t settleMillis;
+  uint32_t maxDelayMillis;
+  bool pending;
+  uint32_t firstChange;   // Of the changes not yet written
+  uint32_t lastChange;
+  uint32_t changeCount;
+  uint32_t writeCount;
+  uint32_t failureCount;
+};
+
+#ifdef ARDUINO
+#include <LittleFS.h>
+#include <ArduinoJson.h>
+
+// The settings as a JSON document in config.json
+class LittleFSConfigStorage : public ConfigStorage {
+public:
+  LittleFSConfigStorage(JsonDocument &doc, const char *path, const char *tempPath)
+    : doc(doc), paths{path, tempPath} {}
+
+  bool parse(ConfigFile file) override {
+    File handle = LittleFS.open(paths[file], "r");
+    if (!handle) {
+      return false;
+    }
+    DeserializationError error = deserializeJson(doc, handle);
+    handle.close();
+    return !error && doc.is<JsonObject>();
+  }
+
+  void reset() override {
+    doc.clear();
+  }
+
+  bool write() override {
+    File handle = LittleFS.open(paths[CONFIG_TEMP], "w");
+    bool written = handle && serializeJson(doc, handle) > 0;
+    handle.close();
+    return written;
+  }
+
+  bool replace() override {
+    return LittleFS.rename(paths[CONFIG_TEMP], paths[CONFIG_CURRENT]);
+  }
+
+  bool exists(ConfigFile file) override {
+    return LittleFS.exists(paths[file]);
+  }
+
+  void remove(ConfigFile file) override {
+    LittleFS.remove(paths[file]);
+  }
+
+private:
+  JsonDocument &doc;
+  const char *paths[2];
+};
+#endif
+
+#endif
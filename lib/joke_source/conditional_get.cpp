@@ -0,0 +1,50 @@
+#include "conditional_get.h"
+#include <string.h>
+#include <strings.h>
+
+// Keeps value if it fits, otherwise nothing
+static void keep(char *field, const char *value) {
+  size_t length = value ? strlen(value) : 0;
+  if (length > VALIDATOR_MAX) {
+    length = 0;
+  }
+  memcpy(field, value ? value : "", length);
+  field[length] = '\0';
+}
+
+ConditionalGet::ConditionalGet() {
+  clear();
+}
+
+void ConditionalGet::clear() {
+  etag[0] = '\0';
+  lastModified[0] = '\0';
+}
+
+void ConditionalGet::restore(const char *etagValue, const char *lastModifiedValue) {
+  keep(etag, etagValue);
+  keep(lastModified, lastModifiedValue);
+}
+
+ConditionalResult ConditionalGet::response(int code) {
+  if (code == 200) {
+    clear();
+    return CONDITIONAL_CONTENT;
+  }
+  if (code == 304 && conditional()) {
+    return CONDITIONAL_NOT_MODIFIED;
+  }
+  return CONDITIONAL_FAILED;
+}
+
+void ConditionalGet::header(const char *name, const char *value) {
+  // A 304 may carry updated validators too; empty ones don't replace
+  if (!value || value[0] == '\0') {
+    return;
+  }
+  if (strcasecmp(name, "ETag") == 0) {
+    keep(etag, value);
+  } else if (strcasecmp(name, "Last-Modified") == 0) {
+    keep(lastModified, value);
+  }
+}
@@ -0,0 +1,58 @@
+#ifndef CONDITIONAL_GET_H
+#define CONDITIONAL_GET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Validators for a conditional GET of the joke source.
+//
+// The ETag and Last-Modified of the cached page are sent back as
+// If-None-Match and If-Modified-Since. A server that still has the same
+// page answers 304 without a body, and the cached joke is used again
+// without downloading or parsing anything. Validators only make sense
+// together with the joke they came with, so they are stored in the joke
+// cache and restored from there.
+//
+// Plain C++ only (no Arduino headers) so the same code runs in host tests.
+
+const size_t VALIDATOR_MAX = 96;  // Longer values aren't kept (the next fetch is unconditional)
+
+enum ConditionalResult {
+  CONDITIONAL_CONTENT,        // 200, parse the body
+  CONDITIONAL_NOT_MODIFIED,   // 304, the cached joke is current
+  CONDITIONAL_FAILED          // Anything else
+};
+
+class ConditionalGet {
+public:
+  ConditionalGet();
+
+  // Forget both, e.g. when the cached joke is gone
+  void clear();
+
+  // From the joke cache (null or "" for a missing one)
+  void restore(const char *etag, const char *lastModified);
+
+  // Request header values, "" when there is nothing to send
+  const char *ifNoneMatch() const { return etag; }
+  const char *ifModifiedSince() const { return lastModified; }
+  bool conditional() const { return etag[0] != '\0' || lastModified[0] != '\0'; }
+
+  // Status code of the response. A 200 drops the old validators, header()
+  // then takes the new ones. A 304 is only expected after a conditional
+  // request.
+  ConditionalResult response(int code);
+
+  // A response header; ETag and Last-Modified (any case) are kept
+  void header(const char *name, const char *value);
+
+  // To store with the joke
+  const char *storedETag() const { return etag; }
+  const char *storedLastModified() const { return lastModified; }
+
+private:
+  char etag[VALIDATOR_MAX + 1];
+  char lastModified[VALIDATOR_MAX + 1];
+};
+
+#endif
@@ -0,0 +1,329 @@
+#include "joke_bank.h"
+#include <string.h>
+#include "byte_io.h"
+#include "joke_limits.h"
+
+static const char BANK_MAGIC[4] = {'J', 'B', 'N', 'K'};
+
+static bool optionsValid(const BankOptions &options) {
+  return options.windowBits >= BANK_WINDOW_BITS_MIN && options.windowBits <= BANK_WINDOW_BITS_MAX &&
+         options.lengthBits >= BANK_LENGTH_BITS_MIN && options.lengthBits <= BANK_LENGTH_BITS_MAX &&
+         options.jokesPerBlock > 0;
+}
+
+static size_t indexSize(uint16_t blocks) {
+  return 4 * ((size_t)blocks + 1);
+}
+
+uint8_t bankMinimumMatch(const BankOptions &options) {
+  // A copy costs 1 + windowBits + lengthBits bits, a literal 9
+  return (1 + options.windowBits + options.lengthBits) / 9 + 1;
+}
+
+// === Reading ===
+
+// Decoder state, on the stack for one read()
+struct BankDecoder {
+  BankStorage *storage;
+  size_t offset;        // Next byte of the block to load
+  size_t end;           // End of the block
+  uint8_t buffer[BANK_READ_CHUNK];
+  uint8_t bufferLength;
+  uint8_t bufferPosition;
+  uint8_t bits;         // Current byte, consumed from the top
+  uint8_t bitsLeft;
+
+  uint8_t window[1 << BANK_WINDOW_BITS_MAX];
+  uint16_t windowMask;
+  uint32_t produced;
+
+  uint8_t skip;         // Jokes before the wanted one in this block
+  bool done;
+  bool tooLong;         // More than JOKE_MAX_LENGTH bytes, the bank is damaged
+  size_t length;        // Of the wanted joke so far
+  char piece[32];       // Passed to the sink when full
+  uint8_t pieceLength;
+  BankTextSink sink;
+  void *context;
+
+  // The next bits, most significant first; -1 past the end of the block
+  int32_t readBits(uint8_t count) {
+    int32_t value = 0;
+    while (count-- > 0) {
+      if (bitsLeft == 0) {
+        if (bufferPosition == bufferLength) {
+          size_t want = end - offset < BANK_READ_CHUNK ? end - offset : BANK_READ_CHUNK;
+          if (want == 0 || storage->read(offset, buffer, want) != want) {
+            return -1;
+          }
+          offset += want;
+          bufferLength = want;
+          bufferPosition = 0;
+        }
+        bits = buffer[bufferPosition++];
+        bitsLeft = 8;
+      }
+      value = (value << 1) | (bits >> 7);
+      bits <<= 1;
+      bitsLeft--;
+    }
+    return value;
+  }
+
+  void flush() {
+    if (pieceLength > 0) {
+      sink(piece, pieceLength, context);
+      pieceLength = 0;
+    }
+  }
+
+  void emit(uint8_t c) {
+    window[produced & windowMask] = c;
+    produced++;
+    if (skip > 0) {
+      skip -= c == 0 ? 1 : 0;
+      return;
+    }
+    if (c == 0) {
+      flush();
+      done = true;
+      return;
+    }
+    if (length == JOKE_MAX_LENGTH) {
+      tooLong = true;
+      return;
+    }
+    length++;
+    piece[pieceLength++] = (char)c;
+    if (pieceLength == sizeof(piece)) {
+      flush();
+    }
+  }
+};
+
+JokeBank::JokeBank(BankStorage &storage)
+  : storage(storage), bankOptions(BANK_DEFAULT_OPTIONS), jokeCount(0), blockCount(0), valid(false) {}
+
+size_t JokeBank::decoderSize() {
+  return sizeof(BankDecoder);
+}
+
+bool JokeBank::open() {
+  valid = false;
+  jokeCount = 0;
+  size_t fileSize = storage.size();
+  uint8_t header[BANK_HEADER_SIZE];
+  if (fileSize < BANK_HEADER_SIZE || storage.read(0, header, sizeof(header)) != sizeof(header) ||
+      memcmp(header, BANK_MAGIC, 4) != 0 || header[4] != BANK_VERSION) {
+    storage.release();
+    return false;
+  }
+  BankOptions options = {header[5], header[6], header[7]};
+  uint16_t jokes = getU16(header + 8);
+  uint16_t blocks = getU16(header + 10);
+  uint16_t expectedCrc = getU16(header + 12);
+  if (!optionsValid(options) || jokes == 0 ||
+      blocks != (jokes + options.jokesPerBlock - 1) / options.jokesPerBlock ||
+      fileSize < BANK_HEADER_SIZE + indexSize(blocks)) {
+    storage.release();
+    return false;
+  }
+
+  // Offsets rise from the end of the index to at most the end of the file
+  uint16_t crc = CRC16_INIT;
+  uint32_t previous = BANK_HEADER_SIZE + indexSize(blocks);
+  uint8_t entries[BANK_READ_CHUNK];
+  bool ordered = true;
+  for (size_t at = 0; at < indexSize(blocks) && ordered; at += sizeof(entries)) {
+    size_t want = indexSize(blocks) - at < sizeof(entries) ? indexSize(blocks) - at : sizeof(entries);
+    if (storage.read(BANK_HEADER_SIZE + at, entries, want) != want) {
+      ordered = false;
+      break;
+    }
+    crc = crc16(crc, entries, want);
+    for (size_t i = 0; i < want; i += 4) {
+      uint32_t offset = getU32(entries + i);
+      bool first = at + i == 0;
+      ordered = ordered && (first ? offset == previous : offset > previous) && offset <= fileSize;
+      previous = offset;
+    }
+  }
+  storage.release();
+  if (!ordered || crc != expectedCrc) {
+    return false;
+  }
+
+  bankOptions = options;
+  jokeCount = jokes;
+  blockCount = blocks;
+  valid = true;
+  return true;
+}
+
+bool JokeBank::read(uint16_t index, BankTextSink sink, void *context) {
+  if (!valid || index >= jokeCount) {
+    return false;
+  }
+  uint16_t block = index / bankOptions.jokesPerBlock;
+  uint8_t offsets[8];
+  if (storage.read(BANK_HEADER_SIZE + 4 * (size_t)block, offsets, sizeof(offsets)) != sizeof(offsets)) {
+    storage.release();
+    return false;
+  }
+
+  BankDecoder decoder;
+  decoder.storage = &storage;
+  decoder.offset = getU32(offsets);
+  decoder.end = getU32(offsets + 4);
+  decoder.bufferLength = 0;
+  decoder.bufferPosition = 0;
+  decoder.bitsLeft = 0;
+  decoder.windowMask = (1 << bankOptions.windowBits) - 1;
+  decoder.produced = 0;
+  decoder.skip = index % bankOptions.jokesPerBlock;
+  decoder.done = false;
+  decoder.tooLong = false;
+  decoder.length = 0;
+  decoder.pieceLength = 0;
+  decoder.sink = sink;
+  decoder.context = context;
+
+  uint8_t minimum = bankMinimumMatch(bankOptions);
+  bool damaged = false;
+  while (!decoder.done && !damaged) {
+    int32_t literal = decoder.readBits(1);
+    if (literal == 1) {
+      int32_t c = decoder.readBits(8);
+      damaged = c < 0;
+      if (!damaged) {
+        decoder.emit((uint8_t)c);
+      }
+    } else if (literal == 0) {
+      int32_t distance = decoder.readBits(bankOptions.windowBits);
+      int32_t length = decoder.readBits(bankOptions.lengthBits);
+      damaged = distance < 0 || length < 0 || (uint32_t)distance + 1 > decoder.produced;
+      for (int32_t i = 0; !damaged && !decoder.done && !decoder.tooLong && i < length + minimum; i++) {
+        decoder.emit(decoder.window[(decoder.produced - distance - 1) & decoder.windowMask]);
+      }
+    } else {
+      damaged = true;
+    }
+    damaged = damaged || decoder.tooLong;
+  }
+  storage.release();
+  return decoder.done && !damaged;
+}
+
+// === Building ===
+
+struct BitWriter {
+  uint8_t *output;
+  size_t capacity;
+  size_t length;
+  uint8_t bitsUsed;  // In the last byte
+  bool overflow;
+
+  void write(uint32_t value, uint8_t count) {
+    while (count-- > 0) {
+      if (bitsUsed == 0) {
+        if (length == capacity) {
+          overflow = true;
+          return;
+        }
+        output[length++] = 0;
+      }
+      output[length - 1] |= ((value >> count) & 1) << (7 - bitsUsed);
+      bitsUsed = (bitsUsed + 1) & 7;
+    }
+  }
+};
+
+size_t bankCompress(const uint8_t *input, size_t length, const BankOptions &options,
+                    uint8_t *output, size_t capacity) {
+  if (!optionsValid(options)) {
+    return 0;
+  }
+  BitWriter writer = {output, capacity, 0, 0, false};
+  size_t window = (size_t)1 << options.windowBits;
+  size_t minimum = bankMinimumMatch(options);
+  size_t longest = ((size_t)1 << options.lengthBits) - 1 + minimum;
+
+  size_t position = 0;
+  while (position < length && !writer.overflow) {
+    // Longest earlier match in the window, the nearest one of equal length
+    size_t bestLength = 0;
+    size_t bestDistance = 0;
+    size_t first = position > window ? position - window : 0;
+    for (size_t candidate = position; candidate-- > first;) {
+      size_t matched = 0;
+      while (matched < longest && position + matched < length &&
+             input[candidate + matched] == input[position + matched]) {
+        matched++;
+      }
+      if (matched > bestLength) {
+        bestLength = matched;
+        bestDistance = position - candidate;
+      }
+    }
+
+    if (bestLength >= minimum) {
+      writer.write(0, 1);
+      writer.write(bestDistance - 1, options.windowBits);
+      writer.write(bestLength - minimum, options.lengthBits);
+      position += bestLength;
+    } else {
+      writer.write(1, 1);
+      writer.write(input[position], 8);
+      position++;
+    }
+  }
+  return writer.overflow ? 0 : writer.length;
+}
+
+size_t buildJokeBank(const char *const *jokes, uint16_t count, const BankOptions &options,
+                     uint8_t *output, size_t capacity) {
+  if (!optionsValid(options) || count == 0) {
+    return 0;
+  }
+  for (uint16_t i = 0; i < count; i++) {
+    size_t length = strlen(jokes[i]);
+    if (length == 0 || length > JOKE_MAX_LENGTH) {
+      return 0;
+    }
+  }
+  uint16_t blocks = (count + options.jokesPerBlock - 1) / options.jokesPerBlock;
+  size_t position = BANK_HEADER_SIZE + indexSize(blocks);
+  if (position > capacity) {
+    return 0;
+  }
+
+  uint8_t *plain = new uint8_t[(size_t)options.jokesPerBlock * (JOKE_MAX_LENGTH + 1)];
+  for (uint16_t block = 0; block < blocks; block++) {
+    size_t plainLength = 0;
+    for (uint16_t i = block * options.jokesPerBlock; i < count && i < (block + 1) * options.jokesPerBlock; i++) {
+      size_t length = strlen(jokes[i]);
+      memcpy(plain + plainLength, jokes[i], length + 1);
+      plainLength += length + 1;
+    }
+    putU32(output + BANK_HEADER_SIZE + 4 * (size_t)block, position);
+    size_t packed = bankCompress(plain, plainLength, options, output + position, capacity - position);
+    if (packed == 0) {
+      delete[] plain;
+      return 0;
+    }
+    position += packed;
+  }
+  delete[] plain;
+  putU32(output + BANK_HEADER_SIZE + 4 * (size_t)blocks, position);
+
+  memcpy(output, BANK_MAGIC, 4);
+  output[4] = BANK_VERSION;
+  output[5] = options.windowBits;
+  output[6] = options.lengthBits;
+  output[7] = options.jokesPerBlock;
+  putU16(output + 8, count);
+  putU16(output + 10, blocks);
+  putU16(output + 12, crc16(CRC16_INIT, output + BANK_HEADER_SIZE, indexSize(blocks)));
+  putU16(output + 14, 0);
+  return position;
+}
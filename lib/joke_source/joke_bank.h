@@ -0,0 +1,134 @@
+#ifndef JOKE_BANK_H
+#define JOKE_BANK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Jokes shipped in the LittleFS image, printed when none can be fetched.
+//
+// The bank is one file: a header, an index of block offsets and the
+// blocks. Each block holds a fixed number of jokes, each followed by a
+// 0 byte, compressed on its own with LZSS in the style of heatshrink: a
+// bit 1 and 8 bits for a literal, a bit 0, distance - 1 and length -
+// minimum for a copy from the last 2^windowBits bytes of the block. Any
+// joke is read by looking up its block in the index and decoding that
+// block up to the joke, with a window and a small read buffer on the stack
+// and nothing on the heap.
+//
+//   0  "JBNK", version, windowBits, lengthBits, jokes per block
+//   8  joke count (uint16 LE), block count (uint16 LE),
+//      CRC-16 of the index, 0 (uint16)
+//  16  block offsets from the start of the file (uint32 LE), one more
+//      than there are blocks so the last one has an end
+//
+// Banks are built on the host (tests/bench_joke_bank.cpp writes
+// data/jokes.bin from assets/jokes.txt).
+//
+// Plain C++ only (no Arduino headers) so the same code runs in host tests.
+
+const size_t BANK_HEADER_SIZE = 16;
+const uint8_t BANK_VERSION = 1;
+const uint8_t BANK_WINDOW_BITS_MIN = 6;
+const uint8_t BANK_WINDOW_BITS_MAX = 9;   // The decoder's window is 512 bytes at most
+const uint8_t BANK_LENGTH_BITS_MIN = 3;
+const uint8_t BANK_LENGTH_BITS_MAX = 6;
+const size_t BANK_READ_CHUNK = 64;
+
+struct BankOptions {
+  uint8_t windowBits;
+  uint8_t lengthBits;
+  uint8_t jokesPerBlock;
+};
+
+const BankOptions BANK_DEFAULT_OPTIONS = {8, 4, 8};
+
+// The bank file. LittleFS on the device; host tests and the build tool use
+// memory.
+class BankStorage {
+public:
+  virtual ~BankStorage() {}
+  virtual size_t size() = 0;
+  virtual size_t read(size_t offset, uint8_t *data, size_t length) = 0;
+  virtual void release() {}  // Done reading for now, e.g. close the file
+};
+
+// Receives a joke in pieces as it is decoded
+typedef void (*BankTextSink)(const char *data, size_t length, void *context);
+
+class JokeBank {
+public:
+  explicit JokeBank(BankStorage &storage);
+
+  // Read and check header and index. False without a usable bank.
+  bool open();
+
+  uint16_t count() const { return jokeCount; }
+  const BankOptions &options() const { return bankOptions; }
+
+  // Decode joke number index into sink. Returns false, with nothing or
+  // part of the joke passed on, if the bank is damaged.
+  bool read(uint16_t index, BankTextSink sink, void *context);
+
+  // Bytes of stack read() uses for its window and buffer
+  static size_t decoderSize();
+
+private:
+  BankStorage &storage;
+  BankOptions bankOptions;
+  uint16_t jokeCount;
+  uint16_t blockCount;
+  bool valid;
+};
+
+// === Building (host side) ===
+
+// Smallest copy worth a reference rather than literals
+uint8_t bankMinimumMatch(const BankOptions &options);
+
+// Compress one block. Returns the compressed size, 0 if it doesn't fit.
+size_t bankCompress(const uint8_t *input, size_t length, const BankOptions &options,
+                    uint8_t *output, size_t capacity);
+
+// A whole bank file from count jokes of at most JOKE_MAX_LENGTH bytes and
+// without 0 bytes. Returns its size, 0 on bad input or if it doesn't fit.
+size_t buildJokeBank(const char *const *jokes, uint16_t count, const BankOptions &options,
+                     uint8_t *output, size_t capacity);
+
+#ifdef ARDUINO
+#include <LittleFS.h>
+
+// The bank as a LittleFS file, kept open while a joke is decoded
+class LittleFSBankStorage : public BankStorage {
+public:
+  explicit LittleFSBankStorage(const char *path) : path(path) {}
+
+  size_t size() override {
+    File bank = LittleFS.open(path, "r");
+    size_t length = bank ? bank.size() : 0;
+    bank.close();
+    return length;
+  }
+
+  size_t read(size_t offset, uint8_t *data, size_t length) override {
+    if (!file) {
+      file = LittleFS.open(path, "r");
+    }
+    if (!file || !file.seek(offset)) {
+      return 0;
+    }
+    return file.read(data, length);
+  }
+
+  void release() override {
+    if (file) {
+      file.close();
+    }
+  }
+
+private:
+  const char *path;
+  File file;
+};
+#endif
+
+#endif
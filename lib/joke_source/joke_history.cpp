@@ -0,0 +1,317 @@
+#include "joke_history.h"
+#include <string.h>
+#include "byte_io.h"
+
+static const uint8_t RECORD_MAGIC = 0xB7;
+static const size_t RECORD_HEADER = 15;   // Magic, date, hash, length
+static const size_t RECORD_CRC = 2;
+
+uint64_t historyHash(const char *text, size_t length) {
+  return fnv1a64(FNV64_OFFSET, text, length);
+}
+
+bool parseHistoryDate(const char *text, uint32_t &date) {
+  if (text == nullptr || strlen(text) != 10 || text[4] != '-' || text[7] != '-') {
+    return false;
+  }
+  uint32_t parts[3] = {0, 0, 0};
+  const uint8_t starts[3] = {0, 5, 8};
+  const uint8_t lengths[3] = {4, 2, 2};
+  for (int part = 0; part < 3; part++) {
+    for (uint8_t i = 0; i < lengths[part]; i++) {
+      char c = text[starts[part] + i];
+      if (c < '0' || c > '9') {
+        return false;
+      }
+      parts[part] = parts[part] * 10 + (c - '0');
+    }
+  }
+  if (parts[1] < 1 || parts[1] > 12 || parts[2] < 1 || parts[2] > 31) {
+    return false;
+  }
+  date = parts[0] * 10000 + parts[1] * 100 + parts[2];
+  return true;
+}
+
+void formatHistoryDate(uint32_t date, char *out) {
+  uint32_t year = date / 10000 % 10000;
+  uint32_t month = date / 100 % 100;
+  uint32_t day = date % 100;
+  const uint32_t values[3] = {year, month, day};
+  const uint8_t widths[3] = {4, 2, 2};
+  size_t at = 0;
+  for (int part = 0; part < 3; part++) {
+    uint32_t value = values[part];
+    for (int i = widths[part] - 1; i >= 0; i--) {
+      out[at + i] = '0' + value % 10;
+      value /= 10;
+    }
+    at += widths[part];
+    if (part < 2) {
+      out[at++] = '-';
+    }
+  }
+  out[at] = '\0';
+}
+
+JokeHistory::JokeHistory(HistoryStorage &storage, size_t budget)
+  : storage(storage), budget(budget), entries(0), logSize(0), compactionCount(0), failed(false) {}
+
+// === Reading ===
+
+bool JokeHistory::readRecord(uint32_t offset, HistoryEntry &result, bool checkText) {
+  if (offset + RECORD_HEADER > logSize ||
+      storage.read(HISTORY_LOG, offset, buffer, RECORD_HEADER) != RECORD_HEADER || buffer[0] != RECORD_MAGIC) {
+    return false;
+  }
+  result.date = getU32(buffer + 1);
+  result.hash = getU64(buffer + 5);
+  result.length = getU16(buffer + 13);
+  result.offset = offset;
+  if (result.length == 0 || offset + RECORD_HEADER + result.length + RECORD_CRC > logSize) {
+    return false;
+  }
+  if (!checkText) {
+    return true;
+  }
+
+  uint16_t crc = crc16(CRC16_INIT, buffer, RECORD_HEADER);
+  size_t done = 0;
+  while (done < result.length) {
+    size_t want = result.length - done < sizeof(buffer) ? result.length - done : sizeof(buffer);
+    if (storage.read(HISTORY_LOG, offset + RECORD_HEADER + done, buffer, want) != want) {
+      return false;
+    }
+    crc = crc16(crc, buffer, want);
+    done += want;
+  }
+  return storage.read(HISTORY_LOG, offset + RECORD_HEADER + done, buffer, RECORD_CRC) == RECORD_CRC &&
+         getU16(buffer) == crc;
+}
+
+bool JokeHistory::readIndex(uint32_t position, uint32_t &date, uint32_t &offset) {
+  uint8_t raw[HISTORY_INDEX_ENTRY];
+  if (position >= entries ||
+      storage.read(HISTORY_INDEX, (size_t)position * HISTORY_INDEX_ENTRY, raw, sizeof(raw)) != sizeof(raw)) {
+    return false;
+  }
+  date = getU32(raw);
+  offset = getU32(raw + 4);
+  return true;
+}
+
+bool JokeHistory::entry(uint32_t position, HistoryEntry &result) {
+  uint32_t date;
+  uint32_t offset;
+  return readIndex(position, date, offset) && readRecord(offset, result, false) && result.date == date;
+}
+
+uint32_t JokeHistory::countBefore(uint32_t before) {
+  if (before == 0) {
+    return entries;
+  }
+  // First position dated before or after `before`
+  uint32_t low = 0;
+  uint32_t high = entries;
+  while (low < high) {
+    uint32_t middle = low + (high - low) / 2;
+    uint32_t date;
+    uint32_t offset;
+    if (!readIndex(middle, date, offset)) {
+      return 0;
+    }
+    if (date < before) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+bool JokeHistory::find(uint32_t date, HistoryEntry &result) {
+  uint32_t position = countBefore(date + 1);
+  return position > 0 && entry(position - 1, result) && result.date == date;
+}
+
+bool JokeHistory::readText(const HistoryEntry &entry, HistoryTextSink sink, void *context) {
+  size_t done = 0;
+  while (done < entry.length) {
+    size_t want = entry.length - done < sizeof(buffer) ? entry.length - done : sizeof(buffer);
+    if (storage.read(HISTORY_LOG, entry.offset + RECORD_HEADER + done, buffer, want) != want) {
+      return false;
+    }
+    sink((const char *)buffer, want, context);
+    done += want;
+  }
+  return true;
+}
+
+size_t JokeHistory::readText(const HistoryEntry &entry, size_t from, char *out, size_t length) {
+  if (from >= entry.length) {
+    return 0;
+  }
+  size_t want = entry.length - from < length ? entry.length - from : length;
+  return storage.read(HISTORY_LOG, entry.offset + RECORD_HEADER + from, (uint8_t *)out, want) == want ? want : 0;
+}
+
+// === Recovery ===
+
+// Index the complete records from `from` on; returns where they end
+uint32_t JokeHistory::scanLog(uint32_t from) {
+  uint32_t position = from;
+  HistoryEntry record;
+  while (position < logSize && readRecord(position, record, true)) {
+    if (!appendIndex(record.date, position)) {
+      failed = true;
+      break;
+    }
+    entries++;
+    position += HISTORY_RECORD_OVERHEAD + record.length;
+  }
+  return position;
+}
+
+uint32_t JokeHistory::recover() {
+  failed = false;
+  logSize = storage.size(HISTORY_LOG);
+  size_t indexBytes = storage.size(HISTORY_INDEX);
+  size_t whole = indexBytes - indexBytes % HISTORY_INDEX_ENTRY;
+  if (whole != indexBytes) {
+    storage.truncate(HISTORY_INDEX, whole);
+  }
+  entries = whole / HISTORY_INDEX_ENTRY;
+
+  // The first entry must be the log's first record and the last one a
+  // complete record, or the index is rebuilt from the log
+  uint32_t indexed = 0;
+  if (entries > 0) {
+    uint32_t firstDate, firstOffset, lastDate, lastOffset;
+    HistoryEntry first, last;
+    bool consistent = readIndex(0, firstDate, firstOffset) && readIndex(entries - 1, lastDate, lastOffset) &&
+                      firstOffset == 0 && readRecord(0, first, false) && first.date == firstDate &&
+                      readRecord(lastOffset, last, true) && last.date == lastDate;
+    if (consistent) {
+      indexed = lastOffset + HISTORY_RECORD_OVERHEAD + last.length;
+    } else {
+      storage.truncate(HISTORY_INDEX, 0);
+      entries = 0;
+    }
+  }
+
+  // Records after the last indexed one, then cut off what isn't complete
+  uint32_t end = scanLog(indexed);
+  if (end < logSize) {
+    storage.truncate(HISTORY_LOG, end);
+    logSize = end;
+  }
+  return entries;
+}
+
+// === Writing ===
+
+bool JokeHistory::appendIndex(uint32_t date, uint32_t offset) {
+  uint8_t raw[HISTORY_INDEX_ENTRY];
+  putU32(raw, date);
+  putU32(raw + 4, offset);
+  return storage.append(HISTORY_INDEX, raw, sizeof(raw));
+}
+
+bool JokeHistory::append(uint32_t date, const char *text, size_t length) {
+  if (length == 0 || length > 0xFFFF) {
+    return false;
+  }
+  uint64_t hash = historyHash(text, length);
+  HistoryEntry last;
+  if (entries > 0 && entry(entries - 1, last)) {
+    if (date < last.date) {
+      return false;
+    }
+    if (date == last.date && hash == last.hash && length == last.length) {
+      return true;
+    }
+  }
+
+  size_t size = HISTORY_RECORD_OVERHEAD + length;
+  if (logSize + size > budget) {
+    compact(size);
+  }
+
+  uint8_t header[RECORD_HEADER];
+  header[0] = RECORD_MAGIC;
+  putU32(header + 1, date);
+  putU64(header + 5, hash);
+  putU16(header + 13, length);
+  uint8_t crc[RECORD_CRC];
+  putU16(crc, crc16(crc16(CRC16_INIT, header, sizeof(header)), (const uint8_t *)text, length));
+
+  // The index entry only once the record is complete
+  uint32_t offset = logSize;
+  if (!storage.append(HISTORY_LOG, header, sizeof(header)) ||
+      !storage.append(HISTORY_LOG, (const uint8_t *)text, length) ||
+      !storage.append(HISTORY_LOG, crc, sizeof(crc)) || !appendIndex(date, offset)) {
+    recover();
+    failed = true;
+    return false;
+  }
+  logSize += size;
+  entries++;
+  return true;
+}
+
+// Copy a record into the new log during compaction
+bool JokeHistory::copyRecord(const HistoryEntry &entry) {
+  size_t size = HISTORY_RECORD_OVERHEAD + entry.length;
+  for (size_t done = 0; done < size;) {
+    size_t want = size - done < sizeof(buffer) ? size - done : sizeof(buffer);
+    if (storage.read(HISTORY_LOG, entry.offset + done, buffer, want) != want ||
+        !storage.append(HISTORY_LOG, buffer, want)) {
+      return false;
+    }
+    done += want;
+  }
+  return true;
+}
+
+// Keep the newest records that, with the incoming one, fill half the budget
+void JokeHistory::compact(size_t incoming) {
+  uint32_t keepFrom = entries;
+  size_t kept = incoming;
+  HistoryEntry record;
+  while (keepFrom > 0 && entry(keepFrom - 1, record)) {
+    size_t size = HISTORY_RECORD_OVERHEAD + record.length;
+    if (kept + size > budget / 2) {
+      break;
+    }
+    kept += size;
+    keepFrom--;
+  }
+  compactionCount++;
+
+  if (keepFrom == entries) {
+    // Nothing fits beside the new record
+    storage.truncate(HISTORY_INDEX, 0);
+    storage.truncate(HISTORY_LOG, 0);
+    recover();
+    return;
+  }
+
+  if (!storage.beginRewrite()) {
+    failed = true;
+    return;
+  }
+  uint32_t offset = 0;
+  bool copied = true;
+  for (uint32_t position = keepFrom; position < entries && copied; position++) {
+    copied = entry(position, record) && copyRecord(record) && appendIndex(record.date, offset);
+    offset += HISTORY_RECORD_OVERHEAD + record.length;
+  }
+  if (!copied) {
+    storage.abortRewrite();
+    failed = true;
+    return;
+  }
+  bool committed = storage.commitRewrite();
+  recover();
+  failed = !committed;
+}
@@ -0,0 +1,189 @@
+#ifndef JOKE_HISTORY_H
+#define JOKE_HISTORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Every day's joke, kept on flash so past jokes can be listed and printed
+// again.
+//
+// Two append-only files. The log holds the records:
+//   0xB7, date (uint32 LE, YYYYMMDD), hash (uint64 LE), text length
+//   (uint16 LE), text, CRC-16 of all before
+// and the index one fixed 8-byte entry per record, date and log offset,
+// in the order appended. Dates only go forward, so the index is sorted and
+// a date is found by binary search, then its record read with one seek.
+//
+// The log is the truth, the index can always be rebuilt from it. A reset
+// mid-append leaves a partial record or entry; recover() cuts it off and
+// indexes a record that reached the log but not the index. When the log
+// would pass its budget, the newest records that fill half of it are
+// copied to new files, which then replace the old ones (log first; an
+// index left over from before is noticed and rebuilt).
+//
+// Plain C++ only (no Arduino headers) so the same code runs in host tests.
+
+const size_t HISTORY_BUDGET = 16 * 1024;   // Log size that triggers compaction
+const size_t HISTORY_RECORD_OVERHEAD = 17; // Header and CRC around the text
+const size_t HISTORY_INDEX_ENTRY = 8;
+
+enum HistoryFile : uint8_t {
+  HISTORY_LOG,
+  HISTORY_INDEX
+};
+
+// The two files. LittleFS on the device; host tests use memory and inject
+// resets at every byte.
+class HistoryStorage {
+public:
+  virtual ~HistoryStorage() {}
+  virtual size_t size(HistoryFile file) = 0;
+  virtual size_t read(HistoryFile file, size_t offset, uint8_t *data, size_t length) = 0;
+  virtual bool append(HistoryFile file, const uint8_t *data, size_t length) = 0;
+  virtual bool truncate(HistoryFile file, size_t length) = 0;
+
+  // Compaction: appends go to new files until commitRewrite() puts them in
+  // place of the old ones, the log first. Reads still see the old files.
+  virtual bool beginRewrite() = 0;
+  virtual bool commitRewrite() = 0;
+  virtual void abortRewrite() = 0;
+};
+
+struct HistoryEntry {
+  uint32_t date;     // YYYYMMDD
+  uint64_t hash;     // historyHash() of the text
+  uint16_t length;
+  uint32_t offset;   // Of the record in the log
+};
+
+// Receives a joke's text in pieces
+typedef void (*HistoryTextSink)(const char *data, size_t length, void *context);
+
+class JokeHistory {
+public:
+  explicit JokeHistory(HistoryStorage &storage, size_t budget = HISTORY_BUDGET);
+
+  // Bring both files to a consistent state after a reset. Returns the
+  // number of jokes kept.
+  uint32_t recover();
+
+  uint32_t count() const { return entries; }
+
+  // Add today's joke. The same joke again for the same date is already
+  // there; an earlier date than the last one is refused.
+  bool append(uint32_t date, const char *text, size_t length);
+
+  // Entry at a position in the index, 0 the oldest
+  bool entry(uint32_t position, HistoryEntry &result);
+
+  // Number of entries dated before `before`: the newest of them is at that
+  // position - 1. 0 for `before` means no limit.
+  uint32_t countBefore(uint32_t before);
+
+  // The last joke of a date
+  bool find(uint32_t date, HistoryEntry &result);
+
+  bool readText(const HistoryEntry &entry, HistoryTextSink sink, void *context);
+
+  // Up to `length` bytes of the text from byte `from` on, for callers that
+  // send it in pieces. Returns the bytes read, 0 at the end or if the log
+  // can't be read.
+  size_t readText(const HistoryEntry &entry, size_t from, char *out, size_t length);
+
+  uint32_t compactions() const { return compactionCount; }
+  bool healthy() const { return !failed; }  // False once a write failed
+
+private:
+  bool readRecord(uint32_t offset, HistoryEntry &result, bool checkText);
+  bool readIndex(uint32_t position, uint32_t &date, uint32_t &offset);
+  bool appendIndex(uint32_t date, uint32_t offset);
+  uint32_t scanLog(uint32_t from);
+  bool copyRecord(const HistoryEntry &entry);
+  void compact(size_t incoming);
+
+  HistoryStorage &storage;
+  size_t budget;
+  uint32_t entries;
+  uint32_t logSize;
+  uint32_t compactionCount;
+  bool failed;
+  uint8_t buffer[64];
+};
+
+// FNV-1a, 64 bits
+uint64_t historyHash(const char *text, size_t length);
+
+// "YYYY-MM-DD" to YYYYMMDD and back (out holds 11 bytes)
+bool parseHistoryDate(const char *text, uint32_t &date);
+void formatHistoryDate(uint32_t date, char *out);
+
+#ifdef ARDUINO
+#include <LittleFS.h>
+
+// The files on LittleFS, each with a temp file for compaction
+class LittleFSHistoryStorage : public HistoryStorage {
+public:
+  LittleFSHistoryStorage(const char *logPath, const char *indexPath, const char *logTemp, const char *indexTemp)
+    : paths{logPath, indexPath}, temps{logTemp, indexTemp} {}
+
+  size_t size(HistoryFile file) override {
+    File handle = LittleFS.open(paths[file], "r");
+    size_t length = handle ? handle.size() : 0;
+    handle.close();
+    return length;
+  }
+
+  size_t read(HistoryFile file, size_t offset, uint8_t *data, size_t length) override {
+    File handle = LittleFS.open(paths[file], "r");
+    if (!handle || !handle.seek(offset)) {
+      return 0;
+    }
+    size_t got = handle.read(data, length);
+    handle.close();
+    return got;
+  }
+
+  bool append(HistoryFile file, const uint8_t *data, size_t length) override {
+    File handle = LittleFS.open(rewriting ? temps[file] : paths[file], "a");
+    bool written = handle && handle.write(data, length) == length;
+    handle.close();
+    return written;
+  }
+
+  bool truncate(HistoryFile file, size_t length) override {
+    if (length == 0) {
+      return !LittleFS.exists(paths[file]) || LittleFS.remove(paths[file]);
+    }
+    File handle = LittleFS.open(paths[file], "r+");
+    bool truncated = handle && handle.truncate(length);
+    handle.close();
+    return truncated;
+  }
+
+  bool beginRewrite() override {
+    LittleFS.remove(temps[HISTORY_LOG]);
+    LittleFS.remove(temps[HISTORY_INDEX]);
+    rewriting = true;
+    return true;
+  }
+
+  bool commitRewrite() override {
+    rewriting = false;
+    return LittleFS.rename(temps[HISTORY_LOG], paths[HISTORY_LOG]) &&
+           LittleFS.rename(temps[HISTORY_INDEX], paths[HISTORY_INDEX]);
+  }
+
+  void abortRewrite() override {
+    rewriting = false;
+    LittleFS.remove(temps[HISTORY_LOG]);
+    LittleFS.remove(temps[HISTORY_INDEX]);
+  }
+
+private:
+  const char *paths[2];
+  const char *temps[2];
+  bool rewriting = false;
+};
+#endif
+
+#endif
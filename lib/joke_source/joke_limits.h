@@ -0,0 +1,10 @@
+#ifndef JOKE_LIMITS_H
+#define JOKE_LIMITS_H
+
+#include <stddef.h>
+
+// Size of a joke's text, shared by the extractor's buffer, the joke bank
+// and the firmware's print queue checks.
+const size_t JOKE_MAX_LENGTH = 2048;  // Jokes are ~1KB, leave room for long ones
+
+#endif
@@ -0,0 +1,124 @@
+#include "recent_jokes.h"
+#include <string.h>
+#include "byte_io.h"
+#include "html_entities.h"
+
+static const size_t ENTRY_SIZE = 12;
+
+// === Fingerprint ===
+
+static bool isSpace(const char *piece, size_t length) {
+  if (length == 1) {
+    char c = piece[0];
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+  }
+  return length == 2 && (uint8_t)piece[0] == 0xC2 && (uint8_t)piece[1] == 0xA0;  // No-break space
+}
+
+uint64_t jokeFingerprint(const char *text, size_t length) {
+  uint64_t hash = FNV64_OFFSET;
+  bool started = false;   // Something other than whitespace was hashed
+  bool spacing = false;   // Whitespace since then, hashed as one space before the next character
+  char decoded[4];
+  size_t i = 0;
+  while (i < length) {
+    // One character reference, a no-break space or a single byte
+    const char *piece = text + i;
+    size_t pieceLength = 1;
+    if (text[i] == '&') {
+      size_t end = i + 1;
+      while (end < length && end - i - 1 <= HTML_ENTITY_MAX_NAME && text[end] != ';' && text[end] != '&') {
+        end++;
+      }
+      size_t referenceLength = end < length && text[end] == ';' ? decodeHTMLEntity(text + i + 1, end - i - 1, decoded) : 0;
+      if (referenceLength > 0) {
+        piece = decoded;
+        pieceLength = referenceLength;
+        i = end;
+      }
+    } else if (i + 1 < length && (uint8_t)text[i] == 0xC2 && (uint8_t)text[i + 1] == 0xA0) {
+      pieceLength = 2;
+      i++;
+    }
+    i++;
+
+    if (isSpace(piece, pieceLength)) {
+      spacing = started;
+      continue;
+    }
+    if (spacing) {
+      hash = fnv1a64(hash, " ", 1);
+      spacing = false;
+    }
+    hash = fnv1a64(hash, piece, pieceLength);
+    started = true;
+  }
+  return hash;
+}
+
+// === Ring ===
+
+RecentJokes::RecentJokes() {
+  clear();
+}
+
+void RecentJokes::clear() {
+  entries = 0;
+  next = 0;
+}
+
+bool RecentJokes::seenBefore(uint64_t fingerprint, uint32_t date) const {
+  for (uint8_t i = 0; i < entries; i++) {
+    if (fingerprints[i] == fingerprint && dates[i] < date) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void RecentJokes::add(uint64_t fingerprint, uint32_t date) {
+  for (uint8_t i = 0; i < entries; i++) {
+    if (fingerprints[i] == fingerprint && dates[i] == date) {
+      return;
+    }
+  }
+  fingerprints[next] = fingerprint;
+  dates[next] = date;
+  next = (next + 1) % RECENT_JOKES_MAX;
+  if (entries < RECENT_JOKES_MAX) {
+    entries++;
+  }
+}
+
+// === Saving ===
+
+size_t RecentJokes::save(uint8_t *out) const {
+  out[0] = entries;
+  size_t position = 1;
+  // Oldest first: from next once the ring has wrapped, from 0 before
+  uint8_t oldest = entries == RECENT_JOKES_MAX ? next : 0;
+  for (uint8_t i = 0; i < entries; i++) {
+    uint8_t slot = (oldest + i) % RECENT_JOKES_MAX;
+    putU64(out + position, fingerprints[slot]);
+    putU32(out + position + 8, dates[slot]);
+    position += ENTRY_SIZE;
+  }
+  putU16(out + position, crc16(CRC16_INIT, out, position));
+  return position + 2;
+}
+
+bool RecentJokes::load(const uint8_t *data, size_t length) {
+  clear();
+  if (length < 3 || data[0] > RECENT_JOKES_MAX || length != 1 + (size_t)data[0] * ENTRY_SIZE + 2 ||
+      getU16(data + length - 2) != crc16(CRC16_INIT, data, length - 2)) {
+    return false;
+  }
+  for (uint8_t i = 0; i < data[0]; i++) {
+    const uint8_t *entry = data + 1 + (size_t)i * ENTRY_SIZE;
+    fingerprints[i] = getU64(entry);
+    dates[i] = getU32(entry + 8);
+  }
+  entries = data[0];
+  next = entries % RECENT_JOKES_MAX;
+  return true;
+}
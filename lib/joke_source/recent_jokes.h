@@ -0,0 +1,55 @@
+#ifndef RECENT_JOKES_H
+#define RECENT_JOKES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The jokes printed lately, to notice a source repeating one.
+//
+// Each joke is kept as a 64-bit fingerprint with the date it was printed,
+// in a ring of RECENT_JOKES_MAX entries (768 bytes), the oldest replaced
+// first. The fingerprint is FNV-1a of the normalized text: character
+// references decoded, runs of whitespace (no-break spaces included) made
+// one space and trimmed at both ends, so the same joke with other markup
+// around it still matches. Distinct jokes collide with a chance of about
+// RECENT_JOKES_MAX / 2^64 each.
+//
+// Saved to flash as a count, the entries oldest first (fingerprint
+// uint64 LE, date uint32 LE) and a CRC-16 of all before.
+//
+// Plain C++ only (no Arduino headers) so the same code runs in host tests.
+
+const uint8_t RECENT_JOKES_MAX = 64;          // About two months of daily jokes
+const size_t RECENT_JOKES_SAVED_MAX = 1 + RECENT_JOKES_MAX * 12 + 2;
+
+// Fingerprint of a joke's normalized text
+uint64_t jokeFingerprint(const char *text, size_t length);
+
+class RecentJokes {
+public:
+  RecentJokes();
+
+  // The joke was printed on a day before `date` (YYYYMMDD). The same joke
+  // again on the day it was printed isn't a repeat.
+  bool seenBefore(uint64_t fingerprint, uint32_t date) const;
+
+  // Remember a joke printed on `date`. Once the ring is full the oldest
+  // entry goes.
+  void add(uint64_t fingerprint, uint32_t date);
+
+  uint8_t count() const { return entries; }
+  void clear();
+
+  // Write the entries to out (RECENT_JOKES_SAVED_MAX bytes at most), or
+  // take them back; load() refuses damaged data and leaves the ring empty.
+  size_t save(uint8_t *out) const;
+  bool load(const uint8_t *data, size_t length);
+
+private:
+  uint64_t fingerprints[RECENT_JOKES_MAX];
+  uint32_t dates[RECENT_JOKES_MAX];
+  uint8_t entries;
+  uint8_t next;      // Slot the next joke goes to
+};
+
+#endif
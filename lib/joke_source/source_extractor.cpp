@@ -0,0 +1,600 @@
+#include "source_extractor.h"
+#include "html_entities.h"
+#include <string.h>
+
+bool parseRuleType(const char *name, ExtractRuleType &type) {
+  if (strcmp(name, "markers") == 0) {
+    type = RULE_MARKERS;
+  } else if (strcmp(name, "id") == 0) {
+    type = RULE_ELEMENT_ID;
+  } else if (strcmp(name, "json") == 0) {
+    type = RULE_JSON_PATH;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char *ruleTypeName(ExtractRuleType type) {
+  switch (type) {
+    case RULE_MARKERS: return "markers";
+    case RULE_ELEMENT_ID: return "id";
+    default: return "json";
+  }
+}
+
+static bool isSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static char lower(char c) {
+  return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+SourceExtractor::SourceExtractor() {
+  ExtractRule none = {RULE_MARKERS, "", ""};
+  begin(none);
+}
+
+const char *SourceExtractor::fail(const char *reason) {
+  if (!error) {
+    error = reason;
+  }
+  state = FAILED;
+  return error;
+}
+
+const char *SourceExtractor::begin(const ExtractRule &rule) {
+  type = rule.type;
+  state = SEARCHING;
+  error = nullptr;
+  historyLength = 0;
+  historyHead = 0;
+  heldLength = 0;
+  inTag = false;
+  tagQuote = 0;
+  depth = 0;
+  jsonDepth = 0;
+  stage = JSON_VALUE;
+  readingKey = false;
+  capture = false;
+  escaped = false;
+  hexDigits = 0;
+  highSurrogate = 0;
+  outputLength = 0;
+  output[0] = '\0';
+  starts.count = 0;
+  ends.count = 0;
+  cleaner.begin(output, sizeof(output));
+
+  const char *patternText = rule.pattern ? rule.pattern : "";
+  const char *endText = rule.end ? rule.end : "";
+  if (strlen(patternText) > SOURCE_PATTERN_MAX || strlen(endText) > SOURCE_PATTERN_MAX) {
+    return fail("Error: Rule pattern too long");
+  }
+  strcpy(pattern, patternText);
+  strcpy(endPattern, endText);
+
+  if (type == RULE_JSON_PATH) {
+    return parsePath() ? nullptr : fail("Error: Invalid JSON path");
+  }
+  if (type == RULE_ELEMENT_ID) {
+    // Matched as id="X" or id='X' inside a tag
+    size_t idLength = strlen(pattern);
+    if (idLength == 0 || 2 * idLength + 11 > SOURCE_PATTERN_MAX) {
+      return fail("Error: Invalid element id");
+    }
+    char id[SOURCE_PATTERN_MAX + 1];
+    strcpy(id, pattern);
+    strcpy(pattern, "id=\"");
+    strcat(pattern, id);
+    strcat(pattern, "\"|id='");
+    strcat(pattern, id);
+    strcat(pattern, "'");
+  }
+  if (!splitAlternatives(pattern, starts) ||
+      (type == RULE_MARKERS && !splitAlternatives(endPattern, ends))) {
+    return fail("Error: Rule needs start and end markers");
+  }
+  return nullptr;
+}
+
+bool SourceExtractor::splitAlternatives(const char *text, Alternatives &alternatives) {
+  alternatives.count = 0;
+  alternatives.longest = 0;
+  size_t start = 0;
+  size_t length = strlen(text);
+  while (start <= length && alternatives.count < SOURCE_ALTERNATIVES_MAX) {
+    const char *bar = strchr(text + start, '|');
+    size_t end = bar ? (size_t)(bar - text) : length;
+    if (end > start) {
+      alternatives.start[alternatives.count] = start;
+      alternatives.length[alternatives.count] = end - start;
+      if (end - start > alternatives.longest) {
+        alternatives.longest = end - start;
+      }
+      alternatives.count++;
+    }
+    start = end + 1;
+  }
+  return alternatives.count > 0;
+}
+
+// "a.b[2].c", optionally starting with "$" or "$."
+bool SourceExtractor::parsePath() {
+  pathLength = 0;
+  size_t i = 0;
+  if (pattern[0] == '$') {
+    i = pattern[1] == '.' ? 2 : 1;
+  }
+  while (pattern[i] != '\0') {
+    if (pathLength == SOURCE_PATH_MAX) {
+      return false;
+    }
+    PathSegment &segment = path[pathLength];
+    if (pattern[i] == '[') {
+      i++;
+      uint32_t index = 0;
+      size_t digits = 0;
+      while (pattern[i] >= '0' && pattern[i] <= '9' && index < 10000) {
+        index = index * 10 + (pattern[i++] - '0');
+        digits++;
+      }
+      if (digits == 0 || pattern[i] != ']') {
+        return false;
+      }
+      i++;
+      segment.keyLength = 0;
+      segment.index = index;
+    } else {
+      size_t start = i;
+      while (pattern[i] != '\0' && pattern[i] != '.' && pattern[i] != '[') {
+        i++;
+      }
+      if (i == start) {
+        return false;
+      }
+      segment.keyStart = start;
+      segment.keyLength = i - start;
+    }
+    pathLength++;
+    if (pattern[i] == '.') {
+      i++;
+      if (pattern[i] == '\0') {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool SourceExtractor::historyEndsWith(const char *text, size_t length) const {
+  if (length > historyLength) {
+    return false;
+  }
+  for (size_t i = 0; i < length; i++) {
+    size_t at = (historyHead + SOURCE_PATTERN_MAX - 1 - i) % SOURCE_PATTERN_MAX;
+    if (history[at] != text[length - 1 - i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int SourceExtractor::matchedAlternative(const Alternatives &alternatives) const {
+  for (uint8_t a = 0; a < alternatives.count; a++) {
+    if (historyEndsWith(pattern + alternatives.start[a], alternatives.length[a])) {
+      return a;
+    }
+  }
+  return -1;
+}
+
+bool SourceExtractor::feed(const uint8_t *data, size_t length) {
+  for (size_t i = 0; i < length && state != DONE && state != FAILED; i++) {
+    char c = (char)data[i];
+    if (type == RULE_JSON_PATH) {
+      jsonByte(c);
+      continue;
+    }
+
+    history[historyHead] = c;
+    historyHead = (historyHead + 1) % SOURCE_PATTERN_MAX;
+    if (historyLength < SOURCE_PATTERN_MAX) {
+      historyLength++;
+    }
+    if (type == RULE_MARKERS) {
+      markersByte(c);
+    } else {
+      elementByte(c);
+    }
+  }
+  return state == DONE || state == FAILED;
+}
+
+void SourceExtractor::markersByte(char c) {
+  if (state == SEARCHING) {
+    if (matchedAlternative(starts) >= 0) {
+      state = IN_TEXT;
+    }
+    return;
+  }
+
+  // Held back until it can't be the start of an end marker, so a marker
+  // that isn't a tag doesn't reach the text
+  held[heldLength++] = c;
+  for (uint8_t a = 0; a < ends.count; a++) {
+    size_t length = ends.length[a];
+    if (length <= heldLength && memcmp(held + heldLength - length, endPattern + ends.start[a], length) == 0) {
+      for (size_t i = 0; i < heldLength - length; i++) {
+        cleaner.put(held[i]);
+      }
+      if (cleaner.overflowed()) {
+        fail("Error: Joke too long for buffer");
+      } else {
+        state = DONE;
+      }
+      return;
+    }
+  }
+  if (heldLength == ends.longest) {
+    cleaner.put(held[0]);
+    memmove(held, held + 1, --heldLength);
+    if (cleaner.overflowed()) {
+      fail("Error: Joke too long for buffer");
+    }
+  }
+}
+
+void SourceExtractor::elementByte(char c) {
+  if (state == IN_TEXT) {
+    cleaner.put(c);
+    if (cleaner.overflowed()) {
+      fail("Error: Joke too long for buffer");
+      return;
+    }
+  }
+
+  if (!inTag) {
+    if (c == '<') {
+      inTag = true;
+      tagNameLength = 0;
+      tagNameDone = false;
+      closingTag = false;
+      closesElement = false;
+      tagQuote = 0;
+    }
+    return;
+  }
+
+  if (tagQuote) {
+    if (c == tagQuote) {
+      tagQuote = 0;
+      // The id attribute ends with its closing quote
+      int matched = state == SEARCHING ? matchedAlternative(starts) : -1;
+      if (matched >= 0) {
+        size_t before = starts.length[matched] + 1;
+        if (historyLength > before &&
+            isSpace(history[(historyHead + SOURCE_PATTERN_MAX - before) % SOURCE_PATTERN_MAX])) {
+          memcpy(elementName, tagName, tagNameLength + 1);
+          state = IN_OPEN_TAG;
+        }
+      }
+    }
+    return;
+  }
+
+  if (!tagNameDone) {
+    if (c == '/' && tagNameLength == 0 && !closingTag) {
+      closingTag = true;
+      return;
+    }
+    if (!isSpace(c) && c != '>' && c != '/') {
+      if (tagNameLength < sizeof(tagName) - 1) {
+        tagName[tagNameLength++] = lower(c);
+      }
+      return;
+    }
+    tagName[tagNameLength] = '\0';
+    tagNameDone = true;
+    if (state == IN_TEXT && strcmp(tagName, elementName) == 0) {
+      if (closingTag) {
+        closesElement = true;
+      } else {
+        depth++;
+      }
+    }
+  }
+
+  if (c == '"' || c == '\'') {
+    tagQuote = c;
+  } else if (c == '>') {
+    inTag = false;
+    char previous = history[(historyHead + SOURCE_PATTERN_MAX - 2) % SOURCE_PATTERN_MAX];
+    if (state == IN_OPEN_TAG) {
+      if (previous == '/') {
+        fail("Error: Element is empty");
+        return;
+      }
+      state = IN_TEXT;
+      depth = 1;
+    } else if (state == IN_TEXT) {
+      if (!closingTag && previous == '/' && strcmp(tagName, elementName) == 0) {
+        depth--;  // <x/> opens and closes
+      }
+      if (closesElement && --depth == 0) {
+        state = DONE;
+      }
+    }
+  }
+}
+
+void SourceExtractor::put(char c) {
+  if (outputLength == JOKE_MAX_LENGTH) {
+    fail("Error: Joke too long for buffer");
+    return;
+  }
+  output[outputLength++] = c;
+}
+
+void SourceExtractor::jsonByte(char c) {
+  if (stage == JSON_STRING) {
+    jsonStringByte(c);
+    return;
+  }
+  if (stage == JSON_LITERAL) {
+    if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '.' || c == '-' || c == '+' || c == 'E') {
+      return;
+    }
+    jsonValueEnd();
+    if (state == FAILED) {
+      return;
+    }
+  }
+  if (isSpace(c)) {
+    return;
+  }
+
+  JsonLevel *top = jsonDepth > 0 ? &levels[jsonDepth - 1] : nullptr;
+  switch (stage) {
+    case JSON_VALUE:
+      if (c == ']' && top && !top->object && top->index == 0) {
+        jsonDepth--;  // Empty array
+        jsonValueEnd();
+      } else {
+        jsonValueStart(c);
+      }
+      return;
+
+    case JSON_KEY:
+      if (c == '"') {
+        const PathSegment *segment = jsonDepth <= pathLength ? &path[jsonDepth - 1] : nullptr;
+        readingKey = true;
+        keyMatches = top->onPath && segment && segment->keyLength > 0;
+        keyPosition = 0;
+        capture = false;
+        escaped = false;
+        hexDigits = 0;
+        highSurrogate = 0;
+        stage = JSON_STRING;
+      } else if (c == '}') {
+        jsonDepth--;  // Empty object
+        jsonValueEnd();
+      } else {
+        fail("Error: Invalid JSON");
+      }
+      return;
+
+    case JSON_COLON:
+      if (c == ':') {
+        stage = JSON_VALUE;
+      } else {
+        fail("Error: Invalid JSON");
+      }
+      return;
+
+    case JSON_AFTER_VALUE:
+      if (top && c == ',') {
+        if (top->object) {
+          stage = JSON_KEY;
+        } else {
+          top->index++;
+          stage = JSON_VALUE;
+        }
+      } else if (top && c == (top->object ? '}' : ']')) {
+        jsonDepth--;
+        jsonValueEnd();
+      } else {
+        fail("Error: Invalid JSON");
+      }
+      return;
+
+    default:
+      return;
+  }
+}
+
+void SourceExtractor::jsonValueStart(char c) {
+  // Is this value on the path to the joke, or the joke itself?
+  bool onPath = true;
+  if (jsonDepth > 0) {
+    const JsonLevel &parent = levels[jsonDepth - 1];
+    const PathSegment *segment = jsonDepth <= pathLength ? &path[jsonDepth - 1] : nullptr;
+    onPath = parent.onPath && segment &&
+             (parent.object ? segment->keyLength > 0 && keyMatches
+                            : segment->keyLength == 0 && segment->index == parent.index);
+  }
+  bool target = onPath && jsonDepth == pathLength;
+
+  if (c == '{' || c == '[') {
+    if (target) {
+      fail("Error: JSON value is not a string");
+    } else if (jsonDepth == SOURCE_JSON_DEPTH) {
+      fail("Error: JSON nested too deeply");
+    } else {
+      levels[jsonDepth++] = {c == '{', onPath, 0};
+      stage = c == '{' ? JSON_KEY : JSON_VALUE;
+    }
+  } else if (c == '"') {
+    readingKey = false;
+    capture = target;
+    escaped = false;
+    hexDigits = 0;
+    highSurrogate = 0;
+    stage = JSON_STRING;
+  } else if (target) {
+    fail("Error: JSON value is not a string");
+  } else if (c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n') {
+    stage = JSON_LITERAL;
+  } else {
+    fail("Error: Invalid JSON");
+  }
+}
+
+void SourceExtractor::jsonStringByte(char c) {
+  if (hexDigits > 0) {
+    int value = hexValue(c);
+    if (value < 0) {
+      fail("Error: Invalid JSON");
+      return;
+    }
+    codepoint = codepoint * 16 + value;
+    if (--hexDigits == 0) {
+      jsonDecoded(codepoint);
+    }
+    return;
+  }
+
+  if (escaped) {
+    escaped = false;
+    switch (c) {
+      case 'n': jsonDecoded('\n'); return;
+      case 't': jsonDecoded('\t'); return;
+      case 'r': jsonDecoded('\r'); return;
+      case 'b': jsonDecoded('\b'); return;
+      case 'f': jsonDecoded('\f'); return;
+      case '"': case '\\': case '/': jsonDecoded((uint8_t)c); return;
+      case 'u':
+        hexDigits = 4;
+        codepoint = 0;
+        return;
+      default:
+        fail("Error: Invalid JSON");
+        return;
+    }
+  }
+
+  if (c == '\\') {
+    escaped = true;
+    return;
+  }
+  if (c == '"') {
+    if (highSurrogate) {
+      highSurrogate = 0;
+      jsonDecoded(0xFFFD);
+    }
+    if (readingKey) {
+      const PathSegment *segment = jsonDepth <= pathLength ? &path[jsonDepth - 1] : nullptr;
+      keyMatches = keyMatches && segment && keyPosition == segment->keyLength;
+      readingKey = false;
+      stage = JSON_COLON;
+    } else if (capture) {
+      state = DONE;
+    } else {
+      jsonValueEnd();
+    }
+    return;
+  }
+
+  // Raw UTF-8 passes as it is
+  if (highSurrogate) {
+    highSurrogate = 0;
+    jsonDecoded(0xFFFD);
+  }
+  jsonDecoded(0x110000 | (uint8_t)c);
+}
+
+// A decoded code point, or a raw byte tagged with 0x110000
+void SourceExtractor::jsonDecoded(uint32_t value) {
+  char bytes[4];
+  size_t count;
+  if (value >= 0x110000) {
+    bytes[0] = (char)(value & 0xFF);
+    count = 1;
+  } else if (value >= 0xD800 && value <= 0xDBFF) {
+    if (highSurrogate) {
+      highSurrogate = 0;
+      jsonDecoded(0xFFFD);
+    }
+    highSurrogate = value;
+    return;
+  } else if (value >= 0xDC00 && value <= 0xDFFF) {
+    uint32_t high = highSurrogate;
+    highSurrogate = 0;
+    count = encodeUTF8(high ? 0x10000 + ((high - 0xD800) << 10) + (value - 0xDC00) : 0xFFFD, bytes);
+  } else {
+    if (highSurrogate) {
+      highSurrogate = 0;
+      jsonDecoded(0xFFFD);
+    }
+    count = encodeUTF8(value, bytes);
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    if (readingKey) {
+      if (keyMatches) {
+        const PathSegment &segment = path[jsonDepth - 1];
+        keyMatches = keyPosition < segment.keyLength && pattern[segment.keyStart + keyPosition] == bytes[i];
+        keyPosition++;
+      }
+    } else if (capture && bytes[i] != '\r') {
+      put(bytes[i]);
+    }
+  }
+}
+
+void SourceExtractor::jsonValueEnd() {
+  stage = JSON_AFTER_VALUE;
+  if (jsonDepth == 0) {
+    fail("Error: JSON path not found");
+  }
+}
+
+const char *SourceExtractor::finish() {
+  if (error) {
+    return error;
+  }
+
+  if (type == RULE_JSON_PATH) {
+    if (state != DONE) {
+      return fail(stage == JSON_STRING && capture ? "Error: JSON string not closed" : "Error: JSON path not found");
+    }
+    // Trim like the HTML cleaner does
+    size_t start = 0;
+    while (start < outputLength && isSpace(output[start])) start++;
+    while (outputLength > start && isSpace(output[outputLength - 1])) outputLength--;
+    memmove(output, output + start, outputLength - start);
+    outputLength -= start;
+    output[outputLength] = '\0';
+  } else {
+    if (state == SEARCHING) {
+      return fail(type == RULE_MARKERS ? "Error: Could not find start marker" : "Error: Could not find element");
+    }
+    if (state != DONE) {
+      return fail(type == RULE_MARKERS ? "Error: Could not find end marker" : "Error: Element not closed");
+    }
+    outputLength = cleaner.finish();
+  }
+
+  if (outputLength == 0) {
+    return fail("Error: Joke extraction resulted in empty text");
+  }
+  return nullptr;
+}
@@ -0,0 +1,154 @@
+#ifndef SOURCE_EXTRACTOR_H
+#define SOURCE_EXTRACTOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "html_text.h"
+#include "joke_limits.h"
+
+// Streaming extractor driven by a declarative rule, so a joke source is a
+// URL plus a few strings in the config rather than code.
+//
+//  RULE_MARKERS     The joke is the HTML between a start and an end
+//                   marker. Either can list alternatives separated by '|',
+//                   e.g. "<div id=\"a\">|<div id='a'>".
+//  RULE_ELEMENT_ID  The joke is the content of the element with this id
+//                   (like the CSS selector #id), up to its closing tag.
+//  RULE_JSON_PATH   The joke is a string in a JSON response, addressed by
+//                   keys and array indices: "joke", "value.text",
+//                   "jokes[0].text".
+//
+// HTML rules run the text through HtmlTextCleaner, JSON strings are taken
+// as they are (escapes decoded). Bytes are fed straight from the HTTP
+// stream and only the joke is kept, in a fixed buffer, so RAM use is
+// bounded by JOKE_MAX_LENGTH and not by the size of the page.
+//
+// Plain C++ only (no Arduino headers) so the same code runs in host tests.
+
+const size_t SOURCE_PATTERN_MAX = 96;      // Rule strings, alternatives included
+const uint8_t SOURCE_ALTERNATIVES_MAX = 4;
+const uint8_t SOURCE_PATH_MAX = 8;         // Segments of a JSON path
+const uint8_t SOURCE_JSON_DEPTH = 16;      // Nesting the JSON scanner follows
+
+enum ExtractRuleType : uint8_t {
+  RULE_MARKERS,
+  RULE_ELEMENT_ID,
+  RULE_JSON_PATH
+};
+
+struct ExtractRule {
+  ExtractRuleType type;
+  const char *pattern;   // Start markers, element id or JSON path
+  const char *end;       // End markers (RULE_MARKERS only)
+};
+
+// Rule type from its config name ("markers", "id", "json"); false if unknown
+bool parseRuleType(const char *name, ExtractRuleType &type);
+const char *ruleTypeName(ExtractRuleType type);
+
+class SourceExtractor {
+public:
+  SourceExtractor();
+
+  // Reset for a new download with this rule (copied). Returns nullptr, or
+  // an error text if the rule can't be used; finish() then reports it too.
+  const char *begin(const ExtractRule &rule);
+
+  // Consume a chunk of the response. Returns true once the joke is complete
+  // (or failed) and the rest of the stream can be skipped.
+  bool feed(const uint8_t *data, size_t length);
+
+  // Call after the last chunk. Returns nullptr on success, otherwise an
+  // error text starting with "Error:".
+  const char *finish();
+
+  const char *text() const { return output; }
+  size_t length() const { return outputLength; }
+
+private:
+  enum State : uint8_t { SEARCHING, IN_OPEN_TAG, IN_TEXT, DONE, FAILED };
+  enum JsonStage : uint8_t { JSON_VALUE, JSON_KEY, JSON_COLON, JSON_AFTER_VALUE, JSON_STRING, JSON_LITERAL };
+
+  struct Alternatives {
+    uint8_t count;
+    uint8_t start[SOURCE_ALTERNATIVES_MAX];
+    uint8_t length[SOURCE_ALTERNATIVES_MAX];
+    uint8_t longest;
+  };
+
+  struct JsonLevel {
+    bool object;
+    bool onPath;      // All path segments down to here matched
+    uint16_t index;   // Current element of an array
+  };
+
+  struct PathSegment {
+    uint8_t keyStart;   // In pattern; keyLength 0 for an index
+    uint8_t keyLength;
+    uint16_t index;
+  };
+
+  const char *fail(const char *reason);
+  bool splitAlternatives(const char *text, Alternatives &alternatives);
+  bool parsePath();
+  bool historyEndsWith(const char *text, size_t length) const;
+  int matchedAlternative(const Alternatives &alternatives) const;
+
+  void markersByte(char c);
+  void elementByte(char c);
+  void jsonByte(char c);
+  void jsonValueStart(char c);
+  void jsonStringByte(char c);
+  void jsonDecoded(uint32_t codepoint);
+  void jsonValueEnd();
+  void put(char c);
+
+  ExtractRuleType type;
+  State state;
+  const char *error;
+  char pattern[SOURCE_PATTERN_MAX + 1];
+  char endPattern[SOURCE_PATTERN_MAX + 1];
+  Alternatives starts;
+  Alternatives ends;
+
+  // Last bytes seen, for marker matching
+  char history[SOURCE_PATTERN_MAX];
+  uint8_t historyLength;
+  uint8_t historyHead;
+
+  // Markers: bytes held back until they can't be part of an end marker
+  char held[SOURCE_PATTERN_MAX];
+  uint8_t heldLength;
+
+  // Element: tag being read and nesting of the element's own tag name
+  char elementName[16];
+  char tagName[16];
+  uint8_t tagNameLength;
+  bool inTag;
+  bool tagNameDone;
+  bool closingTag;
+  bool closesElement;
+  char tagQuote;
+  uint16_t depth;
+
+  // JSON
+  PathSegment path[SOURCE_PATH_MAX];
+  uint8_t pathLength;
+  JsonLevel levels[SOURCE_JSON_DEPTH];
+  uint8_t jsonDepth;
+  JsonStage stage;
+  bool readingKey;
+  bool keyMatches;
+  uint8_t keyPosition;
+  bool capture;          // This string is the joke
+  bool escaped;
+  uint8_t hexDigits;     // Left of a \u escape
+  uint32_t codepoint;
+  uint32_t highSurrogate;
+
+  HtmlTextCleaner cleaner;
+  char output[JOKE_MAX_LENGTH + 1];
+  size_t outputLength;
+};
+
+#endif
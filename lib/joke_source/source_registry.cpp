@@ -0,0 +1,108 @@
+#include "source_registry.h"
+#include <string.h>
+
+static const uint16_t RELIABILITY_FULL = 1000;
+static const uint16_t RELIABILITY_FLOOR = 10;  // Keeps the score finite
+
+static bool fits(const char *text, size_t max) {
+  return text && strlen(text) <= max;
+}
+
+SourceRegistry::SourceRegistry() {
+  clear();
+}
+
+void SourceRegistry::clear() {
+  sourceCount = 0;
+}
+
+bool SourceRegistry::add(const char *name, const char *url, ExtractRuleType type, const char *pattern,
+                         const char *end) {
+  if (sourceCount == JOKE_SOURCES_MAX || !fits(name, SOURCE_NAME_MAX) || !fits(url, SOURCE_URL_MAX) ||
+      !fits(pattern, SOURCE_PATTERN_MAX) || !fits(end ? end : "", SOURCE_PATTERN_MAX) ||
+      name[0] == '\0' || url[0] == '\0' || find(name) >= 0) {
+    return false;
+  }
+  if ((type != RULE_JSON_PATH && pattern[0] == '\0') || (type == RULE_MARKERS && (!end || end[0] == '\0'))) {
+    return false;
+  }
+
+  JokeSource &source = sources[sourceCount++];
+  strcpy(source.name, name);
+  strcpy(source.url, url);
+  source.type = type;
+  strcpy(source.pattern, pattern);
+  strcpy(source.end, end ? end : "");
+  source.stats.attempts = 0;
+  source.stats.successes = 0;
+  source.stats.reliability = RELIABILITY_FULL;
+  source.stats.latencyMillis = 0;
+  return true;
+}
+
+int SourceRegistry::find(const char *name) const {
+  for (uint8_t i = 0; i < sourceCount; i++) {
+    if (strcmp(sources[i].name, name) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+uint32_t SourceRegistry::score(uint8_t index) const {
+  const SourceStats &stats = sources[index].stats;
+  uint64_t latency = stats.latencyMillis > 0 ? stats.latencyMillis : SOURCE_DEFAULT_LATENCY;
+  uint16_t reliability = stats.reliability > RELIABILITY_FLOOR ? stats.reliability : RELIABILITY_FLOOR;
+  uint64_t expected = latency * RELIABILITY_FULL / reliability;
+  return expected > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t)expected;
+}
+
+uint8_t SourceRegistry::order(uint8_t *indices) const {
+  // Insertion sort, stable so equal scores keep the configured order
+  for (uint8_t i = 0; i < sourceCount; i++) {
+    uint8_t at = i;
+    uint32_t value = score(i);
+    while (at > 0 && score(indices[at - 1]) > value) {
+      indices[at] = indices[at - 1];
+      at--;
+    }
+    indices[at] = i;
+  }
+  return sourceCount;
+}
+
+void SourceRegistry::record(uint8_t index, bool success, uint32_t millis) {
+  if (index >= sourceCount) {
+    return;
+  }
+  SourceStats &stats = sources[index].stats;
+  if (stats.attempts < 0xFFFF) {
+    stats.attempts++;
+  }
+  // Running averages with weight 1/4 for the newest try
+  stats.reliability = (stats.reliability * 3 + (success ? RELIABILITY_FULL : 0)) / 4;
+  if (success && stats.successes < 0xFFFF) {
+    stats.successes++;
+  }
+  // Failures count with the time they took: a source that times out costs
+  // its timeout on every try
+  stats.latencyMillis = stats.latencyMillis > 0 ? (stats.latencyMillis * 3 + millis) / 4 : millis;
+}
+
+bool SourceRegistry::restoreStats(const char *name, const SourceStats &stats) {
+  int index = find(name);
+  if (index < 0) {
+    return false;
+  }
+  sources[index].stats = stats;
+  if (sources[index].stats.reliability > RELIABILITY_FULL) {
+    sources[index].stats.reliability = RELIABILITY_FULL;
+  }
+  return true;
+}
+
+void addDefaultSources(SourceRegistry &registry) {
+  registry.add("hahaha", "https://www.hahaha.de/witze/witzdestages.txt", RULE_MARKERS,
+               "<div id=\"witzdestages\">|<div id='witzdestages'>",
+               "<span id=\"witzdestageslink\">|<span id='witzdestageslink'>|</div>");
+}
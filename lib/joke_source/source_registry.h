@@ -0,0 +1,81 @@
+#ifndef SOURCE_REGISTRY_H
+#define SOURCE_REGISTRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "source_extractor.h"
+
+// The joke sources a fetch can use, each a URL with the rule that finds
+// the joke in its response, and how well each has done lately.
+//
+// A fetch tries the sources best first: the one expected to deliver a
+// joke soonest, its recent time per try (failures included) divided by its
+// recent success rate. Both are running averages that favour the last few fetches, so a
+// source that went down drops behind within a couple of failures and comes
+// back once it answers again. A source not tried yet counts as reliable
+// with a typical latency, so it gets a chance early.
+//
+// Plain C++ only (no Arduino headers) so the same code runs in host tests.
+
+const uint8_t JOKE_SOURCES_MAX = 4;
+const size_t SOURCE_NAME_MAX = 15;
+const size_t SOURCE_URL_MAX = 127;
+const uint32_t SOURCE_DEFAULT_LATENCY = 3000;  // Milliseconds, until measured
+
+struct SourceStats {
+  uint16_t attempts;
+  uint16_t successes;
+  uint16_t reliability;     // Recent success rate in per mille
+  uint32_t latencyMillis;   // Recent time per try, 0 until tried
+};
+
+struct JokeSource {
+  char name[SOURCE_NAME_MAX + 1];
+  char url[SOURCE_URL_MAX + 1];
+  ExtractRuleType type;
+  char pattern[SOURCE_PATTERN_MAX + 1];
+  char end[SOURCE_PATTERN_MAX + 1];
+  SourceStats stats;
+
+  ExtractRule rule() const {
+    ExtractRule rule = {type, pattern, end};
+    return rule;
+  }
+};
+
+class SourceRegistry {
+public:
+  SourceRegistry();
+
+  void clear();
+
+  // False if the registry is full, a field is too long or missing, or the
+  // name is taken
+  bool add(const char *name, const char *url, ExtractRuleType type, const char *pattern, const char *end);
+
+  uint8_t count() const { return sourceCount; }
+  const JokeSource &source(uint8_t index) const { return sources[index]; }
+  int find(const char *name) const;  // -1 if unknown
+
+  // Source indices in the order to try them, best first. Returns count().
+  uint8_t order(uint8_t *indices) const;
+
+  // Expected milliseconds to a joke, lower is better
+  uint32_t score(uint8_t index) const;
+
+  // Outcome of one try
+  void record(uint8_t index, bool success, uint32_t millis);
+
+  // Stats saved before a restart, matched by name
+  bool restoreStats(const char *name, const SourceStats &stats);
+
+private:
+  JokeSource sources[JOKE_SOURCES_MAX];
+  uint8_t sourceCount;
+};
+
+// The built-in source, used when the config lists none: hahaha.de's joke of
+// the day, the witzdestages div up to its footer link
+void addDefaultSources(SourceRegistry &registry);
+
+#endif
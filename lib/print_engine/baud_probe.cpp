@@ -0,0 +1,67 @@
+#include "baud_probe.h"
+
+static const uint32_t SETTLE_TIME = 10;    // Let the line idle after a speed change
+static const uint32_t REPLY_TIMEOUT = 50;  // The printer answers within a few byte times
+static const uint8_t CONFIRMATIONS = 2;
+
+// Wait until the clock passes duration, discarding anything received
+static void discardInput(PrinterTransport &transport, PrintClock clock, uint32_t duration) {
+  uint32_t start = clock();
+  while (clock() - start < duration) {
+    transport.read();
+  }
+  while (transport.read() >= 0) {
+  }
+}
+
+// DLE EOT 1, true on a well-formed reply (bit 1 and 4 set, bits 0 and 7
+// clear). Garbage from a wrong rate is skipped until the timeout.
+static bool queryStatus(PrinterTransport &transport, PrintClock clock) {
+  transport.write(0x10);
+  transport.write(0x04);
+  transport.write(1);
+
+  uint32_t start = clock();
+  while (clock() - start < REPLY_TIMEOUT) {
+    int reply = transport.read();
+    if (reply >= 0 && (reply & 0x93) == 0x12) {
+      return true;
+    }
+  }
+  return false;
+}
+
+uint32_t probeBaudRate(PrinterTransport &transport, const uint32_t *rates, size_t count,
+                       PrintClock clock, uint32_t budget) {
+  if (!transport.canRead() || count == 0) {
+    return 0;
+  }
+
+  uint32_t start = clock();
+  while (clock() - start < budget) {
+    for (size_t i = 0; i < count; i++) {
+      if (!transport.setBaudRate(rates[i])) {
+        return 0;
+      }
+      discardInput(transport, clock, SETTLE_TIME);
+
+      uint8_t answered = 0;
+      while (answered < CONFIRMATIONS && queryStatus(transport, clock)) {
+        answered++;
+      }
+      if (answered == CONFIRMATIONS) {
+        return rates[i];
+      }
+    }
+  }
+  return 0;
+}
+
+PrintPacing pacingForBaudRate(uint32_t baud, uint8_t maxBurst) {
+  uint32_t bytesPerSecond = baud / 10;
+  if (bytesPerSecond > 0xFFFF) {
+    bytesPerSecond = 0xFFFF;
+  }
+  PrintPacing pacing = {(uint16_t)bytesPerSecond, 50, maxBurst, 3};
+  return pacing;
+}
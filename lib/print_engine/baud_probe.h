@@ -0,0 +1,33 @@
+#ifndef BAUD_PROBE_H
+#define BAUD_PROBE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "printer_transport.h"
+#include "print_engine.h"
+
+// Finds the printer's baud rate at boot.
+//
+// Each candidate rate is set on the transport and the printer is asked for
+// its status with DLE EOT 1, which it answers at once even while busy. At a
+// wrong rate the reply is missing or garbled, so a rate only counts once two
+// queries in a row got a well-formed status byte. Rounds over all rates
+// repeat until the printer answers or the time budget (a cold printer takes
+// a moment to power up) runs out.
+//
+// Blocks for up to budget ms. On the device the clock should yield() so the
+// watchdog stays fed.
+
+const uint32_t PRINTER_BAUD_RATES[] = {9600, 19200, 38400, 115200};
+const size_t PRINTER_BAUD_RATE_COUNT = sizeof(PRINTER_BAUD_RATES) / sizeof(PRINTER_BAUD_RATES[0]);
+
+// Returns the rate the printer answered at (left set on the transport), or 0
+// if it never did or the transport can't read or change speed.
+uint32_t probeBaudRate(PrinterTransport &transport, const uint32_t *rates, size_t count,
+                       PrintClock clock, uint32_t budget);
+
+// Engine pacing for a line speed: 10 bits per byte (8N1), bursts as large as
+// the port can take without blocking
+PrintPacing pacingForBaudRate(uint32_t baud, uint8_t maxBurst);
+
+#endif
@@ -0,0 +1,48 @@
+#include "escpos_commands.h"
+
+static const uint8_t ESC = 0x1B;
+static const uint8_t GS = 0x1D;
+static const uint8_t LF = 0x0A;
+
+bool queuePrinterSetup(PrintEngine &engine, bool waitForPowerUp, uint8_t codeTable) {
+  bool queued = true;
+
+  // Wait for capacitor to charge and printer to power up properly
+  if (waitForPowerUp) {
+    queued = engine.pause(3000) && queued;
+  }
+
+  // Reset printer to default state
+  const uint8_t reset[] = {ESC, '@'};
+  queued = engine.write(reset, sizeof(reset)) && queued;
+  queued = engine.pause(500) && queued;  // Let the reset complete
+
+  // Characters above 0x7F come from this table (the reset selects 0)
+  const uint8_t table[] = {ESC, 't', codeTable};
+  queued = engine.write(table, sizeof(table)) && queued;
+
+  // Set stronger black fill (print density/heat)
+  const uint8_t heating[] = {
+    ESC, '7',
+    15,  // Heating dots (max 15)
+    150, // Heating time
+    250  // Heating interval
+  };
+  queued = engine.write(heating, sizeof(heating)) && queued;
+  queued = engine.pause(200) && queued;
+  return engine.endJob() && queued;
+}
+
+bool queueInverse(PrintSink &sink, bool enable) {
+  const uint8_t command[] = {GS, 'B', (uint8_t)(enable ? 1 : 0)};
+  bool queued = sink.write(command, sizeof(command));
+  return sink.pause(100) && queued;  // Small pause after mode change
+}
+
+bool queueFeed(PrintSink &sink, uint8_t lines) {
+  bool queued = true;
+  for (uint8_t i = 0; i < lines; i++) {
+    queued = sink.write(LF) && queued;
+  }
+  return queued;
+}
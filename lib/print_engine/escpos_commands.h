@@ -0,0 +1,23 @@
+#ifndef ESCPOS_COMMANDS_H
+#define ESCPOS_COMMANDS_H
+
+#include <stdint.h>
+#include "print_engine.h"
+
+// The ESC/POS sequences the firmware queues for the CSN-A4L, kept here so
+// the host tests and the printer emulator check exactly the bytes the
+// printer gets. Each returns false if the queue was full. The ones that
+// take a PrintSink also render into pre-built print images.
+
+// Reset to defaults, select the code table (ESC t n) and set print
+// density, as its own job. Waits for the printer to power up first unless
+// it is known to be up already.
+bool queuePrinterSetup(PrintEngine &engine, bool waitForPowerUp, uint8_t codeTable = 0);
+
+// White-on-black printing on or off (GS B n)
+bool queueInverse(PrintSink &sink, bool enable);
+
+// Blank lines (LF), paced like printed ones
+bool queueFeed(PrintSink &sink, uint8_t lines);
+
+#endif
@@ -0,0 +1,485 @@
+#include "print_engine.h"
+#include "print_queue_format.h"
+#include <string.h>
+
+static const uint8_t ESCAPE = PRINT_ESCAPE;
+static const uint8_t OP_LITERAL = PRINT_OP_LITERAL;
+static const uint8_t OP_PAUSE = PRINT_OP_PAUSE;
+static const uint8_t OP_END_JOB = PRINT_OP_END_JOB;
+
+static const uint32_t CREDIT_PER_BYTE = 1000;
+static const uint32_t MAX_ELAPSED = 1000;  // Clamp so long idle periods can't overflow the budget
+
+static const PrintPacing DEFAULT_PACING = {960, 50, 16, 3};
+
+// === Printer protocol (CSN-A4L manual, section 7.2) ===
+static const uint8_t DLE = 0x10;
+static const uint8_t EOT = 0x04;
+static const uint8_t GS = 0x1D;
+static const uint8_t XON = 0x11;
+static const uint8_t XOFF = 0x13;
+
+// DLE EOT replies have bit 1 and bit 4 set, bits 0 and 7 clear. GS r
+// replies have bits 4 and 7 clear, so neither can be mistaken for XON/XOFF.
+static const uint8_t STATUS_REPLY_MASK = 0x93;
+static const uint8_t STATUS_REPLY_BITS = 0x12;
+static const uint8_t SYNC_REPLY_MASK = 0x90;
+
+static const uint8_t OFFLINE_COVER_OPEN = 0x04;   // DLE EOT 2
+static const uint8_t OFFLINE_PAPER_END = 0x20;
+static const uint8_t ERROR_UNRECOVERABLE = 0x20;  // DLE EOT 3
+static const uint8_t ERROR_OVERHEAT = 0x40;
+static const uint8_t PAPER_NEAR_END = 0x0C;       // DLE EOT 4 and GS r 1
+static const uint8_t PAPER_END = 0x60;            // DLE EOT 4
+
+static const uint32_t REPLY_TIMEOUT = 250;
+static const uint32_t SYNC_TIMEOUT = 3000;    // A line (or feed) never takes this long
+static const uint32_t XOFF_TIMEOUT = 10000;   // Don't hang forever on a lost XON
+static const uint8_t MAX_MISSED_REPLIES = 3;
+
+static const uint32_t POLL_IDLE = 5000;
+static const uint32_t POLL_PRINTING = 1000;
+static const uint32_t POLL_BLOCKED = 500;
+
+PrintEngine::PrintEngine() {
+  begin(nullptr, nullptr);
+}
+
+void PrintEngine::begin(PrinterTransport *printerTransport, PrintClock printClock) {
+  transport = printerTransport;
+  clock = printClock;
+  pacing = DEFAULT_PACING;
+  head = 0;
+  tail = 0;
+  count = 0;
+  lastUpdate = clock ? clock() : 0;
+  credit = 0;
+  pausing = false;
+  pauseEndsOnSync = false;
+  resumeAt = 0;
+  atBoundary = true;
+
+  memset(&printerStatus, 0, sizeof(printerStatus));
+  offlineStatus = 0;
+  errorStatus = 0;
+  paperStatus = 0;
+  syncStatus = 0;
+  pendingQuery = 0;
+  nextQuery = 2;
+  querySentAt = 0;
+  lastPollAt = lastUpdate - POLL_IDLE;  // First poll right away
+  missedReplies = 0;
+  flowStoppedAt = 0;
+
+  linesInFlight = 0;
+  syncHead = 0;
+  lastAckAt = 0;
+  measuredLineMillis = 0;
+
+  sentBytes = 0;
+  queuedJobs = 0;
+  completedJobs = 0;
+  rejectedWrites = 0;
+  jobLinesSent = 0;
+}
+
+void PrintEngine::setPacing(const PrintPacing &newPacing) {
+  pacing = newPacing;
+  if (pacing.linesInFlight == 0) {
+    pacing.linesInFlight = 1;
+  }
+  if (pacing.linesInFlight > PRINT_MAX_LINES_IN_FLIGHT) {
+    pacing.linesInFlight = PRINT_MAX_LINES_IN_FLIGHT;
+  }
+}
+
+// === Queueing ===
+// Bytes data takes in the queue: ESCAPE goes in as ESCAPE OP_LITERAL
+static size_t escapedLength(const uint8_t *data, size_t length) {
+  size_t needed = length;
+  for (size_t i = 0; i < length; i++) {
+    if (data[i] == ESCAPE) {
+      needed++;
+    }
+  }
+  return needed;
+}
+
+bool PrintEngine::write(uint8_t byte) {
+  return write(&byte, 1);
+}
+
+bool PrintEngine::write(const uint8_t *data, size_t length) {
+  if (escapedLength(data, length) > available()) {
+    rejectedWrites++;
+    return false;
+  }
+
+  for (size_t i = 0; i < length; i++) {
+    push(data[i]);
+    if (data[i] == ESCAPE) {
+      push(OP_LITERAL);
+    }
+  }
+  return true;
+}
+
+bool PrintEngine::print(const char *text) {
+  return write((const uint8_t *)text, strlen(text));
+}
+
+bool PrintEngine::println(const char *text) {
+  return println(text, strlen(text));
+}
+
+bool PrintEngine::println(const char *text, size_t length) {
+  // Text and line end go in together or not at all
+  if (escapedLength((const uint8_t *)text, length) + 2 > available()) {
+    rejectedWrites++;
+    return false;
+  }
+  return write((const uint8_t *)text, length) && print("\r\n");
+}
+
+bool PrintEngine::pause(uint16_t duration) {
+  if (available() < 4) {
+    rejectedWrites++;
+    return false;
+  }
+  push(ESCAPE);
+  push(OP_PAUSE);
+  push(duration & 0xFF);
+  push(duration >> 8);
+  return true;
+}
+
+bool PrintEngine::writeImage(const uint8_t *data, size_t length) {
+  if (length > available()) {
+    rejectedWrites++;
+    return false;
+  }
+  for (size_t i = 0; i < length; i++) {
+    push(data[i]);
+  }
+  return true;
+}
+
+bool PrintEngine::endJob() {
+  if (available() < 2) {
+    rejectedWrites++;
+    return false;
+  }
+  push(ESCAPE);
+  push(OP_END_JOB);
+  queuedJobs++;
+  return true;
+}
+
+// === Draining ===
+void PrintEngine::update() {
+  if (transport == nullptr || clock == nullptr) {
+    return;
+  }
+
+  uint32_t now = clock();
+  uint32_t elapsed = now - lastUpdate;
+  lastUpdate = now;
+  if (elapsed > MAX_ELAPSED) {
+    elapsed = MAX_ELAPSED;
+  }
+
+  readReplies(now);
+  checkTimeouts(now);
+
+  if (pausing) {
+    bool caughtUp = pauseEndsOnSync && hasFeedback() && linesInFlight == 0;
+    if (!caughtUp && (int32_t)(now - resumeAt) < 0) {
+      pollStatus(now);
+      return;
+    }
+    pausing = false;
+  }
+
+  pollStatus(now);
+
+  uint32_t maxCredit = (uint32_t)pacing.maxBurst * CREDIT_PER_BYTE;
+  credit += elapsed * pacing.bytesPerSecond;
+  if (credit > maxCredit) {
+    credit = maxCredit;
+  }
+
+  while (count > 0) {
+    // Problems only stop output between lines, so a status poll can follow
+    if (atBoundary && blocked()) {
+      return;
+    }
+    if (hasFeedback() && linesInFlight >= pacing.linesInFlight) {
+      return;
+    }
+
+    uint8_t byte = peek(0);
+
+    if (byte == ESCAPE) {
+      // An image chunk may end inside a marker; wait for the rest
+      if (count < 2 || (peek(1) == OP_PAUSE && count < 4)) {
+        return;
+      }
+      uint8_t op = peek(1);
+      if (op == OP_PAUSE) {
+        uint16_t duration = peek(2) | (peek(3) << 8);
+        drop(4);
+        atBoundary = true;
+        // With feedback the pause only lasts until the printer caught up
+        if (hasFeedback()) {
+          sendSync(now, false);
+        }
+        startPause(now, duration);
+        return;
+      }
+      if (op == OP_END_JOB) {
+        drop(2);
+        atBoundary = true;
+        completedJobs++;
+        jobLinesSent = 0;
+        continue;
+      }
+      // OP_LITERAL
+      if (!send(ESCAPE)) {
+        return;
+      }
+      drop(2);
+      atBoundary = false;
+      continue;
+    }
+
+    if (!send(byte)) {
+      return;
+    }
+    drop(1);
+    atBoundary = false;
+
+    if (byte == '\n') {
+      atBoundary = true;
+      jobLinesSent++;
+      if (hasFeedback()) {
+        // The printer tells us when the line is done
+        sendSync(now, true);
+        pollStatus(now);
+        continue;
+      }
+      // No feedback: give the mechanism time to print the line
+      uint16_t lineTime = measuredLineMillis > 0 ? measuredLineMillis : pacing.lineMillis;
+      if (lineTime > 0) {
+        startPause(now, lineTime);
+        return;
+      }
+    }
+  }
+}
+
+PrintEngineState PrintEngine::state() const {
+  if (blocked()) {
+    return PRINT_BLOCKED;
+  }
+  if (pausing) {
+    return PRINT_PAUSED;
+  }
+  return count > 0 ? PRINT_SENDING : PRINT_IDLE;
+}
+
+uint16_t PrintEngine::jobLinesPrinted() const {
+  // Syncs in flight may include pause barriers and the previous job's last
+  // lines, so this errs on the side of lines not printed yet
+  uint16_t unconfirmed = hasFeedback() ? linesInFlight : 0;
+  return jobLinesSent > unconfirmed ? jobLinesSent - unconfirmed : 0;
+}
+
+bool PrintEngine::blocked() const {
+  if (printerStatus.flowStopped) {
+    return true;
+  }
+  return printerStatus.known &&
+         (printerStatus.paperOut || printerStatus.coverOpen ||
+          printerStatus.overheated || printerStatus.failed);
+}
+
+bool PrintEngine::send(uint8_t byte) {
+  if (credit < CREDIT_PER_BYTE) {
+    return false;
+  }
+  credit -= CREDIT_PER_BYTE;
+  transport->write(byte);
+  sentBytes++;
+  return true;
+}
+
+void PrintEngine::startPause(uint32_t now, uint16_t duration) {
+  pausing = true;
+  pauseEndsOnSync = hasFeedback();
+  resumeAt = now + duration;
+  credit = 0;
+}
+
+// === Printer feedback ===
+void PrintEngine::readReplies(uint32_t now) {
+  if (!transport->canRead()) {
+    return;
+  }
+
+  int c;
+  while ((c = transport->read()) >= 0) {
+    uint8_t reply = (uint8_t)c;
+    if (reply == XON) {
+      printerStatus.flowStopped = false;
+    } else if (reply == XOFF) {
+      printerStatus.flowStopped = true;
+      flowStoppedAt = now;
+    } else if ((reply & STATUS_REPLY_MASK) == STATUS_REPLY_BITS) {
+      handleStatusReply(reply, now);
+    } else if ((reply & SYNC_REPLY_MASK) == 0) {
+      handleSyncReply(reply, now);
+    }
+  }
+}
+
+void PrintEngine::handleStatusReply(uint8_t reply, uint32_t now) {
+  (void)now;
+  if (pendingQuery == 0) {
+    return;  // Late reply to a query that already timed out
+  }
+
+  switch (pendingQuery) {
+    case 2: offlineStatus = reply; break;
+    case 3: errorStatus = reply; break;
+    case 4: paperStatus = reply; break;
+  }
+  pendingQuery = 0;
+  missedReplies = 0;
+  printerStatus.known = true;
+  updateStatusFlags();
+}
+
+void PrintEngine::handleSyncReply(uint8_t reply, uint32_t now) {
+  if (linesInFlight == 0) {
+    return;
+  }
+
+  syncStatus = reply;
+  missedReplies = 0;
+  printerStatus.known = true;
+  updateStatusFlags();
+
+  // Oldest outstanding sync
+  uint8_t oldest = (syncHead + PRINT_MAX_LINES_IN_FLIGHT - linesInFlight) % PRINT_MAX_LINES_IN_FLIGHT;
+  linesInFlight--;
+
+  if (syncIsLine[oldest]) {
+    // The line started printing when it arrived or when the previous one
+    // finished, whichever was later
+    uint32_t started = syncSentAt[oldest];
+    if ((int32_t)(lastAckAt - started) > 0) {
+      started = lastAckAt;
+    }
+    uint32_t sample = now - started;
+    if (sample > SYNC_TIMEOUT) {
+      sample = SYNC_TIMEOUT;
+    }
+    measuredLineMillis = measuredLineMillis == 0
+      ? (uint16_t)sample
+      : (uint16_t)((3 * (uint32_t)measuredLineMillis + sample) / 4);
+  }
+  lastAckAt = now;
+}
+
+void PrintEngine::checkTimeouts(uint32_t now) {
+  if (pendingQuery != 0 && now - querySentAt > REPLY_TIMEOUT) {
+    pendingQuery = 0;
+    if (missedReplies < MAX_MISSED_REPLIES) {
+      missedReplies++;
+    }
+    if (missedReplies >= MAX_MISSED_REPLIES) {
+      // Nobody is listening: back to fixed pacing
+      printerStatus.known = false;
+      linesInFlight = 0;
+    }
+  }
+
+  if (linesInFlight > 0) {
+    uint8_t oldest = (syncHead + PRINT_MAX_LINES_IN_FLIGHT - linesInFlight) % PRINT_MAX_LINES_IN_FLIGHT;
+    if (now - syncSentAt[oldest] > SYNC_TIMEOUT) {
+      // The printer went offline (paper out ignores GS r) or lost them.
+      // Ask what happened right away.
+      linesInFlight = 0;
+      lastPollAt = now - POLL_IDLE;
+    }
+  }
+
+  if (printerStatus.flowStopped && now - flowStoppedAt > XOFF_TIMEOUT) {
+    printerStatus.flowStopped = false;
+  }
+}
+
+void PrintEngine::pollStatus(uint32_t now) {
+  if (!transport->canRead() || !atBoundary || pendingQuery != 0) {
+    return;
+  }
+
+  uint32_t interval = POLL_IDLE;
+  if (blocked()) {
+    interval = POLL_BLOCKED;
+  } else if (count > 0 || linesInFlight > 0) {
+    interval = POLL_PRINTING;
+  }
+  if (now - lastPollAt < interval) {
+    return;
+  }
+
+  // Real-time query, answered immediately even while offline
+  transport->write(DLE);
+  transport->write(EOT);
+  transport->write(nextQuery);
+  pendingQuery = nextQuery;
+  querySentAt = now;
+  lastPollAt = now;
+  nextQuery = nextQuery == 4 ? 2 : nextQuery + 1;
+}
+
+void PrintEngine::sendSync(uint32_t now, bool isLine) {
+  if (linesInFlight >= PRINT_MAX_LINES_IN_FLIGHT) {
+    return;
+  }
+  // GS r 1 is answered in order, once everything before it is processed
+  transport->write(GS);
+  transport->write('r');
+  transport->write(1);
+  syncSentAt[syncHead] = now;
+  syncIsLine[syncHead] = isLine;
+  syncHead = (syncHead + 1) % PRINT_MAX_LINES_IN_FLIGHT;
+  linesInFlight++;
+}
+
+void PrintEngine::updateStatusFlags() {
+  printerStatus.coverOpen = (offlineStatus & OFFLINE_COVER_OPEN) != 0;
+  printerStatus.paperOut = (offlineStatus & OFFLINE_PAPER_END) != 0 ||
+                           (paperStatus & PAPER_END) != 0;
+  printerStatus.paperNearEnd = (paperStatus & PAPER_NEAR_END) != 0 ||
+                               (syncStatus & PAPER_NEAR_END) != 0;
+  printerStatus.overheated = (errorStatus & ERROR_OVERHEAT) != 0;
+  printerStatus.failed = (errorStatus & ERROR_UNRECOVERABLE) != 0;
+}
+
+// === Ring buffer ===
+void PrintEngine::push(uint8_t byte) {
+  buffer[head] = byte;
+  head = (head + 1) % PRINT_BUFFER_SIZE;
+  count++;
+}
+
+uint8_t PrintEngine::peek(size_t offset) const {
+  return buffer[(tail + offset) % PRINT_BUFFER_SIZE];
+}
+
+void PrintEngine::drop(size_t length) {
+  tail = (tail + length) % PRINT_BUFFER_SIZE;
+  count -= length;
+}
@@ -0,0 +1,169 @@
+#ifndef PRINT_ENGINE_H
+#define PRINT_ENGINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "printer_transport.h"
+#include "print_sink.h"
+
+// Non-blocking printer output.
+//
+// Print functions queue bytes and return at once; update(), called from the
+// main loop, drains the queue at a rate the printer can keep up with. Waits
+// the printer needs (power-up, mode changes, paper movement) are queued as
+// pause markers instead of delay(), so nothing else stalls while a receipt
+// prints.
+//
+// The queue is a byte ring buffer in the format of print_queue_format.h.
+// Jobs rendered ahead of time with PrintImageEncoder are queued as they
+// are with writeImage().
+//
+// Flow control uses the printer's TX line when it is connected:
+//  - DLE EOT 2/3/4 is polled at line boundaries for paper out, cover open
+//    and head overheating. Output stops (the queue is kept) until the
+//    condition clears.
+//  - XOFF stops output until XON.
+//  - Every printed line is followed by GS r 1, which the printer answers
+//    once it has worked through the line. At most a few lines are in flight,
+//    so output runs at the printer's real speed and pauses end as soon as
+//    the printer caught up.
+// If the printer never answers, the engine falls back to fixed pacing, using
+// the line time it last measured.
+
+const size_t PRINT_BUFFER_SIZE = 4096;  // A 2KB joke plus line breaks and header
+const uint8_t PRINT_MAX_LINES_IN_FLIGHT = 8;
+
+// Clock in milliseconds (millis() on the device, simulated in tests)
+typedef uint32_t (*PrintClock)();
+
+enum PrintEngineState {
+  PRINT_IDLE,      // Nothing queued
+  PRINT_SENDING,   // Draining bytes at the paced rate
+  PRINT_PAUSED,    // Waiting for a queued pause or a line to finish
+  PRINT_BLOCKED    // Printer reported a problem or sent XOFF
+};
+
+struct PrintPacing {
+  uint16_t bytesPerSecond;  // Sustained rate, 960 for 9600 baud 8N1
+  uint16_t lineMillis;      // Pause after every '\n' without printer feedback
+  uint8_t maxBurst;         // Bytes written per update() at most
+  uint8_t linesInFlight;    // Unacknowledged lines allowed with feedback
+};
+
+// Last known printer state, from DLE EOT / GS r replies and XON/XOFF
+struct PrinterStatus {
+  bool known;          // Printer answered recently
+  bool paperOut;
+  bool paperNearEnd;
+  bool coverOpen;
+  bool overheated;     // Head temperature or voltage out of range (recovers)
+  bool failed;         // Unrecoverable error
+  bool flowStopped;    // XOFF received
+};
+
+class PrintEngine : public PrintSink {
+public:
+  PrintEngine();
+
+  void begin(PrinterTransport *transport, PrintClock clock);
+  void setPacing(const PrintPacing &pacing);
+
+  // Queue output. Each call is all-or-nothing: false (and nothing queued)
+  // if the data doesn't fit.
+  bool write(uint8_t byte);
+  bool write(const uint8_t *data, size_t length) override;
+  bool print(const char *text);
+  bool println(const char *text);           // Appends "\r\n" like Serial.println
+  bool println(const char *text, size_t length) override;
+  bool pause(uint16_t duration) override;   // Upper bound once the printer answers
+  bool endJob();                            // Counts as one job once drained
+
+  // Queue part of a pre-rendered job (PrintImageEncoder output) as is.
+  // Chunks may split anywhere; call endJob() after the last one.
+  bool writeImage(const uint8_t *data, size_t length);
+
+  // Read replies and drain as much as the pacing allows. Call from the
+  // main loop.
+  void update();
+
+  // Progress
+  PrintEngineState state() const;
+  bool idle() const { return state() == PRINT_IDLE; }
+  size_t pending() const { return count; }
+  size_t available() const { return PRINT_BUFFER_SIZE - count; }
+  uint32_t bytesSent() const { return sentBytes; }
+  uint32_t jobsQueued() const { return queuedJobs; }
+  uint32_t jobsCompleted() const { return completedJobs; }
+  uint32_t writesRejected() const { return rejectedWrites; }
+
+  // Lines ('\n' bytes) of the job at the front of the queue that have
+  // printed. Lines the printer hasn't acknowledged don't count yet; without
+  // feedback a line counts once it was sent.
+  uint16_t jobLinesPrinted() const;
+
+  // Printer feedback
+  const PrinterStatus &status() const { return printerStatus; }
+  bool blocked() const;
+  uint16_t lineMillis() const { return measuredLineMillis; }  // Measured, 0 if unknown
+
+private:
+  void push(uint8_t byte);
+  uint8_t peek(size_t offset) const;
+  void drop(size_t length);
+  void startPause(uint32_t now, uint16_t duration);
+  bool send(uint8_t byte);
+
+  void readReplies(uint32_t now);
+  void handleStatusReply(uint8_t reply, uint32_t now);
+  void handleSyncReply(uint8_t reply, uint32_t now);
+  void checkTimeouts(uint32_t now);
+  void pollStatus(uint32_t now);
+  void sendSync(uint32_t now, bool isLine);
+  void updateStatusFlags();
+  bool hasFeedback() const { return printerStatus.known; }
+
+  PrinterTransport *transport;
+  PrintClock clock;
+  PrintPacing pacing;
+
+  uint8_t buffer[PRINT_BUFFER_SIZE];
+  size_t head;    // Next write position
+  size_t tail;    // Next read position
+  size_t count;
+
+  uint32_t lastUpdate;
+  uint32_t credit;       // Send budget in 1/1000 byte
+  bool pausing;
+  bool pauseEndsOnSync;  // Pause may end early once all lines are acknowledged
+  uint32_t resumeAt;
+  bool atBoundary;       // Last byte sent ended a line, safe for real-time commands
+
+  // Status polling (one DLE EOT query outstanding at a time)
+  PrinterStatus printerStatus;
+  uint8_t offlineStatus;  // Last raw replies to DLE EOT 2/3/4 and GS r 1
+  uint8_t errorStatus;
+  uint8_t paperStatus;
+  uint8_t syncStatus;
+  uint8_t pendingQuery;  // n of the outstanding DLE EOT n, 0 if none
+  uint8_t nextQuery;
+  uint32_t querySentAt;
+  uint32_t lastPollAt;
+  uint8_t missedReplies;
+  uint32_t flowStoppedAt;
+
+  // GS r sync replies, answered in the order they were sent
+  uint32_t syncSentAt[PRINT_MAX_LINES_IN_FLIGHT];
+  bool syncIsLine[PRINT_MAX_LINES_IN_FLIGHT];  // false for the barrier sent at a pause marker
+  uint8_t syncHead;
+  uint8_t linesInFlight;
+  uint32_t lastAckAt;
+  uint16_t measuredLineMillis;
+
+  uint32_t sentBytes;
+  uint32_t queuedJobs;
+  uint32_t completedJobs;
+  uint32_t rejectedWrites;
+  uint16_t jobLinesSent;  // Since the last end-of-job marker
+};
+
+#endif
@@ -0,0 +1,44 @@
+#include "print_image.h"
+#include "print_queue_format.h"
+
+PrintImageEncoder::PrintImageEncoder(PrintImageOutput imageOutput, void *outputContext)
+  : output(imageOutput), context(outputContext), used(0), total(0), failed(false) {
+}
+
+bool PrintImageEncoder::write(const uint8_t *data, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    put(data[i]);
+    if (data[i] == PRINT_ESCAPE) {
+      put(PRINT_OP_LITERAL);
+    }
+  }
+  return !failed;
+}
+
+bool PrintImageEncoder::pause(uint16_t duration) {
+  put(PRINT_ESCAPE);
+  put(PRINT_OP_PAUSE);
+  put(duration & 0xFF);
+  put(duration >> 8);
+  return !failed;
+}
+
+bool PrintImageEncoder::finish() {
+  flush();
+  return !failed;
+}
+
+void PrintImageEncoder::put(uint8_t byte) {
+  buffer[used++] = byte;
+  total++;
+  if (used == sizeof(buffer)) {
+    flush();
+  }
+}
+
+void PrintImageEncoder::flush() {
+  if (used > 0 && !output(buffer, used, context)) {
+    failed = true;
+  }
+  used = 0;
+}
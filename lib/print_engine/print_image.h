@@ -0,0 +1,43 @@
+#ifndef PRINT_IMAGE_H
+#define PRINT_IMAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "print_sink.h"
+
+// Renders a print job ahead of time, in the print queue's own encoding, so
+// it can be stored (the daily joke is kept next to its cache) and later
+// handed to PrintEngine::writeImage() in chunks of any size. Printing it
+// then costs no formatting at all.
+//
+// Output goes through a small buffer to a callback, so rendering needs no
+// RAM for the whole job. Images carry no end-of-job marker; call
+// PrintEngine::endJob() after the last chunk.
+
+typedef bool (*PrintImageOutput)(const uint8_t *data, size_t length, void *context);
+
+class PrintImageEncoder : public PrintSink {
+public:
+  PrintImageEncoder(PrintImageOutput output, void *context);
+
+  bool write(const uint8_t *data, size_t length) override;
+  bool pause(uint16_t duration) override;
+  using PrintSink::write;
+
+  // Flush the buffer. False if any output call failed.
+  bool finish();
+  size_t size() const { return total; }  // Encoded bytes so far
+
+private:
+  void put(uint8_t byte);
+  void flush();
+
+  PrintImageOutput output;
+  void *context;
+  uint8_t buffer[64];
+  size_t used;
+  size_t total;
+  bool failed;
+};
+
+#endif
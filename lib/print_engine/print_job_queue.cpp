@@ -0,0 +1,212 @@
+#include "print_job_queue.h"
+#include <string.h>
+
+PrintJobQueue::PrintJobQueue() : nextId(1), rejectedJobs(0) {
+  memset(jobs, 0, sizeof(jobs));
+}
+
+uint32_t PrintJobQueue::add(PrintJobType type, PrintJobPriority priority,
+                            const char *text, size_t textLength,
+                            const char *date, bool scheduled) {
+  return store(type, priority, text, textLength, date, scheduled, PRINT_JOB_QUEUED);
+}
+
+uint32_t PrintJobQueue::reserve(PrintJobPriority priority, const char *date) {
+  uint32_t id = store(PRINT_JOB_RECEIPT, priority, nullptr, 0, date, false, PRINT_JOB_RECEIVING);
+  if (id != 0) {
+    find(id)->textInFile = true;
+  }
+  return id;
+}
+
+uint32_t PrintJobQueue::hold(PrintJobPriority priority, const char *text, size_t textLength, const char *date) {
+  return store(PRINT_JOB_RECEIPT, priority, text, textLength, date, false, PRINT_JOB_RECEIVING);
+}
+
+uint32_t PrintJobQueue::store(PrintJobType type, PrintJobPriority priority,
+                              const char *text, size_t textLength,
+                              const char *date, bool scheduled, PrintJobStatus status) {
+  size_t dateLength = date ? strlen(date) : 0;
+  if (textLength > PRINT_JOB_TEXT_MAX || dateLength > PRINT_JOB_DATE_MAX) {
+    rejectedJobs++;
+    return 0;
+  }
+
+  PrintJob *job = freeSlot();
+  if (!job) {
+    rejectedJobs++;
+    return 0;
+  }
+
+  job->id = nextId++;
+  if (nextId == 0) {
+    nextId = 1;
+  }
+  job->ticket = 0;
+  job->type = type;
+  job->priority = priority;
+  job->scheduled = scheduled;
+  memcpy(job->date, date ? date : "", dateLength);
+  job->date[dateLength] = '\0';
+  if (textLength > 0) {
+    memcpy(job->text, text, textLength);
+  }
+  job->text[textLength] = '\0';
+  job->textLength = textLength;
+  job->textInFile = false;
+  job->resumeLine = 0;
+  job->status = status;  // Last, the job is complete now
+  return job->id;
+}
+
+bool PrintJobQueue::commit(uint32_t id, uint16_t fileLength) {
+  PrintJob *job = find(id);
+  if (!job || job->status != PRINT_JOB_RECEIVING) {
+    return false;
+  }
+  if (job->textInFile) {
+    job->textLength = fileLength;
+  }
+  job->status = PRINT_JOB_QUEUED;
+  return true;
+}
+
+bool PrintJobQueue::cancel(uint32_t id) {
+  PrintJob *job = find(id);
+  if (!job || job->status != PRINT_JOB_RECEIVING) {
+    return false;
+  }
+  job->status = PRINT_JOB_FREE;
+  job->textInFile = false;
+  return true;
+}
+
+bool PrintJobQueue::restore(const PrintJob &job) {
+  PrintJob *slot = freeSlot();
+  if (!slot) {
+    return false;
+  }
+  *slot = job;
+  slot->ticket = 0;
+  slot->status = PRINT_JOB_QUEUED;
+  if (job.id >= nextId) {
+    nextId = job.id + 1;
+  }
+  return true;
+}
+
+// A free slot, or else the one of the oldest finished job. Jobs whose
+// message file is still there keep their slot until it is removed.
+PrintJob *PrintJobQueue::freeSlot() {
+  PrintJob *slot = nullptr;
+  for (uint8_t i = 0; i < PRINT_JOB_SLOTS; i++) {
+    PrintJob &candidate = jobs[i];
+    if (candidate.status == PRINT_JOB_FREE) {
+      return &candidate;
+    }
+    if ((candidate.status == PRINT_JOB_DONE || candidate.status == PRINT_JOB_FAILED) &&
+        !candidate.textInFile && (!slot || candidate.id < slot->id)) {
+      slot = &candidate;
+    }
+  }
+  return slot;
+}
+
+PrintJob *PrintJobQueue::next() {
+  PrintJob *best = nullptr;
+  for (uint8_t i = 0; i < PRINT_JOB_SLOTS; i++) {
+    PrintJob &job = jobs[i];
+    if (job.status != PRINT_JOB_QUEUED) {
+      continue;
+    }
+    if (!best || job.priority > best->priority ||
+        (job.priority == best->priority && job.id < best->id)) {
+      best = &job;
+    }
+  }
+  return best;
+}
+
+void PrintJobQueue::start(PrintJob &job, uint32_t ticket) {
+  job.ticket = ticket;
+  job.status = PRINT_JOB_PRINTING;
+}
+
+void PrintJobQueue::fail(PrintJob &job) {
+  job.status = PRINT_JOB_FAILED;
+}
+
+void PrintJobQueue::update(uint32_t jobsCompleted) {
+  for (uint8_t i = 0; i < PRINT_JOB_SLOTS; i++) {
+    PrintJob &job = jobs[i];
+    if (job.status == PRINT_JOB_PRINTING && jobsCompleted >= job.ticket) {
+      job.status = PRINT_JOB_DONE;
+    }
+  }
+}
+
+PrintJob *PrintJobQueue::find(uint32_t id) {
+  return const_cast<PrintJob *>(static_cast<const PrintJobQueue *>(this)->find(id));
+}
+
+const PrintJob *PrintJobQueue::find(uint32_t id) const {
+  for (uint8_t i = 0; i < PRINT_JOB_SLOTS; i++) {
+    if (jobs[i].status != PRINT_JOB_FREE && jobs[i].id == id) {
+      return &jobs[i];
+    }
+  }
+  return nullptr;
+}
+
+PrintJob *PrintJobQueue::queued(PrintJobType type) {
+  PrintJob *oldest = nullptr;
+  for (uint8_t i = 0; i < PRINT_JOB_SLOTS; i++) {
+    PrintJob &job = jobs[i];
+    if (job.status == PRINT_JOB_QUEUED && job.type == type && (!oldest || job.id < oldest->id)) {
+      oldest = &job;
+    }
+  }
+  return oldest;
+}
+
+uint8_t PrintJobQueue::depth() const {
+  uint8_t pending = 0;
+  for (uint8_t i = 0; i < PRINT_JOB_SLOTS; i++) {
+    if (jobs[i].status == PRINT_JOB_RECEIVING || jobs[i].status == PRINT_JOB_QUEUED ||
+        jobs[i].status == PRINT_JOB_PRINTING) {
+      pending++;
+    }
+  }
+  return pending;
+}
+
+const char *printJobTypeName(PrintJobType type) {
+  switch (type) {
+    case PRINT_JOB_RECEIPT: return "receipt";
+    case PRINT_JOB_JOKE: return "joke";
+    case PRINT_JOB_SERVER_INFO: return "serverInfo";
+    case PRINT_JOB_PAST_JOKE: return "pastJoke";
+  }
+  return "unknown";
+}
+
+const char *printJobPriorityName(PrintJobPriority priority) {
+  switch (priority) {
+    case PRINT_PRIORITY_LOW: return "low";
+    case PRINT_PRIORITY_NORMAL: return "normal";
+    case PRINT_PRIORITY_HIGH: return "high";
+  }
+  return "unknown";
+}
+
+const char *printJobStatusName(PrintJobStatus status) {
+  switch (status) {
+    case PRINT_JOB_FREE: return "free";
+    case PRINT_JOB_RECEIVING: return "receiving";
+    case PRINT_JOB_QUEUED: return "queued";
+    case PRINT_JOB_PRINTING: return "printing";
+    case PRINT_JOB_DONE: return "done";
+    case PRINT_JOB_FAILED: return "failed";
+  }
+  return "unknown";
+}
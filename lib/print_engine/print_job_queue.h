@@ -0,0 +1,137 @@
+#ifndef PRINT_JOB_QUEUE_H
+#define PRINT_JOB_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Print jobs waiting for the printer: receipts from the web form, jokes and
+// the server info printed at start-up.
+//
+// A fixed number of slots, each holding everything the job needs, so the
+// web server's callbacks can queue a job without touching the heap. Jobs
+// print highest priority first, in the order they were queued within a
+// priority. Finished jobs stay in their slot, where their status can still
+// be looked up, until the slot is needed again.
+//
+// The web server's callbacks and the main loop take turns on the ESP8266
+// (callbacks only run while the loop yields), so no locking is needed.
+// add() writes the job before it marks the slot as queued.
+//
+// Messages too long for a slot are streamed to a file while the request
+// body arrives: reserve() takes the slot, commit() queues the job once the
+// file is complete. A finished job keeps its slot until textInFile is
+// cleared (the file removed). Batches hold() each receipt the same way and
+// commit all of them once the last one is in, or cancel() all.
+
+const uint8_t PRINT_JOB_SLOTS = 8;
+const size_t PRINT_JOB_TEXT_MAX = 400;  // Message kept in the slot (form parameter)
+const size_t PRINT_JOB_DATE_MAX = 10;   // "YYYY-MM-DD" or "DD/MM/YYYY"
+
+// Content type of a message sent as the request body. ESPAsyncWebServer
+// parses a text/plain body as form parameters when it starts like one
+// ("2+2=4"), so the body goes as a type it leaves alone.
+const char PRINT_JOB_BODY_TYPE[] = "application/octet-stream";
+
+enum PrintJobType {
+  PRINT_JOB_RECEIPT,
+  PRINT_JOB_JOKE,
+  PRINT_JOB_SERVER_INFO,
+  PRINT_JOB_PAST_JOKE    // A joke from the history, by its date
+};
+
+enum PrintJobPriority {
+  PRINT_PRIORITY_LOW,
+  PRINT_PRIORITY_NORMAL,
+  PRINT_PRIORITY_HIGH
+};
+
+enum PrintJobStatus {
+  PRINT_JOB_FREE,      // Slot unused
+  PRINT_JOB_RECEIVING, // Message still streaming in
+  PRINT_JOB_QUEUED,    // Waiting for its turn
+  PRINT_JOB_PRINTING,  // Handed to the print engine, not yet drained
+  PRINT_JOB_DONE,
+  PRINT_JOB_FAILED     // Dropped or replaced by an error receipt
+};
+
+struct PrintJob {
+  uint32_t id;           // Counts up from 1, 0 means none
+  uint32_t ticket;       // Print engine job count once this one has drained
+  PrintJobType type;
+  PrintJobPriority priority;
+  PrintJobStatus status;
+  bool scheduled;        // Joke printed by the daily schedule
+  char date[PRINT_JOB_DATE_MAX + 1];  // Receipt date as submitted, empty for today;
+                                      // the past joke's date for PRINT_JOB_PAST_JOKE
+  char text[PRINT_JOB_TEXT_MAX + 1];  // Receipt message, UTF-8
+  uint16_t textLength;
+  bool textInFile;       // Message of textLength bytes in a file rather than text
+  uint16_t resumeLine;   // Lines printed before a reset (print_spool.h)
+};
+
+class PrintJobQueue {
+public:
+  PrintJobQueue();
+
+  // Queue a job, returning its ID. 0 (and nothing queued) if every slot
+  // holds an unfinished job, or text or date are longer than the slot.
+  // Both are copied.
+  uint32_t add(PrintJobType type, PrintJobPriority priority,
+               const char *text = nullptr, size_t textLength = 0,
+               const char *date = nullptr, bool scheduled = false);
+
+  // The job to print next, null if none is queued
+  PrintJob *next();
+
+  // Job handed to the print engine; it is done once the engine has
+  // completed `ticket` jobs in total
+  void start(PrintJob &job, uint32_t ticket);
+  void fail(PrintJob &job);
+
+  // Mark printing jobs done, given PrintEngine::jobsCompleted()
+  void update(uint32_t jobsCompleted);
+
+  // Take a slot for a receipt whose message streams into a file, 0 if
+  // none is free. It is neither printed nor journaled until commit().
+  uint32_t reserve(PrintJobPriority priority, const char *date = nullptr);
+
+  // Like add(), but the receipt waits for commit() as well
+  uint32_t hold(PrintJobPriority priority, const char *text, size_t textLength, const char *date = nullptr);
+
+  // Queue a reserved or held job, given the size of a reserved job's file
+  bool commit(uint32_t id, uint16_t fileLength = 0);
+
+  // Give a reserved or held job's slot back as if it was never taken (a
+  // reserved job's file is the caller's to remove)
+  bool cancel(uint32_t id);
+
+  // Put a job back after a reset, with its ID and progress, as queued.
+  // False if no slot is free.
+  bool restore(const PrintJob &job);
+
+  PrintJob *find(uint32_t id);
+  const PrintJob *find(uint32_t id) const;
+  PrintJob *queued(PrintJobType type);       // Oldest queued job of a type
+
+  // Slots in no particular order; check status for PRINT_JOB_FREE
+  PrintJob &slot(uint8_t index) { return jobs[index]; }
+  const PrintJob &slot(uint8_t index) const { return jobs[index]; }
+  uint8_t depth() const;                     // Receiving, queued or printing
+  bool full() const { return depth() == PRINT_JOB_SLOTS; }
+  uint32_t jobsRejected() const { return rejectedJobs; }
+
+private:
+  uint32_t store(PrintJobType type, PrintJobPriority priority, const char *text, size_t textLength,
+                 const char *date, bool scheduled, PrintJobStatus status);
+  PrintJob *freeSlot();
+
+  PrintJob jobs[PRINT_JOB_SLOTS];
+  uint32_t nextId;
+  uint32_t rejectedJobs;
+};
+
+const char *printJobTypeName(PrintJobType type);
+const char *printJobPriorityName(PrintJobPriority priority);
+const char *printJobStatusName(PrintJobStatus status);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef PRINT_QUEUE_FORMAT_H
+#define PRINT_QUEUE_FORMAT_H
+
+#include <stdint.h>
+
+// Encoding of the print queue, shared by PrintEngine and PrintImageEncoder.
+// Bytes go through unchanged except 0xFF, which introduces an engine
+// command.
+const uint8_t PRINT_ESCAPE = 0xFF;
+const uint8_t PRINT_OP_LITERAL = 0x00;   // PRINT_ESCAPE PRINT_OP_LITERAL: a literal 0xFF
+const uint8_t PRINT_OP_PAUSE = 0x01;     // PRINT_ESCAPE PRINT_OP_PAUSE lo hi: pause in ms
+const uint8_t PRINT_OP_END_JOB = 0x02;   // PRINT_ESCAPE PRINT_OP_END_JOB
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef PRINT_SINK_H
+#define PRINT_SINK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Where a print job is composed: the print queue itself (PrintEngine), or
+// an encoder that renders the job ahead of time (PrintImageEncoder). Job
+// builders take a PrintSink so the same code serves both.
+class PrintSink {
+public:
+  virtual ~PrintSink() {}
+  virtual bool write(const uint8_t *data, size_t length) = 0;
+  virtual bool pause(uint16_t duration) = 0;
+
+  // Text plus "\r\n"
+  virtual bool println(const char *text, size_t length) {
+    return write((const uint8_t *)text, length) && print("\r\n");
+  }
+
+  bool write(uint8_t byte) { return write(&byte, 1); }
+  bool print(const char *text) { return write((const uint8_t *)text, strlen(text)); }
+  bool println(const char *text) { return println(text, strlen(text)); }
+};
+
+#endif
@@ -0,0 +1,274 @@
+#include "print_spool.h"
+#include <string.h>
+#include "byte_io.h"
+
+static const uint8_t RECORD_MAGIC = 0xA5;
+static const size_t RECORD_HEADER = 4;   // Magic, kind, payload length
+static const size_t RECORD_CRC = 2;
+
+static const uint8_t RECORD_JOB = 1;
+static const uint8_t RECORD_PROGRESS = 2;
+static const uint8_t RECORD_DONE = 3;
+
+static const size_t JOB_FIXED_PAYLOAD = 12;  // Everything but date and text
+static const uint8_t JOB_SCHEDULED = 0x01;   // Flags
+static const uint8_t JOB_TEXT_IN_FILE = 0x02;
+
+static bool isJournaled(const PrintJob &job) {
+  return job.type != PRINT_JOB_SERVER_INFO &&
+         (job.status == PRINT_JOB_QUEUED || job.status == PRINT_JOB_PRINTING);
+}
+
+PrintSpool::PrintSpool(SpoolStorage &storage, size_t compactSize)
+  : storage(storage), compactSize(compactSize), journalSize(0), rewriting(false), failed(false) {
+  memset(slots, 0, sizeof(slots));
+}
+
+// === Writing ===
+// The payload is already in record after the header
+bool PrintSpool::appendRecord(uint8_t kind, size_t payloadLength) {
+  record[0] = RECORD_MAGIC;
+  record[1] = kind;
+  putU16(record + 2, payloadLength);
+  size_t length = RECORD_HEADER + payloadLength;
+  putU16(record + length, crc16(CRC16_INIT, record, length));
+  length += RECORD_CRC;
+
+  if (!storage.append(record, length)) {
+    // Don't leave a torn record for later ones to hide behind (a failed
+    // rewrite is dropped as a whole)
+    if (!rewriting) {
+      storage.truncate(journalSize);
+    }
+    failed = true;
+    return false;
+  }
+  journalSize += length;
+  return true;
+}
+
+bool PrintSpool::appendJob(const PrintJob &job) {
+  uint8_t *payload = record + RECORD_HEADER;
+  size_t dateLength = strlen(job.date);
+  size_t textLength = job.textInFile ? 0 : job.textLength;  // The file itself stays as it is
+  putU32(payload, job.id);
+  payload[4] = job.type;
+  payload[5] = job.priority;
+  payload[6] = (job.scheduled ? JOB_SCHEDULED : 0) | (job.textInFile ? JOB_TEXT_IN_FILE : 0);
+  putU16(payload + 7, job.resumeLine);
+  payload[9] = dateLength;
+  memcpy(payload + 10, job.date, dateLength);
+  putU16(payload + 10 + dateLength, job.textLength);
+  memcpy(payload + 12 + dateLength, job.text, textLength);
+  return appendRecord(RECORD_JOB, JOB_FIXED_PAYLOAD + dateLength + textLength);
+}
+
+bool PrintSpool::appendProgress(uint32_t id, uint16_t lines) {
+  putU32(record + RECORD_HEADER, id);
+  putU16(record + RECORD_HEADER + 4, lines);
+  return appendRecord(RECORD_PROGRESS, 6);
+}
+
+bool PrintSpool::appendDone(uint32_t id) {
+  putU32(record + RECORD_HEADER, id);
+  return appendRecord(RECORD_DONE, 4);
+}
+
+// A new journal with only the live jobs, each with its progress
+void PrintSpool::rewrite(const PrintJobQueue &queue) {
+  size_t oldSize = journalSize;
+  bool written = storage.beginRewrite();
+  rewriting = true;
+  journalSize = 0;
+
+  for (uint8_t i = 0; i < PRINT_JOB_SLOTS && written; i++) {
+    const PrintJob &job = queue.slot(i);
+    if (!isJournaled(job)) {
+      continue;
+    }
+    PrintJob progressed = job;
+    if (slots[i].id == job.id && slots[i].lines > job.resumeLine) {
+      progressed.resumeLine = slots[i].lines;
+    }
+    written = appendJob(progressed);
+  }
+
+  rewriting = false;
+  if (written && storage.commitRewrite()) {
+    for (uint8_t i = 0; i < PRINT_JOB_SLOTS; i++) {
+      const PrintJob &job = queue.slot(i);
+      if (isJournaled(job)) {
+        uint16_t lines = slots[i].id == job.id && slots[i].lines > job.resumeLine ? slots[i].lines : job.resumeLine;
+        slots[i] = {job.id, lines, true};
+      } else {
+        slots[i] = {0, 0, false};
+      }
+    }
+    return;
+  }
+
+  // The old journal is still complete
+  storage.abortRewrite();
+  journalSize = oldSize;
+  failed = true;
+}
+
+void PrintSpool::update(PrintJobQueue &queue, uint32_t jobsCompleted, uint16_t frontLines, bool force) {
+  bool wrote = false;
+
+  // Finished jobs first, so the journal never holds more unfinished jobs
+  // than the queue has slots. A reused slot means its job finished too.
+  for (uint8_t i = 0; i < PRINT_JOB_SLOTS; i++) {
+    const PrintJob &job = queue.slot(i);
+    Slot &slot = slots[i];
+    if (slot.open && (job.id != slot.id || !isJournaled(job))) {
+      appendDone(slot.id);
+      slot.open = false;
+      wrote = true;
+    }
+  }
+
+  for (uint8_t i = 0; i < PRINT_JOB_SLOTS; i++) {
+    const PrintJob &job = queue.slot(i);
+    Slot &slot = slots[i];
+    if (isJournaled(job) && slot.id != job.id) {
+      appendJob(job);
+      slot = {job.id, job.resumeLine, true};
+      wrote = true;
+    }
+  }
+
+  // Progress of the job the printer is working on
+  for (uint8_t i = 0; i < PRINT_JOB_SLOTS; i++) {
+    const PrintJob &job = queue.slot(i);
+    Slot &slot = slots[i];
+    if (!slot.open || slot.id != job.id || job.status != PRINT_JOB_PRINTING ||
+        job.ticket != jobsCompleted + 1) {
+      continue;
+    }
+    uint16_t lines = job.resumeLine + frontLines;
+    if (lines > slot.lines && (force || lines - slot.lines >= SPOOL_PROGRESS_LINES)) {
+      appendProgress(job.id, lines);
+      slot.lines = lines;
+      wrote = true;
+    }
+  }
+
+  if (wrote) {
+    storage.sync();
+  }
+
+  bool live = false;
+  for (uint8_t i = 0; i < PRINT_JOB_SLOTS; i++) {
+    live = live || slots[i].open;
+  }
+  if (!live && journalSize > 0) {
+    // Nothing left to resume
+    if (storage.truncate(0)) {
+      journalSize = 0;
+    }
+  } else if (journalSize > compactSize) {
+    rewrite(queue);
+  }
+}
+
+// === Recovery ===
+void PrintSpool::applyRecord(PrintJobQueue &queue, uint8_t kind, size_t payloadLength) {
+  const uint8_t *payload = record + RECORD_HEADER;
+  if (kind == RECORD_JOB && payloadLength >= JOB_FIXED_PAYLOAD) {
+    PrintJob job;
+    memset(&job, 0, sizeof(job));
+    job.id = getU32(payload);
+    job.type = (PrintJobType)payload[4];
+    job.priority = (PrintJobPriority)payload[5];
+    job.scheduled = (payload[6] & JOB_SCHEDULED) != 0;
+    job.textInFile = (payload[6] & JOB_TEXT_IN_FILE) != 0;
+    job.resumeLine = getU16(payload + 7);
+    size_t dateLength = payload[9];
+    if (dateLength > PRINT_JOB_DATE_MAX || JOB_FIXED_PAYLOAD + dateLength > payloadLength) {
+      return;
+    }
+    memcpy(job.date, payload + 10, dateLength);
+    job.textLength = getU16(payload + 10 + dateLength);
+    size_t textLength = job.textInFile ? 0 : job.textLength;
+    if (textLength > PRINT_JOB_TEXT_MAX || JOB_FIXED_PAYLOAD + dateLength + textLength != payloadLength) {
+      return;
+    }
+    memcpy(job.text, payload + 12 + dateLength, textLength);
+    if (!queue.find(job.id)) {
+      queue.restore(job);
+    }
+  } else if (kind == RECORD_PROGRESS && payloadLength == 6) {
+    PrintJob *job = queue.find(getU32(payload));
+    if (job) {
+      job->resumeLine = getU16(payload + 4);
+    }
+  } else if (kind == RECORD_DONE && payloadLength == 4) {
+    PrintJob *job = queue.find(getU32(payload));
+    if (job) {
+      job->status = PRINT_JOB_DONE;
+    }
+  }
+  // Unknown kinds are skipped
+}
+
+uint8_t PrintSpool::recover(PrintJobQueue &queue) {
+  size_t size = storage.size();
+  size_t offset = 0;
+
+  while (offset + RECORD_HEADER + RECORD_CRC <= size) {
+    if (storage.read(offset, record, RECORD_HEADER) != RECORD_HEADER || record[0] != RECORD_MAGIC) {
+      break;
+    }
+    size_t payloadLength = getU16(record + 2);
+    size_t length = RECORD_HEADER + payloadLength + RECORD_CRC;
+    if (length > sizeof(record) || offset + length > size) {
+      break;
+    }
+    if (storage.read(offset + RECORD_HEADER, record + RECORD_HEADER, payloadLength + RECORD_CRC) !=
+        payloadLength + RECORD_CRC) {
+      break;
+    }
+    if (crc16(CRC16_INIT, record, RECORD_HEADER + payloadLength) != getU16(record + RECORD_HEADER + payloadLength)) {
+      break;
+    }
+    applyRecord(queue, record[1], payloadLength);
+    offset += length;
+  }
+
+  // Everything after the committed end was cut off by the reset
+  journalSize = offset;
+  if (offset < size && !storage.truncate(offset)) {
+    failed = true;
+  }
+
+  memset(slots, 0, sizeof(slots));
+  if (journalSize > 0) {
+    // Start over with only what is left to print
+    rewrite(queue);
+  }
+
+  uint8_t restored = 0;
+  for (uint8_t i = 0; i < PRINT_JOB_SLOTS; i++) {
+    if (queue.slot(i).status == PRINT_JOB_QUEUED) {
+      restored++;
+    }
+  }
+  return restored;
+}
+
+// === Resuming ===
+bool ResumeSink::write(const uint8_t *data, size_t length) {
+  size_t start = 0;
+  while (skip > 0 && start < length) {
+    if (data[start] == '\n') {
+      skip--;
+    }
+    start++;
+  }
+  return start == length || target.write(data + start, length - start);
+}
+
+bool ResumeSink::pause(uint16_t duration) {
+  return skip > 0 || target.pause(duration);
+}
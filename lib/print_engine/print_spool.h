@@ -0,0 +1,192 @@
+#ifndef PRINT_SPOOL_H
+#define PRINT_SPOOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "print_job_queue.h"
+#include "print_sink.h"
+
+// Journal of the print job queue on flash, so receipts and jokes survive a
+// reset (power loss, or the restart on WiFi loss) and pick up at the line
+// they had reached.
+//
+// The journal is one append-only file of records:
+//   0xA5, kind, payload length (uint16 LE), payload, CRC-16 of all before
+// JOB holds a whole job (a streamed message stays in its own file until
+// the job is done), PROGRESS the lines of it printed so far and DONE
+// marks it finished. A record counts once its CRC is on flash: recovery
+// reads up to the first incomplete or damaged record (the committed end)
+// and cuts the file there, so a reset mid-write loses at most that record.
+//
+// To spare the flash, update() writes one batch per call and records
+// progress every SPOOL_PROGRESS_LINES lines only, so a reset reprints up
+// to that many lines. Once every journaled job is finished the file is
+// emptied; while jobs stay pending it is compacted (rewritten with only
+// the live jobs, then swapped in) when it grows past the limit. The server
+// info isn't journaled, it is queued again at start-up anyway.
+
+const uint16_t SPOOL_PROGRESS_LINES = 4;
+const size_t SPOOL_COMPACT_SIZE = 8192;
+
+// The journal file. LittleFS on the device; host tests use memory and
+// inject resets at every byte.
+class SpoolStorage {
+public:
+  virtual ~SpoolStorage() {}
+  virtual size_t size() = 0;
+  virtual size_t read(size_t offset, uint8_t *data, size_t length) = 0;
+  virtual bool append(const uint8_t *data, size_t length) = 0;
+  virtual bool sync() = 0;                  // Make the batch so far durable
+  virtual bool truncate(size_t length) = 0;
+
+  // Compaction: appends go to a new file until commitRewrite() replaces
+  // the journal with it in one step. A reset before that keeps the old one.
+  virtual bool beginRewrite() = 0;
+  virtual bool commitRewrite() = 0;
+  virtual void abortRewrite() = 0;
+};
+
+class PrintSpool {
+public:
+  explicit PrintSpool(SpoolStorage &storage, size_t compactSize = SPOOL_COMPACT_SIZE);
+
+  // After a reset: put unfinished jobs back into the (empty) queue with
+  // their progress in resumeLine. Returns how many.
+  uint8_t recover(PrintJobQueue &queue);
+
+  // Journal what changed since the last call: new jobs, finished jobs and
+  // the progress of the job at the front of the print queue (the printing
+  // job with ticket jobsCompleted + 1, frontLines as from
+  // PrintEngine::jobLinesPrinted()). force records progress however little
+  // there is, before a planned restart.
+  void update(PrintJobQueue &queue, uint32_t jobsCompleted, uint16_t frontLines, bool force = false);
+
+  bool healthy() const { return !failed; }  // False once a write failed
+
+private:
+  struct Slot {
+    uint32_t id;     // Job journaled from this queue slot, 0 if none
+    uint16_t lines;  // Progress journaled
+    bool open;       // No DONE record yet
+  };
+
+  bool appendRecord(uint8_t kind, size_t payloadLength);
+  bool appendJob(const PrintJob &job);
+  bool appendProgress(uint32_t id, uint16_t lines);
+  bool appendDone(uint32_t id);
+  void rewrite(const PrintJobQueue &queue);
+  void applyRecord(PrintJobQueue &queue, uint8_t kind, size_t payloadLength);
+
+  SpoolStorage &storage;
+  size_t compactSize;
+  Slot slots[PRINT_JOB_SLOTS];
+  size_t journalSize;     // Bytes in the journal (or the rewrite so far)
+  bool rewriting;
+  bool failed;
+  uint8_t record[4 + 12 + PRINT_JOB_DATE_MAX + PRINT_JOB_TEXT_MAX + 2];  // Fits the largest JOB record
+};
+
+// Passes a job on to another sink without its first `lines` lines, to
+// resume it where it stopped. Lines are counted as '\n' bytes, the way
+// PrintEngine counts them; pauses before the resume point are dropped.
+class ResumeSink : public PrintSink {
+public:
+  ResumeSink(PrintSink &target, uint16_t lines) : target(target), skip(lines) {}
+
+  bool write(const uint8_t *data, size_t length) override;
+  bool pause(uint16_t duration) override;
+  using PrintSink::write;
+
+  void skipLines(uint16_t lines) { skip = lines; }  // Start over for another job
+
+private:
+  PrintSink &target;
+  uint16_t skip;
+};
+
+#ifdef ARDUINO
+#include <LittleFS.h>
+
+// The journal as a LittleFS file. A batch is appended through one open
+// file, so it costs one metadata commit.
+class LittleFSSpoolStorage : public SpoolStorage {
+public:
+  LittleFSSpoolStorage(const char *path, const char *tempPath) : path(path), tempPath(tempPath) {}
+
+  size_t size() override {
+    File file = LittleFS.open(path, "r");
+    size_t length = file ? file.size() : 0;
+    file.close();
+    return length;
+  }
+
+  size_t read(size_t offset, uint8_t *data, size_t length) override {
+    File file = LittleFS.open(path, "r");
+    if (!file || !file.seek(offset)) {
+      return 0;
+    }
+    size_t got = file.read(data, length);
+    file.close();
+    return got;
+  }
+
+  bool append(const uint8_t *data, size_t length) override {
+    if (!batch) {
+      batch = LittleFS.open(rewriting ? tempPath : path, rewriting ? "w" : "a");
+      if (!batch) {
+        return false;
+      }
+    }
+    return batch.write(data, length) == length;
+  }
+
+  bool sync() override {
+    if (batch) {
+      batch.close();
+    }
+    return true;
+  }
+
+  bool truncate(size_t length) override {
+    sync();
+    if (length == 0) {
+      return !LittleFS.exists(path) || LittleFS.remove(path);
+    }
+    File file = LittleFS.open(path, "r+");
+    bool truncated = file && file.truncate(length);
+    file.close();
+    return truncated;
+  }
+
+  bool beginRewrite() override {
+    sync();
+    rewriting = true;
+    return true;
+  }
+
+  bool commitRewrite() override {
+    bool written = (bool)batch;
+    sync();
+    rewriting = false;
+    if (!written) {
+      // Nothing live: an empty journal
+      return truncate(0);
+    }
+    return LittleFS.rename(tempPath, path);
+  }
+
+  void abortRewrite() override {
+    sync();
+    rewriting = false;
+    LittleFS.remove(tempPath);
+  }
+
+private:
+  const char *path;
+  const char *tempPath;
+  File batch;
+  bool rewriting = false;
+};
+#endif
+
+#endif
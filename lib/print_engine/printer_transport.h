@@ -0,0 +1,77 @@
+#ifndef PRINTER_TRANSPORT_H
+#define PRINTER_TRANSPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The byte sink the print engine drains into. On the device this wraps the
+// printer's serial port; host tests use a mock that records every byte
+// together with the simulated time it was sent.
+//
+// Transports that can hear the printer (its TX wired to our RX) also
+// return status replies and XON/XOFF from read(). Serial ports can change
+// speed, which the baud rate probe (baud_probe.h) relies on.
+class PrinterTransport {
+public:
+  virtual ~PrinterTransport() {}
+  virtual size_t write(uint8_t byte) = 0;
+  virtual bool canRead() const { return false; }
+  virtual int read() { return -1; }  // -1 if nothing received
+  virtual bool setBaudRate(uint32_t baud) { (void)baud; return false; }
+};
+
+#ifdef ARDUINO
+#include <Stream.h>
+#include <HardwareSerial.h>
+#include <SoftwareSerial.h>
+
+// Any Arduino Stream (SoftwareSerial, HardwareSerial). Pass receive = false
+// when the printer's TX isn't connected.
+class StreamTransport : public PrinterTransport {
+public:
+  explicit StreamTransport(Stream &stream, bool receive = true)
+    : stream(stream), receive(receive) {}
+  size_t write(uint8_t byte) override { return stream.write(byte); }
+  bool canRead() const override { return receive; }
+  int read() override { return stream.available() > 0 ? stream.read() : -1; }
+
+private:
+  Stream &stream;
+  bool receive;
+};
+
+// Bit-banged serial. Interrupts are off while each byte goes out, about
+// 1 ms per byte at 9600 baud.
+class SoftwareSerialTransport : public StreamTransport {
+public:
+  explicit SoftwareSerialTransport(SoftwareSerial &port) : StreamTransport(port), port(port) {}
+  bool setBaudRate(uint32_t baud) override { port.begin(baud); return true; }
+
+private:
+  SoftwareSerial &port;
+};
+
+// Hardware UART: bytes go through the 128-byte TX FIFO without blocking.
+//  - Serial1 transmits on GPIO2 (D4) only, so there is no status feedback.
+//  - Serial swapped to GPIO15 (D8, TX) and GPIO13 (D7, RX) is a full
+//    duplex port, but the debug console then has to move to Serial1.
+class HardwareSerialTransport : public StreamTransport {
+public:
+  HardwareSerialTransport(HardwareSerial &port, bool receive, bool swapped = false)
+    : StreamTransport(port, receive), port(port), swapped(swapped) {}
+
+  bool setBaudRate(uint32_t baud) override {
+    port.begin(baud, SERIAL_8N1, canRead() ? SERIAL_FULL : SERIAL_TX_ONLY);
+    if (swapped) {
+      port.swap();  // begin() puts UART0 back on GPIO1/3
+    }
+    return true;
+  }
+
+private:
+  HardwareSerial &port;
+  bool swapped;
+};
+#endif
+
+#endif
@@ -0,0 +1,101 @@
+#include "png_writer.h"
+#include <stdio.h>
+#include <vector>
+
+static uint32_t crcTable[256];
+
+static void buildCrcTable() {
+  for (uint32_t n = 0; n < 256; n++) {
+    uint32_t c = n;
+    for (int k = 0; k < 8; k++) {
+      c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+    }
+    crcTable[n] = c;
+  }
+}
+
+static void putBigEndian(std::vector<uint8_t> &out, uint32_t value) {
+  out.push_back(value >> 24);
+  out.push_back(value >> 16);
+  out.push_back(value >> 8);
+  out.push_back(value);
+}
+
+// Length, type, data, CRC over type and data
+static void appendChunk(std::vector<uint8_t> &out, const char *type, const std::vector<uint8_t> &data) {
+  putBigEndian(out, (uint32_t)data.size());
+  size_t crcStart = out.size();
+  out.insert(out.end(), type, type + 4);
+  out.insert(out.end(), data.begin(), data.end());
+
+  uint32_t crc = 0xFFFFFFFFu;
+  for (size_t i = crcStart; i < out.size(); i++) {
+    crc = crcTable[(crc ^ out[i]) & 0xFF] ^ (crc >> 8);
+  }
+  putBigEndian(out, crc ^ 0xFFFFFFFFu);
+}
+
+bool writeMonochromePNG(const char *path, const uint8_t *pixels, uint32_t width, uint32_t height) {
+  if (crcTable[1] == 0) {
+    buildCrcTable();
+  }
+
+  std::vector<uint8_t> png;
+  const uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+  png.insert(png.end(), signature, signature + sizeof(signature));
+
+  std::vector<uint8_t> header;
+  putBigEndian(header, width);
+  putBigEndian(header, height);
+  header.push_back(1);  // Bit depth
+  header.push_back(0);  // Grayscale
+  header.push_back(0);  // Deflate
+  header.push_back(0);  // Adaptive filtering
+  header.push_back(0);  // No interlace
+  appendChunk(png, "IHDR", header);
+
+  // Scanlines: filter type 0, then the row with 0 = black as PNG wants it
+  uint32_t rowBytes = (width + 7) / 8;
+  std::vector<uint8_t> raw;
+  raw.reserve((size_t)(rowBytes + 1) * height);
+  for (uint32_t y = 0; y < height; y++) {
+    raw.push_back(0);
+    for (uint32_t x = 0; x < rowBytes; x++) {
+      raw.push_back(~pixels[(size_t)y * rowBytes + x]);
+    }
+  }
+
+  // zlib stream of stored deflate blocks
+  std::vector<uint8_t> compressed;
+  compressed.push_back(0x78);
+  compressed.push_back(0x01);
+  size_t offset = 0;
+  do {
+    size_t length = raw.size() - offset;
+    if (length > 65535) length = 65535;
+    bool last = offset + length == raw.size();
+    compressed.push_back(last ? 1 : 0);
+    compressed.push_back(length & 0xFF);
+    compressed.push_back(length >> 8);
+    compressed.push_back(~length & 0xFF);
+    compressed.push_back((~length >> 8) & 0xFF);
+    compressed.insert(compressed.end(), raw.begin() + offset, raw.begin() + offset + length);
+    offset += length;
+  } while (offset < raw.size());
+
+  uint32_t a = 1, b = 0;
+  for (size_t i = 0; i < raw.size(); i++) {
+    a = (a + raw[i]) % 65521;
+    b = (b + a) % 65521;
+  }
+  putBigEndian(compressed, (b << 16) | a);
+  appendChunk(png, "IDAT", compressed);
+  appendChunk(png, "IEND", std::vector<uint8_t>());
+
+  FILE *file = fopen(path, "wb");
+  if (file == nullptr) {
+    return false;
+  }
+  bool written = fwrite(png.data(), 1, png.size(), file) == png.size();
+  return fclose(file) == 0 && written;
+}
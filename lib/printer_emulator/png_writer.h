@@ -0,0 +1,11 @@
+#ifndef PNG_WRITER_H
+#define PNG_WRITER_H
+
+#include <stdint.h>
+
+// Writes a black and white image as a 1-bit grayscale PNG. Pixels are packed
+// eight to a byte, leftmost in the top bit, 1 = black, rows padded to whole
+// bytes. The image data is stored uncompressed, so no zlib is needed.
+bool writeMonochromePNG(const char *path, const uint8_t *pixels, uint32_t width, uint32_t height);
+
+#endif
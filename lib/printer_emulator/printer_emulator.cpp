@@ -0,0 +1,427 @@
+#include "printer_emulator.h"
+#include "png_writer.h"
+#include "code_page.h"
+#include "html_entities.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+static const uint8_t LF = 0x0A;
+static const uint8_t CR = 0x0D;
+static const uint8_t DLE = 0x10;
+static const uint8_t EOT = 0x04;
+static const uint8_t ESC = 0x1B;
+static const uint8_t GS = 0x1D;
+
+static const uint8_t CELL_WIDTH = 12;    // Font A, 32 characters on 384 dots
+static const uint8_t CELL_HEIGHT = 24;
+static const uint8_t DEFAULT_LINE_SPACING = 33;
+
+// 5x7 glyphs for 0x20-0x7E, one byte per column, bit 0 at the top. Drawn
+// at 2x3 dots per pixel inside the 12x24 cell.
+static const uint8_t FONT_5X7[95][5] = {
+  {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00},
+  {0x14, 0x7F, 0x14, 0x7F, 0x14}, {0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62},
+  {0x36, 0x49, 0x55, 0x22, 0x50}, {0x00, 0x05, 0x03, 0x00, 0x00}, {0x00, 0x1C, 0x22, 0x41, 0x00},
+  {0x00, 0x41, 0x22, 0x1C, 0x00}, {0x14, 0x08, 0x3E, 0x08, 0x14}, {0x08, 0x08, 0x3E, 0x08, 0x08},
+  {0x00, 0x50, 0x30, 0x00, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x60, 0x60, 0x00, 0x00},
+  {0x20, 0x10, 0x08, 0x04, 0x02}, {0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00},
+  {0x42, 0x61, 0x51, 0x49, 0x46}, {0x21, 0x41, 0x45, 0x4B, 0x31}, {0x18, 0x14, 0x12, 0x7F, 0x10},
+  {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3C, 0x4A, 0x49, 0x49, 0x30}, {0x01, 0x71, 0x09, 0x05, 0x03},
+  {0x36, 0x49, 0x49, 0x49, 0x36}, {0x06, 0x49, 0x49, 0x29, 0x1E}, {0x00, 0x36, 0x36, 0x00, 0x00},
+  {0x00, 0x56, 0x36, 0x00, 0x00}, {0x08, 0x14, 0x22, 0x41, 0x00}, {0x14, 0x14, 0x14, 0x14, 0x14},
+  {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x51, 0x09, 0x06}, {0x32, 0x49, 0x79, 0x41, 0x3E},
+  {0x7E, 0x11, 0x11, 0x11, 0x7E}, {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22},
+  {0x7F, 0x41, 0x41, 0x22, 0x1C}, {0x7F, 0x49, 0x49, 0x49, 0x41}, {0x7F, 0x09, 0x09, 0x01, 0x01},
+  {0x3E, 0x41, 0x41, 0x51, 0x32}, {0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00},
+  {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41}, {0x7F, 0x40, 0x40, 0x40, 0x40},
+  {0x7F, 0x02, 0x04, 0x02, 0x7F}, {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E},
+  {0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E}, {0x7F, 0x09, 0x19, 0x29, 0x46},
+  {0x46, 0x49, 0x49, 0x49, 0x31}, {0x01, 0x01, 0x7F, 0x01, 0x01}, {0x3F, 0x40, 0x40, 0x40, 0x3F},
+  {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x7F, 0x20, 0x18, 0x20, 0x7F}, {0x63, 0x14, 0x08, 0x14, 0x63},
+  {0x03, 0x04, 0x78, 0x04, 0x03}, {0x61, 0x51, 0x49, 0x45, 0x43}, {0x00, 0x7F, 0x41, 0x41, 0x00},
+  {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x7F, 0x00}, {0x04, 0x02, 0x01, 0x02, 0x04},
+  {0x40, 0x40, 0x40, 0x40, 0x40}, {0x00, 0x01, 0x02, 0x04, 0x00}, {0x20, 0x54, 0x54, 0x54, 0x78},
+  {0x7F, 0x48, 0x44, 0x44, 0x38}, {0x38, 0x44, 0x44, 0x44, 0x20}, {0x38, 0x44, 0x44, 0x48, 0x7F},
+  {0x38, 0x54, 0x54, 0x54, 0x18}, {0x08, 0x7E, 0x09, 0x01, 0x02}, {0x0C, 0x52, 0x52, 0x52, 0x3E},
+  {0x7F, 0x08, 0x04, 0x04, 0x78}, {0x00, 0x44, 0x7D, 0x40, 0x00}, {0x20, 0x40, 0x44, 0x3D, 0x00},
+  {0x7F, 0x10, 0x28, 0x44, 0x00}, {0x00, 0x41, 0x7F, 0x40, 0x00}, {0x7C, 0x04, 0x18, 0x04, 0x78},
+  {0x7C, 0x08, 0x04, 0x04, 0x78}, {0x38, 0x44, 0x44, 0x44, 0x38}, {0x7C, 0x14, 0x14, 0x14, 0x08},
+  {0x08, 0x14, 0x14, 0x18, 0x7C}, {0x7C, 0x08, 0x04, 0x04, 0x08}, {0x48, 0x54, 0x54, 0x54, 0x20},
+  {0x04, 0x3F, 0x44, 0x40, 0x20}, {0x3C, 0x40, 0x40, 0x20, 0x7C}, {0x1C, 0x20, 0x40, 0x20, 0x1C},
+  {0x3C, 0x40, 0x30, 0x40, 0x3C}, {0x44, 0x28, 0x10, 0x28, 0x44}, {0x0C, 0x50, 0x50, 0x50, 0x3C},
+  {0x44, 0x64, 0x54, 0x4C, 0x44}, {0x00, 0x08, 0x36, 0x41, 0x00}, {0x00, 0x00, 0x7F, 0x00, 0x00},
+  {0x00, 0x41, 0x36, 0x08, 0x00}, {0x02, 0x01, 0x02, 0x04, 0x02}
+};
+
+PrinterEmulator::PrinterEmulator(const EmulatorConfig &emulatorConfig)
+  : config(emulatorConfig), clock(nullptr), cursor(0), busyUntil(0), busyMillis(0),
+    lineArrival(0), firstByteTime(-1), receivedBytes(0), skippedCommands(0) {
+  if (config.feedMmPerSecond == 0) {
+    config.feedMmPerSecond = DEFAULT_EMULATOR_CONFIG.feedMmPerSecond;
+  }
+  // Power-on heating parameters
+  heatingDots = 7;
+  heatingTime = 80;
+  heatingInterval = 2;
+  resetModes();
+}
+
+void PrinterEmulator::setClock(PrintClock printClock) {
+  clock = printClock;
+}
+
+double PrinterEmulator::now() const {
+  return clock ? (double)clock() : 0;
+}
+
+// === Input ===
+size_t PrinterEmulator::write(uint8_t byte) {
+  if (firstByteTime < 0) {
+    firstByteTime = now();
+  }
+  receivedBytes++;
+
+  if (!command.empty()) {
+    command.push_back(byte);
+    if (command.size() >= commandLength()) {
+      runCommand();
+      command.clear();
+    }
+    return 1;
+  }
+
+  if (byte == ESC || byte == GS || byte == DLE) {
+    command.push_back(byte);
+  } else if (byte == LF) {
+    lineArrival = now();
+    printLine(-1);
+  } else if (byte == CR) {
+    cursor = 0;  // Following characters overwrite the line buffer
+  } else if (byte >= 0x20) {
+    addCharacter(byte);
+  }
+  return 1;
+}
+
+int PrinterEmulator::read() {
+  // Earliest reply that is due
+  double time = now();
+  size_t best = replies.size();
+  for (size_t i = 0; i < replies.size(); i++) {
+    if ((!clock || replies[i].first <= time) &&
+        (best == replies.size() || replies[i].first < replies[best].first)) {
+      best = i;
+    }
+  }
+  if (best == replies.size()) {
+    return -1;
+  }
+  uint8_t reply = replies[best].second;
+  replies.erase(replies.begin() + best);
+  return reply;
+}
+
+// Bytes the command being parsed needs in total
+size_t PrinterEmulator::commandLength() const {
+  if (command.size() < 2) {
+    return 2;
+  }
+  uint8_t op = command[1];
+  if (command[0] == ESC) {
+    switch (op) {
+      case '7': return 5;
+      case '!': case '-': case '3': case 'E': case 'J': case 'a': case 'd': case 't': return 3;
+      default: return 2;
+    }
+  }
+  if (command[0] == GS) {
+    switch (op) {
+      case 'L': return 4;
+      case '!': case 'B': case 'r': return 3;
+      case 'v':
+        if (command.size() < 8) {
+          return 8;
+        }
+        return 8 + (size_t)(command[4] | (command[5] << 8)) * (command[6] | (command[7] << 8));
+      default: return 2;
+    }
+  }
+  return op == EOT ? 3 : 2;  // DLE
+}
+
+void PrinterEmulator::runCommand() {
+  uint8_t op = command[1];
+  uint8_t n = command.size() > 2 ? command[2] : 0;
+
+  if (command[0] == DLE) {
+    if (op != EOT) {
+      skippedCommands++;
+      return;
+    }
+    // Real-time status: never busy, never out of paper
+    if (config.answersStatus) {
+      replies.push_back(std::make_pair(now(), (uint8_t)0x12));
+    }
+    return;
+  }
+
+  if (command[0] == ESC) {
+    switch (op) {
+      case '@': resetModes(); break;
+      case '!': printMode = n; break;
+      case '-': underline = (n & 0x03) != 0; break;
+      case '2': lineSpacing = DEFAULT_LINE_SPACING; break;
+      case '3': lineSpacing = n; break;
+      case '7':
+        heatingDots = command[2];
+        heatingTime = command[3];
+        heatingInterval = command[4];
+        break;
+      case 'E': bold = (n & 0x01) != 0; break;
+      case 'J':
+        lineArrival = now();
+        printLine(n);
+        break;
+      case 'a': alignment = (n >= '0' ? n - '0' : n) % 3; break;
+      case 'd':
+        lineArrival = now();
+        printLine(-1);
+        for (uint8_t i = 1; i < n; i++) {
+          printLine(-1);
+        }
+        break;
+      case 't': codeTable = n; break;
+      default: skippedCommands++; break;
+    }
+    return;
+  }
+
+  // GS
+  switch (op) {
+    case '!': sizeMode = n; break;
+    case 'B': inverse = (n & 0x01) != 0; break;
+    case 'L': leftMargin = command[2] | (command[3] << 8); break;
+    case 'r':
+      // Answered once everything before it has printed
+      if (config.answersStatus) {
+        replies.push_back(std::make_pair(clock ? std::max(busyUntil, now()) : 0, (uint8_t)0x00));
+      }
+      break;
+    case 'v':
+      lineArrival = now();
+      printRaster(command[3], command[4] | (command[5] << 8), command[6] | (command[7] << 8),
+                  command.data() + 8);
+      break;
+    default: skippedCommands++; break;
+  }
+}
+
+void PrinterEmulator::resetModes() {
+  lineSpacing = DEFAULT_LINE_SPACING;
+  printMode = 0;
+  sizeMode = 0;
+  bold = false;
+  underline = false;
+  inverse = false;
+  alignment = 0;
+  leftMargin = 0;
+  codeTable = 0;
+  cells.clear();
+  cursor = 0;
+}
+
+void PrinterEmulator::addCharacter(uint8_t character) {
+  Cell cell;
+  cell.character = character;
+  cell.widthScale = ((printMode & 0x20) ? 2 : 1) * (((sizeMode >> 4) & 0x07) + 1);
+  cell.heightScale = ((printMode & 0x10) ? 2 : 1) * ((sizeMode & 0x07) + 1);
+  cell.bold = bold || (printMode & 0x08);
+  cell.underline = underline || (printMode & 0x80);
+  cell.inverse = inverse;
+  cell.codeTable = codeTable;
+
+  if (cursor < cells.size()) {
+    cells[cursor++] = cell;
+    return;
+  }
+
+  // A full line prints by itself
+  if (lineWidth() + CELL_WIDTH * cell.widthScale > EMULATOR_HEAD_DOTS - leftMargin && !cells.empty()) {
+    lineArrival = now();
+    printLine(-1);
+  }
+  cells.push_back(cell);
+  cursor = cells.size();
+}
+
+// === Rendering ===
+uint16_t PrinterEmulator::lineWidth() const {
+  uint16_t width = 0;
+  for (size_t i = 0; i < cells.size(); i++) {
+    width += CELL_WIDTH * cells[i].widthScale;
+  }
+  return width;
+}
+
+int PrinterEmulator::alignedStart(uint16_t width) const {
+  int space = (int)EMULATOR_HEAD_DOTS - leftMargin - width;
+  if (space < 0) space = 0;
+  if (alignment == 1) return leftMargin + space / 2;
+  if (alignment == 2) return leftMargin + space;
+  return leftMargin;
+}
+
+void PrinterEmulator::setDot(size_t row, int x) {
+  if (x < 0 || x >= EMULATOR_HEAD_DOTS) {
+    return;
+  }
+  dots[row * EMULATOR_ROW_BYTES + x / 8] |= 0x80 >> (x % 8);
+}
+
+// Print the line buffer and feed by the line spacing, or by feedDots (ESC J)
+void PrinterEmulator::printLine(int feedDots) {
+  uint16_t height = 0;
+  for (size_t i = 0; i < cells.size(); i++) {
+    height = std::max<uint16_t>(height, CELL_HEIGHT * cells[i].heightScale);
+  }
+  uint16_t pitch = feedDots >= 0 ? (uint16_t)feedDots : lineSpacing;
+  pitch = std::max(pitch, height);
+
+  size_t firstRow = dotRows();
+  dots.resize(dots.size() + (size_t)pitch * EMULATOR_ROW_BYTES, 0);
+
+  std::string text;
+  bool anyInverse = false;
+  int x = alignedStart(lineWidth());
+  for (size_t i = 0; i < cells.size(); i++) {
+    const Cell &cell = cells[i];
+    int cellWidth = CELL_WIDTH * cell.widthScale;
+    int cellHeight = CELL_HEIGHT * cell.heightScale;
+    size_t top = firstRow + height - cellHeight;  // Common baseline
+
+    uint8_t glyph = (cell.character >= 0x20 && cell.character < 0x7F) ? cell.character : '?';
+    const uint8_t *columns = FONT_5X7[glyph - 0x20];
+    for (int gx = 0; gx < 5; gx++) {
+      for (int gy = 0; gy < 7; gy++) {
+        if (!(columns[gx] & (1 << gy))) continue;
+        for (int dy = 0; dy < 3 * cell.heightScale; dy++) {
+          size_t row = top + (1 + gy * 3) * cell.heightScale + dy;
+          for (int dx = 0; dx < 2 * cell.widthScale + (cell.bold ? 1 : 0); dx++) {
+            setDot(row, x + (1 + gx * 2) * cell.widthScale + dx);
+          }
+        }
+      }
+    }
+    if (cell.underline) {
+      for (int dy = 22 * cell.heightScale; dy < cellHeight; dy++) {
+        for (int dx = 0; dx < cellWidth; dx++) {
+          setDot(top + dy, x + dx);
+        }
+      }
+    }
+    if (cell.inverse) {
+      anyInverse = true;
+      for (int dy = 0; dy < cellHeight; dy++) {
+        for (int dx = 0; dx < cellWidth && x + dx < EMULATOR_HEAD_DOTS; dx++) {
+          if (x + dx >= 0) {
+            dots[(top + dy) * EMULATOR_ROW_BYTES + (x + dx) / 8] ^= 0x80 >> ((x + dx) % 8);
+          }
+        }
+      }
+    }
+    PrinterCodePage page;
+    if (cell.character < 0x80) {
+      text += (char)cell.character;
+    } else if (codePageForSelector(cell.codeTable, page)) {
+      char utf8[4];
+      text.append(utf8, encodeUTF8(codePageToUnicode(page, cell.character), utf8));
+    } else {
+      text += '?';
+    }
+    x += cellWidth;
+  }
+
+  cells.clear();
+  cursor = 0;
+  finishLine(text, anyInverse, firstRow);
+}
+
+void PrinterEmulator::printRaster(uint8_t mode, uint16_t widthBytes, uint16_t height, const uint8_t *data) {
+  if (!cells.empty()) {
+    printLine(-1);
+  }
+  uint8_t widthScale = (mode & 0x01) ? 2 : 1;
+  uint8_t heightScale = (mode & 0x02) ? 2 : 1;
+  uint16_t width = widthBytes * 8 * widthScale;
+
+  size_t firstRow = dotRows();
+  dots.resize(dots.size() + (size_t)height * heightScale * EMULATOR_ROW_BYTES, 0);
+  int left = alignedStart(width);
+  for (uint16_t y = 0; y < height; y++) {
+    for (uint16_t bx = 0; bx < widthBytes * 8; bx++) {
+      if (!(data[y * widthBytes + bx / 8] & (0x80 >> (bx % 8)))) continue;
+      for (uint8_t dy = 0; dy < heightScale; dy++) {
+        for (uint8_t dx = 0; dx < widthScale; dx++) {
+          setDot(firstRow + y * heightScale + dy, left + bx * widthScale + dx);
+        }
+      }
+    }
+  }
+
+  char label[32];
+  snprintf(label, sizeof(label), "[image %ux%u]", (unsigned)width, (unsigned)(height * heightScale));
+  finishLine(label, false, firstRow);
+}
+
+// === Timing ===
+double PrinterEmulator::rowMillis(const uint8_t *row) const {
+  double feedMillis = 1000.0 / ((double)config.feedMmPerSecond * EMULATOR_DOTS_PER_MM);
+
+  size_t black = 0;
+  for (uint16_t i = 0; i < EMULATOR_ROW_BYTES; i++) {
+    uint8_t bits = row[i];
+    while (bits) {
+      black += bits & 1;
+      bits >>= 1;
+    }
+  }
+  if (black == 0) {
+    return feedMillis;
+  }
+
+  // The head fires at most heatingDots at a time
+  size_t perStrobe = ((size_t)heatingDots + 1) * 8;
+  size_t strobes = (black + perStrobe - 1) / perStrobe;
+  double heatMillis = strobes * (heatingTime + heatingInterval) * 0.01;
+  return std::max(feedMillis, heatMillis);
+}
+
+void PrinterEmulator::finishLine(const std::string &text, bool lineInverse, size_t firstRow) {
+  EmulatedLine line;
+  line.text = text;
+  line.inverse = lineInverse;
+  line.dotRows = (uint16_t)(dotRows() - firstRow);
+  line.printMillis = 0;
+  for (size_t row = firstRow; row < dotRows(); row++) {
+    line.printMillis += rowMillis(&dots[row * EMULATOR_ROW_BYTES]);
+  }
+  printed.push_back(line);
+
+  busyUntil = std::max(busyUntil, lineArrival) + line.printMillis;
+  busyMillis += line.printMillis;
+}
+
+// === Output ===
+std::string PrinterEmulator::text() const {
+  std::string result;
+  for (size_t i = 0; i < printed.size(); i++) {
+    result += printed[i].text;
+    result += '\n';
+  }
+  return result;
+}
+
+bool PrinterEmulator::writePNG(const char *path) const {
+  return writeMonochromePNG(path, dots.data(), EMULATOR_HEAD_DOTS, (uint32_t)dotRows());
+}
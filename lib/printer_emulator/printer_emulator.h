@@ -0,0 +1,136 @@
+#ifndef PRINTER_EMULATOR_H
+#define PRINTER_EMULATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "printer_transport.h"
+#include "print_engine.h"
+
+// Host-side stand-in for the CSN-A4L, so print paths can be checked without
+// a printer on the desk.
+//
+// It takes the byte stream the firmware sends (as a PrinterTransport, so a
+// PrintEngine can drain straight into it) and models a 384-dot, 8 dots/mm
+// head with the 12x24 font, 32 characters per line. Every line is rendered
+// into a bitmap (written out as PNG) and kept as text for golden-output
+// tests.
+//
+// Timing: a dot row takes as long as the paper feed (feedMmPerSecond) or
+// the head needs to heat its black dots, whichever is longer. The head heats
+// at most "heating dots" at a time for "heating time" plus "interval", as
+// set with ESC 7. Lines start printing when their LF arrives (by the clock,
+// if one is set) or when the previous line is done.
+//
+// Understood: LF CR, ESC @ ! - 2 3 7 E J a d t, GS ! B L r v0, DLE EOT.
+// Other ESC/GS commands are skipped and counted. Characters above 0x7F are
+// kept as UTF-8 text for the code tables in code_page.h (and as '?' for
+// any other), but drawn as '?'.
+
+const uint16_t EMULATOR_HEAD_DOTS = 384;
+const uint8_t EMULATOR_DOTS_PER_MM = 8;
+const uint16_t EMULATOR_ROW_BYTES = EMULATOR_HEAD_DOTS / 8;
+
+struct EmulatorConfig {
+  uint16_t feedMmPerSecond;  // Paper speed limit, 90 for the CSN-A4L
+  bool answersStatus;        // TX line connected: replies to DLE EOT and GS r
+};
+
+const EmulatorConfig DEFAULT_EMULATOR_CONFIG = {90, true};
+
+struct EmulatedLine {
+  std::string text;    // Characters as received, "[image WxH]" for raster graphics
+  bool inverse;        // Contains white-on-black characters
+  uint16_t dotRows;    // Paper used, including line spacing
+  double printMillis;  // Time the mechanism spent on it
+};
+
+class PrinterEmulator : public PrinterTransport {
+public:
+  explicit PrinterEmulator(const EmulatorConfig &config = DEFAULT_EMULATOR_CONFIG);
+
+  // Arrival time of incoming bytes. Without a clock everything arrives at
+  // once and only the mechanism time counts.
+  void setClock(PrintClock clock);
+
+  size_t write(uint8_t byte) override;
+  bool canRead() const override { return config.answersStatus; }
+  int read() override;
+
+  // Output
+  const std::vector<EmulatedLine> &lines() const { return printed; }
+  std::string text() const;  // One line per printed line
+  const std::vector<uint8_t> &bitmap() const { return dots; }  // MSB left, 1 = black
+  size_t dotRows() const { return dots.size() / EMULATOR_ROW_BYTES; }
+  bool writePNG(const char *path) const;
+
+  // Measurements
+  double paperLengthMm() const { return (double)dotRows() / EMULATOR_DOTS_PER_MM; }
+  double mechanismMillis() const { return busyMillis; }  // Head and motor busy
+  double finishedAt() const { return busyUntil; }        // Clock time the last row was done
+  double firstByteAt() const { return firstByteTime; }
+  uint32_t bytesReceived() const { return receivedBytes; }
+  uint32_t unknownCommands() const { return skippedCommands; }
+
+private:
+  struct Cell {
+    uint8_t character;
+    uint8_t widthScale;
+    uint8_t heightScale;
+    bool bold;
+    bool underline;
+    bool inverse;
+    uint8_t codeTable;    // ESC t n when it was received
+  };
+
+  double now() const;
+  size_t commandLength() const;
+  void runCommand();
+  void resetModes();
+  void addCharacter(uint8_t character);
+  void printLine(int feedDots);
+  void printRaster(uint8_t mode, uint16_t widthBytes, uint16_t height, const uint8_t *data);
+  void finishLine(const std::string &text, bool inverse, size_t firstRow);
+  double rowMillis(const uint8_t *row) const;
+  void setDot(size_t row, int x);
+  uint16_t lineWidth() const;
+  int alignedStart(uint16_t width) const;
+
+  EmulatorConfig config;
+  PrintClock clock;
+
+  // Parser
+  std::vector<uint8_t> command;
+  std::vector<std::pair<double, uint8_t> > replies;
+
+  // Print modes
+  uint8_t lineSpacing;
+  uint8_t printMode;      // ESC !
+  uint8_t sizeMode;       // GS !
+  bool bold;
+  bool underline;
+  bool inverse;
+  uint8_t alignment;      // 0 left, 1 center, 2 right
+  uint16_t leftMargin;
+  uint8_t codeTable;      // ESC t
+  uint8_t heatingDots;    // ESC 7
+  uint8_t heatingTime;
+  uint8_t heatingInterval;
+
+  // Line buffer, CR moves the cursor back over it
+  std::vector<Cell> cells;
+  size_t cursor;
+
+  // Output
+  std::vector<EmulatedLine> printed;
+  std::vector<uint8_t> dots;
+  double busyUntil;
+  double busyMillis;
+  double lineArrival;
+  double firstByteTime;
+  uint32_t receivedBytes;
+  uint32_t skippedCommands;
+};
+
+#endif
@@ -0,0 +1,39 @@
+#include "retry_backoff.h"
+
+RetryBackoff::RetryBackoff(const BackoffPolicy &policy, RandomSource random)
+  : policy(policy), random(random), started(0), failures(0) {}
+
+void RetryBackoff::start(uint32_t now) {
+  started = now;
+  failures = 0;
+}
+
+uint32_t RetryBackoff::failed(uint32_t now) {
+  failures++;
+  if (failures >= policy.maxAttempts) {
+    return BACKOFF_GIVE_UP;
+  }
+
+  uint32_t delay = policy.firstDelayMillis;
+  for (uint8_t i = 1; i < failures && delay < policy.maxDelayMillis; i++) {
+    delay *= 2;
+  }
+  if (delay > policy.maxDelayMillis) {
+    delay = policy.maxDelayMillis;
+  }
+
+  uint32_t spread = (uint64_t)delay * policy.jitterPercent / 100;
+  if (spread > 0) {
+    delay = delay - spread + random(2 * spread + 1);
+  }
+
+  if (now + delay - started > policy.deadlineMillis) {
+    return BACKOFF_GIVE_UP;
+  }
+  return delay;
+}
+
+uint32_t RetryBackoff::remainingMillis(uint32_t now) const {
+  uint32_t elapsed = now - started;
+  return elapsed < policy.deadlineMillis ? policy.deadlineMillis - elapsed : 0;
+}
@@ -0,0 +1,53 @@
+#ifndef RETRY_BACKOFF_H
+#define RETRY_BACKOFF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Delays between retries of a failing operation: exponential backoff with
+// jitter, a limit on attempts and a deadline for the whole operation.
+//
+// The delay doubles from firstDelayMillis up to maxDelayMillis and is then
+// spread by up to jitterPercent either way, so devices that failed together
+// don't all retry together. No attempt is scheduled to start after the
+// deadline. The caller waits (a scheduler timer, not delay()) and tries
+// again.
+//
+// Plain C++ only (no Arduino headers) so the same code runs in host tests.
+
+struct BackoffPolicy {
+  uint32_t firstDelayMillis;
+  uint32_t maxDelayMillis;
+  uint8_t maxAttempts;
+  uint32_t deadlineMillis;   // From start()
+  uint8_t jitterPercent;
+};
+
+// Uniform in [0, bound); the hardware generator on the device
+typedef uint32_t (*RandomSource)(uint32_t bound);
+
+const uint32_t BACKOFF_GIVE_UP = 0xFFFFFFFF;
+
+class RetryBackoff {
+public:
+  RetryBackoff(const BackoffPolicy &policy, RandomSource random);
+
+  // Before the first attempt
+  void start(uint32_t now);
+
+  // After a failed attempt: milliseconds until the next one, or
+  // BACKOFF_GIVE_UP if attempts or time are used up
+  uint32_t failed(uint32_t now);
+
+  uint8_t attempts() const { return failures; }   // Failed so far
+  uint8_t maxAttempts() const { return policy.maxAttempts; }
+  uint32_t remainingMillis(uint32_t now) const;   // Until the deadline
+
+private:
+  BackoffPolicy policy;
+  RandomSource random;
+  uint32_t started;
+  uint8_t failures;
+};
+
+#endif
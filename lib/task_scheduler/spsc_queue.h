@@ -0,0 +1,58 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Lock-free queue for one producer and one consumer, e.g. web server
+// callbacks posting to the main loop.
+//
+// Each side only writes its own index; the producer publishes an item with
+// a release store of writeIndex after copying it in, the consumer frees its
+// slot with a release store of readIndex after copying it out. The indices
+// run freely and wrap, so Size must be a power of two. Word-sized atomics
+// are plain loads and stores on the ESP8266.
+
+template <typename T, uint32_t Size>
+class SpscQueue {
+  static_assert(Size > 0 && (Size & (Size - 1)) == 0, "Size must be a power of two");
+
+public:
+  SpscQueue() : writeIndex(0), readIndex(0) {}
+
+  // Producer side. False if the queue is full.
+  bool push(const T &item) {
+    uint32_t head = writeIndex.load(std::memory_order_relaxed);
+    if (head - readIndex.load(std::memory_order_acquire) == Size) {
+      return false;
+    }
+    items[head & (Size - 1)] = item;
+    writeIndex.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. False if the queue is empty.
+  bool pop(T &item) {
+    uint32_t tail = readIndex.load(std::memory_order_relaxed);
+    if (tail == writeIndex.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = items[tail & (Size - 1)];
+    readIndex.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Either side; only a snapshot while the other side is active
+  uint32_t size() const {
+    return writeIndex.load(std::memory_order_acquire) - readIndex.load(std::memory_order_acquire);
+  }
+  bool empty() const { return size() == 0; }
+
+private:
+  T items[Size];
+  std::atomic<uint32_t> writeIndex;
+  std::atomic<uint32_t> readIndex;
+};
+
+#endif
@@ -0,0 +1,149 @@
+#include "task_scheduler.h"
+#include <string.h>
+
+TaskScheduler::TaskScheduler(SchedulerClock clock)
+  : clock(clock), taskCount(0), running(NO_TASK), runStart(0), lastPassStart(0), passed(false),
+    longestPass(0), longestGap(0), droppedEvents(0) {
+  memset(slots, 0, sizeof(slots));
+}
+
+uint8_t TaskScheduler::add(const char *name, TaskFunction function, void *context, uint32_t budgetMillis) {
+  if (taskCount == SCHEDULER_MAX_TASKS) {
+    return NO_TASK;
+  }
+  Task &task = slots[taskCount];
+  task.function = function;
+  task.context = context;
+  task.periodMillis = 0;
+  task.armed = false;
+  task.stats.name = name;
+  task.stats.budgetMillis = budgetMillis;
+  return taskCount++;
+}
+
+void TaskScheduler::every(uint8_t task, uint32_t periodMillis) {
+  if (task >= taskCount) return;
+  slots[task].periodMillis = periodMillis;
+  slots[task].due = clock() + periodMillis;
+  slots[task].armed = true;
+}
+
+void TaskScheduler::after(uint8_t task, uint32_t delayMillis) {
+  if (task >= taskCount) return;
+  Task &slot = slots[task];
+  uint32_t due = clock() + delayMillis;
+  if (!slot.armed || (int32_t)(due - slot.due) < 0) {
+    slot.due = due;
+  }
+  slot.armed = true;
+}
+
+void TaskScheduler::stop(uint8_t task) {
+  if (task >= taskCount) return;
+  slots[task].armed = false;
+  slots[task].periodMillis = 0;
+}
+
+bool TaskScheduler::post(uint8_t task, uint8_t type, uint32_t value) {
+  TaskEvent event = {task, type, value};
+  if (!events.push(event)) {
+    droppedEvents++;
+    return false;
+  }
+  return true;
+}
+
+void TaskScheduler::run(uint8_t task, const TaskEvent *event) {
+  Task &slot = slots[task];
+  running = task;
+  runStart = clock();
+  slot.function(event, slot.context);
+  uint32_t elapsed = clock() - runStart;
+  running = NO_TASK;
+
+  slot.stats.runs++;
+  if (elapsed > slot.stats.maxMillis) {
+    slot.stats.maxMillis = elapsed;
+  }
+  if (elapsed > slot.stats.budgetMillis) {
+    slot.stats.overruns++;
+  }
+}
+
+void TaskScheduler::runOnce() {
+  uint32_t passStart = clock();
+  if (passed && passStart - lastPassStart > longestGap) {
+    longestGap = passStart - lastPassStart;
+  }
+  lastPassStart = passStart;
+  passed = true;
+
+  // Events posted so far. At most a queue's worth, so a flood can't hold
+  // off the timers.
+  TaskEvent event;
+  for (uint32_t i = 0; i < SCHEDULER_EVENT_SLOTS && events.pop(event); i++) {
+    if (event.task < taskCount) {
+      run(event.task, &event);
+    }
+  }
+
+  for (uint8_t i = 0; i < taskCount; i++) {
+    Task &task = slots[i];
+    uint32_t now = clock();
+    if (!task.armed || (int32_t)(now - task.due) < 0) {
+      continue;
+    }
+    if (task.periodMillis > 0) {
+      task.due += task.periodMillis;
+      if ((int32_t)(now - task.due) >= 0) {
+        task.due = now + task.periodMillis;  // Fell behind
+      }
+    } else {
+      task.armed = false;
+    }
+    run(i, nullptr);
+  }
+
+  uint32_t passMillis = clock() - passStart;
+  if (passMillis > longestPass) {
+    longestPass = passMillis;
+  }
+}
+
+uint32_t TaskScheduler::idleMillis(uint32_t limit) const {
+  if (!events.empty()) {
+    return 0;
+  }
+  uint32_t now = clock();
+  uint32_t idle = limit;
+  for (uint8_t i = 0; i < taskCount; i++) {
+    const Task &task = slots[i];
+    if (!task.armed) {
+      continue;
+    }
+    int32_t wait = (int32_t)(task.due - now);
+    if (wait <= 0) {
+      return 0;
+    }
+    if ((uint32_t)wait < idle) {
+      idle = wait;
+    }
+  }
+  return idle;
+}
+
+bool TaskScheduler::overBudget() const {
+  return running != NO_TASK && clock() - runStart >= slots[running].stats.budgetMillis;
+}
+
+void TaskScheduler::resetStats() {
+  for (uint8_t i = 0; i < taskCount; i++) {
+    slots[i].stats.runs = 0;
+    slots[i].stats.maxMillis = 0;
+    slots[i].stats.overruns = 0;
+  }
+  longestPass = 0;
+  longestGap = 0;
+  passed = false;
+  droppedEvents = 0;
+}
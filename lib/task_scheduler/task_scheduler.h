@@ -0,0 +1,115 @@
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "spsc_queue.h"
+
+// Cooperative run-to-completion scheduler for the main loop.
+//
+// A task is a function that does a bounded piece of work and returns. It
+// runs when its timer is due (every() for periodic work, after() or wake()
+// for one-shot) or when an event is posted to it. Events come from the web
+// server's callbacks through a lock-free queue (post() is the only call
+// allowed from there); the loop side wakes tasks directly.
+//
+// Each pass of runOnce() first delivers the events posted so far, in order,
+// then runs every task whose timer is due, each at most once. Nothing
+// preempts a task, so its budget is what it promises to stay under: runs
+// that take longer are counted as overruns, and a long-running task can
+// check overBudget() to stop early and continue on its next run. The
+// longest pass and the longest gap between passes (the loop latency seen
+// by anything waiting for a task) are recorded.
+//
+// Plain C++ only (no Arduino headers) so the same code runs in host tests.
+
+const uint8_t SCHEDULER_MAX_TASKS = 8;
+const uint32_t SCHEDULER_EVENT_SLOTS = 16;  // Power of two (SpscQueue)
+const uint8_t NO_TASK = 0xFF;
+
+struct TaskEvent {
+  uint8_t task;
+  uint8_t type;     // Up to the task
+  uint32_t value;
+};
+
+// event is null when the task runs for its timer
+typedef void (*TaskFunction)(const TaskEvent *event, void *context);
+
+// Clock in milliseconds (millis() on the device, simulated in tests)
+typedef uint32_t (*SchedulerClock)();
+
+struct TaskStats {
+  const char *name;
+  uint32_t budgetMillis;
+  uint32_t runs;
+  uint32_t maxMillis;   // Longest run
+  uint32_t overruns;    // Runs longer than the budget
+};
+
+class TaskScheduler {
+public:
+  explicit TaskScheduler(SchedulerClock clock);
+
+  // Register a task, NO_TASK if all slots are taken. It doesn't run until
+  // it has a timer or an event.
+  uint8_t add(const char *name, TaskFunction function, void *context, uint32_t budgetMillis);
+
+  // Run every periodMillis, the first time one period from now. A run
+  // that falls behind skips the missed periods rather than catching up.
+  void every(uint8_t task, uint32_t periodMillis);
+
+  // Run once in delayMillis (sooner for a periodic task, whose period
+  // continues from there)
+  void after(uint8_t task, uint32_t delayMillis);
+  void wake(uint8_t task) { after(task, 0); }
+
+  // No more timer runs (events still arrive)
+  void stop(uint8_t task);
+
+  // From the web server's callbacks. False (and counted) if the queue is
+  // full.
+  bool post(uint8_t task, uint8_t type, uint32_t value = 0);
+
+  // One pass of the loop
+  void runOnce();
+
+  // Milliseconds until something is due, at most limit
+  uint32_t idleMillis(uint32_t limit) const;
+
+  // From inside a task: has this run used up its budget?
+  bool overBudget() const;
+
+  uint8_t tasks() const { return taskCount; }
+  const TaskStats &stats(uint8_t task) const { return slots[task].stats; }
+  uint32_t maxPassMillis() const { return longestPass; }
+  uint32_t maxLatencyMillis() const { return longestGap; }
+  uint32_t eventsDropped() const { return droppedEvents; }
+  void resetStats();
+
+private:
+  struct Task {
+    TaskFunction function;
+    void *context;
+    uint32_t periodMillis;  // 0 for one-shot timers
+    uint32_t due;
+    bool armed;
+    TaskStats stats;
+  };
+
+  void run(uint8_t task, const TaskEvent *event);
+
+  SchedulerClock clock;
+  Task slots[SCHEDULER_MAX_TASKS];
+  uint8_t taskCount;
+  SpscQueue<TaskEvent, SCHEDULER_EVENT_SLOTS> events;
+  uint8_t running;        // Task running now, NO_TASK between runs
+  uint32_t runStart;
+  uint32_t lastPassStart;
+  bool passed;            // lastPassStart is valid
+  uint32_t longestPass;
+  uint32_t longestGap;
+  uint32_t droppedEvents;
+};
+
+#endif
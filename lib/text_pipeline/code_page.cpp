@@ -0,0 +1,278 @@
+#include "code_page.h"
+#include "progmem_compat.h"
+#include <string.h>
+
+// Characters 0x80-0xFF of each code page
+static constexpr uint16_t CP437_HIGH[128] PROGMEM = {
+  0x00C7, 0x00FC, 0x00E9, 0x00E2, 0x00E4, 0x00E0, 0x00E5, 0x00E7,
+  0x00EA, 0x00EB, 0x00E8, 0x00EF, 0x00EE, 0x00EC, 0x00C4, 0x00C5,
+  0x00C9, 0x00E6, 0x00C6, 0x00F4, 0x00F6, 0x00F2, 0x00FB, 0x00F9,
+  0x00FF, 0x00D6, 0x00DC, 0x00A2, 0x00A3, 0x00A5, 0x20A7, 0x0192,
+  0x00E1, 0x00ED, 0x00F3, 0x00FA, 0x00F1, 0x00D1, 0x00AA, 0x00BA,
+  0x00BF, 0x2310, 0x00AC, 0x00BD, 0x00BC, 0x00A1, 0x00AB, 0x00BB,
+  0x2591, 0x2592, 0x2593, 0x2502, 0x2524, 0x2561, 0x2562, 0x2556,
+  0x2555, 0x2563, 0x2551, 0x2557, 0x255D, 0x255C, 0x255B, 0x2510,
+  0x2514, 0x2534, 0x252C, 0x251C, 0x2500, 0x253C, 0x255E, 0x255F,
+  0x255A, 0x2554, 0x2569, 0x2566, 0x2560, 0x2550, 0x256C, 0x2567,
+  0x2568, 0x2564, 0x2565, 0x2559, 0x2558, 0x2552, 0x2553, 0x256B,
+  0x256A, 0x2518, 0x250C, 0x2588, 0x2584, 0x258C, 0x2590, 0x2580,
+  0x03B1, 0x00DF, 0x0393, 0x03C0, 0x03A3, 0x03C3, 0x00B5, 0x03C4,
+  0x03A6, 0x0398, 0x03A9, 0x03B4, 0x221E, 0x03C6, 0x03B5, 0x2229,
+  0x2261, 0x00B1, 0x2265, 0x2264, 0x2320, 0x2321, 0x00F7, 0x2248,
+  0x00B0, 0x2219, 0x00B7, 0x221A, 0x207F, 0x00B2, 0x25A0, 0x00A0
+};
+
+// CP858 is the same except for the euro sign in place of the dotless i
+static constexpr uint16_t CP850_HIGH[128] PROGMEM = {
+  0x00C7, 0x00FC, 0x00E9, 0x00E2, 0x00E4, 0x00E0, 0x00E5, 0x00E7,
+  0x00EA, 0x00EB, 0x00E8, 0x00EF, 0x00EE, 0x00EC, 0x00C4, 0x00C5,
+  0x00C9, 0x00E6, 0x00C6, 0x00F4, 0x00F6, 0x00F2, 0x00FB, 0x00F9,
+  0x00FF, 0x00D6, 0x00DC, 0x00F8, 0x00A3, 0x00D8, 0x00D7, 0x0192,
+  0x00E1, 0x00ED, 0x00F3, 0x00FA, 0x00F1, 0x00D1, 0x00AA, 0x00BA,
+  0x00BF, 0x00AE, 0x00AC, 0x00BD, 0x00BC, 0x00A1, 0x00AB, 0x00BB,
+  0x2591, 0x2592, 0x2593, 0x2502, 0x2524, 0x00C1, 0x00C2, 0x00C0,
+  0x00A9, 0x2563, 0x2551, 0x2557, 0x255D, 0x00A2, 0x00A5, 0x2510,
+  0x2514, 0x2534, 0x252C, 0x251C, 0x2500, 0x253C, 0x00E3, 0x00C3,
+  0x255A, 0x2554, 0x2569, 0x2566, 0x2560, 0x2550, 0x256C, 0x00A4,
+  0x00F0, 0x00D0, 0x00CA, 0x00CB, 0x00C8, 0x0131, 0x00CD, 0x00CE,
+  0x00CF, 0x2518, 0x250C, 0x2588, 0x2584, 0x00A6, 0x00CC, 0x2580,
+  0x00D3, 0x00DF, 0x00D4, 0x00D2, 0x00F5, 0x00D5, 0x00B5, 0x00FE,
+  0x00DE, 0x00DA, 0x00DB, 0x00D9, 0x00FD, 0x00DD, 0x00AF, 0x00B4,
+  0x00AD, 0x00B1, 0x2017, 0x00BE, 0x00B6, 0x00A7, 0x00F7, 0x00B8,
+  0x00B0, 0x00A8, 0x00B7, 0x00B9, 0x00B3, 0x00B2, 0x25A0, 0x00A0
+};
+static constexpr uint8_t CP858_EURO_BYTE = 0xD5;
+static constexpr uint16_t EURO_SIGN = 0x20AC;
+
+// Fallbacks for characters a code page lacks, sorted by code point. Empty
+// text drops the character (zero-width and soft hyphens).
+struct Transliteration {
+  uint16_t codepoint;
+  char text[4];
+};
+
+static constexpr Transliteration TRANSLITERATIONS[] PROGMEM = {
+  {0x00A9, "c"}, {0x00AD, ""}, {0x00AE, "R"}, {0x00B4, "'"},
+  {0x00D7, "x"}, {0x0152, "OE"}, {0x0153, "oe"}, {0x0160, "S"}, {0x0161, "s"},
+  {0x0178, "Y"}, {0x017D, "Z"}, {0x017E, "z"}, {0x02C6, "^"}, {0x02DC, "~"},
+  {0x200B, ""}, {0x200C, ""}, {0x200D, ""}, {0x200E, ""}, {0x200F, ""},
+  {0x2010, "-"}, {0x2011, "-"}, {0x2012, "-"}, {0x2013, "-"}, {0x2014, "-"},
+  {0x2015, "-"}, {0x2018, "'"}, {0x2019, "'"}, {0x201A, "'"}, {0x201B, "'"},
+  {0x201C, "\""}, {0x201D, "\""}, {0x201E, "\""}, {0x201F, "\""}, {0x2020, "+"},
+  {0x2022, "*"}, {0x2026, "..."}, {0x2030, "%"}, {0x2032, "'"}, {0x2033, "\""},
+  {0x2039, "<"}, {0x203A, ">"}, {0x20AC, "EUR"}, {0x2122, "TM"}, {0x2212, "-"},
+  {0xFEFF, ""}
+};
+
+static constexpr size_t TRANSLITERATION_COUNT = sizeof(TRANSLITERATIONS) / sizeof(TRANSLITERATIONS[0]);
+
+// Latin-1 letters U+00C0-U+00FF without their accents
+static const char LATIN1_BASE[] PROGMEM = "AAAAAAACEEEEIIIIDNOOOOOxOUUUUYTsaaaaaaaceeeeiiiidnooooo/ouuuuyty";
+
+// === Compile-time table checks and indices ===
+static constexpr size_t utf8Length(uint32_t codepoint) {
+  return codepoint < 0x80 ? 1 : codepoint < 0x800 ? 2 : codepoint < 0x10000 ? 3 : 4;
+}
+
+static constexpr bool transliterationsSorted() {
+  for (size_t i = 0; i + 1 < TRANSLITERATION_COUNT; i++) {
+    if (TRANSLITERATIONS[i].codepoint >= TRANSLITERATIONS[i + 1].codepoint) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// In-place transcoding relies on a fallback being no longer than its UTF-8
+static constexpr bool transliterationsFitInPlace() {
+  for (size_t i = 0; i < TRANSLITERATION_COUNT; i++) {
+    size_t length = 0;
+    while (TRANSLITERATIONS[i].text[length] != '\0') {
+      length++;
+    }
+    if (length > utf8Length(TRANSLITERATIONS[i].codepoint)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static_assert(transliterationsSorted(), "Transliteration table must be sorted and free of duplicates");
+static_assert(transliterationsFitInPlace(), "Transliteration longer than its UTF-8 sequence");
+
+// Code points of one page in ascending order with their bytes, for a
+// binary search from UTF-8 to the page
+struct CodePageIndex {
+  uint16_t codepoints[128];
+  uint8_t bytes[128];
+};
+
+static constexpr uint16_t highCharacter(PrinterCodePage page, size_t index) {
+  return page == CODE_PAGE_CP437 ? CP437_HIGH[index]
+       : page == CODE_PAGE_CP858 && index + 0x80 == CP858_EURO_BYTE ? EURO_SIGN
+       : CP850_HIGH[index];
+}
+
+static constexpr CodePageIndex buildCodePageIndex(PrinterCodePage page) {
+  CodePageIndex index = {};
+  for (size_t i = 0; i < 128; i++) {
+    uint16_t codepoint = highCharacter(page, i);
+    size_t slot = i;
+    while (slot > 0 && index.codepoints[slot - 1] > codepoint) {
+      index.codepoints[slot] = index.codepoints[slot - 1];
+      index.bytes[slot] = index.bytes[slot - 1];
+      slot--;
+    }
+    index.codepoints[slot] = codepoint;
+    index.bytes[slot] = (uint8_t)(0x80 + i);
+  }
+  return index;
+}
+
+static constexpr bool indexUnique(const CodePageIndex &index) {
+  for (size_t i = 0; i + 1 < 128; i++) {
+    if (index.codepoints[i] >= index.codepoints[i + 1]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static constexpr CodePageIndex CODE_PAGE_INDEX[3] PROGMEM = {
+  buildCodePageIndex(CODE_PAGE_CP437),
+  buildCodePageIndex(CODE_PAGE_CP850),
+  buildCodePageIndex(CODE_PAGE_CP858)
+};
+static_assert(indexUnique(CODE_PAGE_INDEX[0]) && indexUnique(CODE_PAGE_INDEX[1]) &&
+              indexUnique(CODE_PAGE_INDEX[2]), "Code page maps a character twice");
+
+// ESC t n values on the CSN-A4L (manual, "Select character code")
+static const uint8_t SELECTORS[3] = {0, 2, 19};
+
+// === Lookups ===
+uint8_t codePageSelector(PrinterCodePage page) {
+  return SELECTORS[page];
+}
+
+bool codePageForSelector(uint8_t selector, PrinterCodePage &page) {
+  for (uint8_t i = 0; i < 3; i++) {
+    if (SELECTORS[i] == selector) {
+      page = (PrinterCodePage)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+uint16_t codePageToUnicode(PrinterCodePage page, uint8_t byte) {
+  if (byte < 0x80) {
+    return byte;
+  }
+  if (page == CODE_PAGE_CP858 && byte == CP858_EURO_BYTE) {
+    return EURO_SIGN;
+  }
+  const uint16_t *table = page == CODE_PAGE_CP437 ? CP437_HIGH : CP850_HIGH;
+  return pgm_read_word(&table[byte - 0x80]);
+}
+
+// Byte for a code point, 0 if the page doesn't have it
+static uint8_t lookupCodePage(PrinterCodePage page, uint32_t codepoint) {
+  const CodePageIndex &index = CODE_PAGE_INDEX[page];
+  size_t low = 0;
+  size_t high = 128;
+  while (low < high) {
+    size_t middle = (low + high) / 2;
+    uint16_t candidate = pgm_read_word(&index.codepoints[middle]);
+    if (candidate == codepoint) {
+      return pgm_read_byte(&index.bytes[middle]);
+    }
+    if (candidate < codepoint) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return 0;
+}
+
+// Writes the fallback for a code point, returns its length
+static size_t transliterate(uint32_t codepoint, char *out) {
+  size_t low = 0;
+  size_t high = TRANSLITERATION_COUNT;
+  while (low < high) {
+    size_t middle = (low + high) / 2;
+    uint16_t candidate = pgm_read_word(&TRANSLITERATIONS[middle].codepoint);
+    if (candidate == codepoint) {
+      char text[4];
+      memcpy_P(text, TRANSLITERATIONS[middle].text, sizeof(text));
+      size_t length = strlen(text);
+      memcpy(out, text, length);
+      return length;
+    }
+    if (candidate < codepoint) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  if (codepoint >= 0xC0 && codepoint <= 0xFF) {
+    out[0] = (char)pgm_read_byte(&LATIN1_BASE[codepoint - 0xC0]);
+  } else {
+    out[0] = '?';
+  }
+  return 1;
+}
+
+// === Transcoding ===
+size_t transcodeUTF8(const char *text, size_t length, PrinterCodePage page, char *out) {
+  size_t read = 0;
+  size_t written = 0;
+
+  while (read < length) {
+    uint8_t c = (uint8_t)text[read];
+    if (c < 0x80) {
+      out[written++] = (char)c;
+      read++;
+      continue;
+    }
+
+    // Decode one sequence; a stray or cut-off one is a single '?'
+    size_t extra = (c & 0xE0) == 0xC0 ? 1 : (c & 0xF0) == 0xE0 ? 2 : (c & 0xF8) == 0xF0 ? 3 : 0;
+    bool valid = extra > 0 && read + extra < length;
+    uint32_t codepoint = c & (0x3F >> extra);
+    for (size_t k = 1; valid && k <= extra; k++) {
+      uint8_t next = (uint8_t)text[read + k];
+      valid = (next & 0xC0) == 0x80;
+      codepoint = (codepoint << 6) | (next & 0x3F);
+    }
+    if (!valid) {
+      out[written++] = '?';
+      read++;
+      continue;
+    }
+    read += extra + 1;
+
+    uint8_t byte = codepoint <= 0xFFFF ? lookupCodePage(page, codepoint) : 0;
+    if (byte != 0) {
+      out[written++] = (char)byte;
+    } else {
+      written += transliterate(codepoint, out + written);
+    }
+  }
+
+  return written;
+}
+
+size_t completeUTF8Length(const char *text, size_t length) {
+  // The lead byte of the last sequence is at most three bytes back
+  for (size_t back = 1; back <= 3 && back <= length; back++) {
+    uint8_t c = (uint8_t)text[length - back];
+    if ((c & 0xC0) == 0x80) {
+      continue;
+    }
+    size_t extra = (c & 0xE0) == 0xC0 ? 1 : (c & 0xF0) == 0xE0 ? 2 : (c & 0xF8) == 0xF0 ? 3 : 0;
+    return extra >= back ? length - back : length;
+  }
+  return length;
+}
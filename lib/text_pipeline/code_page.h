@@ -0,0 +1,44 @@
+#ifndef CODE_PAGE_H
+#define CODE_PAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// UTF-8 to printer code page transcoder.
+//
+// The CSN-A4L prints one byte per character from the code table selected
+// with ESC t n. Text arrives as UTF-8 (jokes, web form input), so it is
+// converted on the way to the printer: ASCII passes through, other
+// characters map to their byte in the code page, and characters the page
+// lacks are transliterated ("..." for an ellipsis, "EUR" for the euro sign
+// outside CP858, base letters for accented ones) or printed as '?'.
+//
+// The lookup indices are built by the compiler into flash. A transcoded
+// character is never longer than its UTF-8 sequence, so transcoding runs
+// in place in a single pass without allocating. Every output byte is one
+// printed column.
+
+enum PrinterCodePage {
+  CODE_PAGE_CP437,  // US, default after power-on
+  CODE_PAGE_CP850,  // Multilingual Latin 1
+  CODE_PAGE_CP858   // CP850 with the euro sign
+};
+
+// n for ESC t n
+uint8_t codePageSelector(PrinterCodePage page);
+
+// Code page for an ESC t n value, false if it is none of the above
+bool codePageForSelector(uint8_t selector, PrinterCodePage &page);
+
+// Character a byte prints as (bytes below 0x80 are ASCII)
+uint16_t codePageToUnicode(PrinterCodePage page, uint8_t byte);
+
+// Transcode length bytes of UTF-8 into out, which may be text itself.
+// Malformed sequences become '?'. Returns the output length (<= length).
+size_t transcodeUTF8(const char *text, size_t length, PrinterCodePage page, char *out);
+
+// Length of text without a UTF-8 sequence cut off at its end. For text
+// that arrives in pieces: the rest belongs in front of the next piece.
+size_t completeUTF8Length(const char *text, size_t length);
+
+#endif
@@ -0,0 +1,80 @@
+#include "date_format.h"
+#include "progmem_compat.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+static const char DAY_NAMES[7][3] PROGMEM = {
+  "So", "Mo", "Di", "Mi", "Do", "Fr", "Sa"
+};
+static const char MONTH_NAMES[12][10] PROGMEM = {
+  "Januar", "Februar", "Maerz", "April", "Mai", "Juni",
+  "Juli", "August", "September", "Oktober", "November", "Dezember"
+};
+
+// Reads a number followed by the expected separator ('\0' for the last field)
+static bool readField(const char *&text, char separator, int &value) {
+  char *end;
+  long parsed = strtol(text, &end, 10);
+  if (end == text || *end != separator) {
+    return false;
+  }
+  value = (int)parsed;
+  text = (separator == '\0') ? end : end + 1;
+  return true;
+}
+
+bool parseDate(const char *text, CalendarDate &date) {
+  bool ok;
+  const char *p = text;
+  if (strchr(text, '-') != nullptr) {
+    ok = readField(p, '-', date.year) && readField(p, '-', date.month) &&
+         readField(p, '\0', date.day);
+  } else if (strchr(text, '/') != nullptr) {
+    ok = readField(p, '/', date.day) && readField(p, '/', date.month) &&
+         readField(p, '\0', date.year);
+  } else {
+    return false;
+  }
+
+  return ok && date.year >= 1900 && date.year <= 2100 &&
+         date.month >= 1 && date.month <= 12 &&
+         date.day >= 1 && date.day <= daysInMonth(date.year, date.month);
+}
+
+int daysInMonth(int year, int month) {
+  static const uint8_t DAYS[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  if (month == 2 && ((year % 4 == 0 && year % 100 != 0) || year % 400 == 0)) {
+    return 29;
+  }
+  return DAYS[month - 1];
+}
+
+// Sakamoto's method
+int dayOfWeek(const CalendarDate &date) {
+  static const uint8_t MONTH_OFFSETS[12] = {0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4};
+  int year = date.year - (date.month < 3 ? 1 : 0);
+  return (year + year / 4 - year / 100 + year / 400 + MONTH_OFFSETS[date.month - 1] + date.day) % 7;
+}
+
+static size_t clampLength(int written, size_t size) {
+  if (written < 0) return 0;
+  return (size_t)written < size ? (size_t)written : size - 1;
+}
+
+size_t formatReceiptDate(const CalendarDate &date, char *out, size_t size) {
+  char dayName[sizeof(DAY_NAMES[0])];
+  char monthName[sizeof(MONTH_NAMES[0])];
+  memcpy_P(dayName, DAY_NAMES[dayOfWeek(date)], sizeof(dayName));
+  memcpy_P(monthName, MONTH_NAMES[date.month - 1], sizeof(monthName));
+  return clampLength(snprintf(out, size, "%s, %02d %s %d", dayName, date.day, monthName, date.year), size);
+}
+
+size_t formatISODate(const CalendarDate &date, char *out, size_t size) {
+  return clampLength(snprintf(out, size, "%04d-%02d-%02d", date.year, date.month, date.day), size);
+}
+
+size_t formatTimeOfDay(int hour, int minute, char *out, size_t size) {
+  return clampLength(snprintf(out, size, "%02d:%02d", hour, minute), size);
+}
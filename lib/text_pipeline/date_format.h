@@ -0,0 +1,32 @@
+#ifndef DATE_FORMAT_H
+#define DATE_FORMAT_H
+
+#include <stddef.h>
+
+// Date parsing and formatting for receipts, independent of the NTP client
+
+struct CalendarDate {
+  int year;
+  int month;  // 1-12
+  int day;    // 1-31
+};
+
+// Parse "YYYY-MM-DD" or "DD/MM/YYYY". Returns false for anything that isn't a
+// real calendar date between 1900 and 2100.
+bool parseDate(const char *text, CalendarDate &date);
+
+int daysInMonth(int year, int month);
+
+// 0 = Sunday ... 6 = Saturday (Gregorian calendar)
+int dayOfWeek(const CalendarDate &date);
+
+// Receipt header, e.g. "Sa, 07 Juni 2025". Returns the length written.
+size_t formatReceiptDate(const CalendarDate &date, char *out, size_t size);
+
+// "2025-06-07"
+size_t formatISODate(const CalendarDate &date, char *out, size_t size);
+
+// "08:05"
+size_t formatTimeOfDay(int hour, int minute, char *out, size_t size);
+
+#endif
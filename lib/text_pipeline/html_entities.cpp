@@ -0,0 +1,346 @@
+#include "html_entities.h"
+#include "progmem_compat.h"
+#include <string.h>
+
+struct HtmlEntity {
+  char name[HTML_ENTITY_MAX_NAME + 1];
+  uint16_t codepoint;
+};
+
+// Source table, only read by the compiler to build the hash index below.
+// Kept sorted by name (byte order) so it is easy to maintain - checked at
+// compile time.
+static constexpr HtmlEntity ENTITIES[] = {
+  {"AElig", 198}, {"Aacute", 193}, {"Acirc", 194}, {"Agrave", 192},
+  {"Alpha", 913}, {"Aring", 197}, {"Atilde", 195}, {"Auml", 196},
+  {"Beta", 914}, {"Ccedil", 199}, {"Chi", 935}, {"Dagger", 8225},
+  {"Delta", 916}, {"ETH", 208}, {"Eacute", 201}, {"Ecirc", 202},
+  {"Egrave", 200}, {"Epsilon", 917}, {"Eta", 919}, {"Euml", 203},
+  {"Gamma", 915}, {"Iacute", 205}, {"Icirc", 206}, {"Igrave", 204},
+  {"Iota", 921}, {"Iuml", 207}, {"Kappa", 922}, {"Lambda", 923}, {"Mu", 924},
+  {"Ntilde", 209}, {"Nu", 925}, {"OElig", 338}, {"Oacute", 211},
+  {"Ocirc", 212}, {"Ograve", 210}, {"Omega", 937}, {"Omicron", 927},
+  {"Oslash", 216}, {"Otilde", 213}, {"Ouml", 214}, {"Phi", 934}, {"Pi", 928},
+  {"Prime", 8243}, {"Psi", 936}, {"Rho", 929}, {"Scaron", 352}, {"Sigma", 931},
+  {"THORN", 222}, {"Tau", 932}, {"Theta", 920}, {"Uacute", 218},
+  {"Ucirc", 219}, {"Ugrave", 217}, {"Upsilon", 933}, {"Uuml", 220},
+  {"Xi", 926}, {"Yacute", 221}, {"Yuml", 376}, {"Zeta", 918}, {"aacute", 225},
+  {"acirc", 226}, {"acute", 180}, {"aelig", 230}, {"agrave", 224},
+  {"alefsym", 8501}, {"alpha", 945}, {"amp", 38}, {"and", 8743}, {"ang", 8736},
+  {"apos", 39}, {"aring", 229}, {"asymp", 8776}, {"atilde", 227},
+  {"auml", 228}, {"bdquo", 8222}, {"beta", 946}, {"brvbar", 166},
+  {"bull", 8226}, {"cap", 8745}, {"ccedil", 231}, {"cedil", 184},
+  {"cent", 162}, {"chi", 967}, {"circ", 710}, {"clubs", 9827}, {"cong", 8773},
+  {"copy", 169}, {"crarr", 8629}, {"cup", 8746}, {"curren", 164},
+  {"dArr", 8659}, {"dagger", 8224}, {"darr", 8595}, {"deg", 176},
+  {"delta", 948}, {"diams", 9830}, {"divide", 247}, {"eacute", 233},
+  {"ecirc", 234}, {"egrave", 232}, {"empty", 8709}, {"emsp", 8195},
+  {"ensp", 8194}, {"epsilon", 949}, {"equiv", 8801}, {"eta", 951},
+  {"eth", 240}, {"euml", 235}, {"euro", 8364}, {"exist", 8707}, {"fnof", 402},
+  {"forall", 8704}, {"frac12", 189}, {"frac14", 188}, {"frac34", 190},
+  {"frasl", 8260}, {"gamma", 947}, {"ge", 8805}, {"gt", 62}, {"hArr", 8660},
+  {"harr", 8596}, {"hearts", 9829}, {"hellip", 8230}, {"iacute", 237},
+  {"icirc", 238}, {"iexcl", 161}, {"igrave", 236}, {"image", 8465},
+  {"infin", 8734}, {"int", 8747}, {"iota", 953}, {"iquest", 191},
+  {"isin", 8712}, {"iuml", 239}, {"kappa", 954}, {"lArr", 8656},
+  {"lambda", 955}, {"lang", 9001}, {"laquo", 171}, {"larr", 8592},
+  {"lceil", 8968}, {"ldquo", 8220}, {"le", 8804}, {"lfloor", 8970},
+  {"lowast", 8727}, {"loz", 9674}, {"lrm", 8206}, {"lsaquo", 8249},
+  {"lsquo", 8216}, {"lt", 60}, {"macr", 175}, {"mdash", 8212}, {"micro", 181},
+  {"middot", 183}, {"minus", 8722}, {"mu", 956}, {"nabla", 8711},
+  {"nbsp", 160}, {"ndash", 8211}, {"ne", 8800}, {"ni", 8715}, {"not", 172},
+  {"notin", 8713}, {"nsub", 8836}, {"ntilde", 241}, {"nu", 957},
+  {"oacute", 243}, {"ocirc", 244}, {"oelig", 339}, {"ograve", 242},
+  {"oline", 8254}, {"omega", 969}, {"omicron", 959}, {"oplus", 8853},
+  {"or", 8744}, {"ordf", 170}, {"ordm", 186}, {"oslash", 248}, {"otilde", 245},
+  {"otimes", 8855}, {"ouml", 246}, {"para", 182}, {"part", 8706},
+  {"permil", 8240}, {"perp", 8869}, {"phi", 966}, {"pi", 960}, {"piv", 982},
+  {"plusmn", 177}, {"pound", 163}, {"prime", 8242}, {"prod", 8719},
+  {"prop", 8733}, {"psi", 968}, {"quot", 34}, {"rArr", 8658}, {"radic", 8730},
+  {"rang", 9002}, {"raquo", 187}, {"rarr", 8594}, {"rceil", 8969},
+  {"rdquo", 8221}, {"real", 8476}, {"reg", 174}, {"rfloor", 8971},
+  {"rho", 961}, {"rlm", 8207}, {"rsaquo", 8250}, {"rsquo", 8217},
+  {"sbquo", 8218}, {"scaron", 353}, {"sdot", 8901}, {"sect", 167},
+  {"shy", 173}, {"sigma", 963}, {"sigmaf", 962}, {"sim", 8764},
+  {"spades", 9824}, {"sub", 8834}, {"sube", 8838}, {"sum", 8721},
+  {"sup", 8835}, {"sup1", 185}, {"sup2", 178}, {"sup3", 179}, {"supe", 8839},
+  {"szlig", 223}, {"tau", 964}, {"there4", 8756}, {"theta", 952},
+  {"thetasym", 977}, {"thinsp", 8201}, {"thorn", 254}, {"tilde", 732},
+  {"times", 215}, {"trade", 8482}, {"uArr", 8657}, {"uacute", 250},
+  {"uarr", 8593}, {"ucirc", 251}, {"ugrave", 249}, {"uml", 168},
+  {"upsih", 978}, {"upsilon", 965}, {"uuml", 252}, {"weierp", 8472},
+  {"xi", 958}, {"yacute", 253}, {"yen", 165}, {"yuml", 255}, {"zeta", 950},
+  {"zwj", 8205}, {"zwnj", 8204}
+};
+
+static constexpr size_t ENTITY_COUNT = sizeof(ENTITIES) / sizeof(ENTITIES[0]);
+
+// Numeric references 128-159 are Windows-1252 in practice (0 = keep as is)
+static const uint16_t WINDOWS_1252_C1[32] PROGMEM = {
+  0x20AC, 0, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+  0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0, 0x017D, 0,
+  0, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+  0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0, 0x017E, 0x0178
+};
+
+// === Compile-time table checks and hash index ===
+static constexpr int compareNames(const char *a, const char *b) {
+  while (*a != '\0' && *a == *b) {
+    a++;
+    b++;
+  }
+  return (int)(unsigned char)*a - (int)(unsigned char)*b;
+}
+
+static constexpr size_t utf8Length(uint32_t codepoint) {
+  return codepoint < 0x80 ? 1 : codepoint < 0x800 ? 2 : codepoint < 0x10000 ? 3 : 4;
+}
+
+static constexpr bool entitiesSorted() {
+  for (size_t i = 0; i + 1 < ENTITY_COUNT; i++) {
+    if (compareNames(ENTITIES[i].name, ENTITIES[i + 1].name) >= 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// In-place decoding relies on "&name;" being at least as long as its UTF-8
+static constexpr bool entitiesFitInPlace() {
+  for (size_t i = 0; i < ENTITY_COUNT; i++) {
+    size_t length = 0;
+    while (ENTITIES[i].name[length] != '\0') {
+      length++;
+    }
+    if (utf8Length(ENTITIES[i].codepoint) > length + 2) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static_assert(entitiesSorted(), "HTML entity table must be sorted and free of duplicates");
+static_assert(entitiesFitInPlace(), "HTML entity longer than its reference text");
+
+// Names up to 8 letters pack into one 64-bit key, so a lookup is a hash,
+// a slot read and a single integer compare instead of a string compare.
+static_assert(HTML_ENTITY_MAX_NAME <= 8, "Entity names must fit a 64-bit key");
+
+static constexpr uint64_t packName(const char *name, size_t length) {
+  uint64_t key = 0;
+  for (size_t i = 0; i < length; i++) {
+    key |= (uint64_t)(uint8_t)name[i] << (8 * i);
+  }
+  return key;
+}
+
+static constexpr size_t entityNameLength(size_t entry) {
+  size_t length = 0;
+  while (ENTITIES[entry].name[length] != '\0') {
+    length++;
+  }
+  return length;
+}
+
+// Open-addressing hash index built by the compiler. Slots hold an entry
+// number (EMPTY_SLOT if unused); collisions probe linearly.
+const size_t HASH_BITS = 9;
+const size_t HASH_SLOTS = 1 << HASH_BITS;
+const uint8_t EMPTY_SLOT = 0xFF;
+const size_t MAX_PROBES = 8;
+
+static_assert(ENTITY_COUNT < EMPTY_SLOT, "Hash index uses 8-bit entry numbers");
+
+static constexpr size_t hashKey(uint64_t key) {
+  return (size_t)((key * 0x9E3779B97F4A7C15ull) >> (64 - HASH_BITS));  // Fibonacci hashing
+}
+
+struct EntityIndex {
+  uint64_t keys[ENTITY_COUNT];
+  uint16_t codepoints[ENTITY_COUNT];
+  uint8_t slots[HASH_SLOTS];
+  size_t longestProbe;
+};
+
+static constexpr EntityIndex buildEntityIndex() {
+  EntityIndex index = {};
+  for (size_t slot = 0; slot < HASH_SLOTS; slot++) {
+    index.slots[slot] = EMPTY_SLOT;
+  }
+  for (size_t entry = 0; entry < ENTITY_COUNT; entry++) {
+    uint64_t key = packName(ENTITIES[entry].name, entityNameLength(entry));
+    index.keys[entry] = key;
+    index.codepoints[entry] = ENTITIES[entry].codepoint;
+
+    size_t slot = hashKey(key);
+    size_t probe = 0;
+    while (index.slots[slot] != EMPTY_SLOT) {
+      slot = (slot + 1) % HASH_SLOTS;
+      probe++;
+    }
+    index.slots[slot] = (uint8_t)entry;
+    if (probe > index.longestProbe) {
+      index.longestProbe = probe;
+    }
+  }
+  return index;
+}
+
+static constexpr EntityIndex ENTITY_INDEX PROGMEM = buildEntityIndex();
+static_assert(ENTITY_INDEX.longestProbe < MAX_PROBES, "Entity hash index has long probe chains");
+
+static uint64_t readKey(size_t entry) {
+  const uint32_t *words = (const uint32_t *)&ENTITY_INDEX.keys[entry];
+  return (uint64_t)pgm_read_dword(words) | ((uint64_t)pgm_read_dword(words + 1) << 32);
+}
+
+// === Decoding ===
+size_t encodeUTF8(uint32_t codepoint, char *out) {
+  if (codepoint < 0x80) {
+    out[0] = (char)codepoint;
+    return 1;
+  }
+  if (codepoint < 0x800) {
+    out[0] = (char)(0xC0 | (codepoint >> 6));
+    out[1] = (char)(0x80 | (codepoint & 0x3F));
+    return 2;
+  }
+  if (codepoint < 0x10000) {
+    out[0] = (char)(0xE0 | (codepoint >> 12));
+    out[1] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+    out[2] = (char)(0x80 | (codepoint & 0x3F));
+    return 3;
+  }
+  out[0] = (char)(0xF0 | (codepoint >> 18));
+  out[1] = (char)(0x80 | ((codepoint >> 12) & 0x3F));
+  out[2] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+  out[3] = (char)(0x80 | (codepoint & 0x3F));
+  return 4;
+}
+
+// Parses "#228" / "#xE4", returns false if the text is not a number
+static bool parseNumericReference(const char *name, size_t length, uint32_t &codepoint) {
+  size_t i = 1;
+  uint32_t base = 10;
+  if (i < length && (name[i] == 'x' || name[i] == 'X')) {
+    base = 16;
+    i++;
+  }
+  if (i >= length) {
+    return false;
+  }
+
+  codepoint = 0;
+  for (; i < length; i++) {
+    char c = name[i];
+    uint32_t digit;
+    if (c >= '0' && c <= '9') {
+      digit = c - '0';
+    } else if (base == 16 && c >= 'a' && c <= 'f') {
+      digit = c - 'a' + 10;
+    } else if (base == 16 && c >= 'A' && c <= 'F') {
+      digit = c - 'A' + 10;
+    } else {
+      return false;
+    }
+    codepoint = codepoint * base + digit;
+  }
+  return true;
+}
+
+// Finds the code point for a packed name. A miss ends at the first empty slot.
+static bool lookupNamedEntity(uint64_t key, uint32_t &codepoint) {
+  size_t slot = hashKey(key);
+  for (size_t probe = 0; probe < MAX_PROBES; probe++) {
+    uint8_t entry = pgm_read_byte(&ENTITY_INDEX.slots[slot]);
+    if (entry == EMPTY_SLOT) {
+      return false;
+    }
+    if (readKey(entry) == key) {
+      codepoint = pgm_read_word(&ENTITY_INDEX.codepoints[entry]);
+      return true;
+    }
+    slot = (slot + 1) % HASH_SLOTS;
+  }
+  return false;
+}
+
+// Resolves the text between '&' and ';' to a code point
+static bool resolveReference(const char *name, size_t length, uint64_t key, uint32_t &codepoint) {
+  if (name[0] != '#') {
+    return lookupNamedEntity(key, codepoint);
+  }
+
+  if (!parseNumericReference(name, length, codepoint)) {
+    return false;
+  }
+  if (codepoint >= 0x80 && codepoint <= 0x9F) {
+    uint16_t mapped = pgm_read_word(&WINDOWS_1252_C1[codepoint - 0x80]);
+    if (mapped != 0) {
+      codepoint = mapped;
+    }
+  }
+  // Same replacements a browser makes for invalid code points
+  if (codepoint == 0 || codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF)) {
+    codepoint = 0xFFFD;
+  }
+  return true;
+}
+
+size_t decodeHTMLEntity(const char *name, size_t length, char *out) {
+  uint32_t codepoint;
+  if (length == 0 || length > HTML_ENTITY_MAX_NAME ||
+      !resolveReference(name, length, packName(name, length), codepoint)) {
+    return 0;
+  }
+  return encodeUTF8(codepoint, out);
+}
+
+size_t decodeHTMLEntities(char *text, size_t length) {
+  size_t write = 0;
+  size_t read = 0;
+
+  while (read < length) {
+    // Copy plain text up to the next '&' in one go
+    const char *amp = (const char *)memchr(text + read, '&', length - read);
+    size_t plainEnd = amp ? (size_t)(amp - text) : length;
+    if (write != read) {
+      memmove(text + write, text + read, plainEnd - read);
+    }
+    write += plainEnd - read;
+    read = plainEnd;
+    if (read >= length) {
+      break;
+    }
+
+    // Scan for the terminating ';', packing the name as we go
+    const char *name = text + read + 1;
+    size_t nameLength = 0;
+    uint64_t key = 0;
+    while (read + 1 + nameLength < length && nameLength <= HTML_ENTITY_MAX_NAME) {
+      char c = name[nameLength];
+      if (c == ';' || c == '&') {
+        break;
+      }
+      key |= (uint64_t)(uint8_t)c << (8 * (nameLength & 7));
+      nameLength++;
+    }
+
+    uint32_t codepoint;
+    if (read + 1 + nameLength < length && name[nameLength] == ';' && nameLength > 0 &&
+        nameLength <= HTML_ENTITY_MAX_NAME &&
+        resolveReference(name, nameLength, key, codepoint)) {
+      // The name has been read, so its bytes may now be overwritten
+      write += encodeUTF8(codepoint, text + write);
+      read += nameLength + 2;
+      continue;
+    }
+
+    // Not a reference, keep the '&'
+    text[write++] = '&';
+    read++;
+  }
+
+  text[write] = '\0';
+  return write;
+}
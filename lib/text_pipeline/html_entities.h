@@ -0,0 +1,32 @@
+#ifndef HTML_ENTITIES_H
+#define HTML_ENTITIES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Single-pass HTML character reference decoder.
+//
+// Named references (all HTML 4 entities plus &apos;) are looked up through a
+// hash index the compiler builds into flash. Decimal (&#228;) and hex
+// (&#xE4;) references are supported too. Output is UTF-8.
+//
+// A decoded reference is never longer than its source text, so decoding can
+// run in place.
+
+// Longest text between '&' and ';' worth looking at ("thetasym", "#x10FFFF")
+const size_t HTML_ENTITY_MAX_NAME = 8;
+
+// Encode a code point as UTF-8. Returns the number of bytes written (1-4).
+size_t encodeUTF8(uint32_t codepoint, char *out);
+
+// Decode one reference, given the text between '&' and ';' (e.g. "ouml",
+// "#228", "#xE4"). Writes up to 4 bytes to out and returns the count, or 0
+// if the reference is unknown.
+size_t decodeHTMLEntity(const char *name, size_t length, char *out);
+
+// Decode every reference in text in place. Unknown references are kept
+// verbatim. Returns the new length and NUL-terminates the result, so text
+// needs room for length + 1 bytes.
+size_t decodeHTMLEntities(char *text, size_t length);
+
+#endif
@@ -0,0 +1,208 @@
+#include "html_text.h"
+
+static const uint8_t MAX_PENDING_BREAKS = 2;
+
+static bool isSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static bool isLetter(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static bool isEntityNameChar(char c, uint8_t position) {
+  return isLetter(c) || (c >= '0' && c <= '9') || (c == '#' && position == 0);
+}
+
+HtmlTextCleaner::HtmlTextCleaner() {
+  begin(nullptr, 0);
+}
+
+void HtmlTextCleaner::begin(char *out, size_t outCapacity) {
+  output = out;
+  capacity = outCapacity;
+  outputLength = 0;
+  overflow = false;
+  if (output != nullptr && capacity > 0) {
+    output[0] = '\0';
+  }
+
+  inTag = false;
+  tagQuote = 0;
+  tagNameLength = 0;
+  tagNameDone = false;
+  entityLength = 0;
+  inEntity = false;
+  pendingSpace = false;
+  pendingBreaks = 0;
+}
+
+void HtmlTextCleaner::put(char c) {
+  if (inTag) {
+    tagByte(c);
+    return;
+  }
+
+  if (c == '<') {
+    flushEntity();
+    inTag = true;
+    tagQuote = 0;
+    tagNameLength = 0;
+    tagNameDone = false;
+    return;
+  }
+
+  entityByte(c);
+}
+
+size_t HtmlTextCleaner::finish() {
+  flushEntity();
+  // Pending spaces and breaks are only written before visible text, so
+  // there is nothing trailing to trim
+  pendingSpace = false;
+  pendingBreaks = 0;
+  return outputLength;
+}
+
+// === Tag stage ===
+void HtmlTextCleaner::tagByte(char c) {
+  if (tagQuote != 0) {
+    if (c == tagQuote) {
+      tagQuote = 0;
+    }
+    return;
+  }
+
+  if (c == '>') {
+    endTag();
+    return;
+  }
+
+  if (!tagNameDone) {
+    if (c == '/' && tagNameLength == 0) {
+      return;  // Closing tag, same break as the opening one
+    }
+    if (isLetter(c) || (tagNameLength > 0 && c >= '0' && c <= '9')) {
+      if (tagNameLength < sizeof(tagName)) {
+        tagName[tagNameLength] = (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+      }
+      if (tagNameLength <= sizeof(tagName)) {
+        tagNameLength++;
+      }
+      return;
+    }
+    tagNameDone = true;
+  }
+
+  if (c == '"' || c == '\'') {
+    tagQuote = c;
+  }
+}
+
+void HtmlTextCleaner::endTag() {
+  inTag = false;
+
+  bool isBreak = tagNameLength == 2 && tagName[0] == 'b' && tagName[1] == 'r';
+  bool isBlock = (tagNameLength == 1 && tagName[0] == 'p') ||
+                 (tagNameLength == 2 && tagName[0] == 'l' && tagName[1] == 'i') ||
+                 (tagNameLength == 3 && tagName[0] == 'd' && tagName[1] == 'i' && tagName[2] == 'v');
+
+  if (isBreak) {
+    if (pendingBreaks < MAX_PENDING_BREAKS) {
+      pendingBreaks++;
+    }
+  } else if (isBlock && pendingBreaks == 0) {
+    pendingBreaks = 1;
+  }
+}
+
+// === Entity stage ===
+void HtmlTextCleaner::entityByte(char c) {
+  if (!inEntity) {
+    if (c == '&') {
+      inEntity = true;
+      entityLength = 0;
+    } else {
+      textByte(c);
+    }
+    return;
+  }
+
+  if (c == ';') {
+    char decoded[4];
+    size_t decodedLength = decodeHTMLEntity(entity, entityLength, decoded);
+    if (decodedLength > 0) {
+      inEntity = false;
+      for (size_t i = 0; i < decodedLength; i++) {
+        textByte(decoded[i]);
+      }
+      return;
+    }
+    // Unknown entity: keep it verbatim
+    flushEntity();
+    textByte(c);
+    return;
+  }
+
+  if (isEntityNameChar(c, entityLength) && entityLength < HTML_ENTITY_MAX_NAME) {
+    entity[entityLength++] = c;
+    return;
+  }
+
+  // Not an entity after all
+  flushEntity();
+  entityByte(c);
+}
+
+void HtmlTextCleaner::flushEntity() {
+  if (!inEntity) {
+    return;
+  }
+  inEntity = false;
+  textByte('&');
+  for (uint8_t i = 0; i < entityLength; i++) {
+    textByte(entity[i]);
+  }
+}
+
+// === Whitespace stage ===
+// Separators are held back until the next visible character, which both
+// collapses runs and trims the start and end of the text
+void HtmlTextCleaner::textByte(char c) {
+  if (isSpace(c)) {
+    pendingSpace = true;
+    return;
+  }
+
+  if (outputLength > 0) {
+    if (pendingBreaks > 0) {
+      for (uint8_t i = 0; i < pendingBreaks; i++) {
+        emit('\n');
+      }
+    } else if (pendingSpace) {
+      emit(' ');
+    }
+  }
+  pendingSpace = false;
+  pendingBreaks = 0;
+
+  emit(c);
+}
+
+void HtmlTextCleaner::emit(char c) {
+  if (outputLength + 1 >= capacity) {
+    overflow = true;
+    return;
+  }
+  output[outputLength++] = c;
+  output[outputLength] = '\0';
+}
+
+size_t cleanHTMLText(const char *html, size_t length, char *output, size_t capacity) {
+  HtmlTextCleaner cleaner;
+  cleaner.begin(output, capacity);
+  for (size_t i = 0; i < length; i++) {
+    cleaner.put(html[i]);
+  }
+  return cleaner.finish();
+}
@@ -0,0 +1,67 @@
+#ifndef HTML_TEXT_H
+#define HTML_TEXT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "html_entities.h"
+
+// Turns HTML into printable text in one pass: tags are stripped, character
+// references decoded, whitespace collapsed and the result trimmed.
+//
+// Block-level tags (<br>, <p>, <div>, <li>) become '\n' so the printer can
+// start a new line. Two <br> in a row give an empty line; other whitespace
+// around breaks is dropped.
+//
+// Text is written into a buffer owned by the caller and nothing is
+// allocated, so this runs per byte straight off a network stream.
+class HtmlTextCleaner {
+public:
+  HtmlTextCleaner();
+
+  // Start writing into output (capacity includes the terminating NUL)
+  void begin(char *output, size_t capacity);
+
+  // Consume one byte of HTML
+  void put(char c);
+
+  // Flush pending state and trim. Returns the final text length.
+  size_t finish();
+
+  size_t length() const { return outputLength; }
+  bool overflowed() const { return overflow; }
+
+private:
+  void tagByte(char c);
+  void endTag();
+  void entityByte(char c);
+  void flushEntity();
+  void textByte(char c);
+  void emit(char c);
+
+  char *output;
+  size_t capacity;
+  size_t outputLength;
+  bool overflow;
+
+  // Tag stage
+  bool inTag;
+  char tagQuote;           // Quote char while inside an attribute value
+  char tagName[4];         // Lower-case name, enough for "div"
+  uint8_t tagNameLength;
+  bool tagNameDone;
+
+  // Entity stage: pending "&name" without the terminating ';'
+  char entity[HTML_ENTITY_MAX_NAME];
+  uint8_t entityLength;
+  bool inEntity;
+
+  // Whitespace stage: separators owed before the next visible character
+  bool pendingSpace;
+  uint8_t pendingBreaks;
+};
+
+// Clean a complete HTML fragment into output. Returns the text length; the
+// result is truncated if it does not fit into capacity - 1 bytes.
+size_t cleanHTMLText(const char *html, size_t length, char *output, size_t capacity);
+
+#endif
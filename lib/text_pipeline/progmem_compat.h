@@ -0,0 +1,21 @@
+#ifndef PROGMEM_COMPAT_H
+#define PROGMEM_COMPAT_H
+
+// Lookup tables live in flash on the ESP8266 (PROGMEM) and are read with the
+// pgm_read_* helpers. On the host they are ordinary const data.
+
+#ifdef ARDUINO
+#include <pgmspace.h>
+#else
+#include <stdint.h>
+#include <string.h>
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define strcmp_P strcmp
+#define memcpy_P memcpy
+#define memcmp_P memcmp
+#endif
+
+#endif
@@ -0,0 +1,377 @@
+#include "receipt_batch.h"
+#include "html_entities.h"
+#include <string.h>
+
+static bool isSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+ReceiptBatchParser::ReceiptBatchParser(BatchItemCallback callback, void *context)
+  : callback(callback), context(context) {
+  reset();
+}
+
+void ReceiptBatchParser::reset() {
+  failure = BATCH_OK;
+  state = START;
+  target = TARGET_NONE;
+  array = false;
+  itemCount = 0;
+  position = 0;
+  messageLength = 0;
+  dateLength = 0;
+  keyLength = 0;
+  highSurrogate = 0;
+}
+
+bool ReceiptBatchParser::write(const char *data, size_t length) {
+  for (size_t i = 0; i < length && failure == BATCH_OK; i++) {
+    put(data[i]);
+    if (failure == BATCH_OK) {
+      position++;
+    }
+  }
+  return failure == BATCH_OK;
+}
+
+BatchError ReceiptBatchParser::finish() {
+  if (failure != BATCH_OK) {
+    return failure;
+  }
+  if (state == START) {
+    fail(BATCH_EMPTY);
+  } else if (state == END && itemCount == 0) {
+    fail(BATCH_EMPTY);
+  } else if (state != END && !(state == AFTER_ITEM && !array)) {
+    fail(BATCH_SYNTAX);  // Cut off
+  }
+  return failure;
+}
+
+void ReceiptBatchParser::fail(BatchError error) {
+  if (failure == BATCH_OK) {
+    failure = error;
+  }
+}
+
+// === Structure ===
+void ReceiptBatchParser::startItem(char c) {
+  messageLength = 0;
+  hasMessage = false;
+  dateLength = 0;
+  hasDate = false;
+  dateTooLong = false;
+
+  if (c == '{') {
+    state = OBJECT_FIRST;
+  } else if (c == '"') {
+    target = TARGET_ITEM;
+    hasMessage = true;
+    state = STRING;
+  } else {
+    fail(BATCH_SYNTAX);
+  }
+}
+
+void ReceiptBatchParser::put(char c) {
+  switch (state) {
+    case START:
+      if (isSpace(c)) return;
+      if (c == '[') {
+        array = true;
+        state = ARRAY_FIRST;
+      } else {
+        startItem(c);  // NDJSON
+      }
+      return;
+
+    case ARRAY_FIRST:
+      if (isSpace(c)) return;
+      if (c == ']') {
+        state = END;
+      } else {
+        startItem(c);
+      }
+      return;
+
+    case ARRAY_NEXT:
+      if (isSpace(c)) return;
+      startItem(c);
+      return;
+
+    case AFTER_ITEM:
+      if (isSpace(c)) return;
+      if (!array) {
+        startItem(c);
+      } else if (c == ',') {
+        state = ARRAY_NEXT;
+      } else if (c == ']') {
+        state = END;
+      } else {
+        fail(BATCH_SYNTAX);
+      }
+      return;
+
+    case OBJECT_FIRST:
+    case OBJECT_NEXT:
+      if (isSpace(c)) return;
+      if (c == '}' && state == OBJECT_FIRST) {
+        emitItem();
+      } else if (c == '"') {
+        keyLength = 0;
+        keyTooLong = false;
+        target = TARGET_KEY;
+        state = STRING;
+      } else {
+        fail(BATCH_SYNTAX);
+      }
+      return;
+
+    case COLON:
+      if (isSpace(c)) return;
+      if (c == ':') {
+        state = VALUE;
+      } else {
+        fail(BATCH_SYNTAX);
+      }
+      return;
+
+    case VALUE:
+      if (isSpace(c)) return;
+      if (c == '"') {
+        state = STRING;
+      } else if (target != TARGET_NONE) {
+        fail(target == TARGET_MESSAGE ? BATCH_NO_MESSAGE : BATCH_SYNTAX);  // Not a string
+      } else if (c == '{' || c == '[') {
+        depth = 1;
+        skipInString = false;
+        skipEscaped = false;
+        state = SKIP_NESTED;
+      } else if (c == ',' || c == '}' || c == ']' || c == ':') {
+        fail(BATCH_SYNTAX);
+      } else {
+        state = SKIP_SCALAR;
+      }
+      if (c == '"' && target == TARGET_MESSAGE) {
+        messageLength = 0;
+        hasMessage = true;
+      } else if (c == '"' && target == TARGET_DATE) {
+        dateLength = 0;
+        dateTooLong = false;
+        hasDate = true;
+      }
+      return;
+
+    case SKIP_NESTED:
+      if (skipEscaped) {
+        skipEscaped = false;
+      } else if (skipInString) {
+        skipEscaped = c == '\\';
+        skipInString = c != '"';
+      } else if (c == '"') {
+        skipInString = true;
+      } else if (c == '{' || c == '[') {
+        depth++;
+      } else if ((c == '}' || c == ']') && --depth == 0) {
+        state = AFTER_VALUE;
+      }
+      return;
+
+    case SKIP_SCALAR:
+      if (c == ',' || c == '}' || isSpace(c)) {
+        state = AFTER_VALUE;
+        put(c);
+      } else if (c == '{' || c == '[' || c == ']' || c == '"' || c == ':') {
+        fail(BATCH_SYNTAX);
+      }
+      return;
+
+    case AFTER_VALUE:
+      if (isSpace(c)) return;
+      if (c == ',') {
+        state = OBJECT_NEXT;
+      } else if (c == '}') {
+        emitItem();
+      } else {
+        fail(BATCH_SYNTAX);
+      }
+      return;
+
+    case STRING:
+      if (c == '"') {
+        stringDone();
+      } else if (c == '\\') {
+        state = ESCAPE;
+      } else if ((uint8_t)c < 0x20) {
+        fail(BATCH_SYNTAX);  // Raw control characters must be escaped
+      } else {
+        append(&c, 1);
+      }
+      return;
+
+    case ESCAPE: {
+      state = STRING;
+      char plain;
+      switch (c) {
+        case '"': plain = '"'; break;
+        case '\\': plain = '\\'; break;
+        case '/': plain = '/'; break;
+        case 'b': plain = '\b'; break;
+        case 'f': plain = '\f'; break;
+        case 'n': plain = '\n'; break;
+        case 'r': plain = '\r'; break;
+        case 't': plain = '\t'; break;
+        case 'u':
+          codepoint = 0;
+          hexDigits = 0;
+          state = UNICODE;
+          return;
+        default:
+          fail(BATCH_SYNTAX);
+          return;
+      }
+      append(&plain, 1);
+      return;
+    }
+
+    case UNICODE: {
+      int value = hexValue(c);
+      if (value < 0) {
+        fail(BATCH_SYNTAX);
+        return;
+      }
+      codepoint = (codepoint << 4) | value;
+      if (++hexDigits == 4) {
+        state = STRING;
+        appendCodepoint(codepoint);
+      }
+      return;
+    }
+
+    case END:
+      if (!isSpace(c)) {
+        fail(BATCH_SYNTAX);
+      }
+      return;
+  }
+}
+
+// The closing quote: what the string was decides what comes next
+void ReceiptBatchParser::stringDone() {
+  if (highSurrogate != 0) {
+    highSurrogate = 0;
+    appendCodepoint(0xFFFD);  // Its low half never came
+  }
+
+  if (target == TARGET_KEY) {
+    key[keyLength] = '\0';
+    if (!keyTooLong && strcmp(key, "message") == 0) {
+      target = TARGET_MESSAGE;
+    } else if (!keyTooLong && strcmp(key, "date") == 0) {
+      target = TARGET_DATE;
+    } else {
+      target = TARGET_NONE;
+    }
+    state = COLON;
+  } else if (target == TARGET_ITEM) {
+    emitItem();
+  } else {
+    state = AFTER_VALUE;
+  }
+}
+
+// === Decoded text ===
+void ReceiptBatchParser::append(const char *bytes, size_t length) {
+  if (highSurrogate != 0) {
+    highSurrogate = 0;
+    appendCodepoint(0xFFFD);  // Its low half never came
+  }
+
+  switch (target) {
+    case TARGET_KEY:
+      if (keyLength + length > BATCH_KEY_MAX) {
+        keyTooLong = true;
+        return;
+      }
+      memcpy(key + keyLength, bytes, length);
+      keyLength += length;
+      return;
+    case TARGET_MESSAGE:
+    case TARGET_ITEM:
+      if (messageLength + length > BATCH_MESSAGE_MAX) {
+        fail(BATCH_TOO_LONG);
+        return;
+      }
+      memcpy(message + messageLength, bytes, length);
+      messageLength += length;
+      return;
+    case TARGET_DATE:
+      if (dateLength + length > BATCH_DATE_MAX) {
+        dateTooLong = true;
+        return;
+      }
+      memcpy(date + dateLength, bytes, length);
+      dateLength += length;
+      return;
+    case TARGET_NONE:
+      return;
+  }
+}
+
+// A \u escape, joining surrogate pairs
+void ReceiptBatchParser::appendCodepoint(uint32_t value) {
+  if (highSurrogate != 0) {
+    uint32_t high = highSurrogate;
+    highSurrogate = 0;
+    if (value >= 0xDC00 && value <= 0xDFFF) {
+      value = 0x10000 + ((high - 0xD800) << 10) + (value - 0xDC00);
+    } else {
+      appendCodepoint(0xFFFD);
+    }
+  }
+
+  if (value >= 0xD800 && value <= 0xDBFF) {
+    highSurrogate = value;
+    return;
+  }
+  if (value == 0 || (value >= 0xDC00 && value <= 0xDFFF)) {
+    value = 0xFFFD;
+  }
+  char bytes[4];
+  append(bytes, encodeUTF8(value, bytes));
+}
+
+void ReceiptBatchParser::emitItem() {
+  state = AFTER_ITEM;
+  if (!hasMessage) {
+    fail(BATCH_NO_MESSAGE);
+    return;
+  }
+  message[messageLength] = '\0';
+  date[dateLength] = '\0';
+  bool withDate = hasDate && !dateTooLong;
+  if (!callback(message, messageLength, withDate ? date : nullptr, context)) {
+    fail(BATCH_STOPPED);
+    return;
+  }
+  itemCount++;
+}
+
+const char *batchErrorText(BatchError error) {
+  switch (error) {
+    case BATCH_OK: return "OK";
+    case BATCH_EMPTY: return "No receipts in the batch";
+    case BATCH_SYNTAX: return "Not a JSON array or NDJSON of receipts";
+    case BATCH_NO_MESSAGE: return "Receipt without a message";
+    case BATCH_TOO_LONG: return "Message too long";
+    case BATCH_STOPPED: return "Batch stopped";
+  }
+  return "Unknown error";
+}
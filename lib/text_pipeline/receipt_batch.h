@@ -0,0 +1,125 @@
+#ifndef RECEIPT_BATCH_H
+#define RECEIPT_BATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Streaming parser for a batch of receipts in one request body, either a
+// JSON array or NDJSON (one item per line):
+//
+//   [{"message": "Milch", "date": "2025-07-04"}, {"message": "Eier"}, "Brot"]
+//
+// An item is an object with a "message" string and an optional "date"
+// string, or just the message as a string. Other fields are skipped.
+//
+// Bytes are fed as the body arrives, and each item is handed to the
+// callback as soon as its closing brace is read, so only one item is kept
+// (in fixed buffers). Escapes are decoded to UTF-8, lone surrogates become
+// U+FFFD. Numbers and literals of skipped fields aren't validated.
+//
+// Plain C++ only (no Arduino headers) so the same code runs in host tests.
+
+const size_t BATCH_MESSAGE_MAX = 400;  // Bytes of UTF-8, fits a print job slot
+const size_t BATCH_DATE_MAX = 10;      // A longer date is dropped (prints today's)
+const size_t BATCH_KEY_MAX = 8;        // Longer keys can't be ours and are skipped
+
+// Return false to stop the batch (BATCH_STOPPED). date is null if the item
+// has none. message is NUL-terminated as well.
+typedef bool (*BatchItemCallback)(const char *message, size_t length, const char *date, void *context);
+
+enum BatchError {
+  BATCH_OK,
+  BATCH_EMPTY,        // No items
+  BATCH_SYNTAX,       // Not a JSON array or NDJSON of items
+  BATCH_NO_MESSAGE,   // An item without a message string
+  BATCH_TOO_LONG,     // A message longer than BATCH_MESSAGE_MAX
+  BATCH_STOPPED       // The callback refused an item
+};
+
+class ReceiptBatchParser {
+public:
+  ReceiptBatchParser(BatchItemCallback callback, void *context);
+
+  // Forget everything before a new body
+  void reset();
+
+  // Consume a chunk of the body. Returns false once the batch has failed;
+  // the rest can be skipped.
+  bool write(const char *data, size_t length);
+
+  // Call after the last chunk: BATCH_OK if the body ended after a complete
+  // batch
+  BatchError finish();
+
+  BatchError error() const { return failure; }
+  uint16_t items() const { return itemCount; }      // Handed to the callback so far
+  size_t offset() const { return position; }        // Bytes consumed, up to the error
+
+private:
+  enum State {
+    START,            // Before the array or the first NDJSON item
+    ARRAY_FIRST,      // After '[': an item or ']'
+    ARRAY_NEXT,       // After ',': an item
+    AFTER_ITEM,       // ',' or ']' in an array; the next item or nothing in NDJSON
+    OBJECT_FIRST,     // After '{': a key or '}'
+    OBJECT_NEXT,      // After ',': a key
+    COLON,
+    VALUE,
+    SKIP_NESTED,      // Object or array value of a field we don't use
+    SKIP_SCALAR,      // Number or literal of a field we don't use
+    AFTER_VALUE,      // ',' or '}'
+    STRING,
+    ESCAPE,
+    UNICODE,          // \uXXXX, `hexDigits` read so far
+    END               // After ']': only whitespace
+  };
+
+  enum Target {
+    TARGET_KEY,
+    TARGET_MESSAGE,   // Value of "message"
+    TARGET_DATE,
+    TARGET_ITEM,      // A string item: all message
+    TARGET_NONE       // String of a field we don't use
+  };
+
+  void put(char c);
+  void startItem(char c);
+  void stringDone();
+  void append(const char *bytes, size_t length);
+  void appendCodepoint(uint32_t codepoint);
+  void emitItem();
+  void fail(BatchError error);
+
+  BatchItemCallback callback;
+  void *context;
+  BatchError failure;
+  State state;
+  Target target;
+  bool array;
+  uint16_t itemCount;
+  size_t position;
+
+  // Current item
+  char message[BATCH_MESSAGE_MAX + 1];
+  size_t messageLength;
+  bool hasMessage;
+  char date[BATCH_DATE_MAX + 1];
+  size_t dateLength;
+  bool hasDate;
+  bool dateTooLong;
+  char key[BATCH_KEY_MAX + 1];
+  size_t keyLength;
+  bool keyTooLong;
+
+  // Escapes and skipping
+  uint32_t codepoint;
+  uint16_t highSurrogate;  // Waiting for its low half, 0 if none
+  uint8_t hexDigits;
+  uint16_t depth;
+  bool skipInString;
+  bool skipEscaped;
+};
+
+const char *batchErrorText(BatchError error);
+
+#endif
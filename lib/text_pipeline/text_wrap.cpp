@@ -0,0 +1,367 @@
+#include "text_wrap.h"
+#include <stdint.h>
+#include <string.h>
+
+// Balanced layout looks back at most this many words for the start of a
+// line. A line holds at most (width + 1) / 2 words, so the result is exact
+// up to 95 columns.
+static const size_t BALANCE_WINDOW = 48;
+static const uint8_t LINE_START = 0x80;  // Flag next to the word count in back[]
+
+static bool isContinuation(char c, bool utf8) {
+  return utf8 && ((uint8_t)c & 0xC0) == 0x80;
+}
+
+// Offset of the first character after `columns` columns from `from`
+static size_t advanceColumns(const char *text, size_t from, size_t end, size_t columns, bool utf8) {
+  size_t counted = 0;
+  size_t pos = from;
+  while (pos < end) {
+    if (!isContinuation(text[pos], utf8)) {
+      if (counted == columns) {
+        break;
+      }
+      counted++;
+    }
+    pos++;
+  }
+  return pos;
+}
+
+// One paragraph that doesn't fit on a line, text[pos..end)
+static size_t wrapGreedy(const char *text, size_t pos, size_t end, const WrapOptions &options,
+                         WrapLineCallback emitLine, void *context) {
+  size_t lines = 0;
+
+  while (pos < end) {
+    size_t limit = advanceColumns(text, pos, end, options.width, options.utf8);
+    if (limit == end) {
+      emitLine(text + pos, end - pos, context);
+      return lines + 1;
+    }
+
+    // Last space within the limit, otherwise cut the word
+    size_t breakAt = limit;
+    while (breakAt > pos && text[breakAt] != ' ') {
+      breakAt--;
+    }
+    if (breakAt == pos) {
+      breakAt = limit;
+    }
+
+    emitLine(text + pos, breakAt - pos, context);
+    lines++;
+
+    // Drop the spaces the line broke at
+    pos = breakAt;
+    while (pos < end && text[pos] == ' ') {
+      pos++;
+    }
+  }
+
+  return lines;
+}
+
+// Best way to lay out the words before one, as seen from the next line
+struct WrapPrefix {
+  size_t start;     // Offset and column of the word the next line starts with
+  size_t column;
+  uint32_t cost;    // Sum of squared free columns
+  uint16_t lines;
+};
+
+static bool better(uint16_t lines, uint32_t cost, const WrapPrefix &best) {
+  return lines < best.lines || (lines == best.lines && cost < best.cost);
+}
+
+static size_t wrapBalanced(const char *text, size_t pos, size_t end, const WrapOptions &options,
+                           WrapLineCallback emitLine, void *context) {
+  // Words on the last line of the best layout ending at each word, flagged
+  // with LINE_START once the breaks are chosen
+  static uint8_t back[WRAP_MAX_WORDS + 1];
+  WrapPrefix window[BALANCE_WINDOW];
+
+  const size_t width = options.width;
+  window[0].start = pos;
+  window[0].column = 0;
+  window[0].cost = 0;
+  window[0].lines = 0;
+  back[0] = 0;
+
+  // Forward pass: best layout of the first w + 1 words, from the last
+  // BALANCE_WINDOW prefixes
+  size_t words = 0;
+  size_t column = 0;
+  size_t endColumn = 0;
+  size_t scan = pos;
+  while (true) {
+    while (scan < end && text[scan] == ' ') {
+      scan++;
+      column++;
+    }
+    if (scan == end) {
+      break;
+    }
+
+    size_t wordStart = scan;
+    size_t wordColumn = column;
+    while (scan < end && text[scan] != ' ') {
+      if (!isContinuation(text[scan], options.utf8)) {
+        column++;
+      }
+      scan++;
+    }
+    if (words == WRAP_MAX_WORDS || column - wordColumn > width) {
+      return wrapGreedy(text, pos, end, options, emitLine, context);
+    }
+    if (words > 0) {
+      window[words % BALANCE_WINDOW].start = wordStart;
+      window[words % BALANCE_WINDOW].column = wordColumn;
+    }
+    endColumn = column;
+
+    size_t oldest = words + 2 > BALANCE_WINDOW ? words + 2 - BALANCE_WINDOW : 0;
+    WrapPrefix best = {0, 0, UINT32_MAX, UINT16_MAX};
+    uint8_t bestWords = 1;
+    for (size_t first = words + 1; first-- > oldest; ) {
+      const WrapPrefix &before = window[first % BALANCE_WINDOW];
+      size_t used = column - before.column;
+      if (used > width) {
+        break;
+      }
+      uint32_t slack = width - used;
+      if (better(before.lines + 1, before.cost + slack * slack, best)) {
+        best.cost = before.cost + slack * slack;
+        best.lines = before.lines + 1;
+        bestWords = words + 1 - first;
+      }
+    }
+    words++;
+    WrapPrefix &prefix = window[words % BALANCE_WINDOW];
+    prefix.cost = best.cost;
+    prefix.lines = best.lines;
+    back[words] = bestWords;
+  }
+
+  if (words == 0) {
+    return wrapGreedy(text, pos, end, options, emitLine, context);
+  }
+
+  // The last line may be as short as it likes
+  size_t oldest = words + 1 > BALANCE_WINDOW ? words + 1 - BALANCE_WINDOW : 0;
+  WrapPrefix best = {0, 0, UINT32_MAX, UINT16_MAX};
+  for (size_t first = words; first-- > oldest; ) {
+    const WrapPrefix &before = window[first % BALANCE_WINDOW];
+    if (endColumn - before.column > width) {
+      break;
+    }
+    if (better(before.lines + 1, before.cost, best)) {
+      best.cost = before.cost;
+      best.lines = before.lines + 1;
+      back[words] = words - first;
+    }
+  }
+
+  // Mark where lines start, back from the end
+  for (size_t word = words; word > 0; ) {
+    word -= back[word] & ~LINE_START;
+    back[word] |= LINE_START;
+  }
+
+  // Emit pass: a line runs from its first word to the end of its last
+  size_t lineStart = pos;
+  size_t wordEnd = pos;
+  size_t word = 0;
+  size_t lines = 0;
+  scan = pos;
+  while (true) {
+    while (scan < end && text[scan] == ' ') {
+      scan++;
+    }
+    if (scan == end) {
+      break;
+    }
+    if (word > 0 && (back[word] & LINE_START)) {
+      emitLine(text + lineStart, wordEnd - lineStart, context);
+      lines++;
+      lineStart = scan;
+    }
+    while (scan < end && text[scan] != ' ') {
+      scan++;
+    }
+    wordEnd = scan;
+    word++;
+  }
+  emitLine(text + lineStart, wordEnd - lineStart, context);
+  return lines + 1;
+}
+
+size_t wrapText(const char *text, size_t length, const WrapOptions &options,
+                WrapLineCallback emitLine, void *context) {
+  WrapOptions checked = options;
+  if (checked.width == 0) {
+    checked.width = 1;
+  }
+
+  size_t lines = 0;
+  size_t pos = 0;
+
+  while (pos < length) {
+    // End of the current paragraph
+    size_t lineEnd = pos;
+    while (lineEnd < length && text[lineEnd] != '\n') {
+      lineEnd++;
+    }
+    size_t cutEnd = lineEnd;
+    if (cutEnd > pos && text[cutEnd - 1] == '\r') {
+      cutEnd--;
+    }
+
+    if (advanceColumns(text, pos, cutEnd, checked.width, checked.utf8) == cutEnd) {
+      emitLine(text + pos, cutEnd - pos, context);
+      lines++;
+    } else if (checked.mode == WRAP_BALANCED) {
+      lines += wrapBalanced(text, pos, cutEnd, checked, emitLine, context);
+    } else {
+      lines += wrapGreedy(text, pos, cutEnd, checked, emitLine, context);
+    }
+    pos = lineEnd + 1;  // Past the '\n' (or past the end)
+  }
+
+  return lines;
+}
+
+size_t wrapText(const char *text, size_t length, size_t width,
+                WrapLineCallback emitLine, void *context) {
+  WrapOptions options = {width, WRAP_GREEDY, false};
+  return wrapText(text, length, options, emitLine, context);
+}
+
+// === Streaming ===
+WrapStream::WrapStream(const WrapOptions &options, WrapLineCallback emitLine, void *context)
+  : width(options.width), utf8(options.utf8), emitLine(emitLine), context(context) {
+  if (width == 0) {
+    width = 1;
+  }
+  if (width > WRAP_STREAM_MAX_WIDTH) {
+    width = WRAP_STREAM_MAX_WIDTH;
+  }
+  reset();
+}
+
+void WrapStream::reset() {
+  used = 0;
+  columns = 0;
+  lines = 0;
+  started = false;
+  broken = false;
+  skipSpaces = false;
+  pendingReturn = false;
+}
+
+void WrapStream::write(const char *text, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    char c = text[i];
+    if (pendingReturn) {
+      pendingReturn = false;
+      if (c == '\n') {
+        endParagraph();
+        continue;
+      }
+      put('\r');
+    }
+    if (c == '\n') {
+      endParagraph();
+    } else if (c == '\r') {
+      started = true;
+      pendingReturn = true;
+    } else {
+      put(c);
+    }
+  }
+}
+
+size_t WrapStream::finish() {
+  pendingReturn = false;  // Dropped at the end of the text as well
+  if (started) {
+    endParagraph();
+  }
+  return lines;
+}
+
+void WrapStream::emit(size_t length) {
+  emitLine(line, length, context);
+  lines++;
+}
+
+void WrapStream::put(char c) {
+  started = true;
+  if (skipSpaces) {
+    if (c == ' ') {
+      return;
+    }
+    skipSpaces = false;
+  }
+
+  bool continuation = isContinuation(c, utf8);
+  if (!continuation && columns == width) {
+    // c is the first character past the line, text[limit] in wrapGreedy()
+    broken = true;
+    size_t breakAt = 0;
+    if (c != ' ') {
+      for (size_t i = used; i-- > 1; ) {
+        if (line[i] == ' ') {
+          breakAt = i;
+          break;
+        }
+      }
+    }
+
+    if (breakAt == 0) {
+      // At c: a space (dropped with the ones after it) or a cut word
+      emit(used);
+      used = 0;
+      columns = 0;
+      if (c == ' ') {
+        skipSpaces = true;
+        return;
+      }
+    } else {
+      emit(breakAt);
+      size_t start = breakAt;
+      while (start < used && line[start] == ' ') {
+        start++;
+      }
+      memmove(line, line + start, used - start);
+      used -= start;
+      columns = 0;
+      for (size_t i = 0; i < used; i++) {
+        if (!isContinuation(line[i], utf8)) {
+          columns++;
+        }
+      }
+    }
+  } else if (used == sizeof(line)) {
+    // Only malformed UTF-8 (endless continuation bytes) gets here
+    broken = true;
+    emit(used);
+    used = 0;
+    columns = 0;
+  }
+
+  line[used++] = c;
+  if (!continuation) {
+    columns++;
+  }
+}
+
+void WrapStream::endParagraph() {
+  if (used > 0 || !broken) {
+    emit(used);
+  }
+  used = 0;
+  columns = 0;
+  started = false;
+  broken = false;
+  skipSpaces = false;
+}
@@ -0,0 +1,80 @@
+#ifndef TEXT_WRAP_H
+#define TEXT_WRAP_H
+
+#include <stddef.h>
+
+// Word wrapping for the 32-column printer.
+//
+// Lines break at spaces, or hard at the width when a word is longer than a
+// line. '\n' (optionally preceded by '\r') always starts a new line, so two
+// in a row print an empty line.
+//
+// Lines are handed to the callback as pointers into text, so wrapping needs
+// no copies and no heap.
+
+typedef void (*WrapLineCallback)(const char *line, size_t length, void *context);
+
+enum WrapMode {
+  WRAP_GREEDY,    // Each line takes as many words as fit
+  WRAP_BALANCED   // Same number of lines, but as even as possible
+};
+
+struct WrapOptions {
+  size_t width;   // Columns per line
+  WrapMode mode;
+  bool utf8;      // Columns count UTF-8 characters and hard cuts keep them
+                  // whole; otherwise every byte is a column
+};
+
+// WRAP_BALANCED is a minimum-raggedness layout (Knuth-Plass without
+// hyphenation): per paragraph it picks the breaks with the fewest lines
+// and, among those, the smallest sum of squared free columns, ignoring the
+// last line. Greedy filling already needs the fewest lines, so this never
+// costs paper; it avoids the odd nearly empty line in the middle of a
+// joke. Paragraphs with more than WRAP_MAX_WORDS words or a word wider
+// than a line are wrapped greedily. Not reentrant (static scratch space).
+const size_t WRAP_MAX_WORDS = 1024;
+
+// Returns the number of lines emitted
+size_t wrapText(const char *text, size_t length, const WrapOptions &options,
+                WrapLineCallback emitLine, void *context);
+
+// Greedy, one column per byte
+size_t wrapText(const char *text, size_t length, size_t width,
+                WrapLineCallback emitLine, void *context);
+
+// Greedy wrapping of text that arrives in pieces (a receipt streamed from
+// flash), with the same lines wrapText() gives in WRAP_GREEDY mode for the
+// whole text. Holds at most one line plus a character, so widths are
+// capped at WRAP_STREAM_MAX_WIDTH columns.
+const size_t WRAP_STREAM_MAX_WIDTH = 48;
+
+class WrapStream {
+public:
+  WrapStream(const WrapOptions &options, WrapLineCallback emitLine, void *context);
+
+  void write(const char *text, size_t length);
+  size_t finish();  // End of the text; returns the number of lines emitted
+  void reset();     // Start over with a new text
+
+private:
+  void put(char c);
+  void endParagraph();
+  void emit(size_t length);
+
+  size_t width;
+  bool utf8;
+  WrapLineCallback emitLine;
+  void *context;
+
+  char line[(WRAP_STREAM_MAX_WIDTH + 1) * 4];  // Current line, UTF-8 at worst
+  size_t used;
+  size_t columns;
+  size_t lines;
+  bool started;        // Paragraph has a character, even a space or '\r'
+  bool broken;         // Paragraph was broken at least once
+  bool skipSpaces;     // Dropping the spaces after a break
+  bool pendingReturn;  // '\r' that ends the paragraph if '\n' follows
+};
+
+#endif
@@ -5,6 +5,10 @@
 
 void setup() {
     Serial.begin(115200);
+    // Debug console on its own UART: wifi setup logs there already
+    if (&logSerial != &Serial) {
+        logSerial.begin(115200);
+    }
     delay(1000);
 
     Serial.println("\n\n=================================");
@@ -56,13 +60,12 @@ void setup() {
 void loop() {
     // Check WiFi connection status
     if (!isWifiConnected()) {
-        Serial.println("WiFi connection lost! Restarting...");
+        debugLog("WiFi connection lost! Restarting...");
+        prepareForRestart();
         delay(1000);
         ESP.restart();
     }
 
-    // Run user program loop
+    // Run user program loop (sleeps until its next task is due)
     mainProgramLoop();
-
-    delay(100);
 }
@@ -1,5 +1,23 @@
 #include "main_program.h"
 #include "wifi_setup.h"
+#include "source_extractor.h"
+#include "text_wrap.h"
+#include "code_page.h"
+#include "date_format.h"
+#include "print_engine.h"
+#include "baud_probe.h"
+#include "escpos_commands.h"
+#include "print_image.h"
+#include "print_job_queue.h"
+#include "print_spool.h"
+#include "receipt_batch.h"
+#include "task_scheduler.h"
+#include "retry_backoff.h"
+#include "conditional_get.h"
+#include "source_registry.h"
+#include "joke_bank.h"
+#include "joke_history.h"
+#include "recent_jokes.h"
 #include <Arduino.h>
 #include <ESPAsyncWebServer.h>
 #include <WiFiUdp.h>
@@ -12,8 +30,94 @@
 #include <WiFiClient.h>
 #include <WiFiClientSecure.h>
 
-// === JOKE SOURCE ===
-const String JOKE_SOURCE = "https://www.hahaha.de/witze/witzdestages.txt";
+// === JOKE SOURCES ===
+// Where jokes come from, tried best first (see source_registry.h). Listed
+// in config.json as "jokeSources", set through /api/sources; without a
+// list, hahaha.de only.
+SourceRegistry jokeSources;
+SourceRegistry pendingSources;   // Posted to /api/sources, applied by the config task
+bool sourcesPending = false;
+const char* SOURCE_STATS_FILE = "/source_stats.json";
+const uint32_t FETCH_WINDOW_MILLIS = 30000;  // No other source is started after this in one attempt
+const size_t SOURCES_BODY_MAX = 2048;
+
+// Jokes shipped in the LittleFS image (data/jokes.bin, built with
+// tests/bench_joke_bank.cpp), printed when no source delivers
+LittleFSBankStorage jokeBankStorage("/jokes.bin");
+JokeBank jokeBank(jokeBankStorage);
+uint32_t bankFallbacks = 0;      // Joke prints that used the bank
+
+// Every day's joke (see joke_history.h), listed by /api/history and
+// printed again through /api/history/reprint
+LittleFSHistoryStorage historyStorage("/history.log", "/history.idx", "/history.log.tmp", "/history.idx.tmp");
+JokeHistory jokeHistory(historyStorage);
+const long HISTORY_PAGE_DEFAULT = 10;
+const long HISTORY_PAGE_MAX = 50;
+const uint8_t HISTORY_PAGES_MAX = 2;         // Pages going out at once
+const size_t HISTORY_TEXT_PIECE = 32;        // Text read from the log per step
+
+// A page of /api/history, put together while the response goes out: the
+// next entry is read from the index, and its text from the log a piece at
+// a time, only when the connection has room for it
+enum HistoryPageStage : uint8_t { PAGE_START, PAGE_ENTRY, PAGE_TEXT, PAGE_END, PAGE_DONE };
+struct HistoryPage {
+  AsyncWebServerRequest *request;  // nullptr while the slot is free
+  HistoryPageStage stage;
+  uint32_t before;
+  uint32_t limit;
+  uint32_t sent;                   // Entries so far
+  uint32_t position;               // Of the entry being sent + 1
+  uint32_t compactions;            // Positions and offsets are from then
+  HistoryEntry entry;
+  size_t textDone;
+  uint32_t lastDate;               // Of the entry sent last
+  uint64_t lastHash;
+  char pending[HISTORY_TEXT_PIECE * 6];  // Next output, \u00xx at worst
+  size_t pendingLength;
+  size_t pendingDone;
+};
+HistoryPage historyPages[HISTORY_PAGES_MAX];
+
+// The jokes printed lately (see recent_jokes.h). A source repeating one is
+// passed over for the next, and with only repeats on offer a bank joke
+// becomes today's.
+RecentJokes recentJokes;
+const char* RECENT_JOKES_FILE = "/recent_jokes.bin";
+uint32_t repeatsSkipped = 0;     // Fetched jokes passed over as repeats
+
+// How the joke server is checked, with build_flags in platformio.ini:
+//  -DJOKE_TLS_PUBLIC_KEY='"-----BEGIN PUBLIC KEY-----\n..."'  pins the server's key;
+//      with an EC key only ECDSA suites are offered, the fastest handshake
+//  -DJOKE_TLS_FINGERPRINT='"AB CD ..."'  pins the certificate's SHA-1
+//  -DJOKE_TLS_PIN_HOST='"example.org"'  the host they are for (hahaha.de)
+// Neither, or another host: the certificate isn't checked.
+#ifndef JOKE_TLS_PIN_HOST
+#define JOKE_TLS_PIN_HOST "www.hahaha.de"
+#endif
+
+// TLS state kept between fetches, per source. The session lets the next
+// handshake resume instead of doing the key exchange again; the fragment
+// length is probed once, 0 if the server doesn't support MFLN.
+struct SourceTls {
+  BearSSL::Session session;
+  bool sessionValid;   // A fetch completed with this session
+  bool probed;
+  uint16_t fragment;
+};
+SourceTls sourceTls[JOKE_SOURCES_MAX];
+const uint16_t JOKE_TLS_FRAGMENTS[] = {512, 1024, 2048, 4096};
+const int JOKE_TLS_BUFFER_FALLBACK = 1024;  // Without MFLN, what has worked with hahaha.de
+
+// Per fetch, for the log and /api/fetch
+struct TlsFetchStats {
+  uint32_t handshakeMillis;   // Connect, handshake and response headers
+  uint32_t peakHeapBytes;     // Heap used at the worst point of the fetch
+  bool resumed;               // Offered a session from an earlier fetch
+  uint16_t fragment;          // MFLN fragment length, 0 without
+  uint32_t fetches;
+  uint32_t resumes;
+};
+TlsFetchStats tlsStats = {0, 0, false, 0, 0, 0};
 
 // === Time Configuration ===
 // Germany: UTC+1 (CET - Central European Time) = 3600 seconds
@@ -26,25 +130,126 @@ NTPClient timeClient(ntpUDP, "pool.ntp.org", utcOffsetInSeconds, 60000);
 AsyncWebServer server(80);
 
 // === Printer Setup ===
-SoftwareSerial printer(D4, D3); // Use D4 (TX, GPIO2), D3 (RX, GPIO0)
+// Serial port, select with build_flags = -DPRINTER_PORT=... in platformio.ini:
+//  PRINTER_PORT_SOFTWARE       SoftwareSerial, RX on D4 (printer TX), TX on D3 (printer RX)
+//  PRINTER_PORT_UART1          Serial1, TX on D4 (printer RX) only, no status feedback
+//  PRINTER_PORT_UART0_SWAPPED  Serial on D7 (RX, printer TX) and D8 (TX, printer RX),
+//                              debug console moves to Serial1 on D4
+// The hardware UARTs don't stall interrupts while sending, which keeps WiFi
+// stable during long receipts.
+#define PRINTER_PORT_SOFTWARE 0
+#define PRINTER_PORT_UART1 1
+#define PRINTER_PORT_UART0_SWAPPED 2
+#ifndef PRINTER_PORT
+#define PRINTER_PORT PRINTER_PORT_SOFTWARE
+#endif
+
+// Baud rate the printer is configured for. Ports with a receive line probe
+// PRINTER_BAUD_RATES at boot and only fall back to this if nobody answers.
+#ifndef PRINTER_BAUD
+#define PRINTER_BAUD 9600
+#endif
+
+#if PRINTER_PORT == PRINTER_PORT_UART0_SWAPPED
+HardwareSerialTransport printerTransport(Serial, true, true);
+HardwareSerial &logSerial = Serial1;
+const uint8_t PRINTER_MAX_BURST = 128;  // TX FIFO size
+#elif PRINTER_PORT == PRINTER_PORT_UART1
+HardwareSerialTransport printerTransport(Serial1, false);
+HardwareSerial &logSerial = Serial;
+const uint8_t PRINTER_MAX_BURST = 128;
+#else
+SoftwareSerial printer(D4, D3);
+SoftwareSerialTransport printerTransport(printer);
+HardwareSerial &logSerial = Serial;
+const uint8_t PRINTER_MAX_BURST = 16;   // Every byte blocks interrupts
+#endif
 const int maxCharsPerLine = 32;
 
-// === Storage for form data ===
-struct Receipt {
-  String message;
-  String timestamp;
-  bool hasData;
+// Code table for characters above 0x7F: CODE_PAGE_CP437, CODE_PAGE_CP850 or
+// CODE_PAGE_CP858. German letters sit at the same bytes in all three.
+#ifndef PRINTER_CODE_PAGE
+#define PRINTER_CODE_PAGE CODE_PAGE_CP858
+#endif
+
+// All printer output is queued here and drained from mainProgramLoop(). A
+// printer that answers status queries paces output and reports paper out
+// and other problems.
+PrintEngine printEngine;
+String lastPrinterProblem = "";
+const size_t PRINT_JOB_OVERHEAD = 128;  // Header, pauses and feeds around the text
+
+// === Print Jobs ===
+// Receipts, jokes and the server info wait here until the print queue has
+// room for them. Web handlers only add jobs; mainProgramLoop() prints them.
+PrintJobQueue printJobs;
+const uint32_t JOB_RETRY_MIN_SECONDS = 5;     // Retry-After bounds when the queue is full
+const uint32_t JOB_RETRY_MAX_SECONDS = 120;
+const size_t SERVER_INFO_LENGTH = 160;        // Text on the server info receipt
+
+// Receipts and jokes are journaled to flash and resume after a reset
+const char* PRINT_SPOOL_FILE = "/print_spool.bin";
+const char* PRINT_SPOOL_TEMP = "/print_spool.tmp";   // Compaction, renamed once complete
+LittleFSSpoolStorage spoolStorage(PRINT_SPOOL_FILE, PRINT_SPOOL_TEMP);
+PrintSpool printSpool(spoolStorage);
+
+// Messages sent as the request body stream into a file per job, so their
+// length is bounded by flash rather than RAM, and print from there
+const char* RECEIPT_DIR = "/jobs";
+const size_t RECEIPT_MAX_LENGTH = 16384;
+const size_t RECEIPT_CHUNK = 128;             // Read from the file per step while printing
+const uint8_t MAX_UPLOADS = 2;                // Message bodies arriving at once
+
+enum UploadResult { UPLOAD_RECEIVING, UPLOAD_DONE, UPLOAD_TOO_LARGE, UPLOAD_QUEUE_FULL, UPLOAD_FAILED };
+struct ReceiptUpload {
+  AsyncWebServerRequest *request;  // nullptr while the slot is free
+  uint32_t jobId;
+  File file;
+  UploadResult result;
 };
-
-Receipt currentReceipt = {"", "", false};
-
-// === Joke Request Structure ===
-struct JokeRequest {
-  bool shouldPrint;    // Flag: should we print a joke?
-  bool isScheduled;    // Flag: true if auto-scheduled, false if manual
+ReceiptUpload uploads[MAX_UPLOADS];
+
+// Receipts posted together to /api/batch, held in their slots until the
+// whole body has been read. One batch at a time.
+struct BatchUpload {
+  AsyncWebServerRequest *request;  // nullptr while no batch arrives
+  uint32_t jobIds[PRINT_JOB_SLOTS];
+  uint8_t jobCount;
+  bool queueFull;
+  BatchError result;
+};
+static bool holdBatchItem(const char *message, size_t length, const char *date, void *context);
+BatchUpload batch = {nullptr, {0}, 0, false, BATCH_OK};
+ReceiptBatchParser batchParser(holdBatchItem, &batch);
+
+// The streamed receipt being printed, open until its end is queued
+static void printWrappedLine(const char *line, size_t length, void *context);
+File receiptFile;
+ResumeSink receiptSink(printEngine, 0);
+WrapStream receiptWrap({(size_t)maxCharsPerLine, WRAP_GREEDY, false}, printWrappedLine, &receiptSink);
+char receiptBuffer[RECEIPT_CHUNK + 3];        // Room for a character cut off by the last read
+size_t receiptCarry = 0;
+
+// === Tasks ===
+// mainProgramLoop() only runs the scheduler. Printing, fetching, time sync
+// and saving the schedule are tasks; web handlers post events to them and
+// never wait for the printer, the network or flash.
+TaskScheduler scheduler([]() -> uint32_t { return millis(); });
+uint8_t printTask = NO_TASK;
+uint8_t fetchTask = NO_TASK;
+uint8_t scheduleTask = NO_TASK;
+uint8_t timeTask = NO_TASK;
+uint8_t configTask = NO_TASK;
+const uint32_t PRINT_TASK_MILLIS = 10;        // Feeding the printer
+const uint32_t SCHEDULE_TASK_MILLIS = 60000;  // Daily joke check
+const uint32_t TIME_TASK_MILLIS = 1000;       // NTPClient itself syncs once a minute
+const uint32_t LOOP_IDLE_MAX_MILLIS = 10;     // Longest sleep between passes
+
+enum TaskEventType {
+  EVENT_JOB_QUEUED,        // Print task, value is the job ID
+  EVENT_SCHEDULE_CHANGED,  // Config task
+  EVENT_SOURCES_CHANGED    // Config task, pendingSources to apply
 };
-
-JokeRequest currentJoke = {false, false};
 
 // === Error Tracking Structure ===
 struct JokeError {
@@ -55,18 +260,80 @@ struct JokeError {
   String detailedMessage;        // Human-readable error description
 };
 
+// === Joke Fetch State ===
+// One HTTPS attempt per run of the fetch task; between attempts it waits on
+// a timer, so other print jobs keep printing while the joke retries.
+enum FetchState {
+  FETCH_IDLE,
+  FETCH_WAITING,   // Attempts under way, a joke job waits for them
+  FETCH_FAILED     // Gave up, the print task prints a joke from the bank or the error receipt
+};
+
+const BackoffPolicy FETCH_BACKOFF = {
+  2000,     // First retry after 2s
+  60000,    // Then doubling up to a minute apart
+  8,        // Attempts
+  180000,   // All within 3 minutes
+  20        // +/- 20% jitter
+};
+
+FetchState fetchState = FETCH_IDLE;
+// Hardware random numbers, so devices that failed together spread out
+RetryBackoff fetchBackoff(FETCH_BACKOFF, [](uint32_t bound) -> uint32_t { return ESP.random() % bound; });
+JokeError fetchError = {-1, true, "", 0, ""};
+uint32_t nextFetchMillis = 0;   // When the next attempt is due, while waiting
+String fetchErrorMessage;       // Printed once the fetch gave up
+bool fetchIsPrefetch = false;   // Started ahead of time, no joke job needed
+
+// Today's joke is fetched ahead of the daily print, shortly after midnight
+// and again a while before the print time if that didn't work, so the
+// scheduled print only reads flash
+const int PREFETCH_AFTER_MIDNIGHT_MINUTES = 5;
+const int PREFETCH_LEAD_MINUTES = 30;
+String prefetchDate;                    // Day the windows below are for
+bool prefetchedAfterMidnight = false;
+bool prefetchedBeforePrint = false;
+uint32_t prefetchHits = 0;              // Joke jobs that found today's joke ready
+uint32_t prefetchMisses = 0;            // Joke jobs that waited for a fetch
+uint32_t jokeJobWaited = 0;             // ID of the joke job waiting, counted when it prints
+
+// Whether today's joke is on flash, cached or rendered. Polled by the
+// print task while a joke job waits, so flash is only looked at again once
+// the day changes or a fetch ended; saving the joke sets it.
+char jokeReadyDate[11] = "";            // ISO day the flag is for, empty to look again
+bool jokeReady = false;
+
 // === Schedule State ===
 struct ScheduleState {
   String dailyPrintTime;        // e.g., "09:00"
   String lastJokePrintDate;     // e.g., "2025-12-16"
-  unsigned long lastCheckMillis; // Throttle checks to once per minute
 };
 
-ScheduleState scheduleState = {"09:00", "", 0};
+ScheduleState scheduleState = {"09:00", ""};
 
 // Joke cache file paths
-const char* JOKE_CACHE_FILE = "/joke_cache.txt";     // Temp HTML (deleted after processing)
 const char* JOKE_CACHE_JSON = "/joke_cache.json";    // Processed cache (persistent)
+const char* LEGACY_HTML_CACHE = "/joke_cache.txt";   // Temp HTML used by older firmware
+
+// The cached joke, already rendered for the printer (wrapped, encoded, in
+// print queue format), so a scheduled print only streams the file. Layout:
+// "JKI1", the ISO date it was rendered for, payload length (uint32 LE),
+// payload.
+const char* JOKE_CACHE_IMAGE = "/joke_cache.bin";
+const char* JOKE_IMAGE_TEMP = "/joke_cache.tmp";    // Renamed once complete
+const char JOKE_IMAGE_MAGIC[] = "JKI1";
+const size_t JOKE_IMAGE_DATE_OFFSET = 4;
+const size_t JOKE_IMAGE_LENGTH_OFFSET = 14;
+const size_t JOKE_IMAGE_HEADER_SIZE = 18;
+const size_t JOKE_IMAGE_CHUNK = 128;
+File jokeImage;  // Open while being streamed to the printer
+
+// Streaming joke extractor for the source being fetched (holds the only
+// copy of the joke while fetching)
+SourceExtractor sourceExtractor;
+
+// ETag and Last-Modified of the cached joke's page, sent on the next fetch
+ConditionalGet jokeValidators;
 
 // === Debug Log Storage ===
 const int MAX_LOG_LINES = 50;
@@ -82,229 +349,213 @@ void debugLog(String message) {
     logCount++;
   }
 
-  // Also print to Serial
-  Serial.println(message);
+  // Also print to the serial console
+  logSerial.println(message);
 }
 
 // === Time Utilities ===
-String getFormattedDateTime() {
+// Current UTC+1 date and time from the NTP client
+static struct tm *currentTimeInfo() {
   timeClient.update();
+  time_t rawTime = timeClient.getEpochTime();
+  return gmtime(&rawTime);
+}
 
-  // Get epoch time
-  unsigned long epochTime = timeClient.getEpochTime();
-
-  // Convert to struct tm
-  time_t rawTime = epochTime;
-  struct tm * timeInfo = gmtime(&rawTime);
-
-  // Day names and month names
-  String dayNames[] = {"So", "Mo", "Di", "Mi", "Do", "Fr", "Sa"};
-  String monthNames[] = {"Januar", "Februar", "Maerz", "April", "Mai", "Juni",
-                        "Juli", "August", "September", "Okotber", "November", "Dezember"};
-
-  // Format: "Sat, 06 Jun 2025"
-  String formatted = dayNames[timeInfo->tm_wday] + ", ";
-  formatted += String(timeInfo->tm_mday < 10 ? "0" : "") + String(timeInfo->tm_mday) + " ";
-  formatted += monthNames[timeInfo->tm_mon] + " ";
-  formatted += String(timeInfo->tm_year + 1900);
+static CalendarDate currentCalendarDate() {
+  struct tm *timeInfo = currentTimeInfo();
+  CalendarDate date = {timeInfo->tm_year + 1900, timeInfo->tm_mon + 1, timeInfo->tm_mday};
+  return date;
+}
 
-  return formatted;
+String getFormattedDateTime() {
+  // Format: "Sa, 07 Juni 2025"
+  char buffer[32];
+  formatReceiptDate(currentCalendarDate(), buffer, sizeof(buffer));
+  return String(buffer);
 }
 
 String formatCustomDate(String customDate) {
-  // Expected format: YYYY-MM-DD or DD/MM/YYYY or similar
-  // This function will try to parse common date formats and return formatted string
-
-  String dayNames[] = {"So", "Mo", "Di", "Mi", "Do", "Fr", "Sa"};
-  String monthNames[] = {"Januar", "Februar", "Maerz", "April", "Mai", "Juni",
-                        "Juli", "August", "September", "Okotber", "November", "Dezember"};
-
-  int day = 0, month = 0, year = 0;
-
-  // Try to parse YYYY-MM-DD format
-  if (customDate.indexOf('-') != -1) {
-    int firstDash = customDate.indexOf('-');
-    int secondDash = customDate.indexOf('-', firstDash + 1);
-
-    if (firstDash != -1 && secondDash != -1) {
-      year = customDate.substring(0, firstDash).toInt();
-      month = customDate.substring(firstDash + 1, secondDash).toInt();
-      day = customDate.substring(secondDash + 1).toInt();
-    }
-  }
-  // Try to parse DD/MM/YYYY format
-  else if (customDate.indexOf('/') != -1) {
-    int firstSlash = customDate.indexOf('/');
-    int secondSlash = customDate.indexOf('/', firstSlash + 1);
-
-    if (firstSlash != -1 && secondSlash != -1) {
-      day = customDate.substring(0, firstSlash).toInt();
-      month = customDate.substring(firstSlash + 1, secondSlash).toInt();
-      year = customDate.substring(secondSlash + 1).toInt();
-    }
-  }
-
-  // Validate parsed values
-  if (day < 1 || day > 31 || month < 1 || month > 12 || year < 1900 || year > 2100) {
+  // Accepts YYYY-MM-DD (from the date picker) or DD/MM/YYYY
+  CalendarDate date;
+  if (!parseDate(customDate.c_str(), date)) {
     debugLog("Invalid date format, using current date");
     return getFormattedDateTime();
   }
 
-  // Calculate day of week (simplified algorithm - may not be 100% accurate for all dates)
-  // For a more accurate calculation, you might want to use a proper date library
-  int dayOfWeek = 0; // Default to Sunday if we can't calculate
-
-  // Format: "Sat, 06 Jun 2025"
-  String formatted = dayNames[dayOfWeek] + ", ";
-  formatted += String(day) + ". ";
-  formatted += monthNames[month - 1] + " ";
-  formatted += String(year);
-
-  return formatted;
+  char buffer[32];
+  formatReceiptDate(date, buffer, sizeof(buffer));
+  return String(buffer);
 }
 
 // Get current date in YYYY-MM-DD format
 String getCurrentDate() {
-  timeClient.update();
-  unsigned long epochTime = timeClient.getEpochTime();
-  time_t rawTime = epochTime;
-  struct tm * timeInfo = gmtime(&rawTime);
-
   char buffer[11]; // "YYYY-MM-DD\0"
-  sprintf(buffer, "%04d-%02d-%02d",
-          timeInfo->tm_year + 1900,
-          timeInfo->tm_mon + 1,
-          timeInfo->tm_mday);
+  formatISODate(currentCalendarDate(), buffer, sizeof(buffer));
   return String(buffer);
 }
 
 // Get current time in HH:MM format
 String getCurrentTime() {
-  timeClient.update();
-  unsigned long epochTime = timeClient.getEpochTime();
-  time_t rawTime = epochTime;
-  struct tm * timeInfo = gmtime(&rawTime);
-
+  struct tm *timeInfo = currentTimeInfo();
   char buffer[6]; // "HH:MM\0"
-  sprintf(buffer, "%02d:%02d",
-          timeInfo->tm_hour,
-          timeInfo->tm_min);
+  formatTimeOfDay(timeInfo->tm_hour, timeInfo->tm_min, buffer, sizeof(buffer));
   return String(buffer);
 }
 
 // === Schedule Configuration Functions ===
-// Load schedule settings from config.json
+// Schedule settings from the config (read at boot, see wifi_setup.h)
 bool loadScheduleConfig(String &dailyPrintTime, String &lastJokePrintDate) {
-  if (!LittleFS.exists("/config.json")) {
-    debugLog("Config file does not exist, using defaults");
-    dailyPrintTime = "09:00";
-    lastJokePrintDate = "";
+  dailyPrintTime = configDoc["dailyPrintTime"] | "09:00";
+  lastJokePrintDate = configDoc["lastJokePrintDate"] | "";
+  if (configDoc["dailyPrintTime"].isNull()) {
+    debugLog("No schedule in config, using defaults");
     return false;
   }
+  return true;
+}
 
-  File configFile = LittleFS.open("/config.json", "r");
-  if (!configFile) {
-    debugLog("Failed to open config file for reading");
-    dailyPrintTime = "09:00";
-    lastJokePrintDate = "";
+// Schedule settings into the config, written to flash once they settle.
+// False if they are the same as before.
+bool saveScheduleConfig(String dailyPrintTime, String lastJokePrintDate) {
+  if (dailyPrintTime == (configDoc["dailyPrintTime"] | "") &&
+      lastJokePrintDate == (configDoc["lastJokePrintDate"] | "")) {
     return false;
   }
+  configDoc["dailyPrintTime"] = dailyPrintTime;
+  configDoc["lastJokePrintDate"] = lastJokePrintDate;
+  configStore.changed(millis());
+  return true;
+}
 
-  JsonDocument doc;
-  DeserializationError error = deserializeJson(doc, configFile);
-  configFile.close();
-
-  if (error) {
-    debugLog("Failed to parse config file");
-    dailyPrintTime = "09:00";
-    lastJokePrintDate = "";
-    return false;
+// === Joke Source Configuration ===
+// Sources from a "jokeSources" list: [{"name", "url", "rule", "pattern", "end"}].
+// Stops at the first one that can't be used and says which.
+static bool sourcesFromJson(JsonArrayConst list, SourceRegistry &registry, String &problem) {
+  registry.clear();
+  for (JsonObjectConst item : list) {
+    const char *name = item["name"] | "";
+    ExtractRuleType type;
+    if (!parseRuleType(item["rule"] | "", type)) {
+      problem = "Source \"" + String(name) + "\": rule must be markers, id or json";
+      return false;
+    }
+    if (registry.count() == JOKE_SOURCES_MAX) {
+      problem = "At most " + String(JOKE_SOURCES_MAX) + " sources";
+      return false;
+    }
+    if (!registry.add(name, item["url"] | "", type, item["pattern"] | "", item["end"] | "")) {
+      problem = "Source \"" + String(name) + "\" is incomplete, too long or a duplicate";
+      return false;
+    }
   }
-
-  // Load with defaults if fields don't exist
-  dailyPrintTime = doc["dailyPrintTime"] | "09:00";
-  lastJokePrintDate = doc["lastJokePrintDate"] | "";
-
   return true;
 }
 
-// Save complete schedule settings
-bool saveScheduleConfig(String dailyPrintTime, String lastJokePrintDate) {
-  // Load existing config to preserve WiFi credentials
-  JsonDocument doc;
+// Sources from the config, hahaha.de if there are none
+void loadJokeSources() {
+  jokeSources.clear();
+  String problem;
+  if (!configDoc["jokeSources"].isNull() && !sourcesFromJson(configDoc["jokeSources"], jokeSources, problem)) {
+    debugLog("Joke sources ignored: " + problem);
+    jokeSources.clear();
+  }
+  if (jokeSources.count() == 0) {
+    addDefaultSources(jokeSources);
+  }
+  debugLog("Joke sources: " + String(jokeSources.count()));
+}
 
-  if (LittleFS.exists("/config.json")) {
-    File configFile = LittleFS.open("/config.json", "r");
-    if (configFile) {
-      deserializeJson(doc, configFile);
-      configFile.close();
+// The source list into the config, written to flash once it settles. An
+// empty list removes it, back to the built-in source.
+void saveJokeSources(const SourceRegistry &registry) {
+  configDoc.remove("jokeSources");
+  if (registry.count() > 0) {
+    JsonArray list = configDoc["jokeSources"].to<JsonArray>();
+    for (uint8_t i = 0; i < registry.count(); i++) {
+      const JokeSource &source = registry.source(i);
+      JsonObject item = list.add<JsonObject>();
+      item["name"] = source.name;
+      item["url"] = source.url;
+      item["rule"] = ruleTypeName(source.type);
+      item["pattern"] = source.pattern;
+      if (source.type == RULE_MARKERS) {
+        item["end"] = source.end;
+      }
     }
   }
 
-  // Update schedule fields
-  doc["dailyPrintTime"] = dailyPrintTime;
-  doc["lastJokePrintDate"] = lastJokePrintDate;
+  configStore.changed(millis());
+}
 
-  // Save back to file
-  File configFile = LittleFS.open("/config.json", "w");
-  if (!configFile) {
-    debugLog("Failed to open config file for writing");
-    return false;
+// Per-source stats survive restarts, by source name
+void loadSourceStats() {
+  File statsFile = LittleFS.open(SOURCE_STATS_FILE, "r");
+  if (!statsFile) {
+    return;
   }
-
-  if (serializeJson(doc, configFile) == 0) {
-    debugLog("Failed to write to config file");
-    configFile.close();
-    return false;
+  JsonDocument doc;
+  DeserializationError error = deserializeJson(doc, statsFile);
+  statsFile.close();
+  if (error) {
+    debugLog("Source stats unreadable, starting over");
+    return;
+  }
+  for (JsonPairConst entry : doc.as<JsonObjectConst>()) {
+    SourceStats stats;
+    stats.attempts = entry.value()["attempts"] | 0;
+    stats.successes = entry.value()["successes"] | 0;
+    stats.reliability = entry.value()["reliability"] | 0;
+    stats.latencyMillis = entry.value()["latency"] | SOURCE_DEFAULT_LATENCY;
+    jokeSources.restoreStats(entry.key().c_str(), stats);
   }
-
-  configFile.close();
-  debugLog("Schedule config saved");
-  return true;
 }
 
-// Update only last print date (optimized for daily writes)
-bool updateLastPrintDate(String date) {
-  // Load existing config
+bool saveSourceStats() {
   JsonDocument doc;
-
-  if (LittleFS.exists("/config.json")) {
-    File configFile = LittleFS.open("/config.json", "r");
-    if (configFile) {
-      deserializeJson(doc, configFile);
-      configFile.close();
-    }
+  for (uint8_t i = 0; i < jokeSources.count(); i++) {
+    const JokeSource &source = jokeSources.source(i);
+    JsonObject item = doc[source.name].to<JsonObject>();
+    item["attempts"] = source.stats.attempts;
+    item["successes"] = source.stats.successes;
+    item["reliability"] = source.stats.reliability;
+    item["latency"] = source.stats.latencyMillis;
   }
 
-  // Update only lastJokePrintDate field
-  doc["lastJokePrintDate"] = date;
-
-  // Save back to file
-  File configFile = LittleFS.open("/config.json", "w");
-  if (!configFile) {
-    debugLog("Failed to open config file for writing");
+  File statsFile = LittleFS.open(SOURCE_STATS_FILE, "w");
+  if (!statsFile) {
+    debugLog("Failed to open source stats for writing");
     return false;
   }
+  bool written = serializeJson(doc, statsFile) > 0;
+  statsFile.close();
+  return written;
+}
 
-  if (serializeJson(doc, configFile) == 0) {
-    debugLog("Failed to write to config file");
-    configFile.close();
-    return false;
+// The list posted to /api/sources replaces the current one. Stats carry
+// over by name; TLS sessions and probes belonged to the old positions.
+void applyPendingSources() {
+  for (uint8_t i = 0; i < pendingSources.count(); i++) {
+    int old = jokeSources.find(pendingSources.source(i).name);
+    if (old >= 0) {
+      pendingSources.restoreStats(pendingSources.source(i).name, jokeSources.source(old).stats);
+    }
   }
-
-  configFile.close();
-  return true;
+  jokeSources = pendingSources;
+  sourcesPending = false;
+  saveJokeSources(jokeSources);
+  if (jokeSources.count() == 0) {
+    addDefaultSources(jokeSources);
+  }
+  for (SourceTls &tls : sourceTls) {
+    tls = SourceTls();
+  }
+  saveSourceStats();
+  debugLog("Joke sources updated: " + String(jokeSources.count()));
 }
 
 // === Scheduler Functions ===
-// Check if we should print scheduled joke
+// Check if we should print scheduled joke (once a minute, from its task)
 bool shouldPrintScheduledJoke() {
-  // Throttle: only check once per 60 seconds
-  if (millis() - scheduleState.lastCheckMillis < 60000) {
-    return false;
-  }
-  scheduleState.lastCheckMillis = millis();
-
   String currentDate = getCurrentDate();
   String currentTime = getCurrentTime();
 
@@ -321,113 +572,108 @@ bool shouldPrintScheduledJoke() {
   return false;
 }
 
-// === Printer Functions ===
-void initializePrinter() {
-  printer.begin(9600);
-
-  // Wait for capacitor to charge and printer to power up properly
-  debugLog("Waiting for printer to power up...");
-  delay(3000); // Increased from 500ms to 3 seconds for capacitor charging
+// Is a prefetch window open that wasn't tried today? Marks it tried.
+bool shouldPrefetchJoke() {
+  if (!timeClient.isTimeSet() || fetchState != FETCH_IDLE) {
+    return false;
+  }
+  String currentDate = getCurrentDate();
+  if (prefetchDate != currentDate) {
+    prefetchDate = currentDate;
+    prefetchedAfterMidnight = false;
+    prefetchedBeforePrint = false;
+  }
+  if (scheduleState.lastJokePrintDate == currentDate) {
+    return false;
+  }
 
-  // Initialise - reset printer to default state
-  printer.write(0x1B); printer.write('@'); // ESC @
-  delay(500); // Increased from 50ms to 500ms to ensure reset completes
+  struct tm *timeInfo = currentTimeInfo();
+  int minutes = timeInfo->tm_hour * 60 + timeInfo->tm_min;
+  int printMinutes = scheduleState.dailyPrintTime.substring(0, 2).toInt() * 60 +
+                     scheduleState.dailyPrintTime.substring(3, 5).toInt();
 
-  debugLog("Printer reset complete, configuring...");
+  if (!prefetchedAfterMidnight && minutes >= PREFETCH_AFTER_MIDNIGHT_MINUTES) {
+    prefetchedAfterMidnight = true;
+    return true;
+  }
+  if (!prefetchedBeforePrint && minutes >= printMinutes - PREFETCH_LEAD_MINUTES) {
+    prefetchedBeforePrint = true;
+    return true;
+  }
+  return false;
+}
 
-  // Set stronger black fill (print density/heat)
-  printer.write(0x1B); printer.write('7');
-  printer.write(15); // Heating dots (max 15)
-  printer.write(150); // Heating time
-  printer.write(250); // Heating interval
-  delay(200); // Add delay after configuration
+// === Printer Functions ===
+void initializePrinter() {
+#if PRINTER_PORT == PRINTER_PORT_UART0_SWAPPED
+  // Boot messages go out on UART0 before its pins move to the printer
+  Serial.flush();
+#endif
+
+  // Find the printer's speed. An answer also means it has powered up.
+  uint32_t baud = probeBaudRate(printerTransport, PRINTER_BAUD_RATES, PRINTER_BAUD_RATE_COUNT,
+                                []() -> uint32_t { yield(); return millis(); }, 3000);
+  bool printerAnswered = baud != 0;
+  if (printerAnswered) {
+    debugLog("Printer answers at " + String(baud) + " baud");
+  } else {
+    baud = PRINTER_BAUD;
+    printerTransport.setBaudRate(baud);
+    debugLog(printerTransport.canRead()
+             ? "Printer did not answer, assuming " + String(baud) + " baud"
+             : "Printer port is send-only, using " + String(baud) + " baud");
+  }
 
-  // Rotation removed - printer will print in normal orientation
+  printEngine.begin(&printerTransport, []() -> uint32_t { return millis(); });
+  printEngine.setPacing(pacingForBaudRate(baud, PRINTER_MAX_BURST));
 
-  debugLog("Printer initialized and ready");
+  // Power-up wait (unless it answered), reset, code table and print density
+  debugLog("Queueing printer reset...");
+  queuePrinterSetup(printEngine, !printerAnswered, codePageSelector(PRINTER_CODE_PAGE));
 }
 
-void printReceipt() {
-  debugLog("Printing receipt...");
+// Everything of a receipt before its message
+static void composeReceiptHeader(PrintSink &sink, const PrintJob &job) {
+  // Dates are formatted here rather than in the web handler
+  String timestamp = job.date[0] != '\0' ? formatCustomDate(job.date) : getFormattedDateTime();
+
+  debugLog("=== Receipt #" + String(job.id) + " ===");
+  if (!job.textInFile) {
+    debugLog("Message: " + String(job.text));
+  } else {
+    debugLog("Message: " + String(job.textLength) + " bytes from flash");
+  }
+  debugLog("Time: " + timestamp);
+  if (job.resumeLine > 0) {
+    debugLog("Resuming at line " + String(job.resumeLine));
+  }
+  debugLog("Queueing receipt...");
 
-  // Small delay to ensure printer is ready for new job
-  delay(1500);
+  // Small pause to ensure printer is ready for new job
+  sink.pause(1500);
 
   // Print header first (normal orientation)
-  setInverse(true);
-  printLine(currentReceipt.timestamp);
-  setInverse(false);
+  queueInverse(sink, true);
+  printLineTo(sink, timestamp);
+  queueInverse(sink, false);
+
+  // Small pause between header and message
+  sink.pause(500);
+}
 
-  // Small delay between header and message
-  delay(500);
+void printReceipt(const PrintJob &job) {
+  // Lines printed before a reset are left out
+  ResumeSink sink(printEngine, job.resumeLine);
+  composeReceiptHeader(sink, job);
 
   // Print wrapped message
-  printWrapped(currentReceipt.message);
+  printWrappedTo(sink, job.text);
 
   // Advance paper
-  advancePaper(2);
-
-  debugLog("Receipt printed successfully");
-}
-
-// Helper function to decode HTML entities (German characters)
-String decodeHTMLEntities(String text) {
-  // Common German HTML entities
-  text.replace("&quot;", "\"");
-  text.replace("&amp;", "&");
-  text.replace("&lt;", "<");
-  text.replace("&gt;", ">");
-  text.replace("&ouml;", "oe");
-  text.replace("&auml;", "ae");
-  text.replace("&uuml;", "ue");
-  text.replace("&Ouml;", "Oe");
-  text.replace("&Auml;", "Ae");
-  text.replace("&Uuml;", "Ue");
-  text.replace("&szlig;", "ss");
-  text.replace("&nbsp;", " ");
-
-  return text;
-}
-
-// Helper function to remove HTML tags
-String stripHTMLTags(String text) {
-  String result = "";
-  bool inTag = false;
-
-  for (int i = 0; i < text.length(); i++) {
-    char c = text.charAt(i);
-
-    if (c == '<') {
-      inTag = true;
-      // Check if it's a <br> tag and convert to space
-      // Check bounds before substring
-      if (i + 4 <= text.length()) {
-        String tag = text.substring(i, i + 4);
-        if (tag.equals("<br>")) {
-          result += " ";
-        }
-      }
-      if (i + 5 <= text.length()) {
-        String tag = text.substring(i, i + 5);
-        if (tag.equals("<br/>")) {
-          result += " ";
-        }
-      }
-      // Also check for <br /> with space
-      if (i + 6 <= text.length()) {
-        String tag = text.substring(i, i + 6);
-        if (tag.equals("<br />")) {
-          result += " ";
-        }
-      }
-    } else if (c == '>') {
-      inTag = false;
-    } else if (!inTag) {
-      result += c;
-    }
-  }
+  queueFeed(sink, 2);
+  printEngine.endJob();
 
-  return result;
+  debugLog("Receipt queued");
 }
 
 // === Error Message Builder ===
@@ -474,25 +720,134 @@ String buildErrorMessage(const JokeError &error) {
   return message;
 }
 
-// Function to fetch joke from server and save to filesystem
-// Returns true if successful, false if failed
-// This runs in main loop where blocking HTTP requests are safe
-bool fetchJokeFromAPI(JokeError &error) {
-  debugLog("Fetching joke from server...");
+// Validators of the cached joke's page, none without a cached joke or if
+// it came from another source
+void loadJokeValidators(const char *sourceUrl) {
+  jokeValidators.clear();
+  File cacheFile = LittleFS.open(JOKE_CACHE_JSON, "r");
+  if (!cacheFile) {
+    return;
+  }
 
-  String jokeURL = JOKE_SOURCE;
+  JsonDocument filter;
+  filter["etag"] = true;
+  filter["lastModified"] = true;
+  filter["jokeText"] = true;
+  filter["source"] = true;
+  JsonDocument doc;
+  DeserializationError error = deserializeJson(doc, cacheFile, DeserializationOption::Filter(filter));
+  cacheFile.close();
 
-  // Use WiFiClientSecure for HTTPS connections
-  WiFiClientSecure client;
-  HTTPClient http;
+  const char *jokeText = doc["jokeText"] | "";
+  const char *source = doc["source"] | "";
+  if (!error && jokeText[0] != '\0' && strcmp(source, sourceUrl) == 0) {
+    jokeValidators.restore(doc["etag"] | "", doc["lastModified"] | "");
+  }
+}
+
+// Scheme, host and port of a source URL
+struct SourceAddress {
+  bool secure;
+  String host;
+  uint16_t port;
+};
+
+static SourceAddress sourceAddress(const char *url) {
+  String text = url;
+  SourceAddress address = {text.startsWith("https://"), "", 0};
+  int start = text.indexOf("://") + 3;
+  int end = text.indexOf('/', start);
+  address.host = text.substring(start, end < 0 ? text.length() : end);
+  int colon = address.host.indexOf(':');
+  address.port = address.secure ? 443 : 80;
+  if (colon >= 0) {
+    address.port = address.host.substring(colon + 1).toInt();
+    address.host = address.host.substring(0, colon);
+  }
+  return address;
+}
+
+// Certificate checks and buffer sizes for a source's server. BearSSL needs
+// a receive buffer as large as the biggest record the server may send:
+// with MFLN that is the negotiated fragment, so the smallest one the server
+// accepts is used for both buffers.
+static void configureJokeTls(WiFiClientSecure &client, SourceTls &tls, const SourceAddress &address) {
+  bool pinned = address.host == JOKE_TLS_PIN_HOST;
+#if defined(JOKE_TLS_PUBLIC_KEY)
+  static BearSSL::PublicKey serverKey(JOKE_TLS_PUBLIC_KEY);
+  if (pinned) {
+    client.setKnownKey(&serverKey);
+    if (serverKey.isEC()) {
+      static const uint16_t ECDSA_SUITES[] = {BR_TLS_ECDHE_ECDSA_WITH_CHACHA20_POLY1305_SHA256,
+                                              BR_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256};
+      client.setCiphers(ECDSA_SUITES, 2);
+    }
+  }
+#elif defined(JOKE_TLS_FINGERPRINT)
+  if (pinned) {
+    client.setFingerprint(JOKE_TLS_FINGERPRINT);
+  }
+#else
+  pinned = false;
+#endif
+  if (!pinned) {
+    client.setInsecure();
+  }
+
+  if (!tls.probed) {
+    for (uint16_t fragment : JOKE_TLS_FRAGMENTS) {
+      if (WiFiClientSecure::probeMaxFragmentLength(address.host.c_str(), address.port, fragment)) {
+        tls.fragment = fragment;
+        break;
+      }
+    }
+    // A failed probe (no connection) is tried again on the next fetch
+    tls.probed = tls.fragment > 0 || WiFi.status() == WL_CONNECTED;
+    debugLog(tls.fragment > 0 ? "TLS: " + address.host + " accepts " + String(tls.fragment) + " byte fragments"
+                              : "TLS: no MFLN at " + address.host + ", using default buffers");
+  }
+  int bufferSize = tls.fragment > 0 ? tls.fragment : JOKE_TLS_BUFFER_FALLBACK;
+  client.setBufferSizes(bufferSize, bufferSize);
+  client.setSession(&tls.session);
+  tlsStats.resumed = tls.sessionValid;
+  tlsStats.fragment = tls.fragment;
+}
 
-  // Skip certificate validation (insecure but necessary for simple ESP8266 HTTPS)
-  client.setInsecure();
+// Function to fetch a joke from one source, extracting the joke text while
+// streaming. Returns true if successful, false if failed. notModified is
+// set when the server confirmed the cached joke (304), nothing was
+// extracted then.
+// This runs in main loop where blocking HTTP requests are safe
+bool fetchJokeFromAPI(uint8_t sourceIndex, JokeError &error, bool &notModified) {
+  notModified = false;
+  const JokeSource &source = jokeSources.source(sourceIndex);
+  debugLog("Fetching joke from " + String(source.name) + "...");
+
+  const char *ruleError = sourceExtractor.begin(source.rule());
+  if (ruleError != nullptr) {
+    error.lastHttpCode = 0;
+    error.errorType = "PROCESSING_FAILED";
+    error.detailedMessage = ruleError;
+    return false;
+  }
 
-  // Reduce buffer sizes to save memory (default is 16KB each!)
-  // Current jokes are ~1KB, but allow room for variation (shorter or longer jokes)
-  // Using 2KB buffers (1KB RX + 1KB TX) instead of default 32KB (16KB each)
-  client.setBufferSizes(1024, 1024);  // RX and TX buffers: 1KB each (still saves 30KB!)
+  String jokeURL = source.url;
+  SourceAddress address = sourceAddress(source.url);
+  SourceTls &tls = sourceTls[sourceIndex];
+  uint32_t heapBefore = ESP.getFreeHeap();
+  uint32_t heapLowest = heapBefore;
+
+  // WiFiClientSecure for HTTPS sources, nothing is allocated for it
+  // until it connects
+  WiFiClient plainClient;
+  WiFiClientSecure secureClient;
+  WiFiClient &client = address.secure ? secureClient : plainClient;
+  HTTPClient http;
+  tlsStats.resumed = false;
+  tlsStats.fragment = 0;
+  if (address.secure) {
+    configureJokeTls(secureClient, tls, address);
+  }
 
   // Allow some time for any pending operations to complete and memory to be freed
   delay(100);
@@ -517,18 +872,42 @@ bool fetchJokeFromAPI(JokeError &error) {
 
   // Add headers that the server expects (some servers reject requests without these)
   http.addHeader("User-Agent", "Mozilla/5.0 (ESP8266)");
-  http.addHeader("Accept", "text/plain, text/html, */*");
+  http.addHeader("Accept", source.type == RULE_JSON_PATH ? "application/json" : "text/plain, text/html, */*");
   http.addHeader("Connection", "close");
 
+  // Ask for the page only if it changed since the cached joke
+  loadJokeValidators(source.url);
+  if (jokeValidators.ifNoneMatch()[0] != '\0') {
+    http.addHeader("If-None-Match", jokeValidators.ifNoneMatch());
+  }
+  if (jokeValidators.ifModifiedSince()[0] != '\0') {
+    http.addHeader("If-Modified-Since", jokeValidators.ifModifiedSince());
+  }
+  const char *validatorHeaders[] = {"ETag", "Last-Modified"};
+  http.collectHeaders(validatorHeaders, 2);
+
   // Make GET request
+  uint32_t requestStart = millis();
   int httpCode = http.GET();
+  tlsStats.handshakeMillis = millis() - requestStart;
+  heapLowest = min(heapLowest, ESP.getFreeHeap());
   error.lastHttpCode = httpCode; // Capture HTTP code
   debugLog("HTTP response code: " + String(httpCode));
 
+  ConditionalResult conditional = jokeValidators.response(httpCode);
+  for (const char *name : validatorHeaders) {
+    jokeValidators.header(name, http.header(name).c_str());
+  }
+
   bool success = false;
 
-  if (httpCode == HTTP_CODE_OK) {  // 200
-    debugLog("HTTP 200 OK - Streaming to file...");
+  if (conditional == CONDITIONAL_NOT_MODIFIED) {
+    debugLog("HTTP 304 - Cached joke is still current");
+    notModified = true;
+    success = true;
+
+  } else if (httpCode == HTTP_CODE_OK) {  // 200
+    debugLog("HTTP 200 OK - Extracting joke from stream...");
 
     // Check content length
     int contentLength = http.getSize();
@@ -538,51 +917,37 @@ bool fetchJokeFromAPI(JokeError &error) {
       debugLog("Content size: Unknown (chunked transfer)");
     }
 
-    // Open file for writing (this will overwrite any existing file)
-    File file = LittleFS.open(JOKE_CACHE_FILE, "w");
-    if (!file) {
-      debugLog("ERROR: Failed to open file for writing!");
-      error.errorType = "FILE_IO_ERROR";
-      error.detailedMessage = "Cannot open cache file for writing";
-      http.end();
-      return false;
-    }
-
-    // Stream the response directly to file in chunks (saves memory!)
+    // Parse the response as it arrives - only the joke text is kept in RAM,
+    // the rest of the page is discarded chunk by chunk
     WiFiClient* stream = http.getStreamPtr();
-    int bytesWritten = 0;
+    int bytesRead = 0;
     uint8_t buffer[128]; // Small buffer - only 128 bytes in RAM at a time
-    const int MAX_FILE_SIZE = 5000; // Safety limit: max 5KB (jokes should be < 2KB)
+    bool jokeComplete = false;
 
-    while (http.connected() && (contentLength > 0 || contentLength == -1)) {
-      // Safety check: prevent downloading huge files
-      if (bytesWritten >= MAX_FILE_SIZE) {
-        debugLog("WARNING: File size exceeded " + String(MAX_FILE_SIZE) + " bytes, stopping download");
-        break;
-      }
+    while (!jokeComplete && http.connected() && (contentLength > 0 || contentLength == -1)) {
       size_t availableSize = stream->available();
 
       if (availableSize) {
         // Read chunk into buffer
         int bytesToRead = ((availableSize > sizeof(buffer)) ? sizeof(buffer) : availableSize);
-        int bytesRead = stream->readBytes(buffer, bytesToRead);
+        int chunkLength = stream->readBytes(buffer, bytesToRead);
 
-        // Write chunk to file
-        file.write(buffer, bytesRead);
-        bytesWritten += bytesRead;
+        // Hand chunk to the extractor, stop as soon as the joke is complete
+        jokeComplete = sourceExtractor.feed(buffer, chunkLength);
+        bytesRead += chunkLength;
 
         if (contentLength > 0) {
-          contentLength -= bytesRead;
+          contentLength -= chunkLength;
         }
 
         // Yield to allow ESP8266 to handle background tasks
+        heapLowest = min(heapLowest, ESP.getFreeHeap());
         yield();
       }
       delay(1);
     }
 
-    file.close();
-    debugLog("Downloaded " + String(bytesWritten) + " bytes to file");
+    debugLog("Read " + String(bytesRead) + " bytes from stream");
 
     success = true;
 
@@ -611,100 +976,24 @@ bool fetchJokeFromAPI(JokeError &error) {
   // Close HTTP connection to free memory ASAP
   http.end();
 
-  return success;
-}
-
-// Function to process cached joke file and extract clean text
-// Returns the joke text, or error message if processing failed
-String processJokeFromFile() {
-  debugLog("Processing joke from file...");
-
-  // Read the entire file into a String
-  // File is small (~1000 bytes) so this is safe after closing HTTP connection
-  File file = LittleFS.open(JOKE_CACHE_FILE, "r");
-  if (!file) {
-    debugLog("ERROR: Failed to open joke cache file for reading!");
-    return "Error: Could not read joke cache";
-  }
-
-  String htmlContent = file.readString();
-  file.close();
-
-  debugLog("Read " + String(htmlContent.length()) + " chars from file");
-
-  String joke = "";
-
-  // Extract content from <div id="witzdestages">
-  int divStart = htmlContent.indexOf("<div id=\"witzdestages\">");
-  if (divStart == -1) {
-    divStart = htmlContent.indexOf("<div id='witzdestages'>");
-  }
-
-  if (divStart != -1) {
-    // Find the closing </div>
-    int divEnd = htmlContent.indexOf("</div>", divStart);
-
-    if (divEnd != -1) {
-      // Extract content between tags
-      joke = htmlContent.substring(divStart, divEnd);
-
-      // Remove the opening div tag
-      int contentStart = joke.indexOf(">") + 1;
-      joke = joke.substring(contentStart);
-
-      // Remove the footer link span (if present)
-      int linkStart = joke.indexOf("<span id=\"witzdestageslink\">");
-      if (linkStart == -1) {
-        linkStart = joke.indexOf("<span id='witzdestageslink'>");
-      }
-      if (linkStart != -1) {
-        joke = joke.substring(0, linkStart);
-      }
+  // A completed handshake left a session to resume next time
+  tls.sessionValid = address.secure && httpCode > 0;
+  tlsStats.peakHeapBytes = heapBefore - heapLowest;
+  tlsStats.fetches++;
+  tlsStats.resumes += tlsStats.resumed ? 1 : 0;
+  debugLog(String(address.secure ? "TLS: " : "HTTP: ") + String(tlsStats.handshakeMillis) + " ms to response" +
+           (tlsStats.resumed ? " (resumed)" : "") + ", peak heap " + String(tlsStats.peakHeapBytes) + " bytes");
 
-      // Decode HTML entities (ö, ä, ü, ß, etc.)
-      joke = decodeHTMLEntities(joke);
-
-      // Remove remaining HTML tags (<br />, etc.)
-      joke = stripHTMLTags(joke);
-
-      // Clean up whitespace
-      joke.trim();
-
-      // Replace multiple spaces with single space
-      while (joke.indexOf("  ") != -1) {
-        joke.replace("  ", " ");
-      }
-
-      debugLog("Final joke: " + String(joke.length()) + " chars");
-
-      if (joke.length() == 0) {
-        return "Error: Joke extraction resulted in empty text";
-      }
-
-    } else {
-      return "Error: Could not find closing div tag";
-    }
-  } else {
-    return "Error: Could not find witzdestages div";
-  }
-
-  return joke;
+  return success;
 }
 
 // === Joke Cache Management Functions ===
 
-// Checks if cached joke is valid for today
+// Checks if cached joke is valid for today. Silent: callers log what
+// they do about it.
 bool isCacheValidForToday() {
-  // Check if cache file exists
-  if (!LittleFS.exists(JOKE_CACHE_JSON)) {
-    debugLog("No cache file exists");
-    return false;
-  }
-
-  // Open and parse cache file
   File cacheFile = LittleFS.open(JOKE_CACHE_JSON, "r");
   if (!cacheFile) {
-    debugLog("Failed to open cache file");
     return false;
   }
 
@@ -712,26 +1001,8 @@ bool isCacheValidForToday() {
   DeserializationError error = deserializeJson(doc, cacheFile);
   cacheFile.close();
 
-  if (error) {
-    debugLog("Failed to parse cache file: " + String(error.c_str()));
-    return false;
-  }
-
-  // Extract and validate date
   String cachedDate = doc["date"] | "";
-  if (cachedDate.length() == 0) {
-    debugLog("Cache missing date field");
-    return false;
-  }
-
-  // Compare with current date
-  String currentDate = getCurrentDate();
-  bool isValid = (cachedDate == currentDate);
-
-  debugLog("Cache date: " + cachedDate + ", Current: " + currentDate +
-           ", Valid: " + (isValid ? "YES" : "NO"));
-
-  return isValid;
+  return !error && cachedDate.length() > 0 && cachedDate == getCurrentDate();
 }
 
 // Load processed joke text from cache
@@ -767,114 +1038,484 @@ String loadCachedJoke() {
   return jokeText;
 }
 
-// Save processed joke with date to cache
-bool saveCachedJoke(String date, String jokeText) {
-  JsonDocument doc;
-
-  // Build JSON structure
-  doc["date"] = date;
-  doc["timestamp"] = String(timeClient.getEpochTime());
-  doc["jokeText"] = jokeText;
-  doc["source"] = JOKE_SOURCE;
-
-  // Write to file
-  File cacheFile = LittleFS.open(JOKE_CACHE_JSON, "w");
-  if (!cacheFile) {
-    debugLog("Failed to open cache file for writing");
-    return false;
+// The recent jokes survive restarts
+void loadRecentJokes() {
+  File recentFile = LittleFS.open(RECENT_JOKES_FILE, "r");
+  if (!recentFile) {
+    return;
   }
-
-  if (serializeJson(doc, cacheFile) == 0) {
-    debugLog("Failed to write cache JSON");
-    cacheFile.close();
-    return false;
+  uint8_t data[RECENT_JOKES_SAVED_MAX];
+  size_t length = recentFile.read(data, sizeof(data));
+  recentFile.close();
+  if (!recentJokes.load(data, length)) {
+    debugLog("Recent jokes unreadable, starting over");
   }
-
-  cacheFile.close();
-  debugLog("Cached joke saved: " + date + ", " + String(jokeText.length()) + " chars");
-  return true;
 }
 
-// Combined fetch + process operation (runs once per day)
-bool fetchAndProcessJoke(JokeError &error) {
-  debugLog("Fetching and processing new joke...");
-
-  // Step 1: Fetch raw HTML from API
-  bool fetchSuccess = fetchJokeFromAPI(error);
-  if (!fetchSuccess) {
-    debugLog("Fetch from API failed");
-    // Error details already populated by fetchJokeFromAPI()
+bool saveRecentJokes() {
+  uint8_t data[RECENT_JOKES_SAVED_MAX];
+  size_t length = recentJokes.save(data);
+  File recentFile = LittleFS.open(RECENT_JOKES_FILE, "w");
+  if (!recentFile) {
+    debugLog("Failed to open recent jokes for writing");
     return false;
   }
+  bool written = recentFile.write(data, length) == length;
+  recentFile.close();
+  return written;
+}
 
-  // Step 2: Process HTML to extract clean text
-  String jokeText = processJokeFromFile();
+// The joke was printed on an earlier day, not long ago
+static bool isRepeatedJoke(const char *jokeText) {
+  uint32_t today;
+  return parseHistoryDate(getCurrentDate().c_str(), today) &&
+         recentJokes.seenBefore(jokeFingerprint(jokeText, strlen(jokeText)), today);
+}
 
-  // Check for processing errors
-  if (jokeText.startsWith("Error:")) {
-    debugLog("Processing failed: " + jokeText);
-    error.errorType = "PROCESSING_FAILED";
-    error.detailedMessage = jokeText;
-    return false;
-  }
+static void appendBankText(const char *data, size_t length, void *context) {
+  static_cast<String *>(context)->concat(data, length);
+}
 
-  if (jokeText.length() == 0) {
-    debugLog("Processing resulted in empty joke");
-    error.errorType = "PROCESSING_FAILED";
-    error.detailedMessage = "HTML processing resulted in empty text";
+static bool readBankJoke(uint16_t index, String &jokeText) {
+  jokeText = "";
+  if (!jokeBank.read(index, appendBankText, &jokeText)) {
+    debugLog("Joke bank damaged at joke " + String(index));
     return false;
   }
+  return true;
+}
 
-  // Step 3: Save processed joke with date to cache
-  String currentDate = getCurrentDate();
-  bool saveSuccess = saveCachedJoke(currentDate, jokeText);
-
-  if (!saveSuccess) {
-    debugLog("Failed to save processed joke to cache");
-    error.errorType = "FILE_IO_ERROR";
-    error.detailedMessage = "Cannot save joke to cache file";
-    return false;
+// A joke from the bank, "" without one: another each day, the same all
+// day. Jokes printed lately are passed over while there are others.
+String loadBankJoke() {
+  if (jokeBank.count() == 0) {
+    return "";
   }
-
-  // Step 4: Delete temp HTML file to save space
-  if (LittleFS.exists(JOKE_CACHE_FILE)) {
-    if (LittleFS.remove(JOKE_CACHE_FILE)) {
-      debugLog("Temp HTML file deleted");
-    } else {
-      debugLog("Warning: Failed to delete temp HTML file");
+  uint16_t first = (timeClient.getEpochTime() / 86400) % jokeBank.count();
+  String jokeText;
+  jokeText.reserve(512);
+  for (uint16_t i = 0; i < jokeBank.count(); i++) {
+    uint16_t index = (first + i) % jokeBank.count();
+    if (!readBankJoke(index, jokeText)) {
+      return "";
+    }
+    if (!isRepeatedJoke(jokeText.c_str())) {
+      debugLog("Joke " + String(index) + " from the bank: " + String(jokeText.length()) + " chars");
+      return jokeText;
     }
   }
+  debugLog("Every bank joke printed lately, repeating joke " + String(first));
+  return readBankJoke(first, jokeText) ? jokeText : String();
+}
 
-  debugLog("Joke fetched, processed, and cached successfully");
-  return true;
+static bool writeImageToFile(const uint8_t *data, size_t length, void *context) {
+  return static_cast<File *>(context)->write(data, length) == length;
 }
 
-// Function for printing jokes
-void printDailyJoke(String jokeText) {
-  debugLog("Printing joke...");
+// isTodaysJokeReady() looks at flash again next time
+static void recheckTodaysJoke() {
+  jokeReadyDate[0] = '\0';
+}
+
+// Today's joke was just saved for `date`, or a write may have left it
+// damaged (ready false)
+static void setJokeReady(const String &date, bool ready) {
+  if (ready && date == getCurrentDate()) {
+    strncpy(jokeReadyDate, date.c_str(), sizeof(jokeReadyDate) - 1);
+    jokeReady = true;
+  } else {
+    recheckTodaysJoke();
+  }
+}
+
+// Render the daily joke receipt into JOKE_CACHE_IMAGE
+bool saveJokeImage(String date, const char *jokeText) {
+  File imageFile = LittleFS.open(JOKE_IMAGE_TEMP, "w");
+  if (!imageFile) {
+    debugLog("Failed to open joke image for writing");
+    LittleFS.remove(JOKE_CACHE_IMAGE);
+    setJokeReady(date, false);
+    return false;
+  }
+
+  uint8_t header[JOKE_IMAGE_HEADER_SIZE] = {0};
+  memcpy(header, JOKE_IMAGE_MAGIC, 4);
+  memcpy(header + JOKE_IMAGE_DATE_OFFSET, date.c_str(), min((size_t)date.length(), (size_t)10));
+  bool written = imageFile.write(header, sizeof(header)) == sizeof(header);
+
+  PrintImageEncoder encoder(writeImageToFile, &imageFile);
+  composeDailyJoke(encoder, String(jokeText), formatCustomDate(date));
+  written = encoder.finish() && written;
+
+  uint32_t length = encoder.size();
+  uint8_t *lengthField = header + JOKE_IMAGE_LENGTH_OFFSET;
+  for (int i = 0; i < 4; i++) {
+    lengthField[i] = (length >> (8 * i)) & 0xFF;
+  }
+  written = written && imageFile.seek(JOKE_IMAGE_LENGTH_OFFSET) &&
+            imageFile.write(lengthField, 4) == 4;
+  imageFile.close();
+
+  // Replace the old image only with a complete one; a stale one must not
+  // survive a new joke either
+  if (!written || !LittleFS.rename(JOKE_IMAGE_TEMP, JOKE_CACHE_IMAGE)) {
+    debugLog("Failed to write joke image");
+    LittleFS.remove(JOKE_IMAGE_TEMP);
+    LittleFS.remove(JOKE_CACHE_IMAGE);
+    setJokeReady(date, false);
+    return false;
+  }
 
-  advancePaper(2);
+  debugLog("Joke image saved: " + String(length) + " bytes");
+  setJokeReady(date, true);
+  return true;
+}
 
-  // Small delay to ensure printer is ready for new job
-  delay(500);
+// Keep a joke in the history and among the recent ones under the date it
+// was the daily joke
+static void rememberJoke(String date, const char *jokeText) {
+  uint32_t day;
+  size_t length = strlen(jokeText);
+  if (!parseHistoryDate(date.c_str(), day)) {
+    return;
+  }
+  if (!jokeHistory.append(day, jokeText, length)) {
+    debugLog("Joke not added to the history");
+  }
+  recentJokes.add(jokeFingerprint(jokeText, length), day);
+  saveRecentJokes();
+}
+
+// A past joke by its "YYYY-MM-DD", "" if the history doesn't have it
+String loadHistoryJoke(const char *date) {
+  uint32_t day;
+  HistoryEntry entry;
+  String jokeText;
+  if (!parseHistoryDate(date, day) || !jokeHistory.find(day, entry)) {
+    return jokeText;
+  }
+  jokeText.reserve(entry.length);
+  if (!jokeHistory.readText(entry, appendBankText, &jokeText)) {
+    debugLog("History damaged at " + String(date));
+    return String();
+  }
+  return jokeText;
+}
 
-  String date = getFormattedDateTime();
-  date = "  " + date;
-  date = date + "  ";
+// Save processed joke with date to cache
+bool saveCachedJoke(String date, const char *jokeText, const char *sourceUrl) {
+  JsonDocument doc;
+
+  // Build JSON structure
+  doc["date"] = date;
+  doc["timestamp"] = String(timeClient.getEpochTime());
+  doc["jokeText"] = jokeText;
+  doc["source"] = sourceUrl;
+  doc["etag"] = jokeValidators.storedETag();
+  doc["lastModified"] = jokeValidators.storedLastModified();
+
+  // Write to file
+  File cacheFile = LittleFS.open(JOKE_CACHE_JSON, "w");
+  if (!cacheFile) {
+    debugLog("Failed to open cache file for writing");
+    setJokeReady(date, false);
+    return false;
+  }
+
+  if (serializeJson(doc, cacheFile) == 0) {
+    debugLog("Failed to write cache JSON");
+    cacheFile.close();
+    setJokeReady(date, false);
+    return false;
+  }
+
+  cacheFile.close();
+  debugLog("Cached joke saved: " + date + ", " + String(strlen(jokeText)) + " chars");
+  setJokeReady(date, true);
+  rememberJoke(date, jokeText);
+
+  // Without an image the joke is rendered when it prints
+  saveJokeImage(date, jokeText);
+  return true;
+}
+
+// Open the joke image if it was rendered for today, positioned at the
+// payload. Header checks only, no String work.
+bool openJokeImage(File &imageFile) {
+  imageFile = LittleFS.open(JOKE_CACHE_IMAGE, "r");
+  if (!imageFile) {
+    return false;
+  }
+
+  uint8_t header[JOKE_IMAGE_HEADER_SIZE];
+  char today[11];
+  formatISODate(currentCalendarDate(), today, sizeof(today));
+
+  bool valid = imageFile.read(header, sizeof(header)) == sizeof(header) &&
+               memcmp(header, JOKE_IMAGE_MAGIC, 4) == 0 &&
+               memcmp(header + JOKE_IMAGE_DATE_OFFSET, today, 10) == 0;
+  if (valid) {
+    const uint8_t *lengthField = header + JOKE_IMAGE_LENGTH_OFFSET;
+    uint32_t length = lengthField[0] | (lengthField[1] << 8) |
+                      ((uint32_t)lengthField[2] << 16) | ((uint32_t)lengthField[3] << 24);
+    valid = imageFile.size() == JOKE_IMAGE_HEADER_SIZE + length;
+  }
+
+  if (!valid) {
+    imageFile.close();
+  }
+  return valid;
+}
+
+bool isJokeImageValidForToday() {
+  File imageFile;
+  bool valid = openJokeImage(imageFile);
+  if (valid) {
+    imageFile.close();
+  }
+  return valid;
+}
+
+// Today's joke is cached or rendered. Reads flash only when the day
+// changed or recheckTodaysJoke() asked for it.
+bool isTodaysJokeReady() {
+  char today[11];
+  formatISODate(currentCalendarDate(), today, sizeof(today));
+  if (strcmp(today, jokeReadyDate) != 0) {
+    jokeReady = isJokeImageValidForToday() || isCacheValidForToday();
+    strcpy(jokeReadyDate, today);
+  }
+  return jokeReady;
+}
+
+static void receiptPath(uint32_t id, char *path, size_t size) {
+  snprintf(path, size, "%s/%lu.txt", RECEIPT_DIR, (unsigned long)id);
+}
+
+// Open a streamed message and queue its header; streamReceipt() queues
+// the message itself as room frees up
+static bool startReceiptStream(const PrintJob &job) {
+  char path[24];
+  receiptPath(job.id, path, sizeof(path));
+  receiptFile = LittleFS.open(path, "r");
+  if (!receiptFile) {
+    debugLog("ERROR: Message of receipt #" + String(job.id) + " is missing");
+    return false;
+  }
+
+  receiptSink.skipLines(job.resumeLine);
+  composeReceiptHeader(receiptSink, job);
+  receiptWrap.reset();
+  receiptCarry = 0;
+  streamReceipt();
+  return true;
+}
+
+// Feed the open message file through transcoding and wrapping to the print
+// queue. A character split between two reads waits for the next one.
+void streamReceipt() {
+  while (receiptFile && printerHasRoomFor(RECEIPT_CHUNK)) {
+    int length = receiptFile.read((uint8_t *)receiptBuffer + receiptCarry, RECEIPT_CHUNK);
+    if (length <= 0) {
+      // A character cut off at the very end prints as '?'
+      size_t rest = transcodeUTF8(receiptBuffer, receiptCarry, PRINTER_CODE_PAGE, receiptBuffer);
+      receiptWrap.write(receiptBuffer, rest);
+      receiptWrap.finish();
+      queueFeed(receiptSink, 2);
+      printEngine.endJob();
+      receiptFile.close();
+      debugLog("Receipt queued");
+      return;
+    }
+
+    size_t buffered = receiptCarry + length;
+    size_t complete = completeUTF8Length(receiptBuffer, buffered);
+    size_t encoded = transcodeUTF8(receiptBuffer, complete, PRINTER_CODE_PAGE, receiptBuffer);
+    receiptWrap.write(receiptBuffer, encoded);
+    receiptCarry = buffered - complete;
+    memmove(receiptBuffer, receiptBuffer + complete, receiptCarry);
+  }
+}
+
+// Message files of finished receipts, which frees their queue slots
+static void removeReceiptFiles() {
+  for (uint8_t i = 0; i < PRINT_JOB_SLOTS; i++) {
+    PrintJob &job = printJobs.slot(i);
+    if (job.textInFile && (job.status == PRINT_JOB_DONE || job.status == PRINT_JOB_FAILED)) {
+      char path[24];
+      receiptPath(job.id, path, sizeof(path));
+      LittleFS.remove(path);
+      job.textInFile = false;
+    }
+  }
+}
+
+// Message files no unfinished job refers to (uploads cut short by a reset)
+static void removeStrayReceiptFiles() {
+  Dir dir = LittleFS.openDir(RECEIPT_DIR);
+  while (dir.next()) {
+    const PrintJob *job = printJobs.find(strtoul(dir.fileName().c_str(), nullptr, 10));
+    if (!job || !job->textInFile) {
+      debugLog("Removing stray message file " + dir.fileName());
+      LittleFS.remove(String(RECEIPT_DIR) + "/" + dir.fileName());
+    }
+  }
+}
+
+// Feed the open joke image to the print queue as room frees up
+void streamJokeImage() {
+  static uint8_t chunk[JOKE_IMAGE_CHUNK];
+
+  while (jokeImage && printEngine.available() >= sizeof(chunk)) {
+    int length = jokeImage.read(chunk, sizeof(chunk));
+    if (length <= 0) {
+      jokeImage.close();
+      printEngine.endJob();
+      debugLog("Joke image queued");
+      return;
+    }
+    printEngine.writeImage(chunk, length);
+  }
+}
+
+// Fetch, check and cache a joke from one source. A joke printed lately
+// isn't cached but sets repeated, unless there is no bank joke to print
+// instead.
+static bool fetchJokeFromSource(uint8_t sourceIndex, JokeError &error, bool &repeated) {
+  const char *sourceUrl = jokeSources.source(sourceIndex).url;
+
+  // Step 1: Fetch page from API (extracts the joke while streaming)
+  bool notModified;
+  bool fetchSuccess = fetchJokeFromAPI(sourceIndex, error, notModified);
+  if (!fetchSuccess) {
+    debugLog("Fetch from API failed");
+    // Error details already populated by fetchJokeFromAPI()
+    return false;
+  }
+
+  // Unchanged page: the cached joke becomes today's, no parsing
+  if (notModified) {
+    String jokeText = loadCachedJoke();
+    repeated = jokeBank.count() > 0 && jokeText.length() > 0 && isRepeatedJoke(jokeText.c_str());
+    if (repeated) {
+      error.errorType = "REPEATED_JOKE";
+      error.detailedMessage = "Unchanged joke printed before";
+      return false;
+    }
+    if (jokeText.length() == 0 || !saveCachedJoke(getCurrentDate(), jokeText.c_str(), sourceUrl)) {
+      error.errorType = "FILE_IO_ERROR";
+      error.detailedMessage = "Cannot refresh cached joke";
+      jokeValidators.clear();
+      return false;
+    }
+    debugLog("Cached joke refreshed for today");
+    return true;
+  }
+
+  // Step 2: Check the text extracted while streaming
+  const char *extractError = sourceExtractor.finish();
+  if (extractError != nullptr) {
+    debugLog("Processing failed: " + String(extractError));
+    error.errorType = "PROCESSING_FAILED";
+    error.detailedMessage = extractError;
+    return false;
+  }
+  debugLog("Final joke: " + String(sourceExtractor.length()) + " chars");
+  repeated = jokeBank.count() > 0 && isRepeatedJoke(sourceExtractor.text());
+  if (repeated) {
+    error.errorType = "REPEATED_JOKE";
+    error.detailedMessage = "Joke printed before";
+    return false;
+  }
+
+  // Step 3: Save processed joke with date to cache
+  String currentDate = getCurrentDate();
+  bool saveSuccess = saveCachedJoke(currentDate, sourceExtractor.text(), sourceUrl);
+
+  if (!saveSuccess) {
+    debugLog("Failed to save processed joke to cache");
+    error.errorType = "FILE_IO_ERROR";
+    error.detailedMessage = "Cannot save joke to cache file";
+    return false;
+  }
+
+  debugLog("Joke fetched, processed, and cached successfully");
+  return true;
+}
+
+// One fetch attempt: the sources best first until one delivers. Once
+// FETCH_WINDOW_MILLIS have passed no other source is started, the next
+// attempt continues.
+bool fetchAndProcessJoke(JokeError &error) {
+  debugLog("Fetching and processing new joke...");
+
+  uint8_t order[JOKE_SOURCES_MAX];
+  uint8_t count = jokeSources.order(order);
+  uint32_t windowStart = millis();
+  bool success = false;
+  bool repeatedAny = false;
+  for (uint8_t i = 0; i < count && !success; i++) {
+    if (i > 0 && millis() - windowStart > FETCH_WINDOW_MILLIS) {
+      debugLog("Fetch window used up, other sources on the next attempt");
+      break;
+    }
+    uint8_t index = order[i];
+    uint32_t started = millis();
+    bool repeated = false;
+    success = fetchJokeFromSource(index, error, repeated);
+    jokeSources.record(index, success || repeated, millis() - started);  // A repeat still delivered
+    repeatedAny = repeatedAny || repeated;
+    repeatsSkipped += repeated ? 1 : 0;
+    if (!success) {
+      error.detailedMessage = String(jokeSources.source(index).name) + ": " + error.detailedMessage;
+      debugLog("Source failed: " + error.detailedMessage);
+    }
+  }
+
+  // Only repeats on offer: a bank joke is today's instead
+  if (!success && repeatedAny) {
+    String bankJoke = loadBankJoke();
+    success = bankJoke.length() > 0 && saveCachedJoke(getCurrentDate(), bankJoke.c_str(), "bank");
+    if (success) {
+      debugLog("Repeated joke replaced by one from the bank");
+      bankFallbacks++;
+    }
+  }
+
+  saveSourceStats();
+  return success;
+}
+
+// The daily joke receipt, queued directly or rendered into the joke image.
+// headerDate is the joke's day, formatted like a receipt date.
+void composeDailyJoke(PrintSink &sink, const String &jokeText, const String &headerDate) {
+  queueFeed(sink, 2);
+
+  // Small pause to ensure printer is ready for new job
+  sink.pause(500);
+
+  String date = "  " + headerDate + "  ";
 
   // Print header
-  setInverse(true);
-  printLine(date);
-  setInverse(false);
+  queueInverse(sink, true);
+  printLineTo(sink, date);
+  queueInverse(sink, false);
 
-  delay(1000);
+  sink.pause(1000);
 
-  // Print the joke text
-  printWrapped(jokeText);
+  // Print the joke text, evenly wrapped (same number of lines)
+  printWrappedTo(sink, jokeText, true);
 
-  advancePaper(2);
+  queueFeed(sink, 2);
+}
 
-  debugLog("Joke printed successfully");
+// Function for printing jokes, from resumeLine on after a reset
+void printDailyJoke(String jokeText, const String &headerDate, uint16_t resumeLine) {
+  debugLog("Queueing joke...");
+  ResumeSink sink(printEngine, resumeLine);
+  composeDailyJoke(sink, jokeText, headerDate);
+  printEngine.endJob();
+  debugLog("Joke queued");
 }
 
 void printServerInfo() {
@@ -884,21 +1525,20 @@ void printServerInfo() {
   debugLog("==================");
 
 
-  // Additional 10s delay before first print job
-  debugLog("Wating for printer to start up...");
-  delay(10000);
+  // Additional 10s pause before first print job
+  printEngine.pause(10000);
 
-  debugLog("Printing server info on thermal printer.");
+  debugLog("Queueing server info for the thermal printer.");
   printLine("PRINTER SERVER READY");
 
-  // Delay between sections
-  delay(500);
+  // Pause between sections
+  printEngine.pause(500);
 
   String serverInfo = "Server started at " + WiFi.localIP().toString();
   printWrapped(serverInfo);
 
   // Print schedule information
-  delay(500);
+  printEngine.pause(500);
   printWrapped("Daily print: " + scheduleState.dailyPrintTime);
   if (scheduleState.lastJokePrintDate.length() > 0) {
     printWrapped("Last printed: " + scheduleState.lastJokePrintDate);
@@ -907,76 +1547,354 @@ void printServerInfo() {
   }
 
   advancePaper(3);
+  printEngine.endJob();
 }
 
 // === Printer Helper Functions ===
 void setInverse(bool enable) {
-  printer.write(0x1D); printer.write('B');
-  printer.write(enable ? 1 : 0); // GS B n
-  delay(100); // Small delay after mode change
+  queueInverse(printEngine, enable);
+}
+
+// UTF-8 text (decoded jokes, web form input) in the printer's code table,
+// one byte per printed column
+String toPrinterText(const String &text) {
+  String encoded = text;
+  size_t length = transcodeUTF8(encoded.c_str(), encoded.length(), PRINTER_CODE_PAGE, encoded.begin());
+  encoded.remove(length);
+  return encoded;
+}
+
+// True if a job with this much text fits into the print queue (line breaks
+// add about one byte in eight)
+bool printerHasRoomFor(size_t textLength) {
+  return printEngine.available() >= textLength + textLength / 8 + PRINT_JOB_OVERHEAD;
+}
+
+// Why the printer can't print right now, empty if it can (or doesn't answer)
+String printerProblem() {
+  const PrinterStatus &status = printEngine.status();
+  if (status.known) {
+    if (status.paperOut) return "out of paper";
+    if (status.coverOpen) return "cover open";
+    if (status.overheated) return "print head overheated";
+    if (status.failed) return "printer error";
+  }
+  return "";
 }
 
 void printLine(String line) {
-  printer.println(line);
-  delay(50); // Small delay after each line to allow printing to complete
+  printLineTo(printEngine, line);
+}
+
+void printLineTo(PrintSink &sink, const String &line) {
+  // The engine paces every line, so no delay is needed here
+  String encoded = toPrinterText(line);
+  if (!sink.println(encoded.c_str(), encoded.length())) {
+    debugLog("Print buffer full, line dropped");
+  }
 }
 
 void advancePaper(int lines) {
-  for (int i = 0; i < lines; i++) {
-    printer.write(0x0A); // LF
-    delay(100); // Delay between line feeds
+  queueFeed(printEngine, lines);
+}
+
+static void printWrappedLine(const char *line, size_t length, void *context) {
+  if (!static_cast<PrintSink *>(context)->println(line, length)) {
+    debugLog("Print buffer full, line dropped");
   }
 }
 
 void printWrapped(String text) {
-  // Print text with word-wrapping in normal order
-  while (text.length() > 0) {
-    if (text.length() <= maxCharsPerLine) {
-      printLine(text);
-      break;
+  printWrappedTo(printEngine, text);
+}
+
+void printWrappedTo(PrintSink &sink, const String &text, bool balanced) {
+  // Print text with word-wrapping in normal order; '\n' starts a new line.
+  // Wrapped after transcoding, so widths count printed columns exactly.
+  String encoded = toPrinterText(text);
+  WrapOptions options = {(size_t)maxCharsPerLine, balanced ? WRAP_BALANCED : WRAP_GREEDY, false};
+  wrapText(encoded.c_str(), encoded.length(), options, printWrappedLine, &sink);
+}
+
+// === Web Server Handlers ===
+// The handlers run in the web server's context: they copy jobs into
+// printJobs and log nothing, so queueing a job never touches the heap.
+
+// Seconds until a queue slot is likely to be free: the oldest printing job
+// is done once the print queue has drained
+static uint32_t jobRetrySeconds() {
+  uint32_t lineMillis = printEngine.lineMillis() > 0 ? printEngine.lineMillis() : 250;
+  uint32_t seconds = (printEngine.pending() / maxCharsPerLine + 1) * lineMillis / 1000;
+  if (seconds < JOB_RETRY_MIN_SECONDS) return JOB_RETRY_MIN_SECONDS;
+  if (seconds > JOB_RETRY_MAX_SECONDS) return JOB_RETRY_MAX_SECONDS;
+  return seconds;
+}
+
+static void sendQueueFull(AsyncWebServerRequest *request) {
+  AsyncWebServerResponse *response = request->beginResponse(429, "text/plain", "Print queue is full, please try again later");
+  response->addHeader("Retry-After", String(jobRetrySeconds()));
+  request->send(response);
+}
+
+static void sendReceiptAccepted(AsyncWebServerRequest *request, uint32_t id) {
+  // Still queued: it prints once the printer is ready again
+  String problem = printerProblem();
+  if (problem.length() > 0) {
+    request->send(200, "text/plain", "Receipt #" + String(id) + " received, but the printer reports: " + problem + ". It will print once that is fixed.");
+  } else {
+    request->send(200, "text/plain", "Receipt #" + String(id) + " received and will be printed!");
+  }
+}
+
+static ReceiptUpload *findUpload(AsyncWebServerRequest *request) {
+  for (uint8_t i = 0; i < MAX_UPLOADS; i++) {
+    if (uploads[i].request == request) {
+      return &uploads[i];
     }
+  }
+  return nullptr;
+}
 
-    // Find the last space within the max character limit
-    int lastSpace = text.lastIndexOf(' ', maxCharsPerLine);
-    if (lastSpace == -1) lastSpace = maxCharsPerLine;
+// Give up on an upload: its job fails and the loop removes the file
+static void dropUpload(ReceiptUpload &upload, UploadResult result) {
+  upload.file.close();
+  PrintJob *job = printJobs.find(upload.jobId);
+  if (job && job->status == PRINT_JOB_RECEIVING) {
+    printJobs.fail(*job);
+  }
+  upload.result = result;
+}
 
-    // Print this line
-    printLine(text.substring(0, lastSpace));
+// The client went away before its message was complete
+static void abortUpload(AsyncWebServerRequest *request) {
+  ReceiptUpload *upload = findUpload(request);
+  if (upload) {
+    if (upload->result == UPLOAD_RECEIVING) {
+      dropUpload(*upload, UPLOAD_FAILED);
+    }
+    upload->request = nullptr;
+  }
+}
 
-    // Remove the printed part and trim
-    text = text.substring(lastSpace);
-    text.trim();
+// Message sent as the request body (PRINT_JOB_BODY_TYPE), in chunks as it
+// arrives.
+// Each chunk goes straight to the job's file; handleSubmit() answers once
+// the body is complete.
+void handleSubmitBody(AsyncWebServerRequest *request, uint8_t *data, size_t length, size_t index, size_t total) {
+  if (request->contentType() != PRINT_JOB_BODY_TYPE) {
+    return;
+  }
+  ReceiptUpload *upload = findUpload(request);
+  if (index == 0) {
+    upload = findUpload(nullptr);
+    if (!upload) {
+      return;  // Uploads all busy, handleSubmit() asks to try again
+    }
+    upload->request = request;
+    upload->jobId = 0;
+    request->onDisconnect([request]() { abortUpload(request); });
+
+    if (total > RECEIPT_MAX_LENGTH) {
+      upload->result = UPLOAD_TOO_LARGE;
+      return;
+    }
+
+    // The date comes with the URL, the body is all message
+    const char *date = nullptr;
+    if (request->hasParam("date")) {
+      const String &customDate = request->getParam("date")->value();
+      if (customDate.length() <= PRINT_JOB_DATE_MAX) {
+        date = customDate.c_str();
+      }
+    }
+    upload->jobId = printJobs.reserve(PRINT_PRIORITY_NORMAL, date);
+    if (upload->jobId == 0) {
+      upload->result = UPLOAD_QUEUE_FULL;
+      return;
+    }
+
+    char path[24];
+    receiptPath(upload->jobId, path, sizeof(path));
+    upload->file = LittleFS.open(path, "w");
+    upload->result = UPLOAD_RECEIVING;
+    if (!upload->file) {
+      dropUpload(*upload, UPLOAD_FAILED);
+      return;
+    }
+  }
+
+  if (!upload || upload->result != UPLOAD_RECEIVING) {
+    return;
+  }
+  if (upload->file.write(data, length) != length) {
+    dropUpload(*upload, UPLOAD_FAILED);  // Flash full
+    return;
+  }
+  if (index + length == total) {
+    upload->file.close();
+    printJobs.commit(upload->jobId, total);
+    upload->result = UPLOAD_DONE;
   }
 }
 
-// === Web Server Handlers ===
 void handleSubmit(AsyncWebServerRequest *request) {
-  if (request->hasParam("message", true)) {
-    currentReceipt.message = request->getParam("message", true)->value();
-
-    // Check if a custom date was provided
-    if (request->hasParam("date", true)) {
-      String customDate = request->getParam("date", true)->value();
-      currentReceipt.timestamp = formatCustomDate(customDate);
-      debugLog("Using custom date: " + customDate);
+  ReceiptUpload *upload = findUpload(request);
+  if (upload) {
+    UploadResult result = upload->result;
+    uint32_t id = upload->jobId;
+    upload->request = nullptr;
+
+    if (result == UPLOAD_DONE) {
+      scheduler.post(printTask, EVENT_JOB_QUEUED, id);
+      sendReceiptAccepted(request, id);
+    } else if (result == UPLOAD_TOO_LARGE) {
+      request->send(413, "text/plain", "Message too long");
+    } else if (result == UPLOAD_QUEUE_FULL) {
+      sendQueueFull(request);
     } else {
-      currentReceipt.timestamp = getFormattedDateTime();
-      debugLog("Using current date");
+      if (result == UPLOAD_RECEIVING) {
+        dropUpload(*upload, UPLOAD_FAILED);  // Body shorter than announced
+      }
+      request->send(500, "text/plain", "Could not store the message");
     }
+    return;
+  }
+
+  // A message body always reaches handleSubmitBody(), which only lets it
+  // pass without an upload while the others are all busy
+  if (request->contentType() == PRINT_JOB_BODY_TYPE && request->contentLength() > 0) {
+    AsyncWebServerResponse *response = request->beginResponse(429, "text/plain", "Other messages are arriving, please try again");
+    response->addHeader("Retry-After", String(JOB_RETRY_MIN_SECONDS));
+    request->send(response);
+    return;
+  }
+  if (!request->hasParam("message", true)) {
+    request->send(400, "text/plain", "Missing message parameter");
+    return;
+  }
 
-    currentReceipt.hasData = true;
+  const String &message = request->getParam("message", true)->value();
+  if (message.length() > PRINT_JOB_TEXT_MAX) {
+    request->send(413, "text/plain", "Message too long");
+    return;
+  }
 
-    debugLog("=== New Receipt Received ===");
-    debugLog("Message: " + currentReceipt.message);
-    debugLog("Time: " + currentReceipt.timestamp);
-    debugLog("============================");
+  // A custom date that can't be a date prints today's, like an invalid one
+  const char *date = nullptr;
+  if (request->hasParam("date", true)) {
+    const String &customDate = request->getParam("date", true)->value();
+    if (customDate.length() <= PRINT_JOB_DATE_MAX) {
+      date = customDate.c_str();
+    }
+  }
 
-    request->send(200, "text/plain", "Receipt received and will be printed!");
-  } else {
-    request->send(400, "text/plain", "Missing message parameter");
+  uint32_t id = printJobs.add(PRINT_JOB_RECEIPT, PRINT_PRIORITY_NORMAL, message.c_str(), message.length(), date);
+  if (id == 0) {
+    sendQueueFull(request);
+    return;
+  }
+  scheduler.post(printTask, EVENT_JOB_QUEUED, id);
+  sendReceiptAccepted(request, id);
+}
+
+// Each receipt of a batch takes its slot as soon as it is parsed
+static bool holdBatchItem(const char *message, size_t length, const char *date, void *context) {
+  BatchUpload *upload = static_cast<BatchUpload *>(context);
+  uint32_t id = printJobs.hold(PRINT_PRIORITY_NORMAL, message, length, date);
+  if (id == 0) {
+    upload->queueFull = true;
+    return false;
+  }
+  upload->jobIds[upload->jobCount++] = id;
+  return true;
+}
+
+// All of the batch or nothing
+static void endBatch(bool queue) {
+  for (uint8_t i = 0; i < batch.jobCount; i++) {
+    if (queue) {
+      printJobs.commit(batch.jobIds[i]);
+    } else {
+      printJobs.cancel(batch.jobIds[i]);
+    }
+  }
+  if (!queue) {
+    batch.jobCount = 0;
+  }
+}
+
+static void abortBatch(AsyncWebServerRequest *request) {
+  if (batch.request == request) {
+    endBatch(false);
+    batch.request = nullptr;
   }
 }
 
+// Body of /api/batch (JSON array or NDJSON), parsed as it arrives
+void handleBatchBody(AsyncWebServerRequest *request, uint8_t *data, size_t length, size_t index, size_t total) {
+  if (index == 0) {
+    if (batch.request != nullptr) {
+      return;  // Another batch is arriving, answered in handleBatch()
+    }
+    batch.request = request;
+    batch.jobCount = 0;
+    batch.queueFull = false;
+    batch.result = BATCH_OK;
+    batchParser.reset();
+    request->onDisconnect([request]() { abortBatch(request); });
+  }
+  if (batch.request != request || batch.result != BATCH_OK) {
+    return;
+  }
+
+  // The callbacks take turns with the main loop, so it never sees part of
+  // a batch queued
+  if (!batchParser.write((const char *)data, length) || index + length == total) {
+    batch.result = batchParser.finish();
+    endBatch(batch.result == BATCH_OK);
+  }
+}
+
+// Handler for /api/batch: the job IDs in the order of the receipts
+void handleBatch(AsyncWebServerRequest *request) {
+  if (batch.request != request) {
+    // Form posts never reach the body handler
+    const String &type = request->contentType();
+    if (request->contentLength() == 0) {
+      request->send(400, "text/plain", batchErrorText(BATCH_EMPTY));
+    } else if (type.startsWith("application/x-www-form-urlencoded") || type.startsWith("multipart/")) {
+      request->send(400, "text/plain", batchErrorText(BATCH_SYNTAX));
+    } else {
+      AsyncWebServerResponse *response = request->beginResponse(429, "text/plain", "Another batch is arriving, please try again");
+      response->addHeader("Retry-After", String(JOB_RETRY_MIN_SECONDS));
+      request->send(response);
+    }
+    return;
+  }
+  batch.request = nullptr;
+
+  if (batch.queueFull) {
+    sendQueueFull(request);
+    return;
+  }
+  if (batch.result != BATCH_OK) {
+    String error = batchErrorText(batch.result);
+    if (batch.result != BATCH_EMPTY) {
+      error += " at byte " + String(batchParser.offset()) + ", nothing queued";
+    }
+    request->send(batch.result == BATCH_TOO_LONG ? 413 : 400, "text/plain", error);
+    return;
+  }
+
+  String json = "{\"jobs\":[";
+  for (uint8_t i = 0; i < batch.jobCount; i++) {
+    json += (i > 0 ? "," : "") + String(batch.jobIds[i]);
+  }
+  scheduler.post(printTask, EVENT_JOB_QUEUED, batch.jobIds[0]);
+  json += "]}";
+  request->send(200, "application/json", json);
+}
+
 void handleLogs(AsyncWebServerRequest *request) {
   String logs = "";
 
@@ -996,13 +1914,432 @@ void handle404(AsyncWebServerRequest *request) {
 
 // Handler for printing daily joke
 void handlePrintJoke(AsyncWebServerRequest *request) {
-  debugLog("Joke print requested via web interface");
+  // A joke that is still waiting covers this request too
+  PrintJob *waiting = printJobs.queued(PRINT_JOB_JOKE);
+  uint32_t id = waiting ? waiting->id : printJobs.add(PRINT_JOB_JOKE, PRINT_PRIORITY_LOW);
+  if (id == 0) {
+    sendQueueFull(request);
+    return;
+  }
+
+  scheduler.post(printTask, EVENT_JOB_QUEUED, id);
+  request->send(200, "text/plain", "Joke #" + String(id) + " will be printed!");
+}
+
+// JSON-escaped text into out, which holds 6 bytes per input byte
+static size_t escapeJSONText(const char *data, size_t length, char *out) {
+  size_t written = 0;
+  for (size_t i = 0; i < length; i++) {
+    uint8_t c = data[i];
+    if (c == '"' || c == '\\') {
+      out[written++] = '\\';
+      out[written++] = c;
+    } else if (c < 0x20) {
+      written += sprintf(out + written, "\\u%04x", c);
+    } else {
+      out[written++] = c;
+    }
+  }
+  return written;
+}
+
+// Where a record is after a compaction moved them: its position + 1, 0 if
+// it was dropped (and with it everything older)
+static uint32_t findHistoryRecord(uint32_t date, uint64_t hash) {
+  uint32_t position = jokeHistory.countBefore(date + 1);
+  HistoryEntry entry;
+  while (position > 0 && jokeHistory.entry(position - 1, entry) && entry.date == date) {
+    if (entry.hash == hash) {
+      return position;
+    }
+    position--;
+  }
+  return 0;
+}
+
+// The next piece of the page into pending. False once it is complete.
+static bool nextHistoryPiece(HistoryPage &page) {
+  // A joke saved meanwhile may have compacted the history: find our place
+  // again. The page ends early if the entry being sent was dropped.
+  if (page.compactions != jokeHistory.compactions()) {
+    page.compactions = jokeHistory.compactions();
+    if (page.stage == PAGE_TEXT) {
+      page.position = findHistoryRecord(page.entry.date, page.entry.hash);
+      if (page.position == 0 || !jokeHistory.entry(page.position - 1, page.entry)) {
+        page.position = 0;
+        page.textDone = page.entry.length;
+      }
+    } else if (page.sent > 0) {
+      uint32_t last = findHistoryRecord(page.lastDate, page.lastHash);
+      page.position = last > 0 ? last - 1 : 0;
+    } else {
+      page.position = jokeHistory.countBefore(page.before);
+    }
+  }
+
+  char *out = page.pending;
+  page.pendingDone = 0;
+  page.pendingLength = 0;
+  switch (page.stage) {
+    case PAGE_START:
+      page.pendingLength = sprintf(out, "{\"count\":%lu,\"jokes\":[", (unsigned long)jokeHistory.count());
+      page.stage = PAGE_ENTRY;
+      return true;
+
+    case PAGE_ENTRY: {
+      // A page doesn't split a date
+      HistoryEntry &entry = page.entry;
+      if (page.position == 0 || !jokeHistory.entry(page.position - 1, entry) ||
+          (page.sent >= page.limit && entry.date != page.lastDate)) {
+        page.stage = PAGE_END;
+        return nextHistoryPiece(page);
+      }
+      char date[11];
+      formatHistoryDate(entry.date, date);
+      page.pendingLength = sprintf(out, "%s{\"date\":\"%s\",\"hash\":\"%08lx%08lx\",\"length\":%u,\"text\":\"",
+                                   page.sent > 0 ? "," : "", date, (unsigned long)(entry.hash >> 32),
+                                   (unsigned long)entry.hash, (unsigned)entry.length);
+      page.textDone = 0;
+      page.stage = PAGE_TEXT;
+      return true;
+    }
+
+    case PAGE_TEXT: {
+      char piece[HISTORY_TEXT_PIECE];
+      size_t length = jokeHistory.readText(page.entry, page.textDone, piece, sizeof(piece));
+      if (length > 0) {
+        page.textDone += length;
+        page.pendingLength = escapeJSONText(piece, length, out);
+        return true;
+      }
+      page.pendingLength = sprintf(out, "\"}");
+      page.sent++;
+      page.lastDate = page.entry.date;
+      page.lastHash = page.entry.hash;
+      page.position = page.position > 0 ? page.position - 1 : 0;
+      page.stage = PAGE_ENTRY;
+      return true;
+    }
+
+    case PAGE_END:
+      if (page.position > 0 && page.lastDate != 0) {
+        char date[11];
+        formatHistoryDate(page.lastDate, date);
+        page.pendingLength = sprintf(out, "],\"next\":\"%s\"}", date);
+      } else {
+        page.pendingLength = sprintf(out, "],\"next\":null}");
+      }
+      page.stage = PAGE_DONE;
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+// Chunked response filler: as much of the page as fits, 0 once it is sent
+static size_t fillHistoryPage(HistoryPage &page, uint8_t *buffer, size_t maxLength) {
+  size_t written = 0;
+  while (written < maxLength) {
+    if (page.pendingDone == page.pendingLength && !nextHistoryPiece(page)) {
+      break;
+    }
+    size_t length = page.pendingLength - page.pendingDone;
+    if (length > maxLength - written) {
+      length = maxLength - written;
+    }
+    memcpy(buffer + written, page.pending + page.pendingDone, length);
+    page.pendingDone += length;
+    written += length;
+  }
+  return written;
+}
+
+// Handler for past jokes, newest first. ?before=YYYY-MM-DD starts before
+// that date, ?limit= (10, at most 50) ends the page; "next" is the before=
+// of the following page. A page doesn't split a date, so it can run a
+// joke or two past limit. Sent chunked and put together as it goes out,
+// so a page never sits in RAM whole.
+void handleHistory(AsyncWebServerRequest *request) {
+  uint32_t before = 0;
+  if (request->hasParam("before") && !parseHistoryDate(request->getParam("before")->value().c_str(), before)) {
+    request->send(400, "text/plain", "before must be YYYY-MM-DD");
+    return;
+  }
+  long limit = request->hasParam("limit") ? request->getParam("limit")->value().toInt() : HISTORY_PAGE_DEFAULT;
+  if (limit < 1 || limit > HISTORY_PAGE_MAX) {
+    request->send(400, "text/plain", "limit must be 1 to " + String(HISTORY_PAGE_MAX));
+    return;
+  }
+
+  HistoryPage *page = nullptr;
+  for (uint8_t i = 0; i < HISTORY_PAGES_MAX && !page; i++) {
+    if (historyPages[i].request == nullptr) {
+      page = &historyPages[i];
+    }
+  }
+  if (!page) {
+    AsyncWebServerResponse *response = request->beginResponse(429, "text/plain", "Other history pages are being sent, please try again");
+    response->addHeader("Retry-After", String(JOB_RETRY_MIN_SECONDS));
+    request->send(response);
+    return;
+  }
+
+  page->request = request;
+  page->stage = PAGE_START;
+  page->before = before;
+  page->limit = (uint32_t)limit;
+  page->sent = 0;
+  page->position = jokeHistory.countBefore(before);
+  page->compactions = jokeHistory.compactions();
+  page->lastDate = 0;
+  page->lastHash = 0;
+  page->pendingLength = 0;
+  page->pendingDone = 0;
+  request->onDisconnect([page]() { page->request = nullptr; });
+  request->send(request->beginChunkedResponse("application/json", [page](uint8_t *buffer, size_t maxLength, size_t) -> size_t {
+    return fillHistoryPage(*page, buffer, maxLength);
+  }));
+}
+
+// Handler for printing a past joke again, the date as form parameter
+void handleHistoryReprint(AsyncWebServerRequest *request) {
+  uint32_t day;
+  if (!request->hasParam("date", true) ||
+      !parseHistoryDate(request->getParam("date", true)->value().c_str(), day)) {
+    request->send(400, "text/plain", "date must be YYYY-MM-DD");
+    return;
+  }
+  HistoryEntry entry;
+  if (!jokeHistory.find(day, entry)) {
+    request->send(404, "text/plain", "No joke of that date in the history");
+    return;
+  }
+
+  const String &date = request->getParam("date", true)->value();
+  uint32_t id = printJobs.add(PRINT_JOB_PAST_JOKE, PRINT_PRIORITY_NORMAL, nullptr, 0, date.c_str());
+  if (id == 0) {
+    sendQueueFull(request);
+    return;
+  }
+  scheduler.post(printTask, EVENT_JOB_QUEUED, id);
+  request->send(200, "text/plain", "Joke of " + date + " will be printed again as #" + String(id) + "!");
+}
+
+static String jobJson(const PrintJob &job) {
+  String json = "{";
+  json += "\"id\":" + String(job.id) + ",";
+  json += "\"type\":\"" + String(printJobTypeName(job.type)) + "\",";
+  json += "\"priority\":\"" + String(printJobPriorityName(job.priority)) + "\",";
+  json += "\"status\":\"" + String(printJobStatusName(job.status)) + "\",";
+  json += "\"scheduled\":" + String(job.scheduled ? "true" : "false");
+  if (job.type == PRINT_JOB_RECEIPT) {
+    json += ",\"length\":" + String(job.textLength);
+  }
+  json += "}";
+  return json;
+}
+
+// Handler for the print job list, or one job with ?id=
+void handleJobs(AsyncWebServerRequest *request) {
+  if (request->hasParam("id")) {
+    const PrintJob *job = printJobs.find(request->getParam("id")->value().toInt());
+    if (!job) {
+      request->send(404, "text/plain", "Unknown job");
+      return;
+    }
+    request->send(200, "application/json", jobJson(*job));
+    return;
+  }
+
+  String json = "{";
+  json += "\"depth\":" + String(printJobs.depth()) + ",";
+  json += "\"capacity\":" + String(PRINT_JOB_SLOTS) + ",";
+  json += "\"rejected\":" + String(printJobs.jobsRejected()) + ",";
+  json += "\"jobs\":[";
+
+  // Oldest first
+  uint32_t lastId = 0;
+  bool first = true;
+  while (true) {
+    const PrintJob *oldest = nullptr;
+    for (uint8_t i = 0; i < PRINT_JOB_SLOTS; i++) {
+      const PrintJob &job = printJobs.slot(i);
+      if (job.status != PRINT_JOB_FREE && job.id > lastId && (!oldest || job.id < oldest->id)) {
+        oldest = &job;
+      }
+    }
+    if (!oldest) {
+      break;
+    }
+    json += (first ? "" : ",") + jobJson(*oldest);
+    first = false;
+    lastId = oldest->id;
+  }
+  json += "]}";
+
+  request->send(200, "application/json", json);
+}
+
+// Handler for task run times and the loop latency since start-up
+void handleScheduler(AsyncWebServerRequest *request) {
+  String json = "{";
+  json += "\"maxPassMillis\":" + String(scheduler.maxPassMillis()) + ",";
+  json += "\"maxLatencyMillis\":" + String(scheduler.maxLatencyMillis()) + ",";
+  json += "\"eventsDropped\":" + String(scheduler.eventsDropped()) + ",";
+  json += "\"tasks\":[";
+  for (uint8_t i = 0; i < scheduler.tasks(); i++) {
+    const TaskStats &stats = scheduler.stats(i);
+    json += String(i > 0 ? "," : "") + "{";
+    json += "\"name\":\"" + String(stats.name) + "\",";
+    json += "\"budgetMillis\":" + String(stats.budgetMillis) + ",";
+    json += "\"runs\":" + String(stats.runs) + ",";
+    json += "\"maxMillis\":" + String(stats.maxMillis) + ",";
+    json += "\"overruns\":" + String(stats.overruns);
+    json += "}";
+  }
+  json += "]}";
+  request->send(200, "application/json", json);
+}
+
+// Handler for the joke fetch: attempts so far and when the next one is due
+void handleFetchStatus(AsyncWebServerRequest *request) {
+  const char *state = "idle";
+  if (fetchState == FETCH_WAITING) state = "retrying";
+  if (fetchState == FETCH_FAILED) state = "failed";
+  uint32_t now = millis();
+  bool waiting = fetchState == FETCH_WAITING && fetchBackoff.attempts() > 0;
+  int32_t untilNext = (int32_t)(nextFetchMillis - now);
+
+  String json = "{";
+  json += "\"state\":\"" + String(state) + "\",";
+  json += "\"attempts\":" + String(fetchBackoff.attempts()) + ",";
+  json += "\"maxAttempts\":" + String(fetchBackoff.maxAttempts()) + ",";
+  json += "\"nextAttemptMillis\":" + String(waiting && untilNext > 0 ? untilNext : 0) + ",";
+  json += "\"deadlineMillis\":" + String(fetchState == FETCH_WAITING ? fetchBackoff.remainingMillis(now) : 0) + ",";
+  json += "\"lastHttpCode\":" + String(fetchBackoff.attempts() > 0 ? fetchError.lastHttpCode : 0) + ",";
+  json += "\"errorType\":\"" + fetchError.errorType + "\",";
+  json += "\"prefetch\":" + String(fetchState == FETCH_WAITING && fetchIsPrefetch ? "true" : "false") + ",";
+  json += "\"prefetchHits\":" + String(prefetchHits) + ",";
+  json += "\"prefetchMisses\":" + String(prefetchMisses) + ",";
+  json += "\"bankJokes\":" + String(jokeBank.count()) + ",";
+  json += "\"bankFallbacks\":" + String(bankFallbacks) + ",";
+  json += "\"repeatsSkipped\":" + String(repeatsSkipped) + ",";
+  json += "\"tls\":{";
+  json += "\"fetches\":" + String(tlsStats.fetches) + ",";
+  json += "\"resumed\":" + String(tlsStats.resumes) + ",";
+  json += "\"fragment\":" + String(tlsStats.fragment) + ",";
+  json += "\"lastHandshakeMillis\":" + String(tlsStats.handshakeMillis) + ",";
+  json += "\"lastPeakHeapBytes\":" + String(tlsStats.peakHeapBytes);
+  json += "}}";
+  request->send(200, "application/json", json);
+}
+
+// Handler for the joke sources in the order the next fetch tries them,
+// with what was measured. Rules contain quotes, so ArduinoJson writes it.
+void handleSourcesList(AsyncWebServerRequest *request) {
+  uint8_t order[JOKE_SOURCES_MAX];
+  uint8_t count = jokeSources.order(order);
+  JsonDocument doc;
+  JsonArray list = doc["sources"].to<JsonArray>();
+  for (uint8_t i = 0; i < count; i++) {
+    const JokeSource &source = jokeSources.source(order[i]);
+    JsonObject item = list.add<JsonObject>();
+    item["name"] = source.name;
+    item["url"] = source.url;
+    item["rule"] = ruleTypeName(source.type);
+    item["pattern"] = source.pattern;
+    if (source.type == RULE_MARKERS) {
+      item["end"] = source.end;
+    }
+    item["attempts"] = source.stats.attempts;
+    item["successes"] = source.stats.successes;
+    item["reliability"] = source.stats.reliability;
+    item["latencyMillis"] = source.stats.latencyMillis;
+    item["score"] = jokeSources.score(order[i]);
+  }
+  doc["pending"] = sourcesPending;
+  String json;
+  serializeJson(doc, json);
+  request->send(200, "application/json", json);
+}
+
+// Body of a POST to /api/sources, kept until the handler below runs
+AsyncWebServerRequest *sourcesRequest = nullptr;
+String sourcesBody;
+bool sourcesTooLong = false;
+
+void handleSourcesBody(AsyncWebServerRequest *request, uint8_t *data, size_t length, size_t index, size_t total) {
+  if (index == 0) {
+    sourcesRequest = request;
+    sourcesBody = "";
+    sourcesTooLong = total > SOURCES_BODY_MAX;
+  }
+  if (sourcesRequest != request || sourcesTooLong) {
+    return;
+  }
+  sourcesBody.concat((const char *)data, length);
+}
 
-  // Queue the joke for printing in the main loop (async-safe)
-  currentJoke.shouldPrint = true;
-  currentJoke.isScheduled = false; // Mark as manual
+// Handler for a new source list: {"sources": [...]} as in config.json. It is
+// checked here and applied by the config task, between fetches.
+void handleSources(AsyncWebServerRequest *request) {
+  if (sourcesRequest != request) {
+    request->send(400, "text/plain", "Expected a JSON body");
+    return;
+  }
+  sourcesRequest = nullptr;
+  if (sourcesTooLong) {
+    sourcesBody = "";
+    request->send(413, "text/plain", "At most " + String(SOURCES_BODY_MAX) + " bytes");
+    return;
+  }
+
+  JsonDocument doc;
+  DeserializationError error = deserializeJson(doc, sourcesBody);
+  sourcesBody = "";
+  if (error || !doc["sources"].is<JsonArrayConst>()) {
+    request->send(400, "text/plain", "Expected {\"sources\": [...]}");
+    return;
+  }
+  String problem;
+  if (!sourcesFromJson(doc["sources"], pendingSources, problem)) {
+    request->send(400, "text/plain", problem);
+    return;
+  }
 
-  request->send(200, "text/plain", "Joke will be printed!");
+  sourcesPending = true;
+  scheduler.post(configTask, EVENT_SOURCES_CHANGED);
+  request->send(200, "application/json", "{\"sources\":" + String(pendingSources.count()) + "}");
+}
+
+void handlePrinterStatus(AsyncWebServerRequest *request) {
+  const char *state = "idle";
+  if (printEngine.state() == PRINT_SENDING) state = "printing";
+  if (printEngine.state() == PRINT_PAUSED) state = "paused";
+  if (printEngine.state() == PRINT_BLOCKED) state = "blocked";
+  const PrinterStatus &status = printEngine.status();
+
+  String json = "{";
+  json += "\"state\":\"" + String(state) + "\",";
+  json += "\"problem\":\"" + printerProblem() + "\",";
+  json += "\"pendingBytes\":" + String(printEngine.pending()) + ",";
+  json += "\"bufferSize\":" + String(PRINT_BUFFER_SIZE) + ",";
+  json += "\"bytesSent\":" + String(printEngine.bytesSent()) + ",";
+  json += "\"jobsQueued\":" + String(printEngine.jobsQueued()) + ",";
+  json += "\"jobsCompleted\":" + String(printEngine.jobsCompleted()) + ",";
+  json += "\"writesRejected\":" + String(printEngine.writesRejected()) + ",";
+  json += "\"statusKnown\":" + String(status.known ? "true" : "false") + ",";
+  json += "\"paperOut\":" + String(status.paperOut ? "true" : "false") + ",";
+  json += "\"paperNearEnd\":" + String(status.paperNearEnd ? "true" : "false") + ",";
+  json += "\"coverOpen\":" + String(status.coverOpen ? "true" : "false") + ",";
+  json += "\"overheated\":" + String(status.overheated ? "true" : "false") + ",";
+  json += "\"failed\":" + String(status.failed ? "true" : "false") + ",";
+  json += "\"flowStopped\":" + String(status.flowStopped ? "true" : "false") + ",";
+  json += "\"lineMillis\":" + String(printEngine.lineMillis());
+  json += "}";
+
+  request->send(200, "application/json", json);
 }
 
 // Handler for WiFi info endpoint
@@ -1025,31 +2362,240 @@ void handleForgetWifi(AsyncWebServerRequest *request) {
   request->send(200, "text/plain", "Forgetting WiFi and restarting...");
 
   // Clear WiFi credentials while preserving schedule settings
-  if (LittleFS.exists("/config.json")) {
-    // Load existing config to preserve non-WiFi fields
-    JsonDocument doc;
-    File configFile = LittleFS.open("/config.json", "r");
-    if (configFile) {
-      deserializeJson(doc, configFile);
-      configFile.close();
+  forgetCredentials();
+
+  // Restart the device after a short delay
+  prepareForRestart();
+  delay(1000);
+  ESP.restart();
+}
+
+// Journal how far the current job got, so it resumes there after a restart
+void prepareForRestart() {
+  printSpool.update(printJobs, printEngine.jobsCompleted(), printEngine.jobLinesPrinted(), true);
+  configStore.flush(millis());
+}
+
+// === Tasks ===
+// First attempt at today's joke, for a waiting joke job or ahead of time
+static void startFetch(bool prefetch) {
+  fetchBackoff.start(millis());
+  fetchError = {-1, true, "", 0, ""};
+  fetchIsPrefetch = prefetch;
+  fetchState = FETCH_WAITING;
+  scheduler.wake(fetchTask);
+}
+
+// A joke job went to the printer
+static void jokeJobStarted(PrintJob &job, uint32_t ticket) {
+  printJobs.start(job, ticket);
+  if (jokeJobWaited == job.id) {
+    prefetchMisses++;
+  } else {
+    prefetchHits++;
+  }
+
+  // Update schedule tracking for scheduled prints (saved by its task)
+  if (job.scheduled) {
+    scheduleState.lastJokePrintDate = getCurrentDate();
+    debugLog("Updated lastJokePrintDate: " + scheduleState.lastJokePrintDate);
+    scheduler.wake(configTask);
+  }
+}
+
+// Feed the printer and start the next job once there is room for it
+static void runPrintTask(const TaskEvent *event, void *context) {
+  printEngine.update();
+  streamJokeImage();
+  streamReceipt();
+  printJobs.update(printEngine.jobsCompleted());
+  printSpool.update(printJobs, printEngine.jobsCompleted(), printEngine.jobLinesPrinted());
+  removeReceiptFiles();
+  String problem = printerProblem();
+  if (problem != lastPrinterProblem) {
+    debugLog(problem.length() > 0 ? "Printer paused: " + problem : "Printer ready");
+    lastPrinterProblem = problem;
+  }
+
+  // Next job in priority order. Not while the joke image or a message file
+  // streams, or the job would land inside it.
+  PrintJob *job = (jokeImage || receiptFile) ? nullptr : printJobs.next();
+  bool jokeJob = job && job->type == PRINT_JOB_JOKE;
+
+  // A joke waits for the fetch task to get today's. Other jobs print
+  // meanwhile: the joke is low priority, so next() only returns it when
+  // nothing else is waiting.
+  if (jokeJob && !isTodaysJokeReady()) {
+    jokeJobWaited = job->id;
+    if (fetchState == FETCH_FAILED && printerHasRoomFor(JOKE_MAX_LENGTH)) {
+      // Today's joke isn't cached, so the next joke job tries the sources again
+      uint32_t ticket = printEngine.jobsQueued() + 1;
+      String bankJoke = loadBankJoke();
+      if (bankJoke.length() > 0) {
+        debugLog("Printing joke #" + String(job->id) + " from the bank (" + fetchError.errorType + ")");
+        printDailyJoke(bankJoke, getFormattedDateTime());
+        jokeJobStarted(*job, ticket);
+        rememberJoke(getCurrentDate(), bankJoke.c_str());
+        bankFallbacks++;
+      } else {
+        printDailyJoke(fetchErrorMessage, getFormattedDateTime());
+        printJobs.fail(*job);
+      }
+      fetchErrorMessage = String();
+      fetchState = FETCH_IDLE;
+    } else if (fetchState == FETCH_IDLE) {
+      debugLog("Cache invalid or missing, fetching today's joke");
+      startFetch(false);
     }
+    return;
+  }
 
-    // Clear only WiFi credential fields
-    doc["ssid"] = "";
-    doc["password"] = "";
+  // The pre-rendered image streams in as the queue drains. Otherwise render
+  // now, waiting for room in the print queue rather than dropping lines.
+  // A joke cut short by a reset is rendered again to skip what printed.
+  bool imageOpened = jokeJob && job->resumeLine == 0 && openJokeImage(jokeImage);
+  if (imageOpened || (jokeJob && printerHasRoomFor(JOKE_MAX_LENGTH))) {
+    debugLog("Printing joke #" + String(job->id) + (job->scheduled ? " (scheduled)" : ""));
+    uint32_t ticket = printEngine.jobsQueued() + 1;
+    String jokeText = imageOpened ? String() : loadCachedJoke();
+
+    if (imageOpened || jokeText.length() > 0) {
+      if (imageOpened) {
+        debugLog("Streaming pre-rendered joke");
+        streamJokeImage();
+      } else {
+        printDailyJoke(jokeText, getFormattedDateTime(), job->resumeLine);
+      }
+      jokeJobStarted(*job, ticket);
+    } else {
+      debugLog("ERROR: Failed to load cached joke");
+      printDailyJoke("Error: Cache corrupted or empty", getFormattedDateTime());
+      printJobs.fail(*job);
+    }
+  }
 
-    // Write back to file
-    configFile = LittleFS.open("/config.json", "w");
-    if (configFile) {
-      serializeJson(doc, configFile);
-      configFile.close();
-      debugLog("WiFi credentials cleared (schedule settings preserved)");
+  // Receipts and server info
+  if (job && job->type == PRINT_JOB_RECEIPT && job->textInFile && printerHasRoomFor(RECEIPT_CHUNK)) {
+    uint32_t ticket = printEngine.jobsQueued() + 1;
+    if (startReceiptStream(*job)) {
+      printJobs.start(*job, ticket);
+    } else {
+      printJobs.fail(*job);
     }
+  } else if (job && job->type == PRINT_JOB_RECEIPT && !job->textInFile && printerHasRoomFor(job->textLength)) {
+    uint32_t ticket = printEngine.jobsQueued() + 1;
+    printReceipt(*job);
+    printJobs.start(*job, ticket);
+  }
+  if (job && job->type == PRINT_JOB_PAST_JOKE && printerHasRoomFor(JOKE_MAX_LENGTH)) {
+    uint32_t ticket = printEngine.jobsQueued() + 1;
+    String jokeText = loadHistoryJoke(job->date);
+    if (jokeText.length() > 0) {
+      debugLog("Printing the joke of " + String(job->date) + " again, #" + String(job->id));
+      // Headed with the joke's own day, like a backdated receipt
+      printDailyJoke(jokeText, formatCustomDate(job->date), job->resumeLine);
+      printJobs.start(*job, ticket);
+    } else {
+      debugLog("No joke of " + String(job->date) + " in the history any more");
+      printJobs.fail(*job);
+    }
+  }
+  if (job && job->type == PRINT_JOB_SERVER_INFO && printerHasRoomFor(SERVER_INFO_LENGTH)) {
+    uint32_t ticket = printEngine.jobsQueued() + 1;
+    printServerInfo();
+    printJobs.start(*job, ticket);
   }
+}
 
-  // Restart the device after a short delay
-  delay(1000);
-  ESP.restart();
+// One attempt at today's joke, the next one scheduled by the backoff
+static void runFetchTask(const TaskEvent *event, void *context) {
+  if (fetchState != FETCH_WAITING) {
+    return;
+  }
+  bool jokeWaiting = printJobs.queued(PRINT_JOB_JOKE) != nullptr;
+  if ((!jokeWaiting && !fetchIsPrefetch) || isTodaysJokeReady()) {
+    fetchState = FETCH_IDLE;  // Nothing waits for it any more
+    return;
+  }
+
+  fetchError.attemptNumber = fetchBackoff.attempts() + 1;
+  debugLog("Fetch attempt " + String(fetchError.attemptNumber) + "/" + String(fetchBackoff.maxAttempts()));
+  if (fetchAndProcessJoke(fetchError)) {
+    fetchState = FETCH_IDLE;
+    recheckTodaysJoke();
+    scheduler.wake(printTask);
+    return;
+  }
+
+  uint32_t delayMillis = fetchBackoff.failed(millis());
+  if (delayMillis == BACKOFF_GIVE_UP && !jokeWaiting) {
+    // Only a prefetch: the next window or the print itself tries again
+    debugLog("Prefetch failed after " + String(fetchError.attemptNumber) + " attempts");
+    fetchState = FETCH_IDLE;
+    recheckTodaysJoke();
+    return;
+  }
+  if (delayMillis == BACKOFF_GIVE_UP) {
+    debugLog("ERROR: Failed to fetch joke after " + String(fetchError.attemptNumber) + " attempts");
+    fetchError.hasInternetConnectivity = verifyInternetConnectivity();
+    if (!fetchError.hasInternetConnectivity) {
+      debugLog("WARNING: No internet connectivity detected (google.com unreachable)");
+    }
+    fetchErrorMessage = buildErrorMessage(fetchError);
+    fetchState = FETCH_FAILED;
+    recheckTodaysJoke();
+    scheduler.wake(printTask);
+    return;
+  }
+  nextFetchMillis = millis() + delayMillis;
+  debugLog("Fetch failed, retrying in " + String(delayMillis / 1000) + "s");
+  scheduler.after(fetchTask, delayMillis);
+}
+
+// Prefetch today's joke; a joke that is already waiting becomes the
+// scheduled one
+static void runScheduleTask(const TaskEvent *event, void *context) {
+  if (shouldPrefetchJoke() && !isTodaysJokeReady()) {
+    debugLog("Prefetching today's joke");
+    startFetch(true);
+  }
+  if (!shouldPrintScheduledJoke()) {
+    return;
+  }
+  debugLog("Scheduled joke print triggered at " + getCurrentTime());
+  PrintJob *waiting = printJobs.queued(PRINT_JOB_JOKE);
+  if (waiting) {
+    waiting->scheduled = true;
+  } else if (printJobs.add(PRINT_JOB_JOKE, PRINT_PRIORITY_LOW, nullptr, 0, nullptr, true) == 0) {
+    debugLog("Print queue full, scheduled joke retried next minute");
+    return;
+  }
+  scheduler.wake(printTask);
+}
+
+static void runTimeTask(const TaskEvent *event, void *context) {
+  timeClient.update();
+}
+
+// Schedule settings changed on the web page or by a scheduled print, or a
+// new source list. Runs again when the changed config is due to be written.
+static void runConfigTask(const TaskEvent *event, void *context) {
+  if (event && event->type == EVENT_SOURCES_CHANGED) {
+    if (sourcesPending) {
+      applyPendingSources();
+    }
+  } else if (saveScheduleConfig(scheduleState.dailyPrintTime, scheduleState.lastJokePrintDate) && event) {
+    debugLog("Schedule time updated to: " + scheduleState.dailyPrintTime);
+  }
+
+  // Changes go to flash once they have settled
+  uint32_t now = millis();
+  if (configStore.dirty() && configStore.dueIn(now) == 0 && !configStore.flush(now)) {
+    debugLog("Failed to write config file, trying again");
+  }
+  if (configStore.dirty()) {
+    scheduler.after(configTask, configStore.dueIn(now));
+  }
 }
 
 // === Setup and Loop ===
@@ -1061,8 +2607,22 @@ void mainProgramSetup() {
   // Initialize printer
   initializePrinter();
 
+  // Older firmware left the raw HTML page on flash between fetches
+  if (LittleFS.exists(LEGACY_HTML_CACHE)) {
+    LittleFS.remove(LEGACY_HTML_CACHE);
+  }
+
   // Load schedule configuration
   loadScheduleConfig(scheduleState.dailyPrintTime, scheduleState.lastJokePrintDate);
+  loadJokeSources();
+  loadSourceStats();
+  loadRecentJokes();
+  debugLog("Joke history: " + String(jokeHistory.recover()) + " jokes");
+  if (jokeBank.open()) {
+    debugLog("Joke bank: " + String(jokeBank.count()) + " jokes");
+  } else {
+    debugLog("No joke bank, a failed fetch prints an error report");
+  }
   debugLog("Schedule loaded: time=" + scheduleState.dailyPrintTime +
            ", lastPrint=" + scheduleState.lastJokePrintDate);
 
@@ -1074,10 +2634,19 @@ void mainProgramSetup() {
   // Serve static files from LittleFS using serveStatic (more efficient)
   server.serveStatic("/", LittleFS, "/").setDefaultFile("main.html");
 
-  server.on("/submit", HTTP_POST, handleSubmit);
+  server.on("/submit", HTTP_POST, handleSubmit, nullptr, handleSubmitBody);
   server.on("/logs", HTTP_GET, handleLogs);
   server.on("/printJoke", HTTP_POST, handlePrintJoke);
   server.on("/wifiInfo", HTTP_GET, handleWifiInfo);
+  server.on("/api/printer", HTTP_GET, handlePrinterStatus);
+  server.on("/api/jobs", HTTP_GET, handleJobs);
+  server.on("/api/batch", HTTP_POST, handleBatch, nullptr, handleBatchBody);
+  server.on("/api/scheduler", HTTP_GET, handleScheduler);
+  server.on("/api/fetch", HTTP_GET, handleFetchStatus);
+  server.on("/api/history", HTTP_GET, handleHistory);
+  server.on("/api/history/reprint", HTTP_POST, handleHistoryReprint);
+  server.on("/api/sources", HTTP_GET, handleSourcesList);
+  server.on("/api/sources", HTTP_POST, handleSources, nullptr, handleSourcesBody);
   server.on("/forgetWifi", HTTP_POST, handleForgetWifi);
 
   // Schedule API endpoints
@@ -1096,8 +2665,7 @@ void mainProgramSetup() {
       // Validate HH:MM format
       if (newTime.length() == 5 && newTime.charAt(2) == ':') {
         scheduleState.dailyPrintTime = newTime;
-        saveScheduleConfig(scheduleState.dailyPrintTime, scheduleState.lastJokePrintDate);
-        debugLog("Schedule time updated to: " + newTime);
+        scheduler.post(configTask, EVENT_SCHEDULE_CHANGED);
         request->send(200, "application/json", "{\"success\":true}");
       } else {
         request->send(400, "text/plain", "Invalid time format (use HH:MM)");
@@ -1121,96 +2689,36 @@ void mainProgramSetup() {
   debugLog("Web server started on port 80");
 
   // Wait a bit longer before printing to ensure printer is fully ready
-  delay(2000); // Additional 2 second delay before first print
+  printEngine.pause(2000); // Additional 2 second pause before first print
 
-  // Print server info
-  printServerInfo();
+  // Jobs cut short by a reset, then the server info before anything else
+  uint8_t resumed = printSpool.recover(printJobs);
+  if (resumed > 0) {
+    debugLog("Resuming " + String(resumed) + " print job(s) from before the restart");
+  }
+  printJobs.add(PRINT_JOB_SERVER_INFO, PRINT_PRIORITY_HIGH);
+  LittleFS.mkdir(RECEIPT_DIR);
+  removeStrayReceiptFiles();
+
+  // Budgets are what each run should stay under (overruns show in
+  // /api/scheduler). The NTP update waits up to a second for its answer,
+  // a fetch attempt up to its HTTP timeout.
+  printTask = scheduler.add("print", runPrintTask, nullptr, 20);
+  fetchTask = scheduler.add("fetch", runFetchTask, nullptr, 10000);
+  scheduleTask = scheduler.add("schedule", runScheduleTask, nullptr, 10);
+  timeTask = scheduler.add("time", runTimeTask, nullptr, 1000);
+  configTask = scheduler.add("config", runConfigTask, nullptr, 100);
+  scheduler.every(printTask, PRINT_TASK_MILLIS);
+  scheduler.every(scheduleTask, SCHEDULE_TASK_MILLIS);
+  scheduler.every(timeTask, TIME_TASK_MILLIS);
+  scheduler.wake(printTask);
 
   debugLog("=== Setup Complete ===");
 }
 
 void mainProgramLoop() {
-  // Update time client
-  timeClient.update();
-
-  // === PHASE 1: CHECK SCHEDULED PRINT ===
-  if (shouldPrintScheduledJoke()) {
-    debugLog("Scheduled joke print triggered at " + getCurrentTime());
-    currentJoke.shouldPrint = true;
-    currentJoke.isScheduled = true;
-  }
-
-  // === PHASE 2: ENSURE CACHE IS READY ===
-  if (currentJoke.shouldPrint && !isCacheValidForToday()) {
-    debugLog("Cache invalid or missing, fetching today's joke");
-
-    int tries = 0;
-    bool fetchSuccess = false;
-    JokeError lastError = {-1, true, "", 0, ""};  // Initialize error struct
-
-    while (tries < 10 && !fetchSuccess) {
-      tries++;
-      debugLog("Fetch attempt " + String(tries) + "/10");
-
-      // Check internet connectivity BEFORE retry (not on first attempt)
-      if (tries > 1) {
-        lastError.hasInternetConnectivity = verifyInternetConnectivity();
-        if (!lastError.hasInternetConnectivity) {
-          debugLog("WARNING: No internet connectivity detected (google.com unreachable)");
-        }
-      }
-
-      // Attempt to fetch
-      lastError.attemptNumber = tries;
-      fetchSuccess = fetchAndProcessJoke(lastError);
-
-      if (!fetchSuccess && tries < 10) {
-        debugLog("Fetch failed, retrying in 10s");
-        delay(10000);
-        yield(); // Allow ESP to handle WiFi, etc.
-      }
-    }
-
-    if (!fetchSuccess) {
-      debugLog("ERROR: Failed to fetch joke after 10 attempts");
-      // Build detailed error message for thermal printer
-      String errorMessage = buildErrorMessage(lastError);
-      printDailyJoke(errorMessage);
-      currentJoke.shouldPrint = false;
-      currentJoke.isScheduled = false;
-      return; // Exit early, skip printing
-    }
-  }
-
-  // === PHASE 3: PRINT JOKE ===
-  if (currentJoke.shouldPrint) {
-    String jokeText = loadCachedJoke();
-
-    if (jokeText.length() > 0) {
-      printDailyJoke(jokeText);
-
-      // Update schedule tracking for scheduled prints
-      if (currentJoke.isScheduled) {
-        String currentDate = getCurrentDate();
-        updateLastPrintDate(currentDate);
-        scheduleState.lastJokePrintDate = currentDate;
-        debugLog("Updated lastJokePrintDate: " + currentDate);
-      }
-    } else {
-      debugLog("ERROR: Failed to load cached joke");
-      printDailyJoke("Error: Cache corrupted or empty");
-    }
-
-    // Reset flags
-    currentJoke.shouldPrint = false;
-    currentJoke.isScheduled = false;
-  }
-
-  // === PHASE 4: RECEIPT PRINTING ===
-  if (currentReceipt.hasData) {
-    printReceipt();
-    currentReceipt.hasData = false; // Reset flag
-  }
+  scheduler.runOnce();
 
-  delay(10); // Small delay to prevent excessive CPU usage
+  // Sleep until the next task is due; WiFi and the web server run meanwhile
+  delay(scheduler.idleMillis(LOOP_IDLE_MAX_MILLIS));
 }
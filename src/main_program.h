@@ -3,21 +3,34 @@
 
 #include <Arduino.h>
 
+class PrintSink;
+struct PrintJob;
+
 // Initialize your main program
 void mainProgramSetup();
 
 // Main program loop
 void mainProgramLoop();
 
+// Before ESP.restart(): saves print progress so jobs resume where they stopped
+void prepareForRestart();
+
 // Thermal printer functions
 void initializePrinter();
-void printReceipt();
-void printDailyJoke();
+void printReceipt(const PrintJob &job);
+void printDailyJoke(String jokeText, const String &headerDate, uint16_t resumeLine = 0);
 void printServerInfo();
 void setInverse(bool enable);
 void printLine(String line);
 void advancePaper(int lines);
 void printWrapped(String text);
+void printLineTo(PrintSink &sink, const String &line);
+void printWrappedTo(PrintSink &sink, const String &text, bool balanced = false);
+void composeDailyJoke(PrintSink &sink, const String &jokeText, const String &headerDate);
+void streamJokeImage();
+void streamReceipt();
+bool printerHasRoomFor(size_t textLength);
+String printerProblem();
 
 // Time utilities
 String getFormattedDateTime();
@@ -28,10 +41,11 @@ String getCurrentTime();
 // Schedule configuration
 bool loadScheduleConfig(String &dailyPrintTime, String &lastJokePrintDate);
 bool saveScheduleConfig(String dailyPrintTime, String lastJokePrintDate);
-bool updateLastPrintDate(String date);
 bool shouldPrintScheduledJoke();
 
-// Debug logging
+// Debug logging. logSerial is the debug console: Serial, or Serial1 when
+// the printer takes over UART0 (PRINTER_PORT_UART0_SWAPPED).
+extern HardwareSerial &logSerial;
 void debugLog(String message);
 
 #endif
@@ -1,4 +1,5 @@
 #include "wifi_setup.h"
+#include "main_program.h"
 #include <CaptivePortal.h>
 #include <LittleFS.h>
 #include <ArduinoJson.h>
@@ -8,6 +9,7 @@
 const char* ap_ssid = "Jester Scribe WiFi-Setup";
 const char* ap_password = "12345678";
 const char* CONFIG_FILE = "/config.json";
+const char* CONFIG_TEMP_FILE = "/config.json.tmp";
 const int wifiConnectionTimeout = 10000;
 
 // Internal state
@@ -18,67 +20,33 @@ String wifiList;
 bool shouldStopAP = false;
 bool wifiConnected = false;
 
-// Saves WiFi credentials to LittleFS as JSON
-bool saveCredentials(String ssid, String password) {
-    JsonDocument doc;
-
-    // Load existing config to preserve schedule fields
-    if (LittleFS.exists(CONFIG_FILE)) {
-        File configFile = LittleFS.open(CONFIG_FILE, "r");
-        if (configFile) {
-            deserializeJson(doc, configFile);
-            configFile.close();
-        }
-    }
-
-    // Update WiFi credentials
-    doc["ssid"] = ssid;
-    doc["password"] = password;
+JsonDocument configDoc;
+LittleFSConfigStorage configStorage(configDoc, CONFIG_FILE, CONFIG_TEMP_FILE);
+ConfigStore configStore(configStorage);
 
-    File configFile = LittleFS.open(CONFIG_FILE, "w");
-    if (!configFile) {
-        Serial.println("Failed to open config file for writing");
-        return false;
-    }
+// Saves WiFi credentials to config.json, right away: the portal closes
+// and the device may restart next
+bool saveCredentials(String ssid, String password) {
+    configDoc["ssid"] = ssid;
+    configDoc["password"] = password;
+    configStore.changed(millis());
 
-    if (serializeJson(doc, configFile) == 0) {
-        Serial.println("Failed to write to config file");
-        configFile.close();
+    if (!configStore.flush(millis())) {
+        Serial.println("Failed to write config file");
         return false;
     }
 
-    configFile.close();
     Serial.println("Credentials saved to config.json");
     return true;
 }
 
-// Loads WiFi credentials from LittleFS
+// Loads WiFi credentials from the config read at start-up
 bool loadCredentials(String &ssid, String &password) {
-    if (!LittleFS.exists(CONFIG_FILE)) {
-        Serial.println("Config file does not exist");
-        return false;
-    }
-
-    File configFile = LittleFS.open(CONFIG_FILE, "r");
-    if (!configFile) {
-        Serial.println("Failed to open config file for reading");
-        return false;
-    }
-
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, configFile);
-    configFile.close();
-
-    if (error) {
-        Serial.println("Failed to parse config file");
-        return false;
-    }
-
-    ssid = doc["ssid"].as<String>();
-    password = doc["password"].as<String>();
+    ssid = configDoc["ssid"] | "";
+    password = configDoc["password"] | "";
 
     if (ssid.length() == 0) {
-        Serial.println("Config file contains empty SSID");
+        Serial.println("Config contains no SSID");
         return false;
     }
 
@@ -97,52 +65,31 @@ void waitForWiFiMode(WiFiMode_t targetMode, unsigned long timeoutMs = 2000) {
 // Verifies internet connectivity by attempting to resolve google.com via DNS
 // Returns true if internet is accessible, false otherwise
 bool verifyInternetConnectivity() {
-    Serial.println("Verifying internet connectivity...");
+    debugLog("Verifying internet connectivity...");
 
     // Attempt to resolve google.com to an IP address
     IPAddress resolvedIP;
     if (WiFi.hostByName("google.com", resolvedIP)) {
-        Serial.print("Internet connectivity verified. google.com resolved to: ");
-        Serial.println(resolvedIP);
+        debugLog("Internet connectivity verified. google.com resolved to: " + resolvedIP.toString());
         return true;
     } else {
-        Serial.println("Internet connectivity check failed: Could not resolve google.com");
+        debugLog("Internet connectivity check failed: Could not resolve google.com");
         return false;
     }
 }
 
-// Clears the saved WiFi credentials from LittleFS while preserving other config fields
+// Clears the saved WiFi credentials while preserving other config fields
 // This forces the device to launch the captive portal on next connection attempt
 void forgetCredentials() {
-    if (LittleFS.exists(CONFIG_FILE)) {
-        // Load existing config to preserve non-WiFi fields (schedule settings, etc.)
-        JsonDocument doc;
-        File configFile = LittleFS.open(CONFIG_FILE, "r");
-        if (configFile) {
-            deserializeJson(doc, configFile);
-            configFile.close();
-        }
-
-        // Clear only WiFi credential fields
-        doc["ssid"] = "";
-        doc["password"] = "";
+    // Clear only WiFi credential fields
+    configDoc["ssid"] = "";
+    configDoc["password"] = "";
+    configStore.changed(millis());
 
-        // Write back to file
-        configFile = LittleFS.open(CONFIG_FILE, "w");
-        if (!configFile) {
-            Serial.println("Warning: Failed to open config file for writing");
-            return;
-        }
-
-        if (serializeJson(doc, configFile) == 0) {
-            Serial.println("Warning: Failed to write updated config file");
-        } else {
-            Serial.println("WiFi credentials cleared (schedule settings preserved)");
-        }
-
-        configFile.close();
+    if (configStore.flush(millis())) {
+        debugLog("WiFi credentials cleared (schedule settings preserved)");
     } else {
-        Serial.println("No credentials file to update");
+        debugLog("Warning: Failed to write updated config file");
     }
 }
 
@@ -270,6 +217,12 @@ void apSetup(CaptivePortal &portal) {
 
 void wifiSetupInit() {
     // WiFi setup initialization - filesystem is managed by main.cpp
+    // The config is read once here; everything after works on the copy in RAM
+    if (configStore.load()) {
+        Serial.println("Config loaded from config.json");
+    } else {
+        Serial.println("No usable config file, using defaults");
+    }
     Serial.println("WiFi setup subsystem initialized");
 }
 
@@ -2,6 +2,14 @@
 #define WIFI_SETUP_H
 
 #include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config_store.h"
+
+// Settings from config.json, read once by wifiSetupInit() and kept in RAM
+// for the main program too. Change configDoc, then call
+// configStore.changed(), or flush() for what must be on flash right away.
+extern JsonDocument configDoc;
+extern ConfigStore configStore;
 
 // Initialize WiFi setup system
 void wifiSetupInit();
@@ -13,6 +21,9 @@ bool wifiSetupConnect();
 // Check if WiFi is currently connected
 bool isWifiConnected();
 
+// Clear the saved WiFi credentials (written at once), keeping the other settings
+void forgetCredentials();
+
 // Verify internet connectivity by attempting to resolve google.com via DNS
 bool verifyInternetConnectivity();
 
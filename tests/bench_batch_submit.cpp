@@ -0,0 +1,306 @@
+// Host load test of receipt intake: one /submit per receipt against
+// /api/batch with PRINT_JOB_SLOTS receipts per request. A minimal HTTP
+// server on loopback runs the same parser and queue calls as the
+// firmware's handlers (form decoding stands in for ESPAsyncWebServer's),
+// and a client sends receipts as fast as they are answered, a new TCP
+// connection per request like the integration scripts. The queue is
+// drained after every request, so the figures are sustained intake, not a
+// burst into empty slots.
+//
+// Absolute numbers are the host's. What carries over to the ESP8266 is the
+// ratio: per request the device pays a connection, a request object on the
+// heap and a response, and a batch pays it once for several receipts.
+//
+// Build & run from the repository root:
+//   g++ -std=c++17 -O2 -pthread -Ilib/print_engine -Ilib/text_pipeline tests/bench_batch_submit.cpp lib/print_engine/print_job_queue.cpp lib/text_pipeline/receipt_batch.cpp lib/text_pipeline/html_entities.cpp -o bench_batch_submit
+//   ./bench_batch_submit [receipts]
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "print_job_queue.h"
+#include "receipt_batch.h"
+
+using namespace std;
+
+static const size_t SEGMENT = 536;  // Body bytes per callback, one TCP segment on the device
+
+static const char *ITEMS[] = {
+  "2x Milch 1,19 EUR", "Brot vom Bäcker", "Eier (10 Stück)", "Kaffee 500g",
+  "Äpfel, Birnen", "Zahnpasta", "Spülmittel", "Käse am Stück"
+};
+
+// === Server side ===
+struct Server {
+  int listener;
+  PrintJobQueue queue;
+  uint32_t ticket = 0;
+  vector<uint32_t> held;
+  size_t received = 0;
+};
+
+static bool holdItem(const char *message, size_t length, const char *date, void *context) {
+  Server *server = static_cast<Server *>(context);
+  uint32_t id = server->queue.hold(PRINT_PRIORITY_NORMAL, message, length, date);
+  if (id == 0) {
+    return false;
+  }
+  server->held.push_back(id);
+  return true;
+}
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return 0;
+}
+
+// One parameter of a form body, decoded
+static string formParam(const string &body, const string &name) {
+  size_t start = 0;
+  while (start < body.size()) {
+    size_t end = body.find('&', start);
+    if (end == string::npos) end = body.size();
+    if (body.compare(start, name.size() + 1, name + "=") == 0) {
+      string value;
+      for (size_t i = start + name.size() + 1; i < end; i++) {
+        if (body[i] == '+') {
+          value += ' ';
+        } else if (body[i] == '%' && i + 2 < end) {
+          value += (char)(hexValue(body[i + 1]) * 16 + hexValue(body[i + 2]));
+          i += 2;
+        } else {
+          value += body[i];
+        }
+      }
+      return value;
+    }
+    start = end + 1;
+  }
+  return "";
+}
+
+static bool readUntil(int fd, string &buffer, const char *marker) {
+  char chunk[SEGMENT];
+  while (buffer.find(marker) == string::npos) {
+    ssize_t got = read(fd, chunk, sizeof(chunk));
+    if (got <= 0) return false;
+    buffer.append(chunk, got);
+  }
+  return true;
+}
+
+static void sendAll(int fd, const string &data) {
+  size_t sent = 0;
+  while (sent < data.size()) {
+    ssize_t n = write(fd, data.data() + sent, data.size() - sent);
+    if (n <= 0) return;
+    sent += n;
+  }
+}
+
+static void handleConnection(Server &server, ReceiptBatchParser &parser, int fd) {
+  string buffer;
+  if (!readUntil(fd, buffer, "\r\n\r\n")) return;
+  size_t headerEnd = buffer.find("\r\n\r\n") + 4;
+  size_t lengthAt = buffer.find("Content-Length: ");
+  size_t contentLength = lengthAt < headerEnd ? strtoul(buffer.c_str() + lengthAt + 16, nullptr, 10) : 0;
+  bool batch = buffer.compare(0, 15, "POST /api/batch") == 0;
+  string body = buffer.substr(headerEnd);
+
+  string reply;
+  if (batch) {
+    // Fed in segments as they come, like the body callback
+    server.held.clear();
+    parser.reset();
+    size_t fed = 0;
+    char chunk[SEGMENT];
+    while (true) {
+      if (fed < body.size()) {
+        size_t length = min(body.size() - fed, SEGMENT);
+        parser.write(body.data() + fed, length);
+        fed += length;
+      } else if (fed < contentLength) {
+        ssize_t got = read(fd, chunk, min(sizeof(chunk), contentLength - fed));
+        if (got <= 0) break;
+        parser.write(chunk, got);
+        fed += got;
+      } else {
+        break;
+      }
+    }
+    bool ok = parser.finish() == BATCH_OK;
+    reply = "{\"jobs\":[";
+    for (size_t i = 0; i < server.held.size(); i++) {
+      if (ok) {
+        server.queue.commit(server.held[i]);
+        reply += (i > 0 ? "," : "") + to_string(server.held[i]);
+      } else {
+        server.queue.cancel(server.held[i]);
+      }
+    }
+    reply += "]}";
+    if (ok) server.received += server.held.size();
+  } else {
+    while (body.size() < contentLength) {
+      char chunk[SEGMENT];
+      ssize_t got = read(fd, chunk, sizeof(chunk));
+      if (got <= 0) break;
+      body.append(chunk, got);
+    }
+    string message = formParam(body, "message");
+    string date = formParam(body, "date");
+    uint32_t id = server.queue.add(PRINT_JOB_RECEIPT, PRINT_PRIORITY_NORMAL, message.data(), message.size(),
+                                   date.empty() ? nullptr : date.c_str());
+    reply = "Receipt #" + to_string(id) + " received and will be printed!";
+    if (id != 0) server.received++;
+  }
+
+  sendAll(fd, "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: " + to_string(reply.size()) +
+              "\r\nConnection: close\r\n\r\n" + reply);
+
+  // The printer takes everything at once
+  while (PrintJob *job = server.queue.next()) {
+    server.queue.start(*job, ++server.ticket);
+  }
+  server.queue.update(server.ticket);
+}
+
+static void serve(Server *server) {
+  ReceiptBatchParser parser(holdItem, server);
+  while (true) {
+    int fd = accept(server->listener, nullptr, nullptr);
+    if (fd < 0) return;
+    handleConnection(*server, parser, fd);
+    close(fd);
+  }
+}
+
+// === Client side ===
+static string urlEncode(const string &text) {
+  static const char *hex = "0123456789ABCDEF";
+  string out;
+  for (unsigned char c : text) {
+    if (isalnum(c) || c == '-' || c == '.' || c == '_' || c == '~') {
+      out += c;
+    } else if (c == ' ') {
+      out += '+';
+    } else {
+      out += '%';
+      out += hex[c >> 4];
+      out += hex[c & 15];
+    }
+  }
+  return out;
+}
+
+static string request(const string &path, const string &type, const string &body) {
+  return "POST " + path + " HTTP/1.1\r\nHost: scribe.local\r\nUser-Agent: curl/8.5.0\r\nAccept: */*\r\n"
+         "Content-Type: " + type + "\r\nContent-Length: " + to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+static size_t post(uint16_t port, const string &data) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (connect(fd, (sockaddr *)&address, sizeof(address)) != 0) {
+    close(fd);
+    return 0;
+  }
+  sendAll(fd, data);
+  char reply[512];
+  size_t total = 0;
+  ssize_t got;
+  while ((got = read(fd, reply, sizeof(reply))) > 0) {
+    total += got;
+  }
+  close(fd);
+  return total;
+}
+
+struct Result {
+  double seconds;
+  size_t requests;
+  size_t bytesSent;
+  size_t bytesReceived;
+};
+
+static Result run(uint16_t port, size_t receipts, size_t perRequest) {
+  Result result = {0, 0, 0, 0};
+  auto start = chrono::steady_clock::now();
+  for (size_t sent = 0; sent < receipts; sent += perRequest) {
+    string data;
+    if (perRequest == 1) {
+      data = request("/submit", "application/x-www-form-urlencoded",
+                     "message=" + urlEncode(ITEMS[sent % 8]) + "&date=2025-07-04");
+    } else {
+      string body = "[";
+      for (size_t i = 0; i < perRequest && sent + i < receipts; i++) {
+        body += string(i > 0 ? ",\n" : "") + "{\"message\":\"" + ITEMS[(sent + i) % 8] + "\",\"date\":\"2025-07-04\"}";
+      }
+      body += "]";
+      data = request("/api/batch", "application/json", body);
+    }
+    result.bytesSent += data.size();
+    result.bytesReceived += post(port, data);
+    result.requests++;
+  }
+  result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  return result;
+}
+
+int main(int argc, char **argv) {
+  size_t receipts = argc > 1 ? strtoul(argv[1], nullptr, 10) : 20000;
+
+  Server server;
+  server.listener = socket(AF_INET, SOCK_STREAM, 0);
+  int reuse = 1;
+  setsockopt(server.listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t length = sizeof(address);
+  if (bind(server.listener, (sockaddr *)&address, sizeof(address)) != 0 || listen(server.listener, 64) != 0 ||
+      getsockname(server.listener, (sockaddr *)&address, &length) != 0) {
+    cout << "Cannot listen on loopback" << endl;
+    return 1;
+  }
+  uint16_t port = ntohs(address.sin_port);
+  thread(serve, &server).detach();
+
+  cout << receipts << " receipts over loopback, a connection per request" << endl;
+  cout << left << setw(24) << "mode" << right << setw(10) << "requests" << setw(14) << "receipts/s"
+       << setw(14) << "bytes/receipt" << endl;
+
+  double singleRate = 0;
+  for (size_t perRequest : {(size_t)1, (size_t)PRINT_JOB_SLOTS}) {
+    server.received = 0;
+    Result result = run(port, receipts, perRequest);
+    double rate = server.received / result.seconds;
+    if (perRequest == 1) singleRate = rate;
+    string mode = perRequest == 1 ? "/submit" : "/api/batch x" + to_string(perRequest);
+    cout << left << setw(24) << mode << right << setw(10) << result.requests << setw(14) << fixed
+         << setprecision(0) << rate << setw(14) << (result.bytesSent + result.bytesReceived) / receipts;
+    if (perRequest > 1) {
+      cout << "   " << setprecision(1) << rate / singleRate << "x";
+    }
+    cout << endl;
+    if (server.received != receipts) {
+      cout << "  only " << server.received << " receipts were queued" << endl;
+      return 1;
+    }
+  }
+  return 0;
+}
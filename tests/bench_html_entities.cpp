@@ -0,0 +1,172 @@
+// Host benchmark: single-pass entity decoder vs. the old replace() chain.
+//
+// The old firmware decoded entities with twelve String::replace() passes.
+// replaceChain() below reproduces Arduino's in-place replace algorithm so
+// the comparison is fair, then both are run over multi-KB joke pages.
+//
+// Build & run from the repository root:
+//   g++ -std=c++17 -O2 -Ilib/text_pipeline tests/bench_html_entities.cpp lib/text_pipeline/html_entities.cpp -o bench_html_entities
+//   ./bench_html_entities
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include "html_entities.h"
+
+using namespace std;
+
+// Arduino String::replace() for a shorter replacement: one strstr() walk
+// with memmove() compaction per call
+static size_t arduinoReplace(char *buffer, size_t length, const char *find, const char *replace) {
+  size_t findLength = strlen(find);
+  size_t replaceLength = strlen(replace);
+  char *writeTo = buffer;
+  char *readFrom = buffer;
+  char *foundAt;
+  while ((foundAt = strstr(readFrom, find)) != NULL) {
+    size_t n = foundAt - readFrom;
+    memmove(writeTo, readFrom, n);
+    writeTo += n;
+    memcpy(writeTo, replace, replaceLength);
+    writeTo += replaceLength;
+    readFrom = foundAt + findLength;
+    length -= findLength - replaceLength;
+  }
+  memmove(writeTo, readFrom, strlen(readFrom) + 1);
+  return length;
+}
+
+static size_t replaceChain(char *text, size_t length) {
+  static const char *entities[][2] = {
+    {"&quot;", "\""}, {"&amp;", "&"}, {"&lt;", "<"}, {"&gt;", ">"},
+    {"&ouml;", "\xC3\xB6"}, {"&auml;", "\xC3\xA4"}, {"&uuml;", "\xC3\xBC"},
+    {"&Ouml;", "\xC3\x96"}, {"&Auml;", "\xC3\x84"}, {"&Uuml;", "\xC3\x9C"},
+    {"&szlig;", "\xC3\x9F"}, {"&nbsp;", "\xC2\xA0"}
+  };
+  for (auto &entity : entities) {
+    length = arduinoReplace(text, length, entity[0], entity[1]);
+  }
+  return length;
+}
+
+// The joke from tests/html_trimming.txt, as it appears in the page
+static const char *JOKE =
+  "Ein Blinder sitzt am Tresen in einer Bar und sagt zum Barkeeper: &quot;Hey, willst du "
+  "einen Blondinenwitz h&ouml;ren?&quot;  In der Bar wird es pl&ouml;tzlich totenstill. "
+  "Da sagt der Typ neben dem Blinden mit ruhiger Stimme: &quot;Es gibt etwas, das du wissen "
+  "solltest, bevor du deinen Witz erz&auml;hlst! Der Barkeeper ist blond, der Rausschmei&szlig;er "
+  "ist blond und ich bin 1,80 gro&szlig;, 100kg schwer, blond und habe den schwarzen "
+  "G&uuml;rtel in Karate. Au&szlig;erdem ist der Typ neben mir 1,90 gro&szlig;, 120 kg schwer "
+  "und ein blonder Gewichtheber. Der Typ zu deiner Rechten ist blond und zwei Meter gro&szlig;, "
+  "150 kg schwer und Wrestler. Jetzt denk noch mal ernsthaft dar&uuml;ber nach, ob du immer "
+  "noch deinen Witz erz&auml;hlen willst.&quot; - &quot;N&ouml;&ouml;, keine Lust ihn "
+  "f&uuml;nf Mal zu erkl&auml;ren!&quot;<br />\n";
+
+static string buildInput(size_t size) {
+  string input;
+  while (input.length() < size) input += JOKE;
+  return input;
+}
+
+static int failures = 0;
+
+static void check(bool condition, const string &name) {
+  if (!condition) {
+    cout << "FAIL: " << name << endl;
+    failures++;
+  }
+}
+
+static string decode(const string &input) {
+  vector<char> buffer(input.begin(), input.end());
+  buffer.push_back('\0');
+  size_t length = decodeHTMLEntities(buffer.data(), input.length());
+  return string(buffer.data(), length);
+}
+
+// Spot checks before timing anything
+static void checkDecoder() {
+  check(decode("&#228;&#xE4;&#XE4;") == "\xC3\xA4\xC3\xA4\xC3\xA4", "numeric references");
+  check(decode("&eacute;&hellip;&ndash;&euro;") == "\xC3\xA9\xE2\x80\xA6\xE2\x80\x93\xE2\x82\xAC",
+        "named references");
+  check(decode("&#150;&#x80;") == "\xE2\x80\x93\xE2\x82\xAC", "Windows-1252 numeric references");
+  check(decode("&#0;&#xD800;&#x110000;") == "\xEF\xBF\xBD\xEF\xBF\xBD\xEF\xBF\xBD",
+        "invalid code points");
+  check(decode("&#x1F600;") == "\xF0\x9F\x98\x80", "astral code point");
+  check(decode("&unknown; &amp &#xZZ; &; &#; AT&T") == "&unknown; &amp &#xZZ; &; &#; AT&T",
+        "unknown references stay verbatim");
+  check(decode("&&amp;&lt&gt;") == "&&&lt>", "adjacent ampersands");
+  check(decode("&amp;lt;") == "&lt;", "single decoding pass");
+
+  string page = buildInput(4096);
+  vector<char> chain(page.begin(), page.end());
+  chain.push_back('\0');
+  size_t chainLength = replaceChain(chain.data(), page.length());
+  check(decode(page) == string(chain.data(), chainLength), "matches replace chain on joke page");
+}
+
+// Best of several runs, so a noisy host doesn't decide the result
+template <typename Decoder>
+static double nsPerByte(const string &input, Decoder decoder) {
+  vector<char> buffer(input.length() + 1);
+  size_t iterations = max<size_t>(20, (size_t)(2 * 1024 * 1024 / input.length()));
+  double best = 1e30;
+  size_t sink = 0;
+
+  for (int run = 0; run < 7; run++) {
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+      memcpy(buffer.data(), input.c_str(), input.length() + 1);
+      sink += decoder(buffer.data(), input.length());
+    }
+    auto end = chrono::steady_clock::now();
+
+    // Subtract the copy so only decoding is measured
+    auto copyStart = chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+      memcpy(buffer.data(), input.c_str(), input.length() + 1);
+      sink += (size_t)buffer[i % input.length()];
+    }
+    auto copyEnd = chrono::steady_clock::now();
+
+    double total = chrono::duration<double, nano>(end - start).count() -
+                   chrono::duration<double, nano>(copyEnd - copyStart).count();
+    best = min(best, total / ((double)iterations * input.length()));
+  }
+
+  if (sink == 0) cout << "";
+  return best;
+}
+
+int main() {
+  checkDecoder();
+  if (failures > 0) {
+    cout << failures << " decoder check(s) failed" << endl;
+    return 1;
+  }
+
+  cout << "input      replace-chain   single-pass   speedup" << endl;
+  const size_t sizes[] = {1024, 4096, 16384, 65536};
+  bool faster = true;
+  for (size_t size : sizes) {
+    string input = buildInput(size);
+    double chain = nsPerByte(input, replaceChain);
+    double single = nsPerByte(input, decodeHTMLEntities);
+    cout << setw(6) << input.length() << " B  "
+         << fixed << setprecision(2)
+         << setw(10) << chain << " ns/B  "
+         << setw(8) << single << " ns/B  "
+         << setw(6) << chain / single << "x" << endl;
+    if (size >= 4096 && single >= chain) faster = false;
+  }
+
+  if (!faster) {
+    cout << "FAIL: single-pass decoder is not faster on multi-KB input" << endl;
+    return 1;
+  }
+  cout << "Single-pass decoder beats the replace chain" << endl;
+  return 0;
+}
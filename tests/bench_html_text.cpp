@@ -0,0 +1,193 @@
+// Host benchmark: fused HTML-to-text pass on worst-case input.
+//
+// The old firmware stripped tags with three substring() copies per '<' and
+// then ran `while (indexOf("  ") != -1) replace("  ", " ")`, which needs
+// another full pass for every halving of the longest space run. The input
+// here is nothing but spaces and tags, so that loop runs as long as it can.
+//
+// The fused cleaner must stay linear: ns/byte may not grow with input size,
+// and it must not allocate at all.
+//
+// Build & run from the repository root:
+//   g++ -std=c++17 -O2 -Ilib/text_pipeline tests/bench_html_text.cpp lib/text_pipeline/html_text.cpp lib/text_pipeline/html_entities.cpp -o bench_html_text
+//   ./bench_html_text
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <new>
+#include "html_text.h"
+
+using namespace std;
+
+// Count every heap allocation made by the process
+static size_t allocations = 0;
+
+void *operator new(size_t size) {
+  allocations++;
+  void *p = malloc(size ? size : 1);
+  if (p == nullptr) throw bad_alloc();
+  return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+// Arduino String::replace() for a shorter replacement: one strstr() walk
+// with memmove() compaction per call
+static size_t arduinoReplace(char *buffer, size_t length, const char *find, const char *replace) {
+  size_t findLength = strlen(find);
+  size_t replaceLength = strlen(replace);
+  char *writeTo = buffer;
+  char *readFrom = buffer;
+  char *foundAt;
+  while ((foundAt = strstr(readFrom, find)) != NULL) {
+    size_t n = foundAt - readFrom;
+    memmove(writeTo, readFrom, n);
+    writeTo += n;
+    memcpy(writeTo, replace, replaceLength);
+    writeTo += replaceLength;
+    readFrom = foundAt + findLength;
+    length -= findLength - replaceLength;
+  }
+  memmove(writeTo, readFrom, strlen(readFrom) + 1);
+  return length;
+}
+
+// stripHTMLTags() + trim() + the double-space loop, as the firmware had them
+static size_t legacyClean(const string &html, string &result) {
+  result.clear();
+  bool inTag = false;
+  for (size_t i = 0; i < html.length(); i++) {
+    char c = html[i];
+    if (c == '<') {
+      inTag = true;
+      if (i + 4 <= html.length() && html.substr(i, 4) == "<br>") result += " ";
+      if (i + 5 <= html.length() && html.substr(i, 5) == "<br/>") result += " ";
+      if (i + 6 <= html.length() && html.substr(i, 6) == "<br />") result += " ";
+    } else if (c == '>') {
+      inTag = false;
+    } else if (!inTag) {
+      result += c;
+    }
+  }
+
+  size_t first = result.find_first_not_of(" \t\n\r");
+  size_t last = result.find_last_not_of(" \t\n\r");
+  result = first == string::npos ? string() : result.substr(first, last - first + 1);
+
+  vector<char> buffer(result.begin(), result.end());
+  buffer.push_back('\0');
+  size_t length = result.length();
+  while (strstr(buffer.data(), "  ") != NULL) {
+    length = arduinoReplace(buffer.data(), length, "  ", " ");
+  }
+  return length;
+}
+
+// Words separated by long runs of spaces and tags, including breaks that the
+// old pipeline turned into yet more spaces
+static string buildInput(size_t size) {
+  static const char *PATTERN[] = {
+    "<b>", "<br />", "<i class=\"x\">", "</i>", "<p>", "</p>", "<br>", "<span>", "</span>"
+  };
+  string input = "Anfang";
+  size_t n = 0;
+  while (input.length() < size - 4) {
+    input.append(1 + (n * 7) % 61, ' ');
+    input += PATTERN[n % 9];
+    n++;
+  }
+  input += "Ende";
+  return input;
+}
+
+static int failures = 0;
+
+static void check(bool condition, const string &name) {
+  if (!condition) {
+    cout << "FAIL: " << name << endl;
+    failures++;
+  }
+}
+
+// Best of several runs, so a noisy host doesn't decide the result
+template <typename Cleaner>
+static double nsPerByte(const string &input, Cleaner clean) {
+  size_t iterations = max<size_t>(5, (size_t)(4 * 1024 * 1024 / input.length()));
+  double best = 1e30;
+  size_t sink = 0;
+
+  for (int run = 0; run < 7; run++) {
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+      sink += clean(input);
+    }
+    auto end = chrono::steady_clock::now();
+    double total = chrono::duration<double, nano>(end - start).count();
+    best = min(best, total / ((double)iterations * input.length()));
+  }
+
+  if (sink == 0) cout << "";
+  return best;
+}
+
+int main() {
+  const size_t sizes[] = {10 * 1024, 20 * 1024, 40 * 1024, 80 * 1024};
+  const size_t largest = sizes[3];
+
+  vector<char> output(largest + 1);
+  string legacyOutput;
+  legacyOutput.reserve(largest);
+
+  auto fused = [&](const string &html) {
+    return cleanHTMLText(html.data(), html.length(), output.data(), output.size());
+  };
+  auto legacy = [&](const string &html) {
+    return legacyClean(html, legacyOutput);
+  };
+
+  // Sanity check and allocation count on the 10KB case
+  string input = buildInput(sizes[0]);
+  size_t before = allocations;
+  size_t length = fused(input);
+  size_t fusedAllocations = allocations - before;
+  check(string(output.data(), length) == "Anfang\n\nEnde", "worst case collapses to two words");
+  check(fusedAllocations == 0, "fused pass allocates nothing");
+
+  before = allocations;
+  legacy(input);
+  size_t legacyAllocations = allocations - before;
+
+  cout << "allocations on " << input.length() << " B: legacy " << legacyAllocations
+       << ", fused " << fusedAllocations << endl << endl;
+
+  cout << "input      legacy         fused" << endl;
+  double first = 0;
+  double worst = 0;
+  for (size_t size : sizes) {
+    input = buildInput(size);
+    double old = nsPerByte(input, legacy);
+    double now = nsPerByte(input, fused);
+    cout << setw(6) << input.length() << " B  "
+         << fixed << setprecision(2)
+         << setw(8) << old << " ns/B  "
+         << setw(6) << now << " ns/B" << endl;
+    if (first == 0) first = now;
+    worst = max(worst, now);
+  }
+
+  // Linear time: per-byte cost stays flat while the input grows 8x
+  check(worst < first * 1.5, "fused pass is O(n)");
+
+  if (failures > 0) {
+    cout << failures << " check(s) failed" << endl;
+    return 1;
+  }
+  cout << "Fused pass is linear and allocation-free" << endl;
+  return 0;
+}
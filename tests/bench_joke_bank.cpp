@@ -0,0 +1,188 @@
+// Host build tool and benchmark for the offline joke bank (joke_bank.h).
+//
+// Reads the corpus (jokes separated by blank lines), builds the bank with
+// a range of window sizes, length fields and jokes per block, and reports
+// for each: bank size against the plain text, decode time per joke
+// (average and worst, best of several runs), the bytes decoded to reach a
+// joke, and the RAM a read takes: the decoder on the stack plus heap
+// allocations, which must be none. Every joke is checked against the
+// corpus. The bank with the default options is then written out for the
+// LittleFS image.
+//
+// Build & run from the repository root:
+//   g++ -std=c++17 -O2 -Ilib/byte_io -Ilib/joke_source tests/bench_joke_bank.cpp lib/joke_source/joke_bank.cpp -o bench_joke_bank
+//   ./bench_joke_bank [assets/jokes.txt] [data/jokes.bin]
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#include "joke_bank.h"
+
+using namespace std;
+
+// === Heap accounting ===
+static size_t allocationCount = 0;
+
+void *operator new(size_t size) {
+  void *block = malloc(size);
+  if (block == nullptr) throw bad_alloc();
+  allocationCount++;
+  return block;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+// === Corpus ===
+static vector<string> readCorpus(const char *path) {
+  ifstream file(path);
+  vector<string> jokes;
+  string line;
+  string joke;
+  while (getline(file, line)) {
+    if (line.find_first_not_of(" \t\r") == string::npos) {
+      if (!joke.empty()) jokes.push_back(joke);
+      joke.clear();
+      continue;
+    }
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    joke += (joke.empty() ? "" : " ") + line;
+  }
+  if (!joke.empty()) jokes.push_back(joke);
+  return jokes;
+}
+
+class MemoryBankStorage : public BankStorage {
+public:
+  explicit MemoryBankStorage(const vector<uint8_t> &data) : data(data) {}
+
+  size_t size() override { return data.size(); }
+
+  size_t read(size_t offset, uint8_t *out, size_t length) override {
+    if (offset >= data.size()) return 0;
+    size_t got = min(length, data.size() - offset);
+    memcpy(out, data.data() + offset, got);
+    return got;
+  }
+
+private:
+  const vector<uint8_t> &data;
+};
+
+static void collect(const char *data, size_t length, void *context) {
+  static_cast<string *>(context)->append(data, length);
+}
+
+static vector<uint8_t> build(const vector<string> &jokes, const BankOptions &options) {
+  vector<const char *> texts;
+  size_t plain = 0;
+  for (const string &joke : jokes) {
+    texts.push_back(joke.c_str());
+    plain += joke.size() + 1;
+  }
+  vector<uint8_t> bank(BANK_HEADER_SIZE + 4 * (jokes.size() + 1) + plain * 2);
+  bank.resize(buildJokeBank(texts.data(), texts.size(), options, bank.data(), bank.size()));
+  return bank;
+}
+
+struct BankResult {
+  size_t size;
+  double averageMicros;
+  double worstMicros;
+  size_t worstDecoded;   // Bytes decoded for the joke furthest into its block
+  size_t allocations;
+  bool correct;
+};
+
+static BankResult measure(const vector<string> &jokes, const BankOptions &options) {
+  BankResult result = {0, 0, 0, 0, 0, true};
+  vector<uint8_t> bank = build(jokes, options);
+  result.size = bank.size();
+  MemoryBankStorage storage(bank);
+  JokeBank reader(storage);
+  if (bank.empty() || !reader.open() || reader.count() != jokes.size()) {
+    result.correct = false;
+    return result;
+  }
+
+  string text;
+  text.reserve(4096);
+  double total = 0;
+  size_t decoded = 0;
+  for (uint16_t i = 0; i < reader.count(); i++) {
+    decoded = i % options.jokesPerBlock == 0 ? 0 : decoded;
+    decoded += jokes[i].size() + 1;
+    result.worstDecoded = max(result.worstDecoded, decoded);
+
+    size_t before = allocationCount;
+    text.clear();
+    result.correct = reader.read(i, collect, &text) && text == jokes[i] && result.correct;
+    result.allocations += allocationCount - before;
+
+    double best = 1e30;
+    for (int run = 0; run < 20; run++) {
+      text.clear();
+      auto start = chrono::steady_clock::now();
+      reader.read(i, collect, &text);
+      auto end = chrono::steady_clock::now();
+      best = min(best, chrono::duration<double, micro>(end - start).count());
+    }
+    total += best;
+    result.worstMicros = max(result.worstMicros, best);
+  }
+  result.averageMicros = total / jokes.size();
+  return result;
+}
+
+int main(int argc, char **argv) {
+  const char *corpusPath = argc > 1 ? argv[1] : "assets/jokes.txt";
+  const char *bankPath = argc > 2 ? argv[2] : "data/jokes.bin";
+  vector<string> jokes = readCorpus(corpusPath);
+  if (jokes.empty()) {
+    cout << "No jokes in " << corpusPath << endl;
+    return 1;
+  }
+  size_t plain = 0;
+  for (const string &joke : jokes) plain += joke.size() + 1;
+  cout << jokes.size() << " jokes, " << plain << " bytes of text" << endl;
+  cout << "Decoder on the stack: " << JokeBank::decoderSize() << " bytes" << endl << endl;
+
+  cout << left << setw(8) << "window" << setw(8) << "length" << setw(8) << "block" << right << setw(8)
+       << "bytes" << setw(8) << "ratio" << setw(10) << "avg us" << setw(10) << "max us" << setw(10)
+       << "decoded" << setw(8) << "allocs" << endl;
+  bool ok = true;
+  for (uint8_t windowBits : {7, 8, 9}) {
+    for (uint8_t lengthBits : {4, 5}) {
+      for (uint8_t perBlock : {4, 8, 16}) {
+        BankOptions options = {windowBits, lengthBits, perBlock};
+        BankResult result = measure(jokes, options);
+        cout << left << setw(8) << (1 << windowBits) << setw(8) << (int)lengthBits << setw(8) << (int)perBlock
+             << right << setw(8) << result.size << setw(7) << fixed << setprecision(0)
+             << 100.0 * result.size / plain << "%" << setw(10) << setprecision(1) << result.averageMicros
+             << setw(10) << result.worstMicros << setw(10) << result.worstDecoded << setw(8)
+             << result.allocations << (result.correct ? "" : "  MISMATCH") << endl;
+        ok = ok && result.correct && result.allocations == 0;
+      }
+    }
+  }
+
+  vector<uint8_t> bank = build(jokes, BANK_DEFAULT_OPTIONS);
+  ofstream out(bankPath, ios::binary);
+  out.write((const char *)bank.data(), bank.size());
+  out.close();
+  cout << endl << "Wrote " << bankPath << " (" << bank.size() << " bytes, window "
+       << (1 << BANK_DEFAULT_OPTIONS.windowBits) << ", " << (int)BANK_DEFAULT_OPTIONS.jokesPerBlock
+       << " jokes per block)" << endl;
+
+  if (!ok || !out) {
+    cout << "Joke bank benchmark failed" << endl;
+    return 1;
+  }
+  return 0;
+}
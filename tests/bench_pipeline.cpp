@@ -0,0 +1,200 @@
+// Host benchmark suite for the receipt text pipeline (lib/text_pipeline).
+//
+// Each stage runs on the same inputs the firmware sees: a joke page streamed
+// in 128-byte chunks, the joke fragment and the cleaned text. For every stage
+// it reports time per input byte (best of several runs), heap allocations
+// per joke and peak heap above the starting point. The pipeline is meant to
+// run without touching the heap, so any allocation fails the run.
+//
+// Build & run from the repository root:
+//   g++ -std=c++17 -O2 -Ilib/text_pipeline -Ilib/joke_source tests/bench_pipeline.cpp lib/text_pipeline/*.cpp lib/joke_source/source_extractor.cpp lib/joke_source/source_registry.cpp -o bench_pipeline
+//   ./bench_pipeline
+// or through PlatformIO:
+//   pio run -e native && .pio/build/native/program
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <new>
+#include "source_extractor.h"
+#include "source_registry.h"
+#include "html_entities.h"
+#include "html_text.h"
+#include "text_wrap.h"
+#include "date_format.h"
+
+using namespace std;
+
+// === Heap accounting ===
+// Every block carries its size so frees can be subtracted from the total
+static size_t allocationCount = 0;
+static size_t heapInUse = 0;
+static size_t heapPeak = 0;
+
+static const size_t HEADER = alignof(max_align_t);
+
+void *operator new(size_t size) {
+  char *block = (char *)malloc(size + HEADER);
+  if (block == nullptr) throw bad_alloc();
+  *(size_t *)block = size;
+  allocationCount++;
+  heapInUse += size;
+  if (heapInUse > heapPeak) heapPeak = heapInUse;
+  return block + HEADER;
+}
+
+void operator delete(void *p) noexcept {
+  if (p == nullptr) return;
+  char *block = (char *)p - HEADER;
+  heapInUse -= *(size_t *)block;
+  free(block);
+}
+
+void operator delete(void *p, size_t) noexcept { operator delete(p); }
+
+// === Inputs ===
+static const char *JOKE_HTML =
+  "<div id=\"witzdestages\">Ein Blinder sitzt am Tresen in einer Bar und sagt zum Barkeeper: "
+  "&quot;Hey, willst du einen Blondinenwitz h&ouml;ren?&quot;  In der Bar wird es pl&ouml;tzlich "
+  "totenstill. Da sagt der Typ neben dem Blinden mit ruhiger Stimme: &quot;Es gibt etwas, das du "
+  "wissen solltest, bevor du deinen Witz erz&auml;hlst! Der Barkeeper ist blond, der "
+  "Rausschmei&szlig;er ist blond und ich bin 1,80 gro&szlig;, 100kg schwer, blond und habe den "
+  "schwarzen G&uuml;rtel in Karate. Au&szlig;erdem ist der Typ neben mir 1,90 gro&szlig;, 120 kg "
+  "schwer und ein blonder Gewichtheber. Der Typ zu deiner Rechten ist blond und zwei Meter "
+  "gro&szlig;, 150 kg schwer und Wrestler. Jetzt denk noch mal ernsthaft dar&uuml;ber nach, ob "
+  "du immer noch deinen Witz erz&auml;hlen willst.&quot; - &quot;N&ouml;&ouml;, keine Lust ihn "
+  "f&uuml;nf Mal zu erkl&auml;ren!&quot;<br />\n"
+  "<span id=\"witzdestageslink\"><a href=\"https://www.hahaha.de\">hahaha.de</a></span></div>";
+
+// Navigation and markup in front of the joke, roughly the size of the real page
+static string buildPage() {
+  string page = "<!DOCTYPE html><html><head><title>Witz des Tages</title></head><body>\n";
+  while (page.length() < 16 * 1024) {
+    page += "<div class=\"nav\"><ul><li><a href=\"/witze/kategorie\">Kategorie &amp; mehr</a></li>"
+            "<li><a href=\"/witze/neu\">Neue Witze</a></li></ul></div>\n";
+  }
+  page += JOKE_HTML;
+  page += "\n<div id=\"footer\">&copy; hahaha.de</div></body></html>\n";
+  return page;
+}
+
+// === Runner ===
+struct StageResult {
+  double nsPerByte;
+  size_t allocations;
+  size_t peakHeap;
+};
+
+static size_t sink = 0;
+
+template <typename Stage>
+static StageResult runStage(size_t bytes, Stage stage) {
+  StageResult result;
+
+  // One cold run for the heap figures
+  size_t countBefore = allocationCount;
+  size_t inUseBefore = heapInUse;
+  heapPeak = heapInUse;
+  sink += stage();
+  result.allocations = allocationCount - countBefore;
+  result.peakHeap = heapPeak - inUseBefore;
+
+  // Timing: best of several batches of about 8MB of input each
+  size_t iterations = max<size_t>(10, (size_t)(8 * 1024 * 1024 / bytes));
+  double best = 1e30;
+  for (int run = 0; run < 7; run++) {
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+      sink += stage();
+    }
+    auto end = chrono::steady_clock::now();
+    double total = chrono::duration<double, nano>(end - start).count();
+    best = min(best, total / ((double)iterations * bytes));
+  }
+  result.nsPerByte = best;
+  return result;
+}
+
+static int failures = 0;
+
+static void report(const char *name, size_t bytes, const StageResult &result) {
+  cout << left << setw(22) << name << right
+       << setw(8) << bytes
+       << fixed << setprecision(2) << setw(11) << result.nsPerByte
+       << setw(13) << result.allocations
+       << setw(11) << result.peakHeap << endl;
+  if (result.allocations > 0) {
+    cout << "FAIL: " << name << " allocates on the heap" << endl;
+    failures++;
+  }
+}
+
+static void countLine(const char *line, size_t length, void *context) {
+  (void)line;
+  *(size_t *)context += length + 1;
+}
+
+int main() {
+  string page = buildPage();
+  string fragment = JOKE_HTML;
+
+  // Buffers the firmware keeps statically
+  static SourceExtractor extractor;
+  static SourceRegistry registry;
+  addDefaultSources(registry);
+  ExtractRule rule = registry.source(0).rule();
+  static char scratch[JOKE_MAX_LENGTH + 1];
+  static char cleaned[JOKE_MAX_LENGTH + 1];
+  size_t cleanedLength = cleanHTMLText(fragment.data(), fragment.length(), cleaned, sizeof(cleaned));
+
+  cout << "Stage                    Bytes    ns/byte  allocs/joke  peak heap" << endl;
+
+  report("BM_ExtractJoke", page.length(), runStage(page.length(), [&]() -> size_t {
+    extractor.begin(rule);
+    const uint8_t *data = (const uint8_t *)page.data();
+    for (size_t offset = 0; offset < page.length(); offset += 128) {
+      if (extractor.feed(data + offset, min<size_t>(128, page.length() - offset))) break;
+    }
+    return extractor.finish() == nullptr ? extractor.length() : 0;
+  }));
+
+  report("BM_DecodeEntities", fragment.length(), runStage(fragment.length(), [&]() -> size_t {
+    memcpy(scratch, fragment.data(), fragment.length());
+    return decodeHTMLEntities(scratch, fragment.length());
+  }));
+
+  report("BM_CleanText", fragment.length(), runStage(fragment.length(), [&]() -> size_t {
+    return cleanHTMLText(fragment.data(), fragment.length(), scratch, sizeof(scratch));
+  }));
+
+  report("BM_WrapText", cleanedLength, runStage(cleanedLength, [&]() -> size_t {
+    size_t printed = 0;
+    wrapText(cleaned, cleanedLength, 32, countLine, &printed);
+    return printed;
+  }));
+
+  report("BM_WrapBalanced", cleanedLength, runStage(cleanedLength, [&]() -> size_t {
+    size_t printed = 0;
+    WrapOptions options = {32, WRAP_BALANCED, true};
+    wrapText(cleaned, cleanedLength, options, countLine, &printed);
+    return printed;
+  }));
+
+  const char *dateInput = "2025-06-07";
+  report("BM_FormatDate", strlen(dateInput), runStage(strlen(dateInput), [&]() -> size_t {
+    CalendarDate date;
+    char header[32];
+    return parseDate(dateInput, date) ? formatReceiptDate(date, header, sizeof(header)) : 0;
+  }));
+
+  if (sink == 0) cout << "";
+  if (failures > 0) {
+    cout << failures << " stage(s) failed" << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,163 @@
+// Host benchmark of every print path through the print engine into the
+// ESC/POS printer emulator, in simulated time. For each path it reports the
+// bytes sent, paper used, how long the print mechanism was busy and how long
+// the whole job took from queueing to the last dot row, once with
+// fixed pacing (printer TX not connected) and once with status feedback.
+// Any command the emulator doesn't understand fails the run.
+//
+// Build & run from the repository root:
+//   g++ -std=c++17 -O2 -Ilib/byte_io -Ilib/print_engine -Ilib/printer_emulator -Ilib/text_pipeline tests/bench_print_paths.cpp lib/print_engine/*.cpp lib/printer_emulator/*.cpp lib/text_pipeline/*.cpp -o bench_print_paths
+//   ./bench_print_paths
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <algorithm>
+#include "print_engine.h"
+#include "escpos_commands.h"
+#include "printer_emulator.h"
+#include "text_wrap.h"
+
+using namespace std;
+
+static const size_t PRINTER_WIDTH = 32;  // maxCharsPerLine in main_program.cpp
+static const uint32_t LOOP_MILLIS = 10;  // Main loop period on the device
+
+static const char *JOKE =
+  "Ein Blinder sitzt am Tresen in einer Bar und sagt zum Barkeeper: \"Hey, willst du einen "
+  "Blondinenwitz hoeren?\" In der Bar wird es ploetzlich totenstill. Da sagt der Typ neben dem "
+  "Blinden mit ruhiger Stimme: \"Es gibt etwas, das du wissen solltest, bevor du deinen Witz "
+  "erzaehlst! Der Barkeeper ist blond, der Rausschmeisser ist blond und ich bin 1,80 gross, "
+  "100kg schwer, blond und habe den schwarzen Guertel in Karate.\" - \"Noe, keine Lust ihn "
+  "fuenf Mal zu erklaeren!\"";
+
+static uint32_t simulatedMillis = 0;
+
+static uint32_t simulatedClock() {
+  return simulatedMillis;
+}
+
+static void queueWrappedLine(const char *line, size_t length, void *context) {
+  static_cast<PrintEngine *>(context)->println(string(line, length).c_str());
+}
+
+static void queueWrapped(PrintEngine &engine, const string &text) {
+  wrapText(text.data(), text.length(), PRINTER_WIDTH, queueWrappedLine, &engine);
+}
+
+// === Print paths, as queued by main_program.cpp ===
+static void queueSetup(PrintEngine &engine) {
+  queuePrinterSetup(engine, true);
+}
+
+static void queueReceipt(PrintEngine &engine) {
+  engine.pause(1500);
+  queueInverse(engine, true);
+  engine.println("Sa, 07 Juni 2025");
+  queueInverse(engine, false);
+  engine.pause(500);
+  queueWrapped(engine, "Einkaufsliste: Milch, Brot, Kaese und ein Glas Gurken fuer das Wochenende.");
+  queueFeed(engine, 2);
+  engine.endJob();
+}
+
+static void queueDailyJoke(PrintEngine &engine) {
+  queueFeed(engine, 2);
+  engine.pause(500);
+  queueInverse(engine, true);
+  engine.println("  Sa, 07 Juni 2025  ");
+  queueInverse(engine, false);
+  engine.pause(1000);
+  queueWrapped(engine, JOKE);
+  queueFeed(engine, 2);
+  engine.endJob();
+}
+
+static void queueServerInfo(PrintEngine &engine) {
+  engine.pause(10000);
+  engine.println("PRINTER SERVER READY");
+  engine.pause(500);
+  queueWrapped(engine, "Server started at 192.168.178.42");
+  engine.pause(500);
+  queueWrapped(engine, "Daily print: 08:00");
+  queueWrapped(engine, "Last printed: 2025-06-06");
+  queueFeed(engine, 3);
+  engine.endJob();
+}
+
+// Not printed by the firmware yet: a 384x64 raster logo (GS v 0)
+static void queueRasterImage(PrintEngine &engine) {
+  const uint8_t header[] = {0x1D, 'v', '0', 0, 48, 0, 64, 0};
+  engine.write(header, sizeof(header));
+  for (int y = 0; y < 64; y++) {
+    for (int x = 0; x < 48; x++) {
+      engine.write((uint8_t)((y / 8 + x) % 2 ? 0xAA : 0x55));
+    }
+  }
+  engine.endJob();
+}
+
+// === Runner ===
+static int failures = 0;
+
+static void run(const char *name, void (*queue)(PrintEngine &), bool feedback) {
+  simulatedMillis = 0;
+  EmulatorConfig config = DEFAULT_EMULATOR_CONFIG;
+  config.answersStatus = feedback;
+  PrinterEmulator printer(config);
+  printer.setClock(simulatedClock);
+  PrintEngine engine;
+  engine.begin(&printer, simulatedClock);
+
+  queue(engine);
+  engine.update();
+  while (!engine.idle() && simulatedMillis < 600000) {
+    simulatedMillis += LOOP_MILLIS;
+    engine.update();
+  }
+
+  double total = max((double)simulatedMillis, printer.finishedAt());
+  double mmPerSecond = total > 0 ? printer.paperLengthMm() * 1000 / total : 0;
+  cout << left << setw(20) << name << setw(10) << (feedback ? "feedback" : "fixed") << right
+       << setw(7) << printer.bytesReceived()
+       << fixed << setprecision(1)
+       << setw(10) << printer.paperLengthMm()
+       << setw(11) << printer.mechanismMillis()
+       << setw(11) << total
+       << setw(8) << mmPerSecond << endl;
+
+  if (printer.unknownCommands() > 0) {
+    cout << "FAIL: " << name << " sends commands the printer doesn't know" << endl;
+    failures++;
+  }
+  if (!engine.idle()) {
+    cout << "FAIL: " << name << " never finished" << endl;
+    failures++;
+  }
+}
+
+int main() {
+  struct Path {
+    const char *name;
+    void (*queue)(PrintEngine &);
+  };
+  const Path paths[] = {
+    {"BM_Setup", queueSetup},
+    {"BM_Receipt", queueReceipt},
+    {"BM_DailyJoke", queueDailyJoke},
+    {"BM_ServerInfo", queueServerInfo},
+    {"BM_RasterImage", queueRasterImage},
+  };
+
+  cout << "Path                Mode        Bytes  Paper mm   Print ms   Total ms    mm/s" << endl;
+  for (const Path &path : paths) {
+    run(path.name, path.queue, false);
+    run(path.name, path.queue, true);
+  }
+
+  if (failures > 0) {
+    cout << failures << " path(s) failed" << endl;
+    return 1;
+  }
+  return 0;
+}
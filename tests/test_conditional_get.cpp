@@ -0,0 +1,261 @@
+// Host test for the conditional GET of the joke source. A stand-in for the
+// joke server on loopback answers 200 with ETag and Last-Modified, or 304
+// when the request's If-None-Match / If-Modified-Since still match. The
+// client sends what ConditionalGet kept and parses the body only on a 200,
+// like fetchJokeFromAPI() does.
+//
+// Build & run from the repository root:
+//   g++ -std=c++17 -pthread -Ilib/joke_source -Ilib/text_pipeline tests/test_conditional_get.cpp lib/joke_source/conditional_get.cpp lib/joke_source/source_extractor.cpp lib/joke_source/source_registry.cpp lib/text_pipeline/html_text.cpp lib/text_pipeline/html_entities.cpp -o test_conditional_get
+//   ./test_conditional_get
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "conditional_get.h"
+#include "source_extractor.h"
+#include "source_registry.h"
+
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool condition, const string &name) {
+  if (!condition) {
+    cout << "FAIL: " << name << endl;
+    failures++;
+  }
+}
+
+static string jokePage(const string &joke) {
+  return "<html><body><div id=\"witzdestages\">" + joke +
+         "<span id=\"witzdestageslink\">mehr Witze</span></div></body></html>";
+}
+
+// === Stand-in joke server ===
+struct JokeServer {
+  int listener;
+  uint16_t port;
+  mutex lock;
+  string page;
+  string etag;           // Not sent when empty
+  string lastModified;   // Not sent when empty
+  int full = 0;          // 200 responses
+  int notModified = 0;   // 304 responses
+};
+
+static bool readUntil(int fd, string &buffer, const char *marker) {
+  char chunk[512];
+  while (buffer.find(marker) == string::npos) {
+    ssize_t got = read(fd, chunk, sizeof(chunk));
+    if (got <= 0) return false;
+    buffer.append(chunk, got);
+  }
+  return true;
+}
+
+static void sendAll(int fd, const string &data) {
+  size_t sent = 0;
+  while (sent < data.size()) {
+    ssize_t n = write(fd, data.data() + sent, data.size() - sent);
+    if (n <= 0) return;
+    sent += n;
+  }
+}
+
+// Value of a request header, "" if absent (names as the client sends them)
+static string requestHeader(const string &request, const string &name) {
+  size_t at = request.find("\r\n" + name + ": ");
+  if (at == string::npos) return "";
+  at += name.size() + 4;
+  return request.substr(at, request.find("\r\n", at) - at);
+}
+
+static void serve(JokeServer *server) {
+  while (true) {
+    int fd = accept(server->listener, nullptr, nullptr);
+    if (fd < 0) return;
+    string request;
+    if (readUntil(fd, request, "\r\n\r\n")) {
+      lock_guard<mutex> guard(server->lock);
+      string ifNoneMatch = requestHeader(request, "If-None-Match");
+      string ifModifiedSince = requestHeader(request, "If-Modified-Since");
+      // If-None-Match wins when both are sent (RFC 9110 13.2.2)
+      bool unchanged = !ifNoneMatch.empty() ? ifNoneMatch == server->etag
+                                            : !ifModifiedSince.empty() && ifModifiedSince == server->lastModified;
+      string validators;
+      if (!server->etag.empty()) validators += "ETag: " + server->etag + "\r\n";
+      if (!server->lastModified.empty()) validators += "Last-Modified: " + server->lastModified + "\r\n";
+      if (unchanged) {
+        server->notModified++;
+        sendAll(fd, "HTTP/1.1 304 Not Modified\r\n" + validators + "Connection: close\r\n\r\n");
+      } else {
+        server->full++;
+        sendAll(fd, "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\n" + validators +
+                    "Content-Length: " + to_string(server->page.size()) + "\r\nConnection: close\r\n\r\n" +
+                    server->page);
+      }
+    }
+    close(fd);
+  }
+}
+
+static void startServer(JokeServer &server) {
+  server.listener = socket(AF_INET, SOCK_STREAM, 0);
+  int yes = 1;
+  setsockopt(server.listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+  bind(server.listener, (sockaddr *)&address, sizeof(address));
+  socklen_t length = sizeof(address);
+  getsockname(server.listener, (sockaddr *)&address, &length);
+  server.port = ntohs(address.sin_port);
+  listen(server.listener, 8);
+  thread(serve, &server).detach();
+}
+
+// === Client side, as in fetchJokeFromAPI() ===
+struct FetchOutcome {
+  ConditionalResult result;
+  string joke;        // Parsed from a 200
+  int parses = 0;     // Times the extractor was fed
+};
+
+static FetchOutcome fetchJoke(uint16_t port, ConditionalGet &validators) {
+  FetchOutcome outcome = {CONDITIONAL_FAILED, "", 0};
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(port);
+  if (connect(fd, (sockaddr *)&address, sizeof(address)) != 0) {
+    close(fd);
+    return outcome;
+  }
+
+  string request = "GET /witze/witzdestages.txt HTTP/1.1\r\nHost: localhost\r\n";
+  if (validators.ifNoneMatch()[0]) request += string("If-None-Match: ") + validators.ifNoneMatch() + "\r\n";
+  if (validators.ifModifiedSince()[0]) request += string("If-Modified-Since: ") + validators.ifModifiedSince() + "\r\n";
+  request += "Connection: close\r\n\r\n";
+  sendAll(fd, request);
+
+  string response;
+  readUntil(fd, response, "\r\n\r\n");
+  size_t headerEnd = response.find("\r\n\r\n");
+  int code = atoi(response.c_str() + 9);
+  outcome.result = validators.response(code);
+
+  // Header lines after the status line
+  size_t line = response.find("\r\n") + 2;
+  while (line < headerEnd) {
+    size_t end = response.find("\r\n", line);
+    size_t colon = response.find(':', line);
+    if (colon < end) {
+      string name = response.substr(line, colon - line);
+      string value = response.substr(colon + 2, end - colon - 2);
+      validators.header(name.c_str(), value.c_str());
+    }
+    line = end + 2;
+  }
+
+  if (outcome.result == CONDITIONAL_CONTENT) {
+    string body = response.substr(headerEnd + 4);
+    char chunk[512];
+    ssize_t got;
+    while ((got = read(fd, chunk, sizeof(chunk))) > 0) {
+      body.append(chunk, got);
+    }
+    SourceRegistry registry;
+    addDefaultSources(registry);
+    SourceExtractor extractor;
+    extractor.begin(registry.source(0).rule());
+    extractor.feed((const uint8_t *)body.data(), body.size());
+    outcome.parses++;
+    if (extractor.finish() == nullptr) {
+      outcome.joke = extractor.text();
+    }
+  }
+  close(fd);
+  return outcome;
+}
+
+static void testAgainstServer() {
+  JokeServer server;
+  server.page = jokePage("Treffen sich zwei Jäger.");
+  server.etag = "\"v1\"";
+  server.lastModified = "Tue, 14 Oct 2025 22:00:00 GMT";
+  startServer(server);
+
+  ConditionalGet validators;
+  FetchOutcome first = fetchJoke(server.port, validators);
+  check(first.result == CONDITIONAL_CONTENT && first.joke == "Treffen sich zwei Jäger.", "200 delivers the joke");
+  check(string(validators.storedETag()) == "\"v1\"" &&
+        string(validators.storedLastModified()) == "Tue, 14 Oct 2025 22:00:00 GMT", "200 keeps the validators");
+
+  // Same page: 304, nothing downloaded or parsed
+  FetchOutcome second = fetchJoke(server.port, validators);
+  check(second.result == CONDITIONAL_NOT_MODIFIED && second.parses == 0, "304 skips the parse");
+  check(string(validators.storedETag()) == "\"v1\"", "304 keeps the validators");
+
+  // New joke: 200 again with the new ETag
+  {
+    lock_guard<mutex> guard(server.lock);
+    server.page = jokePage("Kommt ein Pferd in die Bar.");
+    server.etag = "\"v2\"";
+    server.lastModified = "Wed, 15 Oct 2025 22:00:00 GMT";
+  }
+  FetchOutcome third = fetchJoke(server.port, validators);
+  check(third.result == CONDITIONAL_CONTENT && third.joke == "Kommt ein Pferd in die Bar." &&
+        string(validators.storedETag()) == "\"v2\"", "a changed page is downloaded");
+
+  // A server with only Last-Modified
+  {
+    lock_guard<mutex> guard(server.lock);
+    server.etag = "";
+  }
+  validators.clear();
+  FetchOutcome dated = fetchJoke(server.port, validators);
+  check(dated.result == CONDITIONAL_CONTENT && validators.storedETag()[0] == '\0', "no ETag, none kept");
+  FetchOutcome since = fetchJoke(server.port, validators);
+  check(since.result == CONDITIONAL_NOT_MODIFIED && since.parses == 0, "If-Modified-Since gets a 304");
+
+  check(server.full == 3 && server.notModified == 2, "server saw 3 downloads and 2 revalidations");
+  close(server.listener);
+}
+
+static void testValidators() {
+  ConditionalGet validators;
+  check(!validators.conditional() && validators.response(304) == CONDITIONAL_FAILED,
+        "304 without a conditional request fails");
+  check(validators.response(500) == CONDITIONAL_FAILED, "server errors fail");
+
+  validators.restore("\"abc\"", nullptr);
+  check(validators.conditional() && validators.ifModifiedSince()[0] == '\0', "restored from the cache");
+  validators.header("etag", "W/\"def\"");
+  validators.header("Content-Type", "text/html");
+  check(string(validators.ifNoneMatch()) == "W/\"def\"", "header names in any case, weak tags as sent");
+
+  string tooLong(VALIDATOR_MAX + 1, 'x');
+  validators.header("ETag", tooLong.c_str());
+  check(validators.ifNoneMatch()[0] == '\0', "an oversized ETag isn't kept");
+}
+
+int main() {
+  testValidators();
+  testAgainstServer();
+
+  if (failures == 0) {
+    cout << "All conditional GET tests passed" << endl;
+    return 0;
+  }
+  cout << failures << " conditional GET test(s) failed" << endl;
+  return 1;
+}
@@ -0,0 +1,261 @@
+// Host test for the settings store (config_store.h). Bursts of changes are
+// written once, when they settle or at the latest after the maximum delay,
+// and a failed write is tried again. A session of settings changes is
+// replayed with a reset injected at every write point (each byte of the
+// temp file, truncating it, removing and renaming files, the rename taken
+// as remove-then-rename): after load() the settings are the last ones
+// written or the ones being written, never a mix or the defaults, and the
+// WiFi credentials are always there. A reset during load() itself is
+// injected too.
+//
+// Build & run from the repository root:
+//   g++ -std=c++17 -Ilib/config_store tests/test_config_store.cpp lib/config_store/config_store.cpp -o test_config_store
+//   ./test_config_store
+
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include "config_store.h"
+
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool condition, const string &name) {
+  if (!condition) {
+    cout << "FAIL: " << name << endl;
+    failures++;
+  }
+}
+
+typedef map<string, string> Settings;
+
+// Settings as "key=value" lines closed by "end", the way an incomplete JSON
+// document doesn't parse. After `budget` write points the device "resets":
+// nothing more reaches the files.
+class MemoryStorage : public ConfigStorage {
+public:
+  explicit MemoryStorage(size_t budget = SIZE_MAX) : budget(budget) {}
+
+  bool parse(ConfigFile file) override {
+    settings.clear();
+    if (!present[file]) return false;
+    const string &text = files[file];
+    size_t at = 0;
+    while (at < text.size()) {
+      size_t end = text.find('\n', at);
+      if (end == string::npos) return false;
+      string line = text.substr(at, end - at);
+      if (line == "end") return end + 1 == text.size();
+      size_t equals = line.find('=');
+      if (equals == string::npos) return false;
+      settings[line.substr(0, equals)] = line.substr(equals + 1);
+      at = end + 1;
+    }
+    return false;
+  }
+
+  void reset() override { settings.clear(); }
+
+  bool write() override {
+    string text;
+    for (const auto &entry : settings) text += entry.first + "=" + entry.second + "\n";
+    text += "end\n";
+    if (!spend()) return false;          // open("w") empties the file
+    files[CONFIG_TEMP].clear();
+    present[CONFIG_TEMP] = true;
+    for (char c : text) {
+      if (!spend()) return false;
+      files[CONFIG_TEMP] += c;
+    }
+    return true;
+  }
+
+  bool replace() override {
+    if (!present[CONFIG_TEMP]) return false;
+    if (!spend()) return false;          // The old file goes first
+    present[CONFIG_CURRENT] = false;
+    if (!spend()) return false;
+    files[CONFIG_CURRENT] = files[CONFIG_TEMP];
+    present[CONFIG_CURRENT] = true;
+    present[CONFIG_TEMP] = false;
+    return true;
+  }
+
+  bool exists(ConfigFile file) override { return present[file]; }
+
+  void remove(ConfigFile file) override {
+    if (spend()) present[file] = false;
+  }
+
+  // Power comes back with the files as they are, budget for the next session
+  void restart(size_t nextBudget = SIZE_MAX) {
+    crashed = false;
+    budget = nextBudget;
+    written = 0;
+    settings.clear();
+  }
+
+  Settings settings;
+  string files[2];
+  bool present[2] = {false, false};
+  size_t budget;
+  size_t written = 0;
+  bool crashed = false;
+
+private:
+  bool spend() {
+    if (crashed || written == budget) {
+      crashed = true;
+      return false;
+    }
+    written++;
+    return true;
+  }
+};
+
+static void testDebounce() {
+  MemoryStorage storage;
+  ConfigStore store(storage, 2000, 10000);
+  check(!store.load() && storage.settings.empty(), "no file, defaults");
+  check(!store.dirty() && store.dueIn(0) == 0 && store.flush(0) && store.writes() == 0, "nothing to write");
+
+  // A burst is written once it settles
+  for (uint32_t now = 0; now <= 1000; now += 250) {
+    storage.settings["dailyPrintTime"] = "09:" + to_string(now / 250);
+    store.changed(now);
+  }
+  check(store.dirty() && store.dueIn(1000) == 2000 && store.dueIn(2999) == 1, "waits until settled");
+  check(store.dueIn(3000) == 0 && store.flush(3000) && store.writes() == 1 && !store.dirty(), "burst written once");
+  check(store.changes() == 5, "changes counted");
+
+  // Changes that never settle are written after the maximum delay
+  for (uint32_t now = 5000; now <= 14000; now += 1000) {
+    store.changed(now);
+  }
+  check(store.dueIn(14000) == 1000 && store.dueIn(15000) == 0, "at the latest after the maximum delay");
+
+  // A failed write stays pending and is due again once settled
+  storage.budget = storage.written;
+  check(!store.flush(15000) && store.dirty() && store.failures() == 1, "failed write pending");
+  check(store.dueIn(15000) == 2000 && store.dueIn(17000) == 0, "retried after settling");
+  storage.crashed = false;
+  storage.budget = SIZE_MAX;
+  check(store.flush(17000) && !store.dirty() && store.writes() == 2, "retry written");
+
+  storage.restart();
+  ConfigStore reloaded(storage);
+  check(reloaded.load() && storage.settings["dailyPrintTime"] == "09:4", "written settings load");
+}
+
+// One session of changes: credentials, then the schedule and sources as
+// the device would change them. Each flush is a version.
+static vector<Settings> versions() {
+  vector<Settings> list;
+  Settings settings = {{"ssid", "Heimnetz"}, {"password", "geheim123"}};
+  list.push_back(settings);
+  settings["dailyPrintTime"] = "09:00";
+  list.push_back(settings);
+  for (int day = 1; day <= 5; day++) {
+    settings["lastJokePrintDate"] = "2025-10-0" + to_string(day);
+    if (day == 3) settings["jokeSources"] = "[{\"name\":\"hahaha\",\"url\":\"https://www.hahaha.de/\"}]";
+    if (day == 4) settings["dailyPrintTime"] = "07:30";
+    list.push_back(settings);
+  }
+  return list;
+}
+
+// Flush each version in turn; returns how many were written completely
+static size_t runSession(MemoryStorage &storage, const vector<Settings> &list) {
+  ConfigStore store(storage);
+  store.load();
+  size_t done = 0;
+  uint32_t now = 0;
+  for (const Settings &settings : list) {
+    storage.settings = settings;
+    store.changed(now);
+    now += CONFIG_MAX_DELAY_MILLIS;
+    if (!store.flush(now)) break;
+    done++;
+  }
+  return done;
+}
+
+static void testResets() {
+  vector<Settings> list = versions();
+  MemoryStorage reference;
+  runSession(reference, list);
+  size_t total = reference.written;
+
+  int wrong = 0;
+  int lostCredentials = 0;
+  int stuck = 0;
+  for (size_t budget = 0; budget <= total; budget++) {
+    // Resets in the session, then in the load() that follows at each of its
+    // own write points
+    for (size_t loadBudget = 0; loadBudget <= 3; loadBudget++) {
+      MemoryStorage storage(budget);
+      size_t done = runSession(storage, list);
+      storage.restart(loadBudget);
+      ConfigStore interrupted(storage);
+      interrupted.load();
+      storage.restart();
+
+      ConfigStore store(storage);
+      bool loaded = store.load();
+      const Settings &settings = storage.settings;
+      bool expected = done == 0 ? (!loaded || settings == list[0])
+                                : (settings == list[done - 1] || (done < list.size() && settings == list[done]));
+      if (!expected) wrong++;
+      if (done > 0 && settings.count("ssid") == 0) lostCredentials++;
+
+      // And settings are written again from there
+      storage.settings["dailyPrintTime"] = "11:11";
+      store.changed(0);
+      bool flushed = store.flush(CONFIG_MAX_DELAY_MILLIS);
+      storage.restart();
+      ConfigStore reloaded(storage);
+      if (!flushed || !reloaded.load() || storage.settings["dailyPrintTime"] != "11:11" ||
+          storage.present[CONFIG_TEMP]) {
+        stuck++;
+      }
+    }
+  }
+  check(wrong == 0, "old or new settings after every reset (" + to_string(wrong) + " wrong)");
+  check(lostCredentials == 0, "credentials never lost (" + to_string(lostCredentials) + " lost)");
+  check(stuck == 0, "writing continues after every reset (" + to_string(stuck) + " stuck)");
+}
+
+static void testPartialTemp() {
+  // A temp file cut short beside the current one is dropped
+  MemoryStorage storage;
+  storage.files[CONFIG_CURRENT] = "ssid=Heimnetz\nend\n";
+  storage.present[CONFIG_CURRENT] = true;
+  storage.files[CONFIG_TEMP] = "ssid=Heimn";
+  storage.present[CONFIG_TEMP] = true;
+  ConfigStore store(storage);
+  check(store.load() && storage.settings["ssid"] == "Heimnetz" && !storage.present[CONFIG_TEMP], "partial temp dropped");
+
+  // A complete temp file without a current one takes its place
+  MemoryStorage orphan;
+  orphan.files[CONFIG_TEMP] = "ssid=Neu\nend\n";
+  orphan.present[CONFIG_TEMP] = true;
+  ConfigStore adopted(orphan);
+  check(adopted.load() && orphan.settings["ssid"] == "Neu" && orphan.present[CONFIG_CURRENT] &&
+        !orphan.present[CONFIG_TEMP] && !adopted.dirty(), "complete temp adopted");
+}
+
+int main() {
+  testDebounce();
+  testResets();
+  testPartialTemp();
+
+  if (failures == 0) {
+    cout << "All config store tests passed" << endl;
+    return 0;
+  }
+  cout << failures << " config store test(s) failed" << endl;
+  return 1;
+}
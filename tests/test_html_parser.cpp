@@ -1,222 +1,271 @@
+// End-to-end host test of the receipt text pipeline, using the same library
+// the firmware links (lib/text_pipeline): extract the joke from
+// tests/html_trimming.txt, transcode it for the printer's code page, wrap
+// it for the 32-column printer and format receipt dates.
+//
+// Build & run from the repository root:
+//   g++ -std=c++17 -Ilib/text_pipeline -Ilib/joke_source tests/test_html_parser.cpp lib/text_pipeline/*.cpp lib/joke_source/source_extractor.cpp lib/joke_source/source_registry.cpp -o test_html_parser
+//   ./test_html_parser [path/to/html_trimming.txt]
+
 #include <iostream>
 #include <string>
+#include <vector>
 #include <fstream>
 #include <sstream>
+#include "source_extractor.h"
+#include "source_registry.h"
+#include "text_wrap.h"
+#include "html_entities.h"
+#include "date_format.h"
+#include "code_page.h"
 
 using namespace std;
 
-// Arduino String compatibility layer for testing
-class String {
-public:
-    string data;
-
-    String() {}
-    String(const char* str) : data(str) {}
-    String(const string& str) : data(str) {}
-    String(int num) : data(to_string(num)) {}
+static const size_t PRINTER_WIDTH = 32;  // maxCharsPerLine in main_program.cpp
 
-    int length() const { return data.length(); }
+static int failures = 0;
 
-    char charAt(int index) const {
-        if (index >= 0 && index < data.length())
-            return data[index];
-        return 0;
+static void check(bool condition, const string &name) {
+    if (!condition) {
+        cout << "FAIL: " << name << endl;
+        failures++;
     }
+}
 
-    String substring(int start) const {
-        if (start >= data.length()) return String("");
-        return String(data.substr(start));
-    }
+static void collectLine(const char *line, size_t length, void *context) {
+    static_cast<vector<string> *>(context)->push_back(string(line, length));
+}
 
-    String substring(int start, int end) const {
-        if (start >= data.length()) return String("");
-        if (end > data.length()) end = data.length();
-        if (end <= start) return String("");
-        return String(data.substr(start, end - start));
-    }
+static vector<string> wrap(const string &text, size_t width = PRINTER_WIDTH) {
+    vector<string> lines;
+    wrapText(text.data(), text.length(), width, collectLine, &lines);
+    return lines;
+}
 
-    int indexOf(const char* str) const {
-        size_t pos = data.find(str);
-        return (pos == string::npos) ? -1 : pos;
-    }
+static vector<string> wrapWith(const string &text, size_t width, WrapMode mode, bool utf8) {
+    vector<string> lines;
+    WrapOptions options = {width, mode, utf8};
+    wrapText(text.data(), text.length(), options, collectLine, &lines);
+    return lines;
+}
 
-    int indexOf(const char* str, int from) const {
-        size_t pos = data.find(str, from);
-        return (pos == string::npos) ? -1 : pos;
+// Through WrapStream, in pieces of `piece` bytes
+static vector<string> wrapStreamed(const string &text, size_t width, bool utf8, size_t piece) {
+    vector<string> lines;
+    WrapOptions options = {width, WRAP_GREEDY, utf8};
+    WrapStream stream(options, collectLine, &lines);
+    for (size_t pos = 0; pos < text.length(); pos += piece) {
+        stream.write(text.data() + pos, min(piece, text.length() - pos));
     }
+    size_t count = stream.finish();
+    return count == lines.size() ? lines : vector<string>{"count mismatch"};
+}
 
-    void replace(const char* find, const char* replace) {
-        string findStr(find);
-        string replaceStr(replace);
-        size_t pos = 0;
-        while ((pos = data.find(findStr, pos)) != string::npos) {
-            data.replace(pos, findStr.length(), replaceStr);
-            pos += replaceStr.length();
-        }
+// Free columns squared, except on the last line
+static size_t raggedness(const vector<string> &lines, size_t width) {
+    size_t sum = 0;
+    for (size_t i = 0; i + 1 < lines.size(); i++) {
+        size_t slack = width - lines[i].length();
+        sum += slack * slack;
     }
+    return sum;
+}
 
-    void trim() {
-        // Trim leading whitespace
-        size_t start = data.find_first_not_of(" \t\n\r");
-        if (start == string::npos) {
-            data = "";
-            return;
-        }
-
-        // Trim trailing whitespace
-        size_t end = data.find_last_not_of(" \t\n\r");
-        data = data.substr(start, end - start + 1);
-    }
+static string transcode(const string &text, PrinterCodePage page = CODE_PAGE_CP858) {
+    string out = text;
+    out.resize(transcodeUTF8(out.data(), out.length(), page, &out[0]));
+    return out;
+}
 
-    const char* c_str() const { return data.c_str(); }
+static string receiptDate(const char *text) {
+    CalendarDate date;
+    if (!parseDate(text, date)) return "invalid";
+    char buffer[32];
+    formatReceiptDate(date, buffer, sizeof(buffer));
+    return buffer;
+}
 
-    friend ostream& operator<<(ostream& os, const String& s) {
-        os << s.data;
-        return os;
+static void checkWrapping() {
+    check(wrap("").empty(), "empty text prints nothing");
+    check(wrap("kurz") == vector<string>{"kurz"}, "short line");
+    check(wrap("aaaa bbbb cccc", 9) == vector<string>{"aaaa bbbb", "cccc"}, "break at last space");
+    check(wrap("aaaa  bbbb", 4) == vector<string>{"aaaa", "bbbb"}, "spaces at the break are dropped");
+    check(wrap("abcdefghij", 4) == vector<string>{"abcd", "efgh", "ij"}, "long word is cut");
+    check(wrap("eins\nzwei\r\n\ndrei") == vector<string>{"eins", "zwei", "", "drei"},
+          "newlines start lines, blank lines survive");
+    check(wrap("aaaa bbbb\ncc", 6) == vector<string>{"aaaa", "bbbb", "cc"}, "wrap inside a paragraph");
+    check(wrap("aaaa bbbb   \ncc", 9) == vector<string>{"aaaa bbbb", "cc"}, "trailing spaces add no line");
+
+    // UTF-8: umlauts are one column, cuts keep characters whole
+    check(wrapWith("\xc3\xa4\xc3\xb6\xc3\xbc \xc3\x9f", 5, WRAP_GREEDY, true) ==
+          vector<string>{"\xc3\xa4\xc3\xb6\xc3\xbc \xc3\x9f"}, "umlauts count one column");
+    check(wrapWith("\xc3\xa4\xc3\xb6\xc3\xbc", 2, WRAP_GREEDY, true) ==
+          vector<string>{"\xc3\xa4\xc3\xb6", "\xc3\xbc"}, "hard cut between characters");
+    check(wrap("\xc3\xa4\xc3\xb6\xc3\xbc", 5).size() == 2, "byte mode counts bytes");
+
+    // Balanced: same lines as greedy, more even
+    check(wrapWith("aaa bb cc ddddd", 6, WRAP_GREEDY, false) ==
+          vector<string>{"aaa bb", "cc", "ddddd"}, "greedy leaves a gap");
+    check(wrapWith("aaa bb cc ddddd", 6, WRAP_BALANCED, false) ==
+          vector<string>{"aaa", "bb cc", "ddddd"}, "balanced evens the gap out");
+    check(wrapWith("aaaa bbbb cccc", 9, WRAP_BALANCED, false) ==
+          vector<string>{"aaaa bbbb", "cccc"}, "short last line is free");
+    check(wrapWith("abcdefghij kl", 4, WRAP_BALANCED, false) ==
+          vector<string>{"abcd", "efgh", "ij", "kl"}, "long word falls back to greedy");
+    check(wrapWith("eins\n\nzwei drei", 4, WRAP_BALANCED, false) ==
+          vector<string>{"eins", "", "zwei", "drei"}, "balanced keeps paragraphs");
+
+    // Streaming gives the same lines however the text is cut
+    const char *samples[] = {
+        "", "kurz", "aaaa bbbb cccc", "aaaa  bbbb", "abcdefghij", "eins\nzwei\r\n\ndrei",
+        "aaaa bbbb   \ncc", "  ab cdefghijkl", "a\rb\r", "\r\n\n", "ab   \n  cd   ef\n",
+        "\xc3\xa4\xc3\xb6\xc3\xbc \xc3\x9f\xc3\x9f\xc3\x9f\xc3\x9f Stra\xc3\x9f" "e",
+        "Milch, Eier, Butter\n- Brot\n- K\xc3\xa4se (alter Gouda)\n\nTermin: 14:00 Uhr"
+    };
+    bool same = true;
+    for (const char *sample : samples) {
+        string text = sample;
+        for (size_t width = 1; width <= 12; width++) {
+            for (size_t piece = 1; piece <= text.length() + 1; piece++) {
+                same = same && wrapStreamed(text, width, false, piece) == wrapWith(text, width, WRAP_GREEDY, false);
+                same = same && wrapStreamed(text, width, true, piece) == wrapWith(text, width, WRAP_GREEDY, true);
+            }
+        }
     }
-};
-
-// Copy the helper functions from main_program.cpp
-String decodeHTMLEntities(String text) {
-  // Common German HTML entities
-  text.replace("&quot;", "\"");
-  text.replace("&amp;", "&");
-  text.replace("&lt;", "<");
-  text.replace("&gt;", ">");
-  text.replace("&ouml;", "ö");
-  text.replace("&auml;", "ä");
-  text.replace("&uuml;", "ü");
-  text.replace("&Ouml;", "Ö");
-  text.replace("&Auml;", "Ä");
-  text.replace("&Uuml;", "Ü");
-  text.replace("&szlig;", "ß");
-  text.replace("&nbsp;", " ");
-
-  return text;
+    check(same, "streamed wrapping matches wrapText");
 }
 
-String stripHTMLTags(String text) {
-  String result = "";
-  bool inTag = false;
-
-  for (int i = 0; i < text.length(); i++) {
-    char c = text.charAt(i);
-
-    if (c == '<') {
-      inTag = true;
-      // Check if it's a <br> tag and convert to space
-      if (text.substring(i, i + 4).data == "<br>" || text.substring(i, i + 5).data == "<br/>") {
-        result.data += " ";
-      }
-    } else if (c == '>') {
-      inTag = false;
-    } else if (!inTag) {
-      result.data += c;
+static void checkTranscoding() {
+    check(transcode("Gr\xc3\xbc\xc3\x9f" "e aus K\xc3\xb6ln") == "Gr\x81\xe1" "e aus K\x94ln", "umlauts are one byte");
+    check(transcode("\xc3\x84\xc3\x96\xc3\x9c", CODE_PAGE_CP437) == "\x8e\x99\x9a", "same bytes in CP437");
+    check(transcode("5 \xe2\x82\xac") == "5 \xd5", "euro sign in CP858");
+    check(transcode("5 \xe2\x82\xac", CODE_PAGE_CP850) == "5 EUR", "euro sign spelled out elsewhere");
+    check(transcode("\xe2\x80\x9eJa\xe2\x80\x9c \xe2\x80\x93 na\xe2\x80\xa6") == "\"Ja\" - na...", "punctuation is transliterated");
+    check(transcode("\xc3\xa9t\xc3\xa9", CODE_PAGE_CP437) == "\x82t\x82", "accents the page has");
+    check(transcode("\xc3\x95", CODE_PAGE_CP437) == "O", "accents it lacks fall back to the letter");
+    check(transcode("\xc5\x82 \xf0\x9f\x98\x80") == "? ?", "unknown characters");
+    check(transcode("a\xff" "b\xc3") == "a?b?", "malformed UTF-8");
+    check(transcode("so\xc2\xad" "ft\xe2\x80\x8b") == "so\xf0" "ft", "soft hyphen kept, zero width dropped");
+    check(transcode("plain ASCII\r\n") == "plain ASCII\r\n", "ASCII passes through");
+
+    const string cut = "K\xc3\xb6ln \xe2\x82\xac";
+    check(completeUTF8Length(cut.data(), cut.length()) == cut.length() &&
+          completeUTF8Length(cut.data(), cut.length() - 1) == cut.length() - 3 &&
+          completeUTF8Length(cut.data(), 2) == 1 && completeUTF8Length(cut.data(), 3) == 3,
+          "cut-off sequences are held back");
+    check(completeUTF8Length("a\xff", 2) == 2 && completeUTF8Length("", 0) == 0, "malformed bytes are not held back");
+
+    for (int page = 0; page < 3; page++) {
+        bool roundTrip = true;
+        for (int byte = 0x80; byte < 0x100; byte++) {
+            char utf8[4];
+            string text(utf8, encodeUTF8(codePageToUnicode((PrinterCodePage)page, byte), utf8));
+            roundTrip = roundTrip && transcode(text, (PrinterCodePage)page) == string(1, (char)byte);
+        }
+        check(roundTrip, "every code page byte round-trips");
     }
-  }
 
-  return result;
+    PrinterCodePage page;
+    check(codePageSelector(CODE_PAGE_CP858) == 19 && codePageForSelector(2, page) && page == CODE_PAGE_CP850,
+          "ESC t values");
 }
 
-int main() {
-    // Read the test file
-    ifstream file("C:\\Users\\tim20\\Software Projects\\jester-scribe\\tests\\html_trimming.txt");
+static void checkDates() {
+    check(receiptDate("2025-06-07") == "Sa, 07 Juni 2025", "ISO date");
+    check(receiptDate("24/12/2024") == "Di, 24 Dezember 2024", "European date");
+    check(receiptDate("2024-02-29") == "Do, 29 Februar 2024", "leap day");
+    check(receiptDate("2023-10-01") == "So, 01 Oktober 2023", "October spelling");
+    check(receiptDate("2023-02-29") == "invalid", "no leap day in 2023");
+    check(receiptDate("2025-13-01") == "invalid", "month out of range");
+    check(receiptDate("1899-01-01") == "invalid", "year out of range");
+    check(receiptDate("heute") == "invalid", "not a date");
+    check(receiptDate("2025-06-07x") == "invalid", "trailing junk");
+
+    char buffer[11];
+    CalendarDate date = {2025, 6, 7};
+    formatISODate(date, buffer, sizeof(buffer));
+    check(string(buffer) == "2025-06-07", "ISO format");
+    formatTimeOfDay(8, 5, buffer, sizeof(buffer));
+    check(string(buffer) == "08:05", "time of day");
+}
+
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : "tests/html_trimming.txt";
+    ifstream file(path);
     if (!file.is_open()) {
-        cout << "Error: Could not open test file" << endl;
+        cout << "Error: Could not open " << path << endl;
         return 1;
     }
 
     stringstream buffer;
     buffer << file.rdbuf();
     string content = buffer.str();
-    file.close();
 
-    // Find the HTML input section
     size_t htmlStart = content.find("html input:");
     size_t htmlEnd = content.find("desired output:");
-
     if (htmlStart == string::npos || htmlEnd == string::npos) {
         cout << "Error: Could not find test sections" << endl;
         return 1;
     }
 
     string htmlInput = content.substr(htmlStart + 11, htmlEnd - htmlStart - 11);
-
-    // Trim leading/trailing whitespace from input
-    size_t start = htmlInput.find_first_not_of(" \t\n\r");
-    size_t end = htmlInput.find_last_not_of(" \t\n\r");
-    if (start != string::npos && end != string::npos) {
-        htmlInput = htmlInput.substr(start, end - start + 1);
+    string desired = content.substr(htmlEnd + 15);
+    desired = desired.substr(desired.find_first_not_of(" \t\n\r"));
+    desired = desired.substr(0, desired.find_last_not_of(" \t\n\r") + 1);
+
+    // Cut out by the built-in source's rule, as the firmware does
+    SourceRegistry registry;
+    addDefaultSources(registry);
+    SourceExtractor extractor;
+    extractor.begin(registry.source(0).rule());
+    extractor.feed((const uint8_t *)htmlInput.data(), htmlInput.length());
+    const char *error = extractor.finish();
+    string joke = error ? string(error) : string(extractor.text(), extractor.length());
+    check(joke == desired, "extracted joke matches desired output");
+
+    // Wrapped lines fit the paper and lose nothing but the break spaces
+    vector<string> lines = wrap(joke);
+    string rejoined;
+    for (const string &line : lines) {
+        check(line.length() <= PRINTER_WIDTH, "line fits: " + line);
+        rejoined += (rejoined.empty() ? "" : " ") + line;
     }
+    check(rejoined == joke, "wrapping keeps every word");
+
+    // Umlauts print in one column instead of two
+    size_t characters = 0;
+    for (unsigned char c : joke) characters += (c & 0xC0) != 0x80;
+    check(transcode(joke).length() == characters, "transcoded joke has one byte per character");
+
+    vector<string> balanced = wrapWith(joke, PRINTER_WIDTH, WRAP_BALANCED, false);
+    rejoined.clear();
+    bool balancedFits = true;
+    for (const string &line : balanced) {
+        balancedFits = balancedFits && line.length() <= PRINTER_WIDTH;
+        rejoined += (rejoined.empty() ? "" : " ") + line;
+    }
+    check(balancedFits && rejoined == joke, "balanced wrapping fits and keeps every word");
+    check(balanced.size() == lines.size(), "balanced wrapping uses no extra paper");
+    check(raggedness(balanced, PRINTER_WIDTH) <= raggedness(lines, PRINTER_WIDTH), "balanced is less ragged");
 
-    cout << "=== HTML INPUT ===" << endl;
-    cout << htmlInput << endl << endl;
+    vector<string> streamed = wrapStreamed(joke, PRINTER_WIDTH, false, 7);
+    check(streamed == lines, "streamed joke wraps the same");
 
-    // Simulate the extraction process
-    String htmlContent(htmlInput);
-    String joke = "";
+    checkWrapping();
+    checkTranscoding();
+    checkDates();
 
-    // Extract content from <div id="witzdestages">
-    int divStart = htmlContent.indexOf("<div id=\"witzdestages\">");
-    if (divStart == -1) {
-        divStart = htmlContent.indexOf("<div id='witzdestages'>");
+    cout << "=== RECEIPT PREVIEW ===" << endl;
+    cout << string(PRINTER_WIDTH, '-') << endl;
+    for (const string &line : lines) {
+        cout << line << endl;
     }
+    cout << string(PRINTER_WIDTH, '-') << endl;
 
-    cout << "divStart: " << divStart << endl;
-
-    if (divStart != -1) {
-        // Find the closing </div>
-        int divEnd = htmlContent.indexOf("</div>", divStart);
-        cout << "divEnd: " << divEnd << endl;
-
-        if (divEnd != -1) {
-            // Extract content between tags
-            joke = htmlContent.substring(divStart, divEnd);
-            cout << "After substring extraction: " << joke.length() << " chars" << endl;
-            cout << "Content: " << joke << endl << endl;
-
-            // Remove the opening div tag
-            int contentStart = joke.indexOf(">") + 1;
-            joke = joke.substring(contentStart);
-            cout << "After removing opening tag: " << joke.length() << " chars" << endl;
-            cout << "Content: " << joke << endl << endl;
-
-            // Remove the footer link span (if present)
-            int linkStart = joke.indexOf("<span id=\"witzdestageslink\">");
-            if (linkStart == -1) {
-                linkStart = joke.indexOf("<span id='witzdestageslink'>");
-            }
-            if (linkStart != -1) {
-                joke = joke.substring(0, linkStart);
-            }
-            cout << "After removing footer: " << joke.length() << " chars" << endl;
-            cout << "Content: " << joke << endl << endl;
-
-            // Decode HTML entities (ö, ä, ü, ß, etc.)
-            joke = decodeHTMLEntities(joke);
-            cout << "After decoding entities: " << joke.length() << " chars" << endl;
-            cout << "Content: " << joke << endl << endl;
-
-            // Remove remaining HTML tags (<br />, etc.)
-            joke = stripHTMLTags(joke);
-            cout << "After stripping tags: " << joke.length() << " chars" << endl;
-            cout << "Content: " << joke << endl << endl;
-
-            // Clean up whitespace
-            joke.trim();
-            cout << "After trim: " << joke.length() << " chars" << endl;
-
-            // Replace multiple spaces with single space
-            while (joke.indexOf("  ") != -1) {
-                joke.replace("  ", " ");
-            }
-            cout << "After space cleanup: " << joke.length() << " chars" << endl;
-
-            cout << endl << "=== FINAL RESULT ===" << endl;
-            cout << joke << endl << endl;
-            cout << "Length: " << joke.length() << " chars" << endl;
-        }
+    if (failures == 0) {
+        cout << "All pipeline tests passed" << endl;
+        return 0;
     }
-
-    return 0;
+    cout << failures << " pipeline test(s) failed" << endl;
+    return 1;
 }
@@ -0,0 +1,235 @@
+// Host test for the offline joke bank: every joke comes back from any
+// position in any order with each block size, long and repetitive jokes
+// included, and a damaged bank is refused or read without ever passing on
+// more than a joke's worth of text. The shipped data/jokes.bin must hold
+// exactly the jokes in assets/jokes.txt.
+//
+// Build & run from the repository root:
+//   g++ -std=c++17 -Ilib/byte_io -Ilib/joke_source tests/test_joke_bank.cpp lib/joke_source/joke_bank.cpp -o test_joke_bank
+//   ./test_joke_bank
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "joke_bank.h"
+#include "joke_limits.h"
+
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool condition, const string &name) {
+  if (!condition) {
+    cout << "FAIL: " << name << endl;
+    failures++;
+  }
+}
+
+class MemoryBankStorage : public BankStorage {
+public:
+  vector<uint8_t> data;
+  int reads = 0;
+  int releases = 0;
+
+  size_t size() override { return data.size(); }
+
+  size_t read(size_t offset, uint8_t *out, size_t length) override {
+    reads++;
+    if (offset >= data.size()) return 0;
+    size_t got = min(length, data.size() - offset);
+    memcpy(out, data.data() + offset, got);
+    return got;
+  }
+
+  void release() override { releases++; }
+};
+
+static void collect(const char *data, size_t length, void *context) {
+  static_cast<string *>(context)->append(data, length);
+}
+
+static vector<uint8_t> build(const vector<string> &jokes, const BankOptions &options) {
+  vector<const char *> texts;
+  for (const string &joke : jokes) texts.push_back(joke.c_str());
+  vector<uint8_t> bank(64 * 1024);
+  bank.resize(buildJokeBank(texts.data(), texts.size(), options, bank.data(), bank.size()));
+  return bank;
+}
+
+static string readJoke(JokeBank &bank, uint16_t index, bool *ok = nullptr) {
+  string text;
+  bool read = bank.read(index, collect, &text);
+  if (ok) *ok = read;
+  return read ? text : "<failed>";
+}
+
+static vector<string> sampleJokes() {
+  vector<string> jokes = {
+    "Treffen sich zwei Jäger. Beide tot.",
+    "Was ist grün und klopft an die Tür? Ein Klopfsalat.",
+    "Sitzen zwei Kühe auf der Weide. Sagt die eine: \"Muh.\" Sagt die andere: \"Das wollte ich auch gerade sagen.\"",
+    "x",
+    string(JOKE_MAX_LENGTH, 'a'),                    // Copies overlapping themselves
+  };
+  string mixed;
+  while (mixed.size() < JOKE_MAX_LENGTH - 40) {
+    mixed += "Ha" + string(mixed.size() % 7, 'h') + "a! " + to_string(mixed.size() * 31 % 1000) + "\n";
+  }
+  jokes.push_back(mixed);
+  for (int i = 0; i < 20; i++) {
+    jokes.push_back("Witz Nummer " + to_string(i) + ": " + string(i * 3, 'x') + " Ende.");
+  }
+  return jokes;
+}
+
+static void testRoundTrip() {
+  vector<string> jokes = sampleJokes();
+  for (uint8_t windowBits : {BANK_WINDOW_BITS_MIN, (uint8_t)8, BANK_WINDOW_BITS_MAX}) {
+    for (uint8_t lengthBits : {BANK_LENGTH_BITS_MIN, (uint8_t)4, BANK_LENGTH_BITS_MAX}) {
+      for (uint8_t perBlock : {1, 3, 8, 40}) {
+        BankOptions options = {windowBits, lengthBits, perBlock};
+        string name = "window " + to_string(windowBits) + ", length " + to_string(lengthBits) + ", block " +
+                      to_string(perBlock);
+        MemoryBankStorage storage;
+        storage.data = build(jokes, options);
+        JokeBank bank(storage);
+        if (storage.data.empty() || !bank.open() || bank.count() != jokes.size()) {
+          check(false, "open " + name);
+          continue;
+        }
+        // Back to front, then every other one: no state carries over
+        bool same = true;
+        for (size_t i = jokes.size(); i-- > 0;) same = same && readJoke(bank, i) == jokes[i];
+        for (size_t i = 0; i < jokes.size(); i += 2) same = same && readJoke(bank, i) == jokes[i];
+        check(same, "round trip, " + name);
+      }
+    }
+  }
+}
+
+static void testRandomAccess() {
+  vector<string> jokes = sampleJokes();
+  MemoryBankStorage storage;
+  storage.data = build(jokes, BANK_DEFAULT_OPTIONS);
+  JokeBank bank(storage);
+  check(bank.open() && storage.releases == 1, "open releases the file");
+
+  // The last joke only reads its own block, not the bank
+  size_t lastBlock = (jokes.size() - 1) / BANK_DEFAULT_OPTIONS.jokesPerBlock;
+  size_t blockStart = storage.data[BANK_HEADER_SIZE + 4 * lastBlock] | storage.data[BANK_HEADER_SIZE + 4 * lastBlock + 1] << 8;
+  size_t blockBytes = storage.data.size() - blockStart;
+  storage.reads = 0;
+  check(readJoke(bank, jokes.size() - 1) == jokes.back() && storage.releases == 2, "last joke");
+  check(storage.reads <= 1 + (int)((blockBytes + BANK_READ_CHUNK - 1) / BANK_READ_CHUNK), "reads one block");
+
+  bool ok = true;
+  check(readJoke(bank, jokes.size(), &ok) == "<failed>" && !ok, "index past the end");
+}
+
+static void testBuilderInput() {
+  BankOptions options = BANK_DEFAULT_OPTIONS;
+  uint8_t output[4096];
+  const char *empty[] = {"Witz", ""};
+  check(buildJokeBank(empty, 2, options, output, sizeof(output)) == 0, "empty joke refused");
+  string tooLong(JOKE_MAX_LENGTH + 1, 'z');
+  const char *longOne[] = {tooLong.c_str()};
+  check(buildJokeBank(longOne, 1, options, output, sizeof(output)) == 0, "overlong joke refused");
+  const char *fine[] = {"Witz"};
+  check(buildJokeBank(fine, 1, options, output, 20) == 0, "too small an output");
+  BankOptions wide = {BANK_WINDOW_BITS_MAX + 1, 4, 8};
+  check(buildJokeBank(fine, 1, wide, output, sizeof(output)) == 0, "window larger than the decoder's");
+}
+
+static void testDamage() {
+  vector<string> jokes = sampleJokes();
+  vector<uint8_t> good = build(jokes, BANK_DEFAULT_OPTIONS);
+  size_t indexEnd = BANK_HEADER_SIZE + 4 * ((jokes.size() + 7) / 8 + 1);
+
+  MemoryBankStorage storage;
+  JokeBank bank(storage);
+  storage.data = {};
+  check(!bank.open() && bank.count() == 0, "no bank");
+
+  storage.data = good;
+  storage.data[0] = 'X';
+  check(!bank.open(), "bad magic");
+
+  storage.data = good;
+  storage.data[BANK_HEADER_SIZE + 5] ^= 0x01;
+  check(!bank.open(), "index CRC");
+
+  storage.data = good;
+  storage.data.resize(good.size() - 1);
+  check(!bank.open(), "truncated file");
+
+  storage.data = good;
+  storage.data[5] = BANK_WINDOW_BITS_MAX + 1;
+  check(!bank.open() && !bank.read(0, collect, nullptr), "window too large, nothing read");
+
+  // Flipped bits in the blocks: a read may fail or return other text, but
+  // stays within a joke's length and never reads outside the bank
+  bool bounded = true;
+  for (size_t at = indexEnd; at < good.size(); at += 7) {
+    storage.data = good;
+    storage.data[at] ^= 1 << (at % 8);
+    if (!bank.open()) {
+      check(false, "damaged block still opens");
+      break;
+    }
+    for (uint16_t i = 0; i < bank.count(); i++) {
+      string text;
+      bank.read(i, collect, &text);
+      bounded = bounded && text.size() <= JOKE_MAX_LENGTH;
+    }
+  }
+  check(bounded, "damaged blocks stay bounded");
+}
+
+static void testShippedBank() {
+  ifstream corpus("assets/jokes.txt");
+  ifstream shipped("data/jokes.bin", ios::binary);
+  if (!corpus.is_open() || !shipped.is_open()) {
+    check(false, "open assets/jokes.txt and data/jokes.bin");
+    return;
+  }
+  vector<string> jokes;
+  string line;
+  string joke;
+  while (getline(corpus, line)) {
+    if (line.empty()) {
+      if (!joke.empty()) jokes.push_back(joke);
+      joke.clear();
+    } else {
+      joke += (joke.empty() ? "" : " ") + line;
+    }
+  }
+  if (!joke.empty()) jokes.push_back(joke);
+
+  MemoryBankStorage storage;
+  storage.data.assign(istreambuf_iterator<char>(shipped), istreambuf_iterator<char>());
+  JokeBank bank(storage);
+  check(bank.open() && bank.count() == jokes.size(), "shipped bank opens");
+  bool same = bank.count() == jokes.size();
+  for (uint16_t i = 0; i < bank.count() && same; i++) {
+    same = readJoke(bank, i) == jokes[i];
+  }
+  check(same, "shipped bank matches the corpus (rebuild with bench_joke_bank)");
+}
+
+int main() {
+  testRoundTrip();
+  testRandomAccess();
+  testBuilderInput();
+  testDamage();
+  testShippedBank();
+
+  if (failures == 0) {
+    cout << "All joke bank tests passed" << endl;
+    return 0;
+  }
+  cout << failures << " joke bank test(s) failed" << endl;
+  return 1;
+}
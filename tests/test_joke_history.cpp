@@ -0,0 +1,309 @@
+// Host test for the joke history (joke_history.h). Lookups by date and
+// pagination run on a few weeks of jokes, compaction keeps the log within
+// its budget, and a session of daily appends with compactions is replayed
+// with a reset injected after every byte written: recovery must keep
+// every joke whose append had finished, each with its own text, and the
+// history must go on from there.
+//
+// Build & run from the repository root:
+//   g++ -std=c++17 -Ilib/byte_io -Ilib/joke_source tests/test_joke_history.cpp lib/joke_source/joke_history.cpp -o test_joke_history
+//   ./test_joke_history
+
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include "joke_history.h"
+
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool condition, const string &name) {
+  if (!condition) {
+    cout << "FAIL: " << name << endl;
+    failures++;
+  }
+}
+
+// Both files in memory. After `budget` bytes the device "resets": the
+// write in progress stops at that byte and nothing else reaches storage.
+// Each rename of a compaction counts as one byte, so a reset can fall
+// between them; new files that weren't renamed are lost.
+class MemoryStorage : public HistoryStorage {
+public:
+  explicit MemoryStorage(size_t budget = SIZE_MAX) : budget(budget) {}
+
+  size_t size(HistoryFile file) override { return files[file].size(); }
+
+  size_t read(HistoryFile file, size_t offset, uint8_t *data, size_t length) override {
+    const vector<uint8_t> &source = files[file];
+    if (offset >= source.size()) return 0;
+    size_t got = min(length, source.size() - offset);
+    copy(source.begin() + offset, source.begin() + offset + got, data);
+    return got;
+  }
+
+  bool append(HistoryFile file, const uint8_t *data, size_t length) override {
+    vector<uint8_t> &target = rewriting ? temps[file] : files[file];
+    for (size_t i = 0; i < length; i++) {
+      if (!spend()) return false;
+      target.push_back(data[i]);
+    }
+    return true;
+  }
+
+  bool truncate(HistoryFile file, size_t length) override {
+    if (crashed) return false;
+    files[file].resize(min(length, files[file].size()));
+    return true;
+  }
+
+  bool beginRewrite() override {
+    temps[HISTORY_LOG].clear();
+    temps[HISTORY_INDEX].clear();
+    rewriting = !crashed;
+    return rewriting;
+  }
+
+  bool commitRewrite() override {
+    rewriting = false;
+    for (HistoryFile file : {HISTORY_LOG, HISTORY_INDEX}) {
+      if (!spend()) return false;
+      files[file] = temps[file];
+    }
+    rewrites++;
+    return true;
+  }
+
+  void abortRewrite() override { rewriting = false; }
+
+  // Power comes back: what's on flash stays, the rest is gone
+  void restart() {
+    crashed = false;
+    rewriting = false;
+    budget = SIZE_MAX;
+  }
+
+  vector<uint8_t> files[2];
+  vector<uint8_t> temps[2];
+  size_t budget;
+  size_t written = 0;
+  bool crashed = false;
+  bool rewriting = false;
+  int rewrites = 0;
+
+private:
+  bool spend() {
+    if (crashed || written == budget) {
+      crashed = true;
+      return false;
+    }
+    written++;
+    return true;
+  }
+};
+
+static uint32_t dayDate(int day) {
+  // Consecutive days from 2025-01-01, months of 28 days are enough here
+  return 20250000 + (1 + day / 28) * 100 + 1 + day % 28;
+}
+
+static string jokeFor(int day) {
+  string joke = "Witz vom Tag " + to_string(day) + ": ";
+  for (int i = 0; i < day % 9; i++) joke += "Kommt ein Pferd in die Bar. ";
+  return joke + "Ende.";
+}
+
+static void collect(const char *data, size_t length, void *context) {
+  static_cast<string *>(context)->append(data, length);
+}
+
+static string textOf(JokeHistory &history, const HistoryEntry &entry) {
+  string text;
+  return history.readText(entry, collect, &text) ? text : "<failed>";
+}
+
+static void testDates() {
+  uint32_t date = 0;
+  char text[11];
+  check(parseHistoryDate("2025-10-16", date) && date == 20251016, "date parsed");
+  formatHistoryDate(date, text);
+  check(string(text) == "2025-10-16", "date formatted");
+  check(!parseHistoryDate("2025-13-01", date) && !parseHistoryDate("16.10.2025", date) &&
+        !parseHistoryDate("2025-1-01", date) && !parseHistoryDate(nullptr, date), "bad dates refused");
+  check(historyHash("a", 1) != historyHash("b", 1) && historyHash("", 0) == 0xcbf29ce484222325ULL, "FNV-1a");
+}
+
+static void testLookups() {
+  MemoryStorage storage;
+  JokeHistory history(storage, 64 * 1024);
+  check(history.recover() == 0, "empty history");
+  for (int day = 0; day < 40; day++) {
+    string joke = jokeFor(day);
+    check(history.append(dayDate(day), joke.c_str(), joke.size()), "append day " + to_string(day));
+  }
+  check(history.count() == 40 && history.compactions() == 0, "40 days");
+
+  // The same joke again that day is kept once; a second joke that day is kept
+  string again = jokeFor(39);
+  string second = "Noch einer.";
+  check(history.append(dayDate(39), again.c_str(), again.size()) && history.count() == 40, "same joke once");
+  check(history.append(dayDate(39), second.c_str(), second.size()) && history.count() == 41, "second joke that day");
+  check(!history.append(dayDate(10), second.c_str(), second.size()) && history.count() == 41, "earlier date refused");
+
+  HistoryEntry entry;
+  check(history.find(dayDate(17), entry) && textOf(history, entry) == jokeFor(17) &&
+        entry.hash == historyHash(jokeFor(17).c_str(), jokeFor(17).size()), "found by date");
+  check(history.find(dayDate(39), entry) && textOf(history, entry) == second, "last joke of a date");
+  check(!history.find(dayDate(40), entry) && !history.find(20240101, entry), "unknown dates");
+
+  // In pieces, as /api/history sends it
+  history.find(dayDate(17), entry);
+  string pieces;
+  char piece[7];
+  size_t got;
+  while ((got = history.readText(entry, pieces.size(), piece, sizeof(piece))) > 0) {
+    pieces.append(piece, got);
+  }
+  check(pieces == jokeFor(17) && history.readText(entry, entry.length + 1, piece, sizeof(piece)) == 0,
+        "text read in pieces");
+
+  // A page: the 5 before day 20, newest first
+  uint32_t end = history.countBefore(dayDate(20));
+  check(end == 20 && history.countBefore(0) == 41 && history.countBefore(20200101) == 0, "countBefore");
+  bool page = true;
+  for (uint32_t i = 0; i < 5; i++) {
+    page = page && history.entry(end - 1 - i, entry) && entry.date == dayDate(19 - i);
+  }
+  check(page, "page before a date");
+
+  // A restart finds everything again
+  JokeHistory restarted(storage, 64 * 1024);
+  check(restarted.recover() == 41 && restarted.find(dayDate(3), entry) && textOf(restarted, entry) == jokeFor(3),
+        "recovered after a restart");
+}
+
+static void testCompaction() {
+  MemoryStorage storage;
+  const size_t budget = 2048;
+  JokeHistory history(storage, budget);
+  history.recover();
+  bool bounded = true;
+  for (int day = 0; day < 200; day++) {
+    string joke = jokeFor(day);
+    history.append(dayDate(day), joke.c_str(), joke.size());
+    bounded = bounded && storage.files[HISTORY_LOG].size() <= budget &&
+              storage.files[HISTORY_INDEX].size() == history.count() * HISTORY_INDEX_ENTRY;
+  }
+  check(bounded, "log within its budget");
+  check(history.compactions() > 0 && history.healthy(), "compacted");
+
+  HistoryEntry entry;
+  check(history.find(dayDate(199), entry) && textOf(history, entry) == jokeFor(199), "newest kept");
+  check(!history.find(dayDate(0), entry), "oldest dropped");
+  bool ordered = true;
+  uint32_t previous = 0;
+  for (uint32_t i = 0; i < history.count(); i++) {
+    ordered = ordered && history.entry(i, entry) && entry.date > previous &&
+              textOf(history, entry) == jokeFor((int)(i + 200 - history.count()));
+    previous = entry.date;
+  }
+  check(ordered, "kept jokes in order, contiguous up to today");
+
+  // A joke larger than half the budget replaces everything
+  string huge(budget / 2 + 10, 'x');
+  check(history.append(dayDate(200), huge.c_str(), huge.size()) && history.count() == 1, "oversized joke alone");
+}
+
+// Daily appends with compactions; returns the bytes written
+static size_t runSession(MemoryStorage &storage, int days, map<uint32_t, string> *finished) {
+  JokeHistory history(storage, 1024);
+  history.recover();
+  for (int day = 0; day < days; day++) {
+    string joke = jokeFor(day);
+    if (!history.append(dayDate(day), joke.c_str(), joke.size())) break;
+    if (finished) (*finished)[dayDate(day)] = joke;
+  }
+  return storage.written;
+}
+
+static void testResets() {
+  const int days = 30;
+  MemoryStorage reference;
+  size_t total = runSession(reference, days, nullptr);
+  check(reference.rewrites > 2, "session compacts several times");
+
+  int lost = 0;
+  int damaged = 0;
+  int stuck = 0;
+  for (size_t budget = 0; budget <= total; budget++) {
+    MemoryStorage storage(budget);
+    map<uint32_t, string> finished;
+    runSession(storage, days, &finished);
+    storage.restart();
+
+    JokeHistory history(storage, 1024);
+    history.recover();
+    HistoryEntry entry;
+    // The newest finished joke survives, and everything kept is intact
+    if (!finished.empty() && !history.find(finished.rbegin()->first, entry)) lost++;
+    for (uint32_t i = 0; i < history.count(); i++) {
+      if (!history.entry(i, entry)) {
+        damaged++;
+        break;
+      }
+      string expected = jokeFor(0);
+      for (int day = 0; day < days; day++) {
+        if (dayDate(day) == entry.date) expected = jokeFor(day);
+      }
+      if (textOf(history, entry) != expected) {
+        damaged++;
+        break;
+      }
+    }
+    if (storage.files[HISTORY_INDEX].size() != history.count() * HISTORY_INDEX_ENTRY) damaged++;
+
+    // And it goes on
+    string next = "Nach dem Neustart.";
+    if (!history.append(dayDate(days), next.c_str(), next.size()) || !history.find(dayDate(days), entry) ||
+        textOf(history, entry) != next) {
+      stuck++;
+    }
+  }
+  check(lost == 0, "no finished joke lost (" + to_string(lost) + " resets lost one)");
+  check(damaged == 0, "history intact after every reset (" + to_string(damaged) + " damaged)");
+  check(stuck == 0, "history continues after every reset (" + to_string(stuck) + " stuck)");
+}
+
+static void testStaleIndex() {
+  MemoryStorage storage;
+  JokeHistory history(storage, 64 * 1024);
+  history.recover();
+  for (int day = 0; day < 5; day++) {
+    string joke = jokeFor(day);
+    history.append(dayDate(day), joke.c_str(), joke.size());
+  }
+  // An index that doesn't belong to the log is rebuilt from it
+  storage.files[HISTORY_INDEX].assign(3 * HISTORY_INDEX_ENTRY, 0x42);
+  JokeHistory restarted(storage, 64 * 1024);
+  HistoryEntry entry;
+  check(restarted.recover() == 5 && restarted.find(dayDate(4), entry) && textOf(restarted, entry) == jokeFor(4),
+        "foreign index rebuilt");
+}
+
+int main() {
+  testDates();
+  testLookups();
+  testCompaction();
+  testResets();
+  testStaleIndex();
+
+  if (failures == 0) {
+    cout << "All joke history tests passed" << endl;
+    return 0;
+  }
+  cout << failures << " joke history test(s) failed" << endl;
+  return 1;
+}
@@ -0,0 +1,235 @@
+// Host test for the joke source registry and its declarative extractors.
+//
+// The built-in hahaha.de rule must cut tests/html_trimming.txt to its
+// desired output in every chunk size, and handle the page's edge cases
+// (quoting, breaks, references, overflow). Marker, element-id and JSON-path
+// rules are checked on small pages, and the registry's ordering on
+// simulated fetch outcomes: a source that fails drops behind, a faster one
+// moves up, and a recovered one comes back.
+//
+// Build & run from the repository root:
+//   g++ -std=c++17 -Ilib/joke_source -Ilib/text_pipeline tests/test_joke_sources.cpp lib/joke_source/source_extractor.cpp lib/joke_source/source_registry.cpp lib/text_pipeline/html_text.cpp lib/text_pipeline/html_entities.cpp -o test_joke_sources
+//   ./test_joke_sources [path/to/html_trimming.txt]
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "html_text.h"
+#include "source_extractor.h"
+#include "source_registry.h"
+
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool condition, const string &name) {
+  if (!condition) {
+    cout << "FAIL: " << name << endl;
+    failures++;
+  }
+}
+
+static SourceExtractor extractor;
+
+static string extract(const ExtractRule &rule, const string &page, size_t chunkSize) {
+  extractor.begin(rule);
+  const uint8_t *data = (const uint8_t *)page.data();
+  for (size_t offset = 0; offset < page.length(); offset += chunkSize) {
+    if (extractor.feed(data + offset, min(chunkSize, page.length() - offset))) break;
+  }
+  const char *error = extractor.finish();
+  return error ? string(error) : string(extractor.text(), extractor.length());
+}
+
+static void testDefaultSource(const char *path) {
+  ifstream file(path);
+  if (!file.is_open()) {
+    check(false, string("open ") + path);
+    return;
+  }
+  stringstream buffer;
+  buffer << file.rdbuf();
+  string content = buffer.str();
+  size_t htmlStart = content.find("html input:");
+  size_t htmlEnd = content.find("desired output:");
+  if (htmlStart == string::npos || htmlEnd == string::npos) {
+    check(false, string("test sections in ") + path);
+    return;
+  }
+
+  // Surround the snippet with page noise, like the real response
+  string page = "<html><body><div id=\"nav\">&nbsp;</div>" +
+                content.substr(htmlStart + 11, htmlEnd - htmlStart - 11) +
+                "<div id=\"footer\">&copy; hahaha.de</div></body></html>";
+  string desired = content.substr(htmlEnd + 15);
+  desired = desired.substr(desired.find_first_not_of(" \t\n\r"));
+  desired = desired.substr(0, desired.find_last_not_of(" \t\n\r") + 1);
+
+  SourceRegistry registry;
+  addDefaultSources(registry);
+  check(registry.count() == 1 && registry.source(0).type == RULE_MARKERS, "built-in source");
+  ExtractRule rule = registry.source(0).rule();
+
+  check(desired.rfind("Ein Blinder", 0) == 0, "desired output");
+  for (size_t chunk = 1; chunk <= page.length(); chunk++) {
+    if (extract(rule, page, chunk) != desired) {
+      check(false, "built-in rule, chunk size " + to_string(chunk));
+      break;
+    }
+  }
+
+  // Edge cases. Tags are recognised before entities are decoded, so an
+  // escaped "&lt;i&gt;" stays visible text, and breaks become '\n'.
+  const char *cases[][2] = {
+    {"<p>no joke here</p>", "Error: Could not find start marker"},
+    {"<div id='witzdestages'>Single &auml;quotes<br>and <b>bold</b></div>",
+     "Single \xC3\xA4quotes\nand bold"},
+    {"<div id=\"witzdestages\">  &unknown; &amp &lt;i&gt;x &szlig  a > b  </div>",
+     "&unknown; &amp <i>x &szlig a > b"},
+    {"<div id=\"witzdestages\">Never closed", "Error: Could not find end marker"},
+    {"<div id=\"witzdestages\"> <br/> </div>", "Error: Joke extraction resulted in empty text"},
+    {"<div id=\"witzdestages\">Line\none<br />\r\n two</div>", "Line one\ntwo"},
+    {"<div id=\"witzdestages\"><p>One</p> <p>Two<br><br><BR>Three</p><ul><li>a</li><li>b</li></ul></div>",
+     "One\nTwo\n\nThree\na\nb"},
+    {"<div id=\"witzdestages\">a<pre>b</pre><brx>c <a title=\"x>y\" href='<p>'>d</a></div>", "abc d"},
+    {"<div id=\"witzdestages\">Joke<span id='witzdestageslink'>Footer</span></div>", "Joke"},
+    {"<div id=\"witzdestages\">&#228;&#xE4;&eacute;&hellip;&ndash;&#150;</div>",
+     "\xC3\xA4\xC3\xA4\xC3\xA9\xE2\x80\xA6\xE2\x80\x93\xE2\x80\x93"},
+  };
+  for (auto &testCase : cases) {
+    check(extract(rule, testCase[0], 3) == testCase[1], string("built-in rule: ") + testCase[0]);
+  }
+
+  // Jokes that don't fit the buffer are rejected instead of truncated
+  string longJoke = "<div id=\"witzdestages\">" + string(JOKE_MAX_LENGTH + 10, 'x') + "</div>";
+  check(extract(rule, longJoke, 64) == "Error: Joke too long for buffer", "overflow is reported");
+
+  // The cleaner on its own truncates instead of overflowing the buffer
+  char small[8];
+  size_t smallLength = cleanHTMLText("<p>Hallo   Welt</p>", 19, small, sizeof(small));
+  check(smallLength == 7 && string(small) == "Hallo W", "cleaner truncates to capacity");
+}
+
+static void testMarkers() {
+  ExtractRule rule = {RULE_MARKERS, "<!-- joke -->", "<!-- /joke -->|ENDE"};
+  check(extract(rule, "x<!-- joke -->Ein <i>Witz</i><!-- /joke -->y", 1) == "Ein Witz", "markers");
+  // An end marker that isn't a tag doesn't leak into the text
+  check(extract(rule, "<!-- joke -->Kurz und gut ENDE mehr", 2) == "Kurz und gut", "plain-text end marker");
+  check(extract(rule, "<!-- joke -->EN EN ENDE", 1) == "EN EN", "partial end markers are text");
+  check(extract(rule, "nothing", 1) == "Error: Could not find start marker", "start missing");
+  check(extract(rule, "<!-- joke -->open", 1) == "Error: Could not find end marker", "end missing");
+
+  ExtractRule noEnd = {RULE_MARKERS, "<p>", ""};
+  check(extract(noEnd, "<p>x</p>", 1) == "Error: Rule needs start and end markers", "rule without an end");
+}
+
+static void testElementId() {
+  ExtractRule rule = {RULE_ELEMENT_ID, "joke", nullptr};
+  check(extract(rule, "<div class=\"a\"><p id=\"joke\" class='x'>Ein &quot;Witz&quot;</p><p>nope</p></div>", 1) ==
+        "Ein \"Witz\"", "element by id");
+  // Nested elements of the same name belong to it, tag names in any case
+  check(extract(rule, "<DIV id='joke'><div>Eins</div><div>Zwei</div>Drei</div><div>Vier</div>", 4) ==
+        "Eins\nZwei\nDrei", "nested elements");
+  check(extract(rule, "<div data-id=\"joke\">x</div>", 1) == "Error: Could not find element", "data-id isn't id");
+  check(extract(rule, "<div id=\"joke\"/>", 1) == "Error: Element is empty", "empty element");
+  check(extract(rule, "<section id=\"joke\">Offen <section>x</section>", 1) == "Error: Element not closed",
+        "unclosed element");
+}
+
+static void testJsonPath() {
+  ExtractRule plain = {RULE_JSON_PATH, "joke", nullptr};
+  string page = "{\"id\":\"R7UfaahVfFd\",\"joke\":\"My dog used to chase people on a bike a lot. "
+                "It got so bad I had to take his bike away.\",\"status\":200}";
+  check(extract(plain, page, 1) ==
+        "My dog used to chase people on a bike a lot. It got so bad I had to take his bike away.", "top-level key");
+
+  ExtractRule nested = {RULE_JSON_PATH, "$.value.jokes[1].text", nullptr};
+  string api = "{ \"type\" : \"success\", \"value\" : { \"count\": 2, \"flags\": [true, null, -1.5e3],"
+               " \"jokes\" : [ {\"text\": \"erster\"}, {\"tags\": {}, \"text\": \"Zwei\\nZeilen \\u00e4\\ud83d\\ude00"
+               " \\\"zitiert\\\"\"} ] } }";
+  for (size_t chunk = 1; chunk <= api.length(); chunk++) {
+    if (extract(nested, api, chunk) != "Zwei\nZeilen \xC3\xA4\xF0\x9F\x98\x80 \"zitiert\"") {
+      check(false, "nested path, chunk size " + to_string(chunk));
+      break;
+    }
+  }
+
+  // Keys that only start like the one on the path, and the same key elsewhere
+  ExtractRule setup = {RULE_JSON_PATH, "setup", nullptr};
+  check(extract(setup, "{\"setupX\":\"a\",\"other\":{\"setup\":\"b\"},\"setup\":\"c\"}", 5) == "c",
+        "keys match exactly and only at their depth");
+
+  ExtractRule root = {RULE_JSON_PATH, "[0]", nullptr};
+  check(extract(root, "[\"  Witz  \", \"zwei\"]", 1) == "Witz", "array index, trimmed");
+
+  check(extract(plain, "{\"joke\":42}", 1) == "Error: JSON value is not a string", "number at the path");
+  check(extract(plain, "{\"jokes\":[]}", 1) == "Error: JSON path not found", "path missing");
+  check(extract(plain, "{\"joke\" \"x\"}", 1) == "Error: Invalid JSON", "syntax error");
+  check(extract(plain, "{\"joke\":\"   \"}", 1) == "Error: Joke extraction resulted in empty text", "empty joke");
+  ExtractRule broken = {RULE_JSON_PATH, "a..b", nullptr};
+  check(extract(broken, "{}", 1) == "Error: Invalid JSON path", "bad path");
+
+  string longJoke = "{\"joke\":\"" + string(JOKE_MAX_LENGTH + 1, 'x') + "\"}";
+  check(extract(plain, longJoke, 64) == "Error: Joke too long for buffer", "overflow");
+}
+
+static void testRegistry() {
+  SourceRegistry registry;
+  check(registry.add("hahaha", "https://a.example/", RULE_MARKERS, "<a>", "</a>") &&
+        registry.add("api", "https://b.example/joke", RULE_JSON_PATH, "joke", nullptr) &&
+        registry.add("local", "http://192.168.1.5/", RULE_ELEMENT_ID, "joke", nullptr), "sources added");
+  check(!registry.add("api", "https://c.example/", RULE_JSON_PATH, "joke", nullptr), "names are unique");
+  check(!registry.add("bad", "https://c.example/", RULE_MARKERS, "<a>", ""), "markers need an end");
+  check(!registry.add(string(SOURCE_NAME_MAX + 1, 'n').c_str(), "https://c.example/", RULE_JSON_PATH, "j", nullptr),
+        "long names are rejected");
+
+  uint8_t order[JOKE_SOURCES_MAX];
+  registry.order(order);
+  check(order[0] == 0 && order[1] == 1 && order[2] == 2, "untried sources keep the configured order");
+
+  // hahaha.de times out twice: the others move ahead
+  registry.record(0, false, 10000);
+  registry.record(0, false, 10000);
+  registry.record(1, true, 1800);
+  registry.record(2, true, 400);
+  registry.order(order);
+  check(order[0] == 2 && order[1] == 1 && order[2] == 0, "failing source drops, fastest first");
+
+  // The local one goes down; after a few failures the API is preferred
+  registry.record(2, false, 5000);
+  registry.record(2, false, 5000);
+  registry.record(2, false, 5000);
+  registry.order(order);
+  check(order[0] == 1, "a source that went down is passed over");
+
+  // hahaha.de recovers
+  for (int i = 0; i < 10; i++) {
+    registry.record(0, true, 900);
+  }
+  registry.order(order);
+  check(order[0] == 0, "a recovered source comes back");
+  check(registry.source(0).stats.attempts == 12 && registry.source(0).stats.successes == 10, "counts");
+
+  // Saved stats come back by name, even in a different configuration
+  SourceStats saved = registry.source(1).stats;
+  SourceRegistry restarted;
+  restarted.add("api", "https://b.example/joke", RULE_JSON_PATH, "joke", nullptr);
+  check(restarted.restoreStats("api", saved) && !restarted.restoreStats("gone", saved) &&
+        restarted.source(0).stats.latencyMillis == saved.latencyMillis, "stats restored");
+}
+
+int main(int argc, char **argv) {
+  testDefaultSource(argc > 1 ? argv[1] : "tests/html_trimming.txt");
+  testMarkers();
+  testElementId();
+  testJsonPath();
+  testRegistry();
+
+  if (failures == 0) {
+    cout << "All joke source tests passed" << endl;
+    return 0;
+  }
+  cout << failures << " joke source test(s) failed" << endl;
+  return 1;
+}
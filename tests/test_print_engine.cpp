@@ -0,0 +1,715 @@
+// Host test for the queue-driven print engine, the baud rate probe,
+// pre-rendered print images and the print job queue against a mock
+// transport, simulated printers that answer status queries, and a
+// simulated millisecond clock.
+//
+// Build & run from the repository root:
+//   g++ -std=c++17 -Ilib/byte_io -Ilib/print_engine tests/test_print_engine.cpp lib/print_engine/*.cpp -o test_print_engine
+//   ./test_print_engine
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include "print_engine.h"
+#include "baud_probe.h"
+#include "print_image.h"
+#include "print_job_queue.h"
+
+using namespace std;
+
+static uint32_t simulatedMillis = 0;
+
+static uint32_t simulatedClock() {
+  return simulatedMillis;
+}
+
+// For blocking code: time passes while it polls
+static uint32_t tickingClock() {
+  return simulatedMillis++;
+}
+
+// Records every byte with the simulated time it was written
+class MockTransport : public PrinterTransport {
+public:
+  size_t write(uint8_t byte) override {
+    bytes.push_back(byte);
+    times.push_back(simulatedMillis);
+    return 1;
+  }
+
+  string text() const { return string(bytes.begin(), bytes.end()); }
+
+  vector<uint8_t> bytes;
+  vector<uint32_t> times;
+};
+
+// A printer on a two-way line. It answers DLE EOT n at once and GS r 1 once
+// every line before it has printed, takes lineTime ms per line, and can be
+// switched out of paper, overheated or told to send XOFF/XON. Commands are
+// stripped so text holds only what would be printed.
+class FakePrinter : public PrinterTransport {
+public:
+  explicit FakePrinter(uint32_t lineTime, bool answers = true)
+    : lineTime(lineTime), answers(answers) {}
+
+  size_t write(uint8_t byte) override {
+    command.push_back(byte);
+    if (command[0] == 0x10) {            // DLE EOT n
+      if (command.size() < 3) return 1;
+      queries++;
+      reply(simulatedMillis, statusReply(command[2]));
+      command.clear();
+      return 1;
+    }
+    if (command[0] == 0x1D) {            // GS r 1
+      if (command.size() < 3) return 1;
+      // Offline (paper out) the printer doesn't work through its buffer
+      if (!paperOut) reply(max(busyUntil, simulatedMillis), paperNearEnd ? 0x0C : 0x00);
+      command.clear();
+      return 1;
+    }
+    command.clear();
+    text.push_back((char)byte);
+    if (byte == '\n') {
+      busyUntil = max(busyUntil, simulatedMillis) + lineTime;
+      lineDone.push_back(busyUntil);
+      size_t buffered = count_if(lineDone.begin(), lineDone.end(),
+                                 [](uint32_t done) { return done > simulatedMillis; });
+      maxLinesBuffered = max(maxLinesBuffered, buffered);
+    }
+    return 1;
+  }
+
+  bool canRead() const override { return true; }
+
+  int read() override {
+    // Earliest reply that is due
+    size_t best = replies.size();
+    for (size_t i = 0; i < replies.size(); i++) {
+      if (replies[i].first <= simulatedMillis && (best == replies.size() || replies[i].first < replies[best].first)) {
+        best = i;
+      }
+    }
+    if (best == replies.size()) return -1;
+    uint8_t byte = replies[best].second;
+    replies.erase(replies.begin() + best);
+    return byte;
+  }
+
+  void reply(uint32_t at, uint8_t byte) {
+    if (answers) replies.push_back(make_pair(at, byte));
+  }
+
+  uint8_t statusReply(uint8_t n) const {
+    uint8_t status = 0x12;
+    if (n == 2) status |= (coverOpen ? 0x04 : 0) | (paperOut ? 0x20 : 0);
+    if (n == 3) status |= overheated ? 0x40 : 0;
+    if (n == 4) status |= (paperOut ? 0x60 : 0) | (paperNearEnd ? 0x0C : 0);
+    return status;
+  }
+
+  uint32_t lineTime;
+  bool answers;
+  bool paperOut = false;
+  bool paperNearEnd = false;
+  bool coverOpen = false;
+  bool overheated = false;
+
+  string text;
+  size_t queries = 0;
+  size_t maxLinesBuffered = 0;
+
+private:
+  vector<uint8_t> command;
+  vector<pair<uint32_t, uint8_t>> replies;
+  vector<uint32_t> lineDone;
+  uint32_t busyUntil = 0;
+};
+
+// A printer listening at one baud rate. At any other rate our bytes arrive
+// garbled and it answers with noise; the very first noise byte happens to
+// look like a status reply.
+class BaudPrinter : public PrinterTransport {
+public:
+  BaudPrinter(uint32_t baud, bool receive = true, uint32_t powerUpAt = 0)
+    : baud(baud), receive(receive), powerUpAt(powerUpAt) {}
+
+  size_t write(uint8_t byte) override {
+    if (simulatedMillis < powerUpAt) return 1;
+    if (currentBaud != baud) {
+      replies.push_back(noiseBytes++ == 0 ? 0x12 : 0xF0);
+      return 1;
+    }
+    command.push_back(byte);
+    if (command.size() == 3) {
+      if (command[0] == 0x10 && command[1] == 0x04 && command[2] == 1) replies.push_back(0x16);
+      command.clear();
+    }
+    return 1;
+  }
+
+  bool canRead() const override { return receive; }
+
+  int read() override {
+    if (replies.empty()) return -1;
+    uint8_t byte = replies.front();
+    replies.erase(replies.begin());
+    return byte;
+  }
+
+  bool setBaudRate(uint32_t rate) override {
+    currentBaud = rate;
+    command.clear();
+    return true;
+  }
+
+  uint32_t baud;
+  bool receive;
+  uint32_t powerUpAt;
+  uint32_t currentBaud = 0;
+
+private:
+  vector<uint8_t> command;
+  vector<uint8_t> replies;
+  size_t noiseBytes = 0;
+};
+
+static int failures = 0;
+
+static void check(bool condition, const string &name) {
+  if (!condition) {
+    cout << "FAIL: " << name << endl;
+    failures++;
+  }
+}
+
+// Run the main loop every step ms until the engine is idle
+static uint32_t drain(PrintEngine &engine, uint32_t step = 10, uint32_t limit = 600000) {
+  uint32_t start = simulatedMillis;
+  engine.update();
+  while (!engine.idle() && simulatedMillis - start < limit) {
+    simulatedMillis += step;
+    engine.update();
+  }
+  return simulatedMillis - start;
+}
+
+// Run the main loop for a while regardless of state
+static void run(PrintEngine &engine, uint32_t duration, uint32_t step = 10) {
+  for (uint32_t t = 0; t < duration; t += step) {
+    simulatedMillis += step;
+    engine.update();
+  }
+}
+
+static string receipt(int lines) {
+  string text;
+  for (int i = 0; i < lines; i++) {
+    text += string(32, 'a' + i % 26) + "\r\n";
+  }
+  return text;
+}
+
+static void queueReceipt(PrintEngine &engine, int lines) {
+  for (int i = 0; i < lines; i++) {
+    engine.println(string(32, 'a' + i % 26).c_str());
+  }
+  engine.endJob();
+}
+
+static void testPassThrough() {
+  simulatedMillis = 1000;
+  MockTransport mock;
+  PrintEngine engine;
+  engine.begin(&mock, simulatedClock);
+
+  const uint8_t setup[] = {0x1B, '7', 15, 150, 250, 0xFF, 0x00, 0xFF};
+  check(engine.write(setup, sizeof(setup)), "queue command bytes");
+  check(engine.println("Hallo"), "queue a line");
+  check(engine.endJob(), "end job");
+
+  // Queueing never touches the transport
+  check(mock.bytes.empty(), "nothing sent before update()");
+  check(engine.state() == PRINT_SENDING && engine.jobsQueued() == 1, "job is queued");
+
+  drain(engine);
+  vector<uint8_t> expected(setup, setup + sizeof(setup));
+  for (char c : string("Hallo\r\n")) expected.push_back((uint8_t)c);
+  check(mock.bytes == expected, "bytes pass through unchanged, including 0xFF");
+  check(engine.jobsCompleted() == 1 && engine.bytesSent() == expected.size(), "progress counters");
+}
+
+static void testRate() {
+  simulatedMillis = 0;
+  MockTransport mock;
+  PrintEngine engine;
+  engine.begin(&mock, simulatedClock);
+  PrintPacing pacing = {1000, 0, 16, 3};
+  engine.setPacing(pacing);
+
+  string block(2000, 'x');
+  engine.print(block.c_str());
+
+  // Never ahead of bytesPerSecond (plus one burst)
+  bool withinRate = true;
+  for (int i = 0; i < 100; i++) {
+    simulatedMillis += 10;
+    engine.update();
+    if (mock.bytes.size() > simulatedMillis * 1000 / 1000 + 16) withinRate = false;
+  }
+  check(withinRate, "output stays within bytesPerSecond");
+  check(mock.bytes.size() >= 900, "output keeps up with bytesPerSecond");
+
+  // One long gap in the loop doesn't turn into a huge burst
+  size_t before = mock.bytes.size();
+  simulatedMillis += 5000;
+  engine.update();
+  check(mock.bytes.size() - before <= 16, "bursts are capped after a stall");
+}
+
+static void testPauses() {
+  simulatedMillis = 0;
+  MockTransport mock;
+  PrintEngine engine;
+  engine.begin(&mock, simulatedClock);
+  PrintPacing pacing = {960, 50, 16, 3};
+  engine.setPacing(pacing);
+
+  engine.print("A");
+  engine.pause(300);
+  engine.println("B");
+  engine.print("C");
+  drain(engine, 5);
+
+  check(mock.text() == "AB\r\nC", "pause markers are not sent");
+  check(mock.times[1] - mock.times[0] >= 300, "queued pause is honoured");
+  check(mock.times[4] - mock.times[3] >= 50, "line pacing after a newline");
+  check(engine.state() == PRINT_IDLE, "idle when drained");
+}
+
+static void testFullBuffer() {
+  simulatedMillis = 0;
+  MockTransport mock;
+  PrintEngine engine;
+  engine.begin(&mock, simulatedClock);
+
+  string big(PRINT_BUFFER_SIZE - 1, 'y');
+  check(engine.print(big.c_str()), "fill all but one byte");
+  check(!engine.print("zz"), "write that doesn't fit is rejected");
+  check(!engine.write(0xFF), "escaped byte needs two slots");
+  check(engine.pending() == PRINT_BUFFER_SIZE - 1, "rejected writes queue nothing");
+  check(engine.writesRejected() == 2, "rejections are counted");
+
+  // The ring buffer wraps around cleanly
+  drain(engine, 10);
+  check(engine.print("wrap"), "space again after draining");
+  drain(engine, 10);
+  check(mock.text() == big + "wrap", "wrapped data arrives in order");
+
+  // 0xFF (what NBSP transcodes to) takes two slots: a line that only fits
+  // unescaped is rejected whole instead of losing its line end
+  PrintEngine tight;
+  tight.begin(&mock, simulatedClock);
+  check(tight.print(string(PRINT_BUFFER_SIZE - 5, 'y').c_str()), "leave five bytes free");
+  check(!tight.println("\xFF\xFF"), "escaped line that doesn't fit is rejected");
+  check(tight.pending() == PRINT_BUFFER_SIZE - 5, "rejected line queues nothing");
+  check(tight.println("\xFF"), "escaped line that fits is queued");
+  check(tight.pending() == PRINT_BUFFER_SIZE - 1, "escape and line end both queued");
+}
+
+static bool appendImage(const uint8_t *data, size_t length, void *context) {
+  vector<uint8_t> *image = static_cast<vector<uint8_t> *>(context);
+  image->insert(image->end(), data, data + length);
+  return true;
+}
+
+static bool failImage(const uint8_t *, size_t, void *) {
+  return false;
+}
+
+static void composeJob(PrintSink &sink) {
+  sink.print("A");
+  sink.write((uint8_t)0xFF);
+  sink.pause(300);
+  sink.println("B");
+  sink.print(string(100, 'c').c_str());
+}
+
+static void testPrintImage() {
+  simulatedMillis = 0;
+  MockTransport direct;
+  PrintEngine engine;
+  engine.begin(&direct, simulatedClock);
+  composeJob(engine);
+  engine.endJob();
+  drain(engine, 5);
+
+  vector<uint8_t> image;
+  PrintImageEncoder encoder(appendImage, &image);
+  composeJob(encoder);
+  check(encoder.finish() && encoder.size() == image.size(), "image is flushed completely");
+  check(image.size() == 1 + 2 + 4 + 3 + 100, "0xFF and the pause are encoded");
+
+  // Odd chunks split the escaped byte and the pause marker
+  simulatedMillis = 0;
+  MockTransport streamed;
+  engine.begin(&streamed, simulatedClock);
+  for (size_t offset = 0; offset < image.size(); offset += 3) {
+    check(engine.writeImage(image.data() + offset, min((size_t)3, image.size() - offset)), "image chunk queued");
+    simulatedMillis += 5;
+    engine.update();
+  }
+  engine.endJob();
+  drain(engine, 5);
+
+  check(streamed.bytes == direct.bytes, "streamed image prints like the queued job");
+  check(streamed.times[2] - streamed.times[1] >= 300, "pause inside the image is honoured");
+  check(engine.jobsCompleted() == 1, "image job completes");
+
+  PrintImageEncoder failing(failImage, nullptr);
+  composeJob(failing);
+  check(!failing.finish(), "output errors are reported");
+}
+
+static void testReceiptTiming() {
+  simulatedMillis = 0;
+  MockTransport mock;
+  PrintEngine engine;
+  engine.begin(&mock, simulatedClock);
+
+  // A joke-sized receipt: 25 lines of 32 characters
+  for (int i = 0; i < 25; i++) {
+    engine.println(string(32, 'a' + i % 26).c_str());
+  }
+  engine.endJob();
+
+  uint32_t elapsed = drain(engine, 10);
+  // Per line: 50 ms of line pacing, one 16-byte burst, then the other 18
+  // bytes at 960 B/s
+  check(elapsed >= 25 * 68 && elapsed < 25 * 120, "receipt drains at the paced rate");
+  check(engine.jobsCompleted() == 1, "receipt completed");
+}
+
+static void testFeedbackPacing() {
+  simulatedMillis = 0;
+  FakePrinter printer(20);
+  PrintEngine engine;
+  engine.begin(&printer, simulatedClock);
+
+  queueReceipt(engine, 25);
+  uint32_t elapsed = drain(engine, 10);
+  check(printer.text == receipt(25), "feedback: text arrives intact");
+  check(engine.status().known, "feedback: printer answers");
+  // Fixed pacing needs at least 25 * 68 ms (testReceiptTiming); a fast
+  // printer is now only limited by the line rate
+  check(elapsed < 25 * 50, "feedback: faster than fixed line pauses");
+  check(engine.lineMillis() >= 20 && engine.lineMillis() <= 35, "feedback: line time is measured");
+  check(engine.jobsCompleted() == 1, "feedback: receipt completed");
+}
+
+static void testFeedbackWindow() {
+  simulatedMillis = 0;
+  FakePrinter printer(200);
+  PrintEngine engine;
+  engine.begin(&printer, simulatedClock);
+
+  queueReceipt(engine, 20);
+  uint32_t elapsed = drain(engine, 10);
+  check(printer.text == receipt(20), "slow printer: text arrives intact");
+  check(printer.maxLinesBuffered <= 3, "slow printer: at most linesInFlight lines buffered");
+  check(elapsed < 20 * 200 + 500, "slow printer: output keeps the printer busy");
+  check(engine.lineMillis() >= 190 && engine.lineMillis() <= 230, "slow printer: line time is measured");
+}
+
+static void testJobLines() {
+  simulatedMillis = 0;
+  FakePrinter printer(100);
+  PrintEngine engine;
+  engine.begin(&printer, simulatedClock);
+
+  queueReceipt(engine, 3);
+  queueReceipt(engine, 10);
+  run(engine, 600);
+  uint16_t midway = engine.jobLinesPrinted();
+  size_t printedLines = count(printer.text.begin(), printer.text.end(), '\n');
+  check(engine.jobsCompleted() == 1 && midway > 0 && (size_t)midway + 3 <= printedLines,
+        "job lines count from the current job, confirmed lines only");
+  drain(engine, 10);
+  check(engine.jobLinesPrinted() == 0 && engine.jobsCompleted() == 2, "job lines restart with the next job");
+}
+
+static void testPaperOut() {
+  simulatedMillis = 0;
+  FakePrinter printer(50);
+  PrintEngine engine;
+  engine.begin(&printer, simulatedClock);
+
+  queueReceipt(engine, 30);
+  run(engine, 300);
+  printer.paperOut = true;
+  run(engine, 2000);
+  check(engine.status().paperOut && engine.state() == PRINT_BLOCKED, "paper out is reported");
+
+  size_t printedWhileOut = printer.text.size();
+  run(engine, 3000);
+  check(printer.text.size() == printedWhileOut, "nothing is sent without paper");
+  check(engine.pending() > 0 && engine.writesRejected() == 0, "queued receipt is kept");
+
+  printer.paperOut = false;
+  drain(engine, 10);
+  check(!engine.status().paperOut, "paper out clears");
+  check(printer.text == receipt(30), "receipt completes after reloading paper");
+}
+
+static void testFlowControl() {
+  simulatedMillis = 0;
+  FakePrinter printer(20);
+  PrintEngine engine;
+  engine.begin(&printer, simulatedClock);
+
+  queueReceipt(engine, 20);
+  run(engine, 200);
+  printer.reply(simulatedMillis, 0x13);  // XOFF
+  run(engine, 20);
+  size_t stoppedAt = printer.text.size();
+  check(engine.state() == PRINT_BLOCKED && engine.status().flowStopped, "XOFF blocks output");
+  run(engine, 2000);
+  check(printer.text.size() - stoppedAt <= 34, "XOFF stops output at the next line");
+
+  printer.reply(simulatedMillis, 0x11);  // XON
+  drain(engine, 10);
+  check(printer.text == receipt(20), "XON resumes output");
+}
+
+static void testOverheat() {
+  simulatedMillis = 0;
+  FakePrinter printer(20);
+  PrintEngine engine;
+  engine.begin(&printer, simulatedClock);
+
+  // An idle printer gets one query every 5 s, all three after 15 s
+  printer.overheated = true;
+  run(engine, 15000);
+  queueReceipt(engine, 5);
+  run(engine, 2000);
+  check(engine.status().overheated && engine.state() == PRINT_BLOCKED, "overheating blocks output");
+  check(printer.text.empty(), "nothing printed while overheated");
+
+  printer.overheated = false;
+  drain(engine, 10);
+  check(printer.text == receipt(5), "printing resumes after cooling down");
+}
+
+static void testPausesEndEarly() {
+  simulatedMillis = 0;
+  FakePrinter printer(20);
+  PrintEngine engine;
+  engine.begin(&printer, simulatedClock);
+  run(engine, 100);
+
+  engine.println("A");
+  engine.pause(3000);
+  engine.println("B");
+  size_t before = printer.text.size();
+  uint32_t start = simulatedMillis;
+  drain(engine, 10);
+  check(printer.text.substr(before) == "A\r\nB\r\n", "pause with feedback: text intact");
+  check(simulatedMillis - start < 500, "pause ends once the printer caught up");
+}
+
+static void testSilentPrinter() {
+  simulatedMillis = 0;
+  FakePrinter printer(20, false);
+  PrintEngine engine;
+  engine.begin(&printer, simulatedClock);
+
+  queueReceipt(engine, 25);
+  uint32_t elapsed = drain(engine, 10);
+  check(printer.text == receipt(25), "silent printer: text arrives intact");
+  check(!engine.status().known && !engine.blocked(), "silent printer: status unknown, not blocked");
+  check(elapsed >= 25 * 68, "silent printer: falls back to fixed pacing");
+  check(printer.queries > 0 && printer.queries < 20, "silent printer: polls sparingly");
+}
+
+static void testBaudProbe() {
+  simulatedMillis = 0;
+  BaudPrinter printer(38400);
+  uint32_t found = probeBaudRate(printer, PRINTER_BAUD_RATES, PRINTER_BAUD_RATE_COUNT, tickingClock, 3000);
+  check(found == 38400 && printer.currentBaud == 38400, "probe finds the printer's rate");
+  check(simulatedMillis < 500, "probe is quick when the printer is up");
+
+  simulatedMillis = 0;
+  BaudPrinter slowStart(115200, true, 800);
+  found = probeBaudRate(slowStart, PRINTER_BAUD_RATES, PRINTER_BAUD_RATE_COUNT, tickingClock, 3000);
+  check(found == 115200 && simulatedMillis >= 800, "probe waits for the printer to power up");
+
+  simulatedMillis = 0;
+  BaudPrinter silent(9600, true, 100000);
+  found = probeBaudRate(silent, PRINTER_BAUD_RATES, PRINTER_BAUD_RATE_COUNT, tickingClock, 1000);
+  check(found == 0 && simulatedMillis >= 1000 && simulatedMillis < 1500, "probe gives up after its budget");
+
+  simulatedMillis = 0;
+  BaudPrinter txOnly(9600, false);
+  found = probeBaudRate(txOnly, PRINTER_BAUD_RATES, PRINTER_BAUD_RATE_COUNT, tickingClock, 1000);
+  check(found == 0 && simulatedMillis == 0, "nothing to probe without a receive line");
+
+  FakePrinter fixedSpeed(20);
+  found = probeBaudRate(fixedSpeed, PRINTER_BAUD_RATES, PRINTER_BAUD_RATE_COUNT, tickingClock, 1000);
+  check(found == 0 && fixedSpeed.queries == 0, "fixed-speed transports are left alone");
+
+  PrintPacing fast = pacingForBaudRate(115200, 128);
+  check(fast.bytesPerSecond == 11520 && fast.maxBurst == 128, "pacing follows the baud rate");
+  check(pacingForBaudRate(9600, 16).bytesPerSecond == 960, "9600 baud is 960 bytes per second");
+}
+
+static void testPrintJobQueue() {
+  PrintJobQueue queue;
+  check(queue.next() == nullptr && queue.depth() == 0, "job queue starts empty");
+
+  uint32_t joke = queue.add(PRINT_JOB_JOKE, PRINT_PRIORITY_LOW);
+  uint32_t first = queue.add(PRINT_JOB_RECEIPT, PRINT_PRIORITY_NORMAL, "Hallo", 5, "2025-06-07");
+  uint32_t second = queue.add(PRINT_JOB_RECEIPT, PRINT_PRIORITY_NORMAL, "Welt", 4);
+  uint32_t info = queue.add(PRINT_JOB_SERVER_INFO, PRINT_PRIORITY_HIGH);
+  check(joke == 1 && first == 2 && second == 3 && info == 4, "job IDs count up from 1");
+  check(queue.depth() == 4 && queue.queued(PRINT_JOB_JOKE)->id == joke, "queued jobs are found by type");
+
+  const PrintJob *receipt = queue.find(first);
+  check(receipt && string(receipt->text) == "Hallo" && receipt->textLength == 5 &&
+        string(receipt->date) == "2025-06-07", "receipt text and date are copied");
+  check(queue.find(second)->date[0] == '\0', "no date means today");
+
+  // Highest priority first, then first come first served
+  PrintJob *job = queue.next();
+  check(job && job->id == info, "high priority prints first");
+  queue.start(*job, 1);
+  check(queue.next()->id == first, "same priority prints in order");
+  queue.start(*queue.next(), 2);
+  queue.start(*queue.next(), 3);
+  check(queue.next()->id == joke, "low priority prints last");
+  check(queue.find(info)->status == PRINT_JOB_PRINTING, "started jobs are printing");
+
+  queue.update(2);
+  check(queue.find(info)->status == PRINT_JOB_DONE && queue.find(first)->status == PRINT_JOB_DONE &&
+        queue.find(second)->status == PRINT_JOB_PRINTING, "jobs are done once the engine drained them");
+  check(queue.depth() == 2, "depth counts queued and printing jobs");
+
+  PrintJob *jokeJob = queue.next();
+  queue.fail(*jokeJob);
+  check(queue.find(joke)->status == PRINT_JOB_FAILED && !queue.queued(PRINT_JOB_JOKE), "failed jobs are finished");
+
+  // Too long for the slot: rejected, nothing queued
+  string longText(PRINT_JOB_TEXT_MAX + 1, 'x');
+  check(queue.add(PRINT_JOB_RECEIPT, PRINT_PRIORITY_NORMAL, longText.c_str(), longText.size()) == 0,
+        "text longer than a slot is rejected");
+  check(queue.add(PRINT_JOB_RECEIPT, PRINT_PRIORITY_NORMAL, "x", 1, "2025-06-07 12:00") == 0,
+        "overlong date is rejected");
+  check(queue.depth() == 1 && queue.jobsRejected() == 2, "rejected jobs are counted, not queued");
+
+  // Finished slots are reused oldest first; unfinished ones never
+  uint32_t id = 0;
+  for (int i = 0; i < PRINT_JOB_SLOTS - 1; i++) {
+    id = queue.add(PRINT_JOB_RECEIPT, PRINT_PRIORITY_NORMAL, "x", 1);
+  }
+  check(id != 0 && queue.full(), "finished slots are reused");
+  check(queue.find(info) == nullptr && queue.find(joke) == nullptr && queue.find(second) != nullptr,
+        "oldest finished jobs are replaced, printing ones kept");
+  check(queue.add(PRINT_JOB_JOKE, PRINT_PRIORITY_LOW) == 0 && queue.jobsRejected() == 3, "full queue rejects jobs");
+
+  queue.update(3);
+  check(!queue.full() && queue.add(PRINT_JOB_JOKE, PRINT_PRIORITY_LOW, nullptr, 0, nullptr, true) != 0,
+        "a drained job makes room");
+
+  // A streamed message takes its slot before it is complete
+  PrintJobQueue streamed;
+  uint32_t upload = streamed.reserve(PRINT_PRIORITY_NORMAL, "07/06/2025");
+  check(upload != 0 && streamed.next() == nullptr && streamed.depth() == 1 &&
+        streamed.find(upload)->status == PRINT_JOB_RECEIVING, "receiving jobs wait for their message");
+  check(streamed.commit(upload, 5000) && streamed.next()->id == upload &&
+        streamed.find(upload)->textInFile && streamed.find(upload)->textLength == 5000, "committed jobs print");
+  check(!streamed.commit(upload, 1), "a job is committed once");
+  streamed.fail(*streamed.find(upload));
+  for (int i = 0; i < PRINT_JOB_SLOTS - 1; i++) {
+    streamed.add(PRINT_JOB_RECEIPT, PRINT_PRIORITY_NORMAL, "x", 1);
+  }
+  check(streamed.add(PRINT_JOB_RECEIPT, PRINT_PRIORITY_NORMAL, "x", 1) == 0, "a finished job keeps its file's slot");
+  streamed.find(upload)->textInFile = false;
+  check(streamed.add(PRINT_JOB_RECEIPT, PRINT_PRIORITY_NORMAL, "x", 1) != 0, "the slot is free once the file is gone");
+
+  // A batch is held back until all of it is in
+  PrintJobQueue batch;
+  uint32_t milk = batch.hold(PRINT_PRIORITY_NORMAL, "Milch", 5);
+  uint32_t eggs = batch.hold(PRINT_PRIORITY_NORMAL, "Eier", 4, "2025-07-04");
+  check(milk != 0 && eggs != 0 && batch.next() == nullptr && !batch.find(milk)->textInFile,
+        "held jobs wait with their text");
+  check(batch.commit(milk) && batch.commit(eggs) && batch.next()->id == milk &&
+        batch.find(eggs)->textLength == 4 && string(batch.find(eggs)->date) == "2025-07-04", "committed batch prints");
+  uint32_t dropped = batch.hold(PRINT_PRIORITY_NORMAL, "Brot", 4);
+  check(batch.cancel(dropped) && batch.find(dropped) == nullptr && batch.depth() == 2 && !batch.cancel(milk),
+        "a cancelled job gives its slot back");
+
+  check(queue.slot(0).status != PRINT_JOB_FREE && string(printJobStatusName(PRINT_JOB_PRINTING)) == "printing" &&
+        string(printJobTypeName(PRINT_JOB_SERVER_INFO)) == "serverInfo" &&
+        string(printJobTypeName(PRINT_JOB_PAST_JOKE)) == "pastJoke", "slots and names for the status API");
+}
+
+// ESPAsyncWebServer's rule for a POST body: parsed as form parameters if
+// it is a form, or text/plain whose first chunk starts with parameter
+// characters up to an '='. Anything else goes to the body callback.
+static bool isParamChar(char c) {
+  return c && c != '{' && c != '[' && c != '&' && c != '=';
+}
+
+static bool parsedAsForm(const string &contentType, const string &chunk) {
+  if (contentType == "application/x-www-form-urlencoded") return true;
+  if (contentType != "text/plain" || chunk.empty() || !isParamChar(chunk[0])) return false;
+  size_t i = 0;
+  while (i < chunk.size() && isParamChar(chunk[i++])) {}
+  return i < chunk.size() && chunk[i - 1] == '=';
+}
+
+static void testMessageBody() {
+  // Messages that look like a form field still arrive as the body
+  const char *messages[] = {"2+2=4", "Milch=2 Liter", "a=b", "=", "Hallo Welt"};
+  bool body = true;
+  for (const char *message : messages) {
+    body = body && !parsedAsForm(PRINT_JOB_BODY_TYPE, message);
+  }
+  check(body, "messages with '=' reach the body callback");
+  check(parsedAsForm("text/plain", "2+2=4") && parsedAsForm("text/plain", "Milch=2 Liter"),
+        "as text/plain they would not");
+
+  // And are stored as they came, '=' and all
+  PrintJobQueue queue;
+  uint32_t id = queue.reserve(PRINT_PRIORITY_NORMAL);
+  check(id != 0 && queue.commit(id, strlen("Milch=2 Liter")) && queue.find(id)->textLength == 13,
+        "the whole message is queued");
+}
+
+int main() {
+  testPassThrough();
+  testRate();
+  testPauses();
+  testFullBuffer();
+  testPrintImage();
+  testPrintJobQueue();
+  testMessageBody();
+  testReceiptTiming();
+  testFeedbackPacing();
+  testFeedbackWindow();
+  testJobLines();
+  testPaperOut();
+  testFlowControl();
+  testOverheat();
+  testPausesEndEarly();
+  testSilentPrinter();
+  testBaudProbe();
+
+  if (failures == 0) {
+    cout << "All print engine tests passed" << endl;
+    return 0;
+  }
+  cout << failures << " print engine test(s) failed" << endl;
+  return 1;
+}
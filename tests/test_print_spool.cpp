@@ -0,0 +1,338 @@
+// Host test for the print spool (the journal of the print job queue on
+// flash). A scripted session of jobs is replayed with a reset injected
+// after every byte written, and what recovery brings back is checked
+// against the session's states around the reset.
+//
+// Build & run from the repository root:
+//   g++ -std=c++17 -Ilib/byte_io -Ilib/print_engine tests/test_print_spool.cpp lib/print_engine/*.cpp -o test_print_spool
+//   ./test_print_spool
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include "print_spool.h"
+
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool condition, const string &name) {
+  if (!condition) {
+    cout << "FAIL: " << name << endl;
+    failures++;
+  }
+}
+
+// The journal in memory. After `budget` bytes the device "resets": the
+// write in progress stops at that byte and nothing else reaches storage.
+// A rewrite that wasn't committed is lost, like the temp file would be.
+class MemoryStorage : public SpoolStorage {
+public:
+  explicit MemoryStorage(size_t budget = SIZE_MAX) : budget(budget) {}
+
+  size_t size() override { return file.size(); }
+
+  size_t read(size_t offset, uint8_t *data, size_t length) override {
+    if (offset >= file.size()) return 0;
+    size_t got = min(length, file.size() - offset);
+    copy(file.begin() + offset, file.begin() + offset + got, data);
+    return got;
+  }
+
+  bool append(const uint8_t *data, size_t length) override {
+    vector<uint8_t> &target = rewriting ? temp : file;
+    for (size_t i = 0; i < length; i++) {
+      if (crashed || written == budget) {
+        crashed = true;
+        return false;
+      }
+      target.push_back(data[i]);
+      written++;
+    }
+    return true;
+  }
+
+  bool sync() override { return !crashed; }
+
+  bool truncate(size_t length) override {
+    if (crashed) return false;
+    file.resize(min(length, file.size()));
+    return true;
+  }
+
+  bool beginRewrite() override {
+    temp.clear();
+    rewriting = !crashed;
+    return rewriting;
+  }
+
+  bool commitRewrite() override {
+    rewriting = false;
+    if (crashed) return false;
+    file = temp;
+    rewrites++;
+    return true;
+  }
+
+  void abortRewrite() override { rewriting = false; }
+
+  vector<uint8_t> file;
+  vector<uint8_t> temp;
+  size_t budget;
+  size_t written = 0;
+  bool crashed = false;
+  bool rewriting = false;
+  int rewrites = 0;
+};
+
+// What a recovery brought back: text and resume line per job ID
+typedef map<uint32_t, pair<string, uint16_t>> Recovered;
+
+static Recovered recoverFrom(const vector<uint8_t> &file, uint8_t *count = nullptr) {
+  MemoryStorage storage;
+  storage.file = file;
+  PrintJobQueue queue;
+  PrintSpool spool(storage);
+  uint8_t restored = spool.recover(queue);
+  if (count) *count = restored;
+
+  Recovered jobs;
+  for (uint8_t i = 0; i < PRINT_JOB_SLOTS; i++) {
+    const PrintJob &job = queue.slot(i);
+    if (job.status == PRINT_JOB_QUEUED) {
+      jobs[job.id] = make_pair(string(job.text, job.textLength), job.resumeLine);
+    }
+  }
+  return jobs;
+}
+
+// Receipts and a joke through queue, engine and spool. After every
+// update() the journal is recovered as is, which gives the state a reset
+// at that point must bring back.
+static size_t runSession(MemoryStorage &storage, size_t compactSize, vector<size_t> *written,
+                         vector<Recovered> *states) {
+  PrintJobQueue queue;
+  PrintSpool spool(storage, compactSize);
+  spool.recover(queue);
+  uint32_t completed = 0;
+
+  auto step = [&](uint16_t frontLines, bool force = false) {
+    spool.update(queue, completed, frontLines, force);
+    if (written && !storage.crashed) {
+      written->push_back(storage.written);
+      states->push_back(recoverFrom(storage.file));
+    }
+  };
+
+  queue.add(PRINT_JOB_SERVER_INFO, PRINT_PRIORITY_HIGH);
+  queue.add(PRINT_JOB_RECEIPT, PRINT_PRIORITY_NORMAL, "Erster Zettel", 13, "2025-06-07");
+  queue.add(PRINT_JOB_JOKE, PRINT_PRIORITY_LOW, nullptr, 0, nullptr, true);
+  step(0);
+
+  // Server info prints (ticket 1), then the receipt (ticket 2)
+  queue.start(*queue.next(), 1);
+  step(3);
+  completed = 1;
+  queue.update(completed);
+  queue.start(*queue.next(), 2);
+  step(0);
+  step(2);
+  step(5);
+  queue.add(PRINT_JOB_RECEIPT, PRINT_PRIORITY_NORMAL, "Zweiter", 7);
+  step(9);
+  step(10, true);
+
+  // Receipt done, the second one prints; the joke waits
+  completed = 2;
+  queue.update(completed);
+  queue.start(*queue.next(), 3);
+  step(0);
+  step(4);
+  completed = 3;
+  queue.update(completed);
+  step(0);
+
+  // The joke, then nothing left
+  queue.start(*queue.next(), 4);
+  step(6);
+  completed = 4;
+  queue.update(completed);
+  step(0);
+  return storage.written;
+}
+
+static void testJournal() {
+  MemoryStorage storage;
+  vector<size_t> written;
+  vector<Recovered> states;
+  runSession(storage, SPOOL_COMPACT_SIZE, &written, &states);
+
+  check(states[0].size() == 2 && states[0][2].first == "Erster Zettel" && states[0][3].first == "",
+        "receipt and joke are journaled, server info isn't");
+  check(states[1][2].second == 0, "no progress before the job reaches the printer");
+  check(states[3][2].second == 0, "progress below the batch size isn't written");
+  check(states[4][2].second == 5, "progress every few lines");
+  check(states[5].size() == 3 && states[5][2].second == 9, "new jobs join the journal");
+  check(states[6][2].second == 10, "forced progress before a restart");
+  check(states[7].size() == 2 && states[7].count(2) == 0, "finished jobs are dropped");
+  check(states[8][4].second == 4, "progress of the next job");
+  check(states.back().empty() && storage.file.empty(), "journal is emptied once everything printed");
+
+  // Recovery cuts off a torn record, and the journal carries on from there
+  MemoryStorage torn;
+  torn.file = vector<uint8_t>(storage.file);
+  PrintJobQueue queue;
+  queue.add(PRINT_JOB_RECEIPT, PRINT_PRIORITY_NORMAL, "Hallo", 5);
+  PrintSpool spool(torn);
+  spool.update(queue, 0, 0);
+  size_t complete = torn.file.size();
+  torn.file.push_back(0xA5);
+  torn.file.push_back(2);
+
+  PrintJobQueue recovered;
+  PrintSpool after(torn);
+  check(after.recover(recovered) == 1 && torn.file.size() == complete, "torn record is cut off");
+  check(recovered.find(1) && recovered.add(PRINT_JOB_JOKE, PRINT_PRIORITY_LOW) == 2, "IDs continue after recovery");
+  after.update(recovered, 0, 0);
+  check(recoverFrom(torn.file).size() == 2, "journal continues after recovery");
+
+  // A streamed message is journaled without its text, and not before it
+  // is complete
+  MemoryStorage files;
+  PrintJobQueue uploads;
+  PrintSpool uploadSpool(files);
+  uint32_t upload = uploads.reserve(PRINT_PRIORITY_NORMAL);
+  uploadSpool.update(uploads, 0, 0);
+  check(files.file.empty(), "receiving jobs aren't journaled");
+  uploads.commit(upload, 9000);
+  uploadSpool.update(uploads, 0, 0);
+  PrintJobQueue restored;
+  PrintSpool restoredSpool(files);
+  restoredSpool.recover(restored);
+  const PrintJob *fileJob = restored.find(upload);
+  check(files.file.size() < 40 && fileJob && fileJob->textInFile && fileJob->textLength == 9000,
+        "streamed jobs are journaled by reference");
+
+  // Damaged records count as torn
+  MemoryStorage damaged;
+  damaged.file = torn.file;
+  damaged.file[10] ^= 0x40;
+  check(recoverFrom(damaged.file).empty(), "a bad checksum ends the journal");
+}
+
+// A reset after every byte: recovery brings back exactly the state before
+// the interrupted update(), or after it, or a mix of its records
+static void testCrashes(size_t compactSize, const string &name) {
+  MemoryStorage reference;
+  vector<size_t> written;
+  vector<Recovered> states;
+  size_t total = runSession(reference, compactSize, &written, &states);
+
+  bool allConsistent = true;
+  bool allResumable = true;
+  for (size_t budget = 0; budget <= total; budget++) {
+    MemoryStorage storage(budget);
+    runSession(storage, compactSize, nullptr, nullptr);
+    Recovered got = recoverFrom(storage.file);
+
+    // States around the reset
+    size_t after = 0;
+    while (after < written.size() && written[after] <= budget) {
+      after++;
+    }
+    Recovered empty;
+    const Recovered &before = after == 0 ? empty : states[after - 1];
+    const Recovered &next = after < states.size() ? states[after] : before;
+
+    bool consistent = true;
+    for (auto &job : got) {
+      auto b = before.find(job.first);
+      auto n = next.find(job.first);
+      if (b == before.end() && n == next.end()) {
+        consistent = false;  // Never journaled
+        continue;
+      }
+      const string &text = b != before.end() ? b->second.first : n->second.first;
+      uint16_t low = b != before.end() ? b->second.second : n->second.second;
+      uint16_t high = n != next.end() ? n->second.second : low;
+      consistent = consistent && job.second.first == text &&
+                   job.second.second >= min(low, high) && job.second.second <= max(low, high);
+    }
+    for (auto &job : before) {
+      if (next.count(job.first) && !got.count(job.first)) {
+        consistent = false;  // Unfinished on both sides, but lost
+      }
+    }
+    if (!consistent) {
+      cout << "  inconsistent after " << budget << " bytes" << endl;
+    }
+    allConsistent = allConsistent && consistent;
+
+    // The recovered journal is usable: recovering twice gives the same
+    MemoryStorage again;
+    again.file = storage.file;
+    PrintJobQueue queue;
+    PrintSpool spool(again);
+    spool.recover(queue);
+    allResumable = allResumable && recoverFrom(again.file) == got;
+  }
+
+  check(allConsistent, name + ": a reset at any byte loses no committed job or progress");
+  check(allResumable, name + ": recovery leaves a clean journal");
+}
+
+static void testCompaction() {
+  MemoryStorage storage;
+  vector<size_t> written;
+  vector<Recovered> states;
+  runSession(storage, 64, &written, &states);
+  check(storage.rewrites > 0, "journal is compacted past the limit");
+  check(states[4][2].second == 5 && states[5].size() == 3, "compaction keeps jobs and progress");
+}
+
+static void testResumeSink() {
+  vector<uint8_t> out;
+  int pauses = 0;
+
+  class Collect : public PrintSink {
+  public:
+    Collect(vector<uint8_t> &out, int &pauses) : out(out), pauses(pauses) {}
+    bool write(const uint8_t *data, size_t length) override {
+      out.insert(out.end(), data, data + length);
+      return true;
+    }
+    bool pause(uint16_t) override { pauses++; return true; }
+    vector<uint8_t> &out;
+    int &pauses;
+  } collect(out, pauses);
+
+  ResumeSink sink(collect, 2);
+  sink.pause(500);
+  sink.println("eins");
+  sink.write((const uint8_t *)"zw", 2);
+  sink.println("ei");
+  sink.pause(500);
+  sink.println("drei");
+  check(string(out.begin(), out.end()) == "drei\r\n" && pauses == 1, "resume skips the printed lines");
+
+  out.clear();
+  ResumeSink whole(collect, 0);
+  whole.println("alles");
+  check(string(out.begin(), out.end()) == "alles\r\n", "nothing skipped from the start");
+}
+
+int main() {
+  testJournal();
+  testCompaction();
+  testCrashes(SPOOL_COMPACT_SIZE, "append");
+  testCrashes(64, "compaction");
+  testResumeSink();
+
+  if (failures == 0) {
+    cout << "All print spool tests passed" << endl;
+    return 0;
+  }
+  cout << failures << " print spool test(s) failed" << endl;
+  return 1;
+}
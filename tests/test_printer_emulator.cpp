@@ -0,0 +1,302 @@
+// Golden-output tests for the print paths, run through the ESC/POS printer
+// emulator: the same command sequences the firmware queues (escpos_commands)
+// go through the print engine into the emulated CSN-A4L, which renders them
+// to text and pixels.
+//
+// Build & run from the repository root:
+//   g++ -std=c++17 -Ilib/byte_io -Ilib/print_engine -Ilib/printer_emulator -Ilib/text_pipeline tests/test_printer_emulator.cpp lib/print_engine/*.cpp lib/printer_emulator/*.cpp lib/text_pipeline/*.cpp -o test_printer_emulator
+//   ./test_printer_emulator [receipt.png]
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "print_engine.h"
+#include "escpos_commands.h"
+#include "printer_emulator.h"
+#include "text_wrap.h"
+#include "code_page.h"
+#include "date_format.h"
+
+using namespace std;
+
+static const size_t PRINTER_WIDTH = 32;  // maxCharsPerLine in main_program.cpp
+
+static uint32_t simulatedMillis = 0;
+
+static uint32_t simulatedClock() {
+  return simulatedMillis;
+}
+
+static int failures = 0;
+
+static void check(bool condition, const string &name) {
+  if (!condition) {
+    cout << "FAIL: " << name << endl;
+    failures++;
+  }
+}
+
+static void drain(PrintEngine &engine) {
+  engine.update();
+  while (!engine.idle() && simulatedMillis < 10000000) {
+    simulatedMillis += 10;
+    engine.update();
+  }
+}
+
+static void queueWrappedLine(const char *line, size_t length, void *context) {
+  static_cast<PrintEngine *>(context)->println(string(line, length).c_str());
+}
+
+// printReceipt() in main_program.cpp
+static void queueReceipt(PrintEngine &engine, const string &timestamp, const string &message) {
+  engine.pause(1500);
+  queueInverse(engine, true);
+  engine.println(timestamp.c_str());
+  queueInverse(engine, false);
+  engine.pause(500);
+  wrapText(message.data(), message.length(), PRINTER_WIDTH, queueWrappedLine, &engine);
+  queueFeed(engine, 2);
+  engine.endJob();
+}
+
+// composeDailyJoke() in main_program.cpp
+static void queueDailyJoke(PrintEngine &engine, const string &headerDate, const string &joke) {
+  queueFeed(engine, 2);
+  engine.pause(500);
+  queueInverse(engine, true);
+  engine.println(("  " + headerDate + "  ").c_str());
+  queueInverse(engine, false);
+  engine.pause(1000);
+  WrapOptions options = {PRINTER_WIDTH, WRAP_BALANCED, false};
+  wrapText(joke.data(), joke.length(), options, queueWrappedLine, &engine);
+  queueFeed(engine, 2);
+  engine.endJob();
+}
+
+static size_t blackDots(const PrinterEmulator &printer, size_t firstRow, size_t rows) {
+  size_t count = 0;
+  for (size_t i = firstRow * EMULATOR_ROW_BYTES; i < (firstRow + rows) * EMULATOR_ROW_BYTES; i++) {
+    for (uint8_t bits = printer.bitmap()[i]; bits; bits >>= 1) count += bits & 1;
+  }
+  return count;
+}
+
+// Feed raw bytes straight into an emulator without a clock
+static void send(PrinterEmulator &printer, const string &bytes) {
+  for (char c : bytes) printer.write((uint8_t)c);
+}
+
+static void testSetup() {
+  simulatedMillis = 0;
+  PrinterEmulator printer;
+  PrintEngine engine;
+  engine.begin(&printer, simulatedClock);
+  queuePrinterSetup(engine, true);
+  drain(engine);
+
+  check(printer.lines().empty(), "setup prints nothing");
+  check(printer.unknownCommands() == 0, "setup commands are understood");
+  check(printer.bytesReceived() >= 7, "setup bytes reach the printer");
+}
+
+static void testReceiptGolden(const char *pngPath) {
+  simulatedMillis = 0;
+  PrinterEmulator printer;
+  printer.setClock(simulatedClock);
+  PrintEngine engine;
+  engine.begin(&printer, simulatedClock);
+
+  queueReceipt(engine, "Sa, 07 Juni 2025",
+               "Einkaufsliste: Milch, Brot, Kaese und ein Glas Gurken fuer das Wochenende.");
+  drain(engine);
+
+  check(printer.text() ==
+        "Sa, 07 Juni 2025\n"
+        "Einkaufsliste: Milch, Brot,\n"
+        "Kaese und ein Glas Gurken fuer\n"
+        "das Wochenende.\n"
+        "\n"
+        "\n", "receipt text matches golden output");
+  check(printer.unknownCommands() == 0, "receipt commands are understood");
+
+  const vector<EmulatedLine> &lines = printer.lines();
+  check(lines.size() == 6 && lines[0].inverse && !lines[1].inverse, "only the header is inverse");
+  check(printer.dotRows() == 6 * 33, "every line advances the default 33 dots");
+  check(printer.paperLengthMm() > 24.7 && printer.paperLengthMm() < 24.8, "paper length in mm");
+
+  // Header glyphs are white on black, body text is black on white
+  size_t header = blackDots(printer, 0, 24);
+  size_t body = blackDots(printer, 33, 24);
+  check(header > 16 * 12 * 24 * 6 / 10, "inverse header cells are mostly black");
+  check(body > 0 && body < 384 * 24 * 3 / 10, "body text is mostly white");
+
+  // Heavy lines heat longer than light ones, blank feeds only move paper
+  check(lines[0].printMillis > lines[1].printMillis, "inverse line takes longer to heat");
+  check(lines[1].printMillis > lines[4].printMillis, "text takes longer than a feed");
+  double feedMillis = 33 * 1000.0 / (90 * 8);
+  check(lines[4].printMillis > feedMillis - 0.01 && lines[4].printMillis < feedMillis + 0.01,
+        "a blank line is paced by the paper feed");
+  check(printer.finishedAt() >= 1500 + printer.mechanismMillis(), "queued pauses delay printing");
+
+  if (pngPath != nullptr) {
+    check(printer.writePNG(pngPath), "receipt PNG written");
+    cout << "Receipt image: " << pngPath << endl;
+  }
+}
+
+// A joke printed again from the history is headed with its own day, as
+// formatCustomDate() formats the job's date, not with today's
+static void testPastJokeGolden() {
+  simulatedMillis = 0;
+  PrinterEmulator printer;
+  printer.setClock(simulatedClock);
+  PrintEngine engine;
+  engine.begin(&printer, simulatedClock);
+
+  CalendarDate day;
+  char headerDate[32];
+  check(parseDate("2024-12-24", day) && formatReceiptDate(day, headerDate, sizeof(headerDate)) > 0,
+        "history date formats as a receipt date");
+  queueDailyJoke(engine, headerDate, "Treffen sich zwei Jaeger. Beide tot.");
+  drain(engine);
+
+  check(printer.text() ==
+        "\n"
+        "\n"
+        "  Di, 24 Dezember 2024  \n"
+        "Treffen sich zwei Jaeger. Beide\n"
+        "tot.\n"
+        "\n"
+        "\n", "past joke text matches golden output");
+  check(printer.unknownCommands() == 0, "past joke commands are understood");
+
+  const vector<EmulatedLine> &lines = printer.lines();
+  check(lines.size() == 7 && lines[2].inverse && !lines[3].inverse, "only the dated header is inverse");
+}
+
+// UTF-8 goes through the transcoder and the code table selected at setup,
+// and comes back out of the emulator as the same text
+static void testCodePage() {
+  simulatedMillis = 0;
+  PrinterEmulator printer;
+  PrintEngine engine;
+  engine.begin(&printer, simulatedClock);
+  queuePrinterSetup(engine, false, codePageSelector(CODE_PAGE_CP858));
+
+  string text = "Viele Gr\xc3\xbc\xc3\x9f" "e aus K\xc3\xb6ln \xe2\x80\x93 5 \xe2\x82\xac\xc2\xa0" "f\xc3\xbcr \xe2\x80\x9eS\xc3\xbc\xc3\x9f" "es\xe2\x80\x9c";
+  string encoded = text;
+  encoded.resize(transcodeUTF8(encoded.data(), encoded.length(), CODE_PAGE_CP858, &encoded[0]));
+  wrapText(encoded.data(), encoded.length(), PRINTER_WIDTH, queueWrappedLine, &engine);
+  engine.endJob();
+  drain(engine);
+
+  check(printer.text() == "Viele Gr\xc3\xbc\xc3\x9f" "e aus K\xc3\xb6ln - 5 \xe2\x82\xac\xc2\xa0" "f\xc3\xbcr\n"
+                          "\"S\xc3\xbc\xc3\x9f" "es\"\n", "umlauts, euro and no-break space print in CP858");
+  check(printer.lines().size() == 2, "umlauts take one column when wrapping");
+  check(printer.unknownCommands() == 0, "ESC t is understood");
+
+  // Without ESC t the printer stays in CP437, where the euro sign is missing
+  PrinterEmulator reset;
+  send(reset, "\x1b" "@" "5 \xd5\n");
+  check(reset.text() == "5 \xe2\x95\x92\n", "ESC @ selects CP437");
+}
+
+static void testLineBuffer() {
+  PrinterEmulator printer;
+  send(printer, "abc\rX\n");
+  send(printer, string(40, 'w') + "\n");
+  send(printer, "\x1b" "a" "\x01" "mitte\n");
+  send(printer, "\x1b" "@" "\x1b" "3" "\x40" "eng\n");
+  check(printer.text() == "Xbc\n" + string(32, 'w') + "\n" + string(8, 'w') + "\nmitte\neng\n",
+        "CR overwrites, long lines wrap by themselves");
+  check(printer.lines()[4].dotRows == 0x40, "ESC 3 sets the line spacing");
+
+  // Centred text starts in the middle of the head
+  size_t row = printer.lines()[0].dotRows + printer.lines()[1].dotRows + printer.lines()[2].dotRows + 10;
+  size_t firstBlack = EMULATOR_HEAD_DOTS;
+  for (int x = 0; x < EMULATOR_HEAD_DOTS; x++) {
+    if (printer.bitmap()[row * EMULATOR_ROW_BYTES + x / 8] & (0x80 >> (x % 8))) {
+      firstBlack = x;
+      break;
+    }
+  }
+  check(firstBlack > 150 && firstBlack < 170, "ESC a 1 centres the line");
+}
+
+static void testModes() {
+  PrinterEmulator printer;
+  send(printer, string("\x1d" "!" "\x11", 3) + "XX\n");
+  check(printer.lines()[0].dotRows == 48, "GS ! doubles the height");
+  send(printer, string("\x1d" "!" "\x00", 3) + string("\x1b" "E" "\x01", 3) + "B\n" +
+                string("\x1b" "E" "\x00", 3) + "B\n");
+  size_t first = printer.lines()[0].dotRows;
+  check(blackDots(printer, first, 33) > blackDots(printer, first + 33, 33), "bold prints more dots");
+
+  send(printer, "\x1b" "\x70" "\n");
+  check(printer.unknownCommands() == 1, "unknown commands are counted");
+}
+
+static void testRaster() {
+  PrinterEmulator printer;
+  string image = string("\x1d" "v" "0" "\x00" "\x10" "\x00" "\x0a" "\x00", 8) + string(16 * 10, '\xff');
+  send(printer, image);
+  check(printer.text() == "[image 128x10]\n", "raster image is labelled");
+  check(printer.dotRows() == 10 && blackDots(printer, 0, 10) == 1280, "raster image is drawn");
+
+  // Two strobes of 64 dots per row at the power-on heat settings
+  check(printer.lines()[0].printMillis > 10 * 2 * 0.82 - 0.01, "raster rows are heat-limited");
+}
+
+static void testStatusReplies() {
+  simulatedMillis = 0;
+  PrinterEmulator printer;
+  printer.setClock(simulatedClock);
+  send(printer, string("\x10\x04\x02", 3));
+  check(printer.read() == 0x12, "DLE EOT is answered at once");
+
+  send(printer, "slow line\n");
+  send(printer, string("\x1d" "r" "\x01", 3));
+  check(printer.read() == -1, "GS r waits for the line to print");
+  simulatedMillis = 1000;
+  check(printer.read() == 0x00, "GS r is answered once the line printed");
+
+  EmulatorConfig silent = {90, false};
+  PrinterEmulator txOnly(silent);
+  send(txOnly, string("\x10\x04\x02", 3));
+  check(!txOnly.canRead() && txOnly.read() == -1, "no replies without a TX line");
+}
+
+static void testPNG() {
+  PrinterEmulator printer;
+  send(printer, "PNG\n");
+  const char *path = "/tmp/test_printer_emulator.png";
+  check(printer.writePNG(path), "PNG is written");
+
+  ifstream file(path, ios::binary);
+  string data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+  check(data.substr(0, 8) == "\x89PNG\r\n\x1a\n", "PNG signature");
+  // Signature, IHDR, IDAT (zlib header, one stored block, Adler-32), IEND
+  size_t raw = 33 * (EMULATOR_ROW_BYTES + 1);
+  check(data.size() == 8 + 25 + 12 + 2 + 5 + raw + 4 + 12, "PNG size");
+}
+
+int main(int argc, char **argv) {
+  testSetup();
+  testReceiptGolden(argc > 1 ? argv[1] : nullptr);
+  testPastJokeGolden();
+  testCodePage();
+  testLineBuffer();
+  testModes();
+  testRaster();
+  testStatusReplies();
+  testPNG();
+
+  if (failures == 0) {
+    cout << "All printer emulator tests passed" << endl;
+    return 0;
+  }
+  cout << failures << " printer emulator test(s) failed" << endl;
+  return 1;
+}
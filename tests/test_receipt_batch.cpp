@@ -0,0 +1,153 @@
+// Host test for the receipt batch parser (the body of /api/batch). Every
+// batch is fed in every chunk size, so items split across chunks at any
+// byte parse the same.
+//
+// Build & run from the repository root:
+//   g++ -std=c++17 -Ilib/text_pipeline tests/test_receipt_batch.cpp lib/text_pipeline/receipt_batch.cpp lib/text_pipeline/html_entities.cpp -o test_receipt_batch
+//   ./test_receipt_batch
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "receipt_batch.h"
+
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool condition, const string &name) {
+  if (!condition) {
+    cout << "FAIL: " << name << endl;
+    failures++;
+  }
+}
+
+struct Parsed {
+  vector<string> items;  // "message|date", date "-" if none
+  BatchError error;
+  size_t offset;
+};
+
+struct Collector {
+  vector<string> items;
+  size_t limit;
+};
+
+static bool collect(const char *message, size_t length, const char *date, void *context) {
+  Collector *collector = static_cast<Collector *>(context);
+  if (collector->items.size() == collector->limit) {
+    return false;
+  }
+  collector->items.push_back(string(message, length) + "|" + (date ? date : "-"));
+  return true;
+}
+
+static Parsed parse(const string &body, size_t chunk, size_t limit = SIZE_MAX) {
+  Collector collector = {{}, limit};
+  ReceiptBatchParser parser(collect, &collector);
+  for (size_t i = 0; i < body.size(); i += chunk) {
+    if (!parser.write(body.data() + i, min(chunk, body.size() - i))) {
+      break;
+    }
+  }
+  Parsed parsed = {collector.items, parser.finish(), parser.offset()};
+  return parsed;
+}
+
+// The same result in every chunk size
+static Parsed parseAll(const string &body, const string &name, size_t limit = SIZE_MAX) {
+  Parsed whole = parse(body, body.size() > 0 ? body.size() : 1, limit);
+  bool same = true;
+  for (size_t chunk = 1; chunk < body.size(); chunk++) {
+    Parsed split = parse(body, chunk, limit);
+    same = same && split.items == whole.items && split.error == whole.error && split.offset == whole.offset;
+  }
+  check(same, name + ": same in every chunk size");
+  return whole;
+}
+
+static void testFormats() {
+  Parsed array = parseAll("[{\"message\": \"Milch\", \"date\": \"2025-07-04\"},\n {\"message\":\"Eier\"}, \"Brot\"]\n",
+                          "array");
+  check(array.error == BATCH_OK && array.items == vector<string>({"Milch|2025-07-04", "Eier|-", "Brot|-"}),
+        "array of objects and strings");
+
+  Parsed ndjson = parseAll("{\"message\":\"eins\"}\n{\"date\":\"07/06/2025\",\"message\":\"zwei\"}\r\n\"drei\"\n",
+                           "ndjson");
+  check(ndjson.error == BATCH_OK && ndjson.items == vector<string>({"eins|-", "zwei|07/06/2025", "drei|-"}),
+        "NDJSON, fields in any order");
+
+  Parsed unterminated = parseAll("{\"message\":\"ohne Zeilenende\"}", "last line");
+  check(unterminated.error == BATCH_OK && unterminated.items.size() == 1, "NDJSON without a final newline");
+
+  Parsed skipped = parseAll("[{\"id\": 17, \"tags\": [\"a\", {\"b\": \"}]\"}], \"message\": \"x\", \"urgent\": true,"
+                            " \"n\": -1.5e3, \"note\": null, \"messages\": \"nicht\"}]", "skipped");
+  check(skipped.error == BATCH_OK && skipped.items == vector<string>({"x|-"}), "other fields are skipped");
+}
+
+static void testStrings() {
+  Parsed escapes = parseAll("[\"a\\\"b\\\\c\\/d\\ne\\tf\", \"\\u00fc\\u00DF\\u20ac\", \"\\ud83d\\ude00\"]", "escapes");
+  check(escapes.error == BATCH_OK && escapes.items.size() == 3 &&
+        escapes.items[0] == "a\"b\\c/d\ne\tf|-" &&
+        escapes.items[1] == "\xC3\xBC\xC3\x9F\xE2\x82\xAC|-" &&
+        escapes.items[2] == "\xF0\x9F\x98\x80|-", "escapes decode to UTF-8");
+
+  Parsed utf8 = parseAll("[\"Grüße\"]", "raw UTF-8");
+  check(utf8.items.size() == 1 && utf8.items[0] == "Grüße|-", "raw UTF-8 passes through");
+
+  Parsed lone = parseAll("[\"a\\ud83db\", \"\\ude00\", \"\\ud83d\", \"\\u0000\"]", "surrogates");
+  check(lone.error == BATCH_OK && lone.items.size() == 4 &&
+        lone.items[0] == "a\xEF\xBF\xBD" "b|-" && lone.items[1] == "\xEF\xBF\xBD|-" &&
+        lone.items[2] == "\xEF\xBF\xBD|-" && lone.items[3] == "\xEF\xBF\xBD|-",
+        "lone surrogates and NUL become U+FFFD");
+
+  Parsed longDate = parseAll("[{\"message\":\"m\",\"date\":\"2025-07-04T10:00\"}]", "long date");
+  check(longDate.error == BATCH_OK && longDate.items[0] == "m|-", "a date too long is dropped");
+
+  string fits(BATCH_MESSAGE_MAX, 'x');
+  Parsed full = parse("[\"" + fits + "\"]", 7);
+  check(full.error == BATCH_OK && full.items.size() == 1, "a message of the maximum length fits");
+  Parsed tooLong = parse("[\"ok\", \"" + fits + "y\"]", 7);
+  check(tooLong.error == BATCH_TOO_LONG && tooLong.items.size() == 1, "a longer message fails the batch");
+}
+
+static void testErrors() {
+  check(parseAll("", "empty").error == BATCH_EMPTY, "empty body");
+  check(parseAll(" [ ] ", "empty array").error == BATCH_EMPTY, "empty array");
+  check(parseAll("[{\"date\":\"2025-07-04\"}]", "no message").error == BATCH_NO_MESSAGE, "item without message");
+  check(parseAll("[{\"message\": 5}]", "number").error == BATCH_NO_MESSAGE, "message that isn't a string");
+  check(parseAll("[{\"message\":\"a\"}", "cut off").error == BATCH_SYNTAX, "array cut off");
+  check(parseAll("{\"message\":\"a", "cut string").error == BATCH_SYNTAX, "string cut off");
+  check(parseAll("[\"a\" \"b\"]", "missing comma").error == BATCH_SYNTAX, "missing comma");
+  check(parseAll("[\"a\"] x", "trailing").error == BATCH_SYNTAX, "garbage after the array");
+  check(parseAll("message=hallo", "form").error == BATCH_SYNTAX, "a form post is no batch");
+  check(parseAll("[\"a\nb\"]", "raw newline").error == BATCH_SYNTAX, "raw control characters");
+  check(parseAll("[\"\\x\"]", "bad escape").error == BATCH_SYNTAX, "unknown escape");
+
+  Parsed bad = parseAll("[\"eins\", \"zwei\", 3]", "offset");
+  check(bad.error == BATCH_SYNTAX && bad.items.size() == 2 && bad.offset == 17, "error offset and items before it");
+
+  Parsed stopped = parseAll("[\"a\", \"b\", \"c\"]", "stopped", 2);
+  check(stopped.error == BATCH_STOPPED && stopped.items.size() == 2, "the callback stops the batch");
+
+  // A parser is reused for the next body
+  Collector collector = {{}, SIZE_MAX};
+  ReceiptBatchParser parser(collect, &collector);
+  parser.write("[1", 2);
+  parser.reset();
+  parser.write("[\"neu\"]", 7);
+  check(parser.finish() == BATCH_OK && collector.items == vector<string>({"neu|-"}), "reset starts over");
+}
+
+int main() {
+  testFormats();
+  testStrings();
+  testErrors();
+
+  if (failures == 0) {
+    cout << "All receipt batch tests passed" << endl;
+    return 0;
+  }
+  cout << failures << " receipt batch test(s) failed" << endl;
+  return 1;
+}
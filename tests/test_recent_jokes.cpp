@@ -0,0 +1,219 @@
+// Host test for repeated-joke detection (recent_jokes.h). A corpus of a few
+// thousand distinct jokes (assets/jokes.txt and jokes put together from
+// parts, many only a word apart) is printed one a day: the false-positive
+// rate, new jokes taken for repeats, is measured and must stay at 0, while
+// every joke repeated within the ring is caught, even with its whitespace
+// and character references written differently.
+//
+// Build & run from the repository root:
+//   g++ -std=c++17 -Ilib/byte_io -Ilib/joke_source -Ilib/text_pipeline tests/test_recent_jokes.cpp lib/joke_source/recent_jokes.cpp lib/text_pipeline/html_entities.cpp -o test_recent_jokes
+//   ./test_recent_jokes
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+#include "recent_jokes.h"
+
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool condition, const string &name) {
+  if (!condition) {
+    cout << "FAIL: " << name << endl;
+    failures++;
+  }
+}
+
+static uint64_t fingerprint(const string &text) {
+  return jokeFingerprint(text.c_str(), text.size());
+}
+
+static uint32_t dayDate(int day) {
+  // Consecutive days, months of 28 days are enough here
+  return 20250000 + (1 + day / 28 % 12) * 100 + 1 + day % 28 + day / 336 * 10000;
+}
+
+static vector<string> corpus() {
+  vector<string> jokes;
+  ifstream file("assets/jokes.txt");
+  string line;
+  string joke;
+  while (getline(file, line)) {
+    if (line.empty()) {
+      if (!joke.empty()) jokes.push_back(joke);
+      joke.clear();
+    } else {
+      joke += (joke.empty() ? "" : " ") + line;
+    }
+  }
+  if (!joke.empty()) jokes.push_back(joke);
+
+  const char *who[] = {"Ein Mann", "Eine Frau", "Fritzchen", "Der Lehrer", "Ein Pferd", "Zwei Jäger",
+                       "Die Oma", "Ein Polizist", "Der Chef", "Eine Schnecke", "Ein Informatiker",
+                       "Der Bäcker", "Eine Kuh", "Der Arzt", "Ein Känguru", "Die Nachbarin"};
+  const char *where[] = {"in die Bar", "zum Arzt", "in die Schule", "auf den Markt", "ins Kino",
+                         "in den Wald", "zur Bank", "ins Büro", "an den Strand", "in die Kirche",
+                         "zum Friseur", "in die Bibliothek", "auf den Bahnhof", "ins Museum"};
+  const char *punch[] = {"Sagt der Wirt: \"Warum so ein langes Gesicht?\"", "Fragt keiner, warum.",
+                         "\"Muh\", sagt die Kuh.", "Da war die Tür zu.", "Seitdem geht er zu Fuß.",
+                         "Der Rest ist Geschichte.", "Und die Moral von der Geschicht'?",
+                         "Ruft der andere: \"Das wollte ich auch gerade sagen!\"",
+                         "Antwortet sie: \"Nur montags.\"", "Drei Tage später: dasselbe.",
+                         "Das Känguru lacht.", "Keiner hat's gemerkt.", "Am Ende zahlt die Oma.",
+                         "Bis heute."};
+  for (const char *a : who) {
+    for (const char *b : where) {
+      for (const char *c : punch) {
+        jokes.push_back(string(a) + " kommt " + b + ". " + c);
+      }
+    }
+  }
+  return jokes;
+}
+
+// The same joke as another page might deliver it
+static string reformatted(const string &joke, int variant) {
+  string out;
+  if (variant % 2) out += "\n  ";
+  for (char c : joke) {
+    if (c == ' ' && variant % 3 == 0) out += "&nbsp;";
+    else if (c == ' ' && variant % 3 == 1) out += " \t\r\n ";
+    else if (c == '"') out += variant % 2 ? "&quot;" : "&#34;";
+    else if (c == '\'') out += "&#x27;";
+    else out += c;
+  }
+  if (variant % 2 == 0) out += "  \n";
+  // ä, ö and ü as references
+  for (const char *pair : {"\xC3\xA4&auml;", "\xC3\xB6&#246;", "\xC3\xBC&#xFC;"}) {
+    string raw(pair, 2);
+    string reference(pair + 2);
+    for (size_t at = out.find(raw); at != string::npos; at = out.find(raw, at + reference.size())) {
+      out.replace(at, 2, reference);
+    }
+  }
+  return out;
+}
+
+static void testFingerprint() {
+  string joke = "Treffen sich zwei J\xC3\xA4ger. \"Beide\" tot.";
+  check(fingerprint(joke) == fingerprint("  Treffen  sich\nzwei J&auml;ger.&nbsp;&quot;Beide&#34; tot.\r\n"),
+        "whitespace and references don't count");
+  check(fingerprint(joke) != fingerprint("Treffen sich zwei J\xC3\xA4ger. \"Beide\" tot!"), "text counts");
+  check(fingerprint("a b") != fingerprint("ab"), "a space still separates words");
+  check(fingerprint("Fish &chips;") == fingerprint("Fish &amp;chips;") &&
+        fingerprint("Fish & chips") == fingerprint("Fish &amp; chips"), "unknown references kept as written");
+  check(fingerprint("&") == fingerprint("&amp;") && fingerprint("&am") != fingerprint("&"), "cut-off references");
+  check(fingerprint("") == fingerprint(" \n\t"), "nothing but whitespace");
+}
+
+static void testRing() {
+  RecentJokes recent;
+  check(!recent.seenBefore(1, 20250102) && recent.count() == 0, "empty ring");
+  recent.add(1, 20250101);
+  recent.add(1, 20250101);
+  check(recent.count() == 1, "same joke the same day kept once");
+  check(!recent.seenBefore(1, 20250101), "not a repeat on its own day");
+  check(recent.seenBefore(1, 20250102) && !recent.seenBefore(2, 20250102), "repeat on a later day");
+
+  for (int day = 1; day <= RECENT_JOKES_MAX; day++) {
+    recent.add(100 + day, dayDate(day));
+  }
+  check(recent.count() == RECENT_JOKES_MAX, "ring full");
+  check(!recent.seenBefore(1, dayDate(RECENT_JOKES_MAX + 1)), "oldest joke forgotten");
+  check(recent.seenBefore(101, dayDate(RECENT_JOKES_MAX + 1)) &&
+        recent.seenBefore(100 + RECENT_JOKES_MAX, dayDate(RECENT_JOKES_MAX + 1)), "the last ones kept");
+}
+
+static void testSaving() {
+  RecentJokes recent;
+  uint8_t saved[RECENT_JOKES_SAVED_MAX];
+  size_t length = recent.save(saved);
+  RecentJokes loaded;
+  check(length == 3 && loaded.load(saved, length) && loaded.count() == 0, "empty ring saved");
+
+  // Wrapped: oldest first, and adding continues where it left off
+  for (int day = 0; day < RECENT_JOKES_MAX + 10; day++) {
+    recent.add(0xF00D000000000000ULL + day, dayDate(day));
+  }
+  length = recent.save(saved);
+  check(length == RECENT_JOKES_SAVED_MAX && loaded.load(saved, length) && loaded.count() == RECENT_JOKES_MAX,
+        "full ring saved");
+  int today = RECENT_JOKES_MAX + 10;
+  check(loaded.seenBefore(0xF00D000000000000ULL + today - 1, dayDate(today)) &&
+        loaded.seenBefore(0xF00D000000000000ULL + 10, dayDate(today)) &&
+        !loaded.seenBefore(0xF00D000000000000ULL + 9, dayDate(today)), "entries back after loading");
+  loaded.add(1, dayDate(today));
+  check(!loaded.seenBefore(0xF00D000000000000ULL + 10, dayDate(today + 1)) &&
+        loaded.seenBefore(0xF00D000000000000ULL + 11, dayDate(today + 1)), "oldest goes first after loading");
+
+  bool refused = true;
+  for (size_t at = 0; at < length; at++) {
+    saved[at] ^= 0x10;
+    refused = refused && !loaded.load(saved, length) && loaded.count() == 0;
+    saved[at] ^= 0x10;
+  }
+  check(refused, "damaged data refused");
+  check(!loaded.load(saved, length - 1) && !loaded.load(saved, 0), "truncated data refused");
+}
+
+static void testCorpus() {
+  vector<string> jokes = corpus();
+  check(jokes.size() > 3000, "corpus of a few thousand jokes");
+
+  // No two distinct jokes share a fingerprint
+  set<uint64_t> prints;
+  for (const string &joke : jokes) prints.insert(fingerprint(joke));
+  check(prints.size() == jokes.size(), "no fingerprint collisions");
+
+  // One joke a day. Every seventh day the source repeats one from 1 to 60
+  // days ago, written differently.
+  RecentJokes recent;
+  vector<string> printed;
+  size_t falsePositives = 0;
+  size_t repeats = 0;
+  size_t caught = 0;
+  size_t next = 0;
+  for (int day = 0; next < jokes.size(); day++) {
+    uint32_t date = dayDate(day);
+    string joke;
+    bool repeat = day % 7 == 6 && printed.size() > 60;
+    if (repeat) {
+      joke = reformatted(printed[printed.size() - 1 - day % 60], day);
+      repeats++;
+    } else {
+      joke = jokes[next++];
+    }
+    bool seen = recent.seenBefore(fingerprint(joke), date);
+    if (repeat) {
+      caught += seen ? 1 : 0;
+    } else {
+      falsePositives += seen ? 1 : 0;
+    }
+    if (!seen) {
+      recent.add(fingerprint(joke), date);
+      printed.push_back(joke);
+    }
+  }
+  cout << "Corpus of " << jokes.size() << " jokes: " << falsePositives << " new jokes taken for repeats ("
+       << 100.0 * falsePositives / jokes.size() << " %), " << caught << " of " << repeats << " repeats caught" << endl;
+  check(falsePositives == 0, "false-positive rate");
+  check(repeats > 0 && caught == repeats, "repeats caught");
+}
+
+int main() {
+  testFingerprint();
+  testRing();
+  testSaving();
+  testCorpus();
+
+  if (failures == 0) {
+    cout << "All recent joke tests passed" << endl;
+    return 0;
+  }
+  cout << failures << " recent joke test(s) failed" << endl;
+  return 1;
+}
@@ -0,0 +1,260 @@
+// Host test for the cooperative task scheduler, its event queue and the
+// retry backoff, on a simulated clock. The event queue is also run with a
+// real producer thread against a consumer to check nothing is lost or
+// reordered.
+//
+// Build & run from the repository root:
+//   g++ -std=c++17 -pthread -Ilib/task_scheduler tests/test_task_scheduler.cpp lib/task_scheduler/*.cpp -o test_task_scheduler
+//   ./test_task_scheduler
+
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "task_scheduler.h"
+#include "retry_backoff.h"
+
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool condition, const string &name) {
+  if (!condition) {
+    cout << "FAIL: " << name << endl;
+    failures++;
+  }
+}
+
+static uint32_t now = 0;
+static uint32_t fakeClock() { return now; }
+
+// What ran, as "name@time" or "name:type=value@time" for events
+static vector<string> trace;
+
+struct Recorder {
+  string name;
+  uint32_t cost;  // Simulated milliseconds per run
+};
+
+static void record(const TaskEvent *event, void *context) {
+  Recorder *recorder = static_cast<Recorder *>(context);
+  string entry = recorder->name;
+  if (event) {
+    entry += ":" + to_string(event->type) + "=" + to_string(event->value);
+  }
+  trace.push_back(entry + "@" + to_string(now));
+  now += recorder->cost;
+}
+
+static void runUntil(TaskScheduler &scheduler, uint32_t end, uint32_t step = 1) {
+  while ((int32_t)(end - now) > 0) {
+    scheduler.runOnce();
+    now += step;
+  }
+}
+
+static void testTimers() {
+  now = 0;
+  trace.clear();
+  TaskScheduler scheduler(fakeClock);
+  Recorder fast = {"fast", 0};
+  Recorder slow = {"slow", 0};
+  uint8_t a = scheduler.add("fast", record, &fast, 5);
+  uint8_t b = scheduler.add("slow", record, &slow, 5);
+  scheduler.every(a, 10);
+  scheduler.every(b, 25);
+  runUntil(scheduler, 51);
+  check(trace == vector<string>({"fast@10", "fast@20", "slow@25", "fast@30", "fast@40", "fast@50", "slow@50"}),
+        "periodic tasks run on time");
+
+  // One-shot and wake
+  trace.clear();
+  scheduler.stop(a);
+  scheduler.stop(b);
+  scheduler.after(a, 7);
+  scheduler.wake(b);
+  check(scheduler.idleMillis(100) == 0, "a woken task is due now");
+  runUntil(scheduler, 80);
+  check(trace == vector<string>({"slow@51", "fast@58"}), "one-shot timers run once");
+  check(scheduler.idleMillis(100) == 100, "idle until the limit with nothing armed");
+
+  // A sooner wake-up moves a periodic task's next run, a later one doesn't
+  trace.clear();
+  scheduler.every(a, 20);  // Due at 100
+  scheduler.after(a, 5);
+  scheduler.after(a, 50);
+  check(scheduler.idleMillis(100) == 5, "idle until the next timer");
+  runUntil(scheduler, 126);
+  check(trace == vector<string>({"fast@85", "fast@105", "fast@125"}), "period continues from the early run");
+}
+
+static void testEvents() {
+  now = 1000;
+  trace.clear();
+  TaskScheduler scheduler(fakeClock);
+  Recorder print = {"print", 0};
+  Recorder config = {"config", 0};
+  uint8_t p = scheduler.add("print", record, &print, 5);
+  uint8_t c = scheduler.add("config", record, &config, 5);
+  scheduler.every(p, 100);
+
+  check(scheduler.post(p, 1, 42) && scheduler.post(c, 2) && scheduler.post(p, 1, 43), "events are posted");
+  check(scheduler.idleMillis(100) == 0, "pending events end the idle time");
+  scheduler.runOnce();
+  check(trace == vector<string>({"print:1=42@1000", "config:2=0@1000", "print:1=43@1000"}),
+        "events run in the order posted");
+
+  // A full queue drops and counts; the rest is delivered over two passes
+  trace.clear();
+  int posted = 0;
+  for (uint32_t i = 0; i < SCHEDULER_EVENT_SLOTS + 3; i++) {
+    posted += scheduler.post(c, 3, i) ? 1 : 0;
+  }
+  check(posted == (int)SCHEDULER_EVENT_SLOTS && scheduler.eventsDropped() == 3, "a full queue drops events");
+  scheduler.post(NO_TASK, 0);  // Ignored
+  scheduler.runOnce();
+  scheduler.runOnce();
+  check(trace.size() == SCHEDULER_EVENT_SLOTS && trace.back() == "config:3=15@1000", "queued events arrive");
+}
+
+static void testBudgets() {
+  now = 0;
+  trace.clear();
+  TaskScheduler scheduler(fakeClock);
+  Recorder quick = {"quick", 2};
+  Recorder blocking = {"blocking", 40};
+  uint8_t q = scheduler.add("quick", record, &quick, 5);
+  uint8_t b = scheduler.add("blocking", record, &blocking, 20);
+  scheduler.every(q, 10);
+  scheduler.after(b, 30);
+  runUntil(scheduler, 100);
+
+  check(scheduler.stats(q).overruns == 0 && scheduler.stats(q).maxMillis == 2, "runs within budget");
+  check(scheduler.stats(b).runs == 1 && scheduler.stats(b).overruns == 1 && scheduler.stats(b).maxMillis == 40,
+        "an overrun is counted");
+  check(scheduler.maxPassMillis() == 42 && scheduler.maxLatencyMillis() == 43, "longest pass and loop latency");
+  check(string(scheduler.stats(b).name) == "blocking" && scheduler.tasks() == 2, "stats by task");
+
+  // The quick task didn't catch up on the periods the blocking one took:
+  // 10, 20, 30, then 73, 83, 93
+  int quickRuns = 0;
+  for (const string &entry : trace) {
+    quickRuns += entry.rfind("quick@", 0) == 0 ? 1 : 0;
+  }
+  check(quickRuns == 6, "missed periods are skipped");
+
+  scheduler.resetStats();
+  check(scheduler.maxPassMillis() == 0 && scheduler.stats(b).runs == 0, "stats reset");
+
+  // A task polling overBudget() stops at its budget
+  struct Chunked {
+    TaskScheduler *scheduler;
+    int chunks;
+  } chunked = {&scheduler, 0};
+  uint8_t w = scheduler.add("chunked", [](const TaskEvent *, void *context) {
+    Chunked *work = static_cast<Chunked *>(context);
+    while (!work->scheduler->overBudget() && work->chunks < 100) {
+      work->chunks++;
+      now += 3;
+    }
+  }, &chunked, 10);
+  scheduler.stop(q);
+  scheduler.wake(w);
+  scheduler.runOnce();
+  check(chunked.chunks == 4 && scheduler.stats(w).overruns == 1 && !scheduler.overBudget(),
+        "overBudget() lets work stop near the budget");
+
+  // No more slots
+  TaskScheduler full(fakeClock);
+  for (uint8_t i = 0; i < SCHEDULER_MAX_TASKS; i++) {
+    full.add("t", record, &quick, 1);
+  }
+  check(full.add("extra", record, &quick, 1) == NO_TASK, "task slots are limited");
+}
+
+// A producer thread posts as fast as it can; everything arrives in order
+static void testQueueThreads() {
+  SpscQueue<uint32_t, 8> queue;
+  const uint32_t count = 200000;
+  thread producer([&queue, count]() {
+    for (uint32_t i = 0; i < count; i++) {
+      while (!queue.push(i)) {
+        this_thread::yield();
+      }
+    }
+  });
+
+  bool ordered = true;
+  uint32_t expected = 0;
+  while (expected < count) {
+    uint32_t value;
+    if (queue.pop(value)) {
+      ordered = ordered && value == expected;
+      expected++;
+    } else {
+      this_thread::yield();
+    }
+  }
+  producer.join();
+  check(ordered && queue.empty(), "SPSC queue across threads loses and reorders nothing");
+}
+
+static uint32_t noJitter(uint32_t bound) { return bound / 2; }
+static uint32_t lowest(uint32_t) { return 0; }
+static uint32_t highest(uint32_t bound) { return bound - 1; }
+
+static void testBackoff() {
+  BackoffPolicy policy = {1000, 8000, 6, 60000, 0};
+  RetryBackoff backoff(policy, noJitter);
+  backoff.start(500);
+  vector<uint32_t> delays;
+  uint32_t time = 500;
+  uint32_t delay;
+  while ((delay = backoff.failed(time)) != BACKOFF_GIVE_UP) {
+    delays.push_back(delay);
+    time += delay;
+  }
+  check(delays == vector<uint32_t>({1000, 2000, 4000, 8000, 8000}) && backoff.attempts() == 6,
+        "delays double up to the limit, then attempts run out");
+
+  // Jitter spreads each delay by the percentage either way
+  BackoffPolicy jittered = {1000, 8000, 6, 60000, 20};
+  RetryBackoff low(jittered, lowest);
+  RetryBackoff high(jittered, highest);
+  low.start(0);
+  high.start(0);
+  check(low.failed(0) == 800 && high.failed(0) == 1200 && low.failed(0) == 1600 && high.failed(0) == 2400,
+        "jitter within the percentage");
+
+  // The deadline ends retries early, counting the time attempts took
+  BackoffPolicy deadline = {1000, 60000, 20, 10000, 0};
+  RetryBackoff limited(deadline, noJitter);
+  limited.start(0);
+  check(limited.failed(3000) == 1000 && limited.failed(6000) == 2000 && limited.remainingMillis(6000) == 4000,
+        "retries within the deadline");
+  check(limited.failed(9000) == BACKOFF_GIVE_UP && limited.remainingMillis(12000) == 0, "no attempt past the deadline");
+
+  // Across the millis() wrap
+  RetryBackoff wrapped(policy, noJitter);
+  wrapped.start(0xFFFFF000);
+  check(wrapped.failed(0xFFFFFF00) == 1000 && wrapped.failed(0x500) == 2000, "time wraps");
+
+  // Started over
+  limited.start(20000);
+  check(limited.attempts() == 0 && limited.failed(20000) == 1000, "start() resets");
+}
+
+int main() {
+  testTimers();
+  testEvents();
+  testBudgets();
+  testQueueThreads();
+  testBackoff();
+
+  if (failures == 0) {
+    cout << "All task scheduler tests passed" << endl;
+    return 0;
+  }
+  cout << failures << " task scheduler test(s) failed" << endl;
+  return 1;
+}